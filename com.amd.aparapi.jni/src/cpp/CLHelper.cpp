@@ -36,11 +36,25 @@
    and Securitys website at http://www.bis.doc.gov/. 
    */
 
-#define CLHELPER_SOURCE
 #include "CLHelper.h"
-#include "List.h"
+#include "ProgramCache.h"
+#include "Mutex.h"
 #include <map>
 
+#if !defined (_WIN32)
+#include <dlfcn.h>
+#endif
+
+// looked up as the library loads, libOpenCL is loaded by then as we link against it
+const CLHelper::CreateSubDevices CLHelper::createSubDevices = 
+   (CLHelper::CreateSubDevices)CLHelper::getEntryPoint("clCreateSubDevices");
+const CLHelper::ReleaseDevice CLHelper::releaseDevice = 
+   (CLHelper::ReleaseDevice)CLHelper::getEntryPoint("clReleaseDevice");
+const CLHelper::EnqueueFillBuffer CLHelper::enqueueFillBuffer = 
+   (CLHelper::EnqueueFillBuffer)CLHelper::getEntryPoint("clEnqueueFillBuffer");
+const CLHelper::EnqueueMarkerWithWaitList CLHelper::enqueueMarkerWithWaitList = 
+   (CLHelper::EnqueueMarkerWithWaitList)CLHelper::getEntryPoint("clEnqueueMarkerWithWaitList");
+
 void setMap(std::map<cl_int, const char*>& errorMap) {
    errorMap[CL_SUCCESS]                         = "success";
    errorMap[CL_DEVICE_NOT_FOUND]                = "device not found";
@@ -92,15 +106,23 @@ void setMap(std::map<cl_int, const char*>& errorMap) {
    errorMap[0]                                  = NULL;
 }
 
+// filled on first use, read only after that
+static Mutex errorMapLock;
+static std::map<cl_int,const char*> errorMap;
+static volatile bool mapSet = false;
+
 const char *CLHelper::errString(cl_int status) {
-   static bool mapSet = false;
-   static std::map<cl_int,const char*> errorMap;
    if(!mapSet) {
-      setMap(errorMap);
-      mapSet = true;
+      ScopedLock lock(errorMapLock);
+      if(!mapSet) {
+         setMap(errorMap);
+         memoryBarrier();
+         mapSet = true;
+      }
    }
-   if(errorMap.find(status) != errorMap.end()) {
-      return errorMap[status];
+   std::map<cl_int,const char*>::const_iterator found = errorMap.find(status);
+   if(found != errorMap.end()) {
+      return found->second;
    }
 
    //if we don't know what the error is
@@ -131,13 +153,22 @@ void CLHelper::getBuildErr(JNIEnv *jenv, cl_device_id deviceId,  cl_program prog
 
 cl_program CLHelper::compile(JNIEnv *jenv, cl_context context, size_t deviceCount, cl_device_id* deviceIds, jstring source, jstring* log, cl_int* status){
    const char *sourceChars = jenv->GetStringUTFChars(source, NULL);
-   size_t sourceSize[] = { strlen(sourceChars) };
-   cl_program program = clCreateProgramWithSource(context, 1, &sourceChars, sourceSize, status); 
-   jenv->ReleaseStringUTFChars(source, sourceChars);
-   *status = clBuildProgram(program, deviceCount, deviceIds, NULL, NULL, NULL);
-   if(*status == CL_BUILD_PROGRAM_FAILURE) {
-      getBuildErr(jenv, *deviceIds, program, log);
+   cl_program program = ProgramCache::load(context, deviceCount, deviceIds, sourceChars, NULL);
+   if (program != NULL) {
+      *status = CL_SUCCESS;
+   } else {
+      jlong buildStart = ProgramCache::nanoTime();
+      size_t sourceSize[] = { strlen(sourceChars) };
+      program = clCreateProgramWithSource(context, 1, &sourceChars, sourceSize, status); 
+      *status = clBuildProgram(program, deviceCount, deviceIds, NULL, NULL, NULL);
+      atomicAdd(&ProgramCache::buildNanos, ProgramCache::nanoTime() - buildStart);
+      if(*status == CL_BUILD_PROGRAM_FAILURE) {
+         getBuildErr(jenv, *deviceIds, program, log);
+      } else if (*status == CL_SUCCESS) {
+         ProgramCache::store(program, deviceCount, deviceIds, sourceChars, NULL);
+      }
    }
+   jenv->ReleaseStringUTFChars(source, sourceChars);
    return(program);
 }
 
@@ -156,4 +187,24 @@ jstring CLHelper::getExtensions(JNIEnv *jenv, cl_device_id deviceId, cl_int *sta
    return jextensions;
 }
 
+jint CLHelper::getVersion(cl_device_id deviceId){
+   char version[128] = "";
+   int major = 1;
+   int minor = 0;
+   if (clGetDeviceInfo(deviceId, CL_DEVICE_VERSION, sizeof(version), version, NULL) != CL_SUCCESS
+         || sscanf(version, "OpenCL %d.%d", &major, &minor) != 2) {
+      return(10);
+   }
+   return((jint)(major * 10 + minor));
+}
+
+void* CLHelper::getEntryPoint(const char* name){
+#if defined (_WIN32)
+   HMODULE openCL = GetModuleHandleA("OpenCL.dll");
+   return((openCL != NULL) ? (void*)GetProcAddress(openCL, name) : NULL);
+#else
+   return(dlsym(RTLD_DEFAULT, name));
+#endif
+}
+
 
@@ -41,12 +41,46 @@
 
 #include "Common.h"
 
+// OpenCL 1.2 values, so the 1.2 entry points below can be used when building against 1.1 headers
+#ifndef CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN
+#define CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN 0x1088
+#define CL_DEVICE_AFFINITY_DOMAIN_NUMA (1 << 0)
+#endif
+#ifndef CL_MAP_WRITE_INVALIDATE_REGION
+#define CL_MAP_WRITE_INVALIDATE_REGION (1 << 2)
+#endif
+
 class CLHelper{
    public:
    static const char *errString(cl_int status);
    static void getBuildErr(JNIEnv *jenv, cl_device_id deviceId, cl_program program, jstring *log);
    static cl_program compile(JNIEnv *jenv, cl_context context, size_t deviceCount, cl_device_id* deviceId, jstring source, jstring* log, cl_int *status);
    static jstring getExtensions(JNIEnv *jenv, cl_device_id deviceId, cl_int *status);
+
+   /**
+    * @return the OpenCL version of the device as major * 10 + minor, 10 if it can't be read
+    */
+   static jint getVersion(cl_device_id deviceId);
+
+   /**
+    * @return a function exported by the OpenCL library we were loaded against, NULL if it has no such function
+    */
+   static void* getEntryPoint(const char* name);
+
+   // OpenCL 1.2 entry points. These are found at runtime rather than linked, so a library built against 1.2 headers
+   // still loads on a 1.1 runtime (see enqueueMarker in Aparapi.cpp). Each is NULL if the runtime lacks it.
+   typedef cl_int (CL_API_CALL *CreateSubDevices)(cl_device_id device, const intptr_t* properties, cl_uint numDevices, 
+         cl_device_id* devices, cl_uint* numDevicesReturned);
+   typedef cl_int (CL_API_CALL *ReleaseDevice)(cl_device_id device);
+   typedef cl_int (CL_API_CALL *EnqueueFillBuffer)(cl_command_queue queue, cl_mem buffer, const void* pattern, size_t patternSize,
+         size_t offset, size_t size, cl_uint numEvents, const cl_event* waitList, cl_event* event);
+   typedef cl_int (CL_API_CALL *EnqueueMarkerWithWaitList)(cl_command_queue queue, cl_uint numEvents, const cl_event* waitList, 
+         cl_event* event);
+
+   static const CreateSubDevices createSubDevices;
+   static const ReleaseDevice releaseDevice;
+   static const EnqueueFillBuffer enqueueFillBuffer;
+   static const EnqueueMarkerWithWaitList enqueueMarkerWithWaitList;
 };
 
 #endif // CLHELPER_H
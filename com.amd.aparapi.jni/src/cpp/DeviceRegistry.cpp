@@ -0,0 +1,352 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#define DEVICEREGISTRY_SOURCE
+#include "DeviceRegistry.h"
+#include "CLHelper.h"
+#include "Config.h"
+#include "Mutex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct PooledQueue {
+   cl_command_queue queue;
+   cl_command_queue_properties properties;
+};
+
+struct DeviceEntry {
+   cl_context context;
+   jint references;
+   std::vector<PooledQueue> idleQueues;
+};
+
+struct QueueEntry {
+   cl_context context;
+   cl_device_id deviceId;
+   cl_command_queue_properties properties;
+};
+
+struct ProgramEntry {
+   cl_program program;
+   cl_context context;
+   jint references;
+   jlong lastUse;
+};
+
+// idle queues kept per device, beyond this they are released
+static const size_t MAX_IDLE_QUEUES = 8;
+
+// the registry is used from every kernel thread so all of its state is guarded by one lock, which is never held 
+// whilst compiling
+static Mutex registryLock;
+static std::map<cl_device_id, DeviceEntry> devices;
+static std::map<cl_command_queue, QueueEntry> busyQueues;
+static std::map<std::string, ProgramEntry> programs;
+static std::map<cl_program, std::string> programKeys;
+// programs still referenced when their context was released, released with their last reference
+static std::map<cl_program, jint> orphanedPrograms;
+static jlong programClock = 0;
+static jlong contextsCreated = 0;
+static jlong programsCreated = 0;
+
+/**
+ * @return the device whose shared context this is, devices.end() for contexts the registry did not create.
+ * Must be called with the lock held.
+ */
+static std::map<cl_device_id, DeviceEntry>::iterator findContext(cl_context context) {
+   std::map<cl_device_id, DeviceEntry>::iterator i = devices.begin();
+   while (i != devices.end() && i->second.context != context) {
+      i++;
+   }
+   return i;
+}
+
+/**
+ * @return the context of the device, created on first use
+ */
+cl_context DeviceRegistry::acquireContext(cl_device_id deviceId, cl_int* status) {
+   ScopedLock lock(registryLock);
+   *status = CL_SUCCESS;
+   std::map<cl_device_id, DeviceEntry>::iterator found = devices.find(deviceId);
+   if (found != devices.end()) {
+      found->second.references++;
+      return found->second.context;
+   }
+
+   cl_platform_id platformId = NULL;
+   clGetDeviceInfo(deviceId, CL_DEVICE_PLATFORM, sizeof(platformId), &platformId, NULL);
+   cl_context_properties cps[3] = { CL_CONTEXT_PLATFORM, (cl_context_properties)platformId, 0 };
+   cl_context_properties* cprops = (NULL == platformId) ? NULL : cps;
+   cl_context context = clCreateContext(cprops, 1, &deviceId, NULL, NULL, status);
+   if (*status != CL_SUCCESS) {
+      return (cl_context)0;
+   }
+
+   DeviceEntry entry;
+   entry.context = context;
+   entry.references = 1;
+   devices[deviceId] = entry;
+   contextsCreated++;
+   if (config != NULL && config->isVerbose()) {
+      fprintf(stderr, "created shared context %p for device %p\n", context, deviceId);
+   }
+   return context;
+}
+
+/**
+ * drop a reference to a context. With the last reference the context, its idle queues and its unreferenced 
+ * programs are released, programs still in use are released with their last reference.
+ */
+void DeviceRegistry::releaseContext(cl_context context) {
+   std::vector<PooledQueue> idleQueues;
+   std::vector<cl_program> unusedPrograms;
+   {
+      ScopedLock lock(registryLock);
+      std::map<cl_device_id, DeviceEntry>::iterator found = findContext(context);
+      if (found != devices.end()) {
+         if (--found->second.references > 0) {
+            return;
+         }
+         idleQueues = found->second.idleQueues;
+         devices.erase(found);
+         // a later context may reuse the address, so none of these programs may be found by key again
+         std::map<std::string, ProgramEntry>::iterator i = programs.begin();
+         while (i != programs.end()) {
+            if (i->second.context == context) {
+               if (i->second.references == 0) {
+                  unusedPrograms.push_back(i->second.program);
+               } else {
+                  orphanedPrograms[i->second.program] = i->second.references;
+               }
+               programKeys.erase(i->second.program);
+               programs.erase(i++);
+            } else {
+               i++;
+            }
+         }
+         if (config != NULL && config->isVerbose()) {
+            fprintf(stderr, "released shared context %p\n", context);
+         }
+      }
+   }
+   for (size_t i = 0; i < idleQueues.size(); i++) {
+      clReleaseCommandQueue(idleQueues[i].queue);
+   }
+   for (size_t i = 0; i < unusedPrograms.size(); i++) {
+      clReleaseProgram(unusedPrograms[i]);
+   }
+   // queues and programs still in use hold their own reference to the context
+   clReleaseContext(context);
+}
+
+/**
+ * @return an idle queue of the device with these properties, created if none is idle
+ */
+cl_command_queue DeviceRegistry::acquireQueue(cl_context context, cl_device_id deviceId, cl_command_queue_properties properties, cl_int* status) {
+   {
+      ScopedLock lock(registryLock);
+      std::map<cl_device_id, DeviceEntry>::iterator found = devices.find(deviceId);
+      if (found != devices.end() && found->second.context == context) {
+         std::vector<PooledQueue>& idleQueues = found->second.idleQueues;
+         for (size_t i = 0; i < idleQueues.size(); i++) {
+            if (idleQueues[i].properties == properties) {
+               cl_command_queue queue = idleQueues[i].queue;
+               idleQueues.erase(idleQueues.begin() + i);
+               QueueEntry entry = { context, deviceId, properties };
+               busyQueues[queue] = entry;
+               *status = CL_SUCCESS;
+               return queue;
+            }
+         }
+      }
+   }
+
+   cl_command_queue queue = clCreateCommandQueue(context, deviceId, properties, status);
+   if (*status == CL_SUCCESS) {
+      ScopedLock lock(registryLock);
+      std::map<cl_device_id, DeviceEntry>::iterator found = devices.find(deviceId);
+      if (found != devices.end() && found->second.context == context) {
+         QueueEntry entry = { context, deviceId, properties };
+         busyQueues[queue] = entry;
+      }
+   }
+   return queue;
+}
+
+/**
+ * return a queue to the idle pool of its device once everything enqueued on it has completed
+ */
+void DeviceRegistry::releaseQueue(cl_command_queue queue) {
+   clFinish(queue);
+   {
+      ScopedLock lock(registryLock);
+      std::map<cl_command_queue, QueueEntry>::iterator found = busyQueues.find(queue);
+      if (found != busyQueues.end()) {
+         // only pooled whilst the context it belongs to is still shared
+         std::map<cl_device_id, DeviceEntry>::iterator device = devices.find(found->second.deviceId);
+         bool pooled = device != devices.end() && device->second.context == found->second.context
+            && device->second.idleQueues.size() < MAX_IDLE_QUEUES;
+         if (pooled) {
+            PooledQueue idle = { queue, found->second.properties };
+            device->second.idleQueues.push_back(idle);
+         }
+         busyQueues.erase(found);
+         if (pooled) {
+            return;
+         }
+      }
+   }
+   clReleaseCommandQueue(queue);
+}
+
+/**
+ * release unreferenced programs, least recently used first, until at most maxCachedPrograms are cached.
+ * Must be called with the lock held.
+ */
+static void evictPrograms() {
+   size_t capacity = (config == NULL) ? 64 : (size_t)config->getMaxCachedPrograms();
+   while (programs.size() > capacity) {
+      std::map<std::string, ProgramEntry>::iterator victim = programs.end();
+      for (std::map<std::string, ProgramEntry>::iterator i = programs.begin(); i != programs.end(); i++) {
+         if (i->second.references == 0 && (victim == programs.end() || i->second.lastUse < victim->second.lastUse)) {
+            victim = i;
+         }
+      }
+      if (victim == programs.end()) {
+         // everything cached is in use
+         return;
+      }
+      if (config != NULL && config->isVerbose()) {
+         fprintf(stderr, "evicting cached program %p\n", victim->second.program);
+      }
+      clReleaseProgram(victim->second.program);
+      programKeys.erase(victim->second.program);
+      programs.erase(victim);
+   }
+}
+
+/**
+ * @return the program built from source for the device in this context, built (or loaded from the binary cache) 
+ * on a miss. Programs which fail to build are returned but not cached.
+ */
+cl_program DeviceRegistry::acquireProgram(JNIEnv *jenv, cl_context context, cl_device_id deviceId, jstring source, jstring* log, cl_int* status) {
+   const char* sourceChars = jenv->GetStringUTFChars(source, NULL);
+   // a program can only be used in the context it was built in
+   char owner[64];
+   sprintf(owner, "%p %p\n", context, deviceId);
+   std::string key = std::string(owner) + sourceChars;
+   jenv->ReleaseStringUTFChars(source, sourceChars);
+
+   {
+      ScopedLock lock(registryLock);
+      std::map<std::string, ProgramEntry>::iterator found = programs.find(key);
+      if (found != programs.end()) {
+         found->second.references++;
+         found->second.lastUse = ++programClock;
+         *status = CL_SUCCESS;
+         return found->second.program;
+      }
+   }
+
+   cl_program program = CLHelper::compile(jenv, context, 1, &deviceId, source, log, status);
+   if (*status != CL_SUCCESS) {
+      return program;
+   }
+
+   ScopedLock lock(registryLock);
+   programsCreated++;
+   if (findContext(context) == devices.end()) {
+      // not a shared context, so no other kernel can use the program
+      return program;
+   }
+   std::map<std::string, ProgramEntry>::iterator found = programs.find(key);
+   if (found != programs.end()) {
+      // another thread built it whilst we were
+      clReleaseProgram(program);
+      found->second.references++;
+      found->second.lastUse = ++programClock;
+      return found->second.program;
+   }
+   ProgramEntry entry = { program, context, 1, ++programClock };
+   programs[key] = entry;
+   programKeys[program] = key;
+   evictPrograms();
+   return program;
+}
+
+/**
+ * drop a reference to a program, cached programs stay built until they are evicted
+ */
+void DeviceRegistry::releaseProgram(cl_program program) {
+   {
+      ScopedLock lock(registryLock);
+      std::map<cl_program, std::string>::iterator found = programKeys.find(program);
+      if (found != programKeys.end()) {
+         programs[found->second].references--;
+         evictPrograms();
+         return;
+      }
+      std::map<cl_program, jint>::iterator orphan = orphanedPrograms.find(program);
+      if (orphan != orphanedPrograms.end()) {
+         if (--orphan->second > 0) {
+            return;
+         }
+         orphanedPrograms.erase(orphan);
+      }
+   }
+   clReleaseProgram(program);
+}
+
+/**
+ * @return {live shared contexts, cached programs, shared contexts created, programs created}
+ */
+jlongArray DeviceRegistry::getCounters(JNIEnv *jenv) {
+   jlong counters[4];
+   {
+      ScopedLock lock(registryLock);
+      counters[0] = (jlong)devices.size();
+      counters[1] = (jlong)programs.size();
+      counters[2] = contextsCreated;
+      counters[3] = programsCreated;
+   }
+   jlongArray array = jenv->NewLongArray(4);
+   jenv->SetLongArrayRegion(array, 0, 4, counters);
+   return array;
+}
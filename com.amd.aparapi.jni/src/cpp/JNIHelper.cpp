@@ -174,3 +174,22 @@ jobject JNIHelper::createInstance(JNIEnv *jenv, const char* className, const cha
    }
    return(instance);
 } 
+
+JNIEnv* JNIHelper::attachCurrentThread(JavaVM *jvm, bool& attached){
+   JNIEnv *jenv = NULL;
+   attached = false;
+   if (jvm->GetEnv((void **)&jenv, JNI_VERSION_1_6) != JNI_OK){
+      if (jvm->AttachCurrentThreadAsDaemon((void **)&jenv, NULL) != JNI_OK){
+         fprintf(stderr, "bummer! failed to attach callback thread to the jvm\n");
+         return(NULL);
+      }
+      attached = true;
+   }
+   return(jenv);
+}
+
+void JNIHelper::detachCurrentThread(JavaVM *jvm, bool attached){
+   if (attached){
+      jvm->DetachCurrentThread();
+   }
+}
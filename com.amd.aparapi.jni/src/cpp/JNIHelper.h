@@ -164,6 +164,21 @@ class JNIHelper {
 
       static jobject getStaticFieldObject(JNIEnv *jenv, const char *className, const char *fieldName, const char *signature);
 
+      /**
+       * Get the JNIEnv for the calling thread, attaching it to the jvm as a daemon if needed.
+       * OpenCL event callbacks run on driver threads which the jvm does not know about.
+       *
+       * @param jvm the jvm to attach to
+       * @param attached out: true if this call attached the thread, pass it on to detachCurrentThread
+       * @return the JNIEnv for the calling thread or NULL if it could not be attached
+       */
+      static JNIEnv* attachCurrentThread(JavaVM *jvm, bool& attached);
+
+      /**
+       * Detach the calling thread if it was attached by attachCurrentThread.
+       */
+      static void detachCurrentThread(JavaVM *jvm, bool attached);
+
       static const char *getType(jint value) {
          return "int";
       }
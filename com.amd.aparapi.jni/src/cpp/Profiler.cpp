@@ -0,0 +1,312 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+#include "Profiler.h"
+#include "Config.h"
+#include "Mutex.h"
+
+#if defined (_WIN32)
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+static const char PROFILE_MAGIC[8] = { 'A', 'P', 'A', 'R', 'P', 'R', 'O', 'F' };
+static const jint BYTE_ORDER_MARK = 0x01020304;  // lets the reader tell the byte order of the records
+static const jint DRAIN_MILLIS = 20;
+
+/**
+ * A ring entry, sequence is its position once free to fill, position + 1 once filled and position + RING_SIZE 
+ * once drained (the next position it will be filled for).
+ */
+struct ProfileSlot {
+   volatile jlong sequence;
+   ProfileRecord record;
+};
+
+static Mutex profilerLock;                 // taken by init and whoever drains the ring, never by record
+static volatile bool initialized = false;
+static ProfileSlot* volatile ring = NULL;  // NULL unless a profile file is being written
+static volatile jlong head = 0;            // the next position to fill
+static jlong tail = 0;                     // the next position to drain, guarded by profilerLock
+static volatile jlong dropped = 0;
+static FILE* file = NULL;
+
+static void copyName(char* to, size_t size, const char* from) {
+   strncpy(to, (from != NULL) ? from : "", size - 1);
+   to[size - 1] = '\0';
+}
+
+/**
+ * the type of an event recorded without one, from its command
+ */
+static jint commandType(cl_event event) {
+   cl_command_type command = 0;
+   clGetEventInfo(event, CL_EVENT_COMMAND_TYPE, sizeof(command), &command, NULL);
+   switch (command) {
+      case CL_COMMAND_NDRANGE_KERNEL:
+      case CL_COMMAND_TASK:
+         return(Profiler::EXECUTE);
+      case CL_COMMAND_WRITE_BUFFER:
+      case CL_COMMAND_UNMAP_MEM_OBJECT:
+         return(Profiler::WRITE);
+      case CL_COMMAND_READ_BUFFER:
+      case CL_COMMAND_MAP_BUFFER:
+         return(Profiler::READ);
+   }
+   return(Profiler::UNKNOWN);
+}
+
+/**
+ * write every filled record to the file in order, called with profilerLock held
+ */
+static void drain() {
+   while (true) {
+      ProfileSlot* slot = &ring[tail & (Profiler::RING_SIZE - 1)];
+      if (slot->sequence != tail + 1) {
+         break;
+      }
+      memoryBarrier();
+      fwrite(&slot->record, sizeof(ProfileRecord), 1, file);
+      memoryBarrier();
+      slot->sequence = tail + Profiler::RING_SIZE;
+      tail++;
+   }
+}
+
+/**
+ * claim the slot at head, unless the drain has not caught up with it yet
+ *
+ * @return the slot to fill and publish as position + 1, NULL if the ring is full
+ */
+static ProfileSlot* claim(ProfileSlot* slots, jlong& position) {
+   position = head;
+   while (true) {
+      ProfileSlot* slot = &slots[position & (Profiler::RING_SIZE - 1)];
+      jlong difference = slot->sequence - position;
+      if (difference == 0) {
+         if (atomicCompareAndSwap(&head, position, position + 1)) {
+            return(slot);
+         }
+         position = head;
+      } else if (difference < 0) {
+         atomicAdd(&dropped, 1);
+         return(NULL);
+      } else {
+         position = head;
+      }
+   }
+}
+
+#if defined (_WIN32)
+static unsigned __stdcall drainMain(void*) {
+#else
+static void* drainMain(void*) {
+#endif
+   while (true) {
+#if defined (_WIN32)
+      Sleep(DRAIN_MILLIS);
+#else
+      usleep(DRAIN_MILLIS * 1000);
+#endif
+      Profiler::flush();
+   }
+   return 0;
+}
+
+static void flushAtExit() {
+   Profiler::flush();
+   if (dropped > 0) {
+      fprintf(stderr, "profiler dropped %ld events whilst its ring was full\n", (long)dropped);
+   }
+}
+
+/**
+ * open the profile file and start draining the ring to it if one is configured. Only the first call does anything,
+ * config must already have been created.
+ */
+void Profiler::init() {
+   if (initialized) {
+      return;
+   }
+   ScopedLock lock(profilerLock);
+   if (initialized) {
+      return;
+   }
+   const char* path = config->getProfileFile();
+   if (path != NULL) {
+      file = fopen(path, "wb");
+      if (file == NULL) {
+         fprintf(stderr, "could not open profile file %s, events are not recorded\n", path);
+      } else {
+         jint recordSize = sizeof(ProfileRecord);
+         fwrite(PROFILE_MAGIC, sizeof(PROFILE_MAGIC), 1, file);
+         fwrite(&BYTE_ORDER_MARK, sizeof(BYTE_ORDER_MARK), 1, file);
+         fwrite(&recordSize, sizeof(recordSize), 1, file);
+
+         ProfileSlot* slots = new ProfileSlot[RING_SIZE];
+         for (jint i = 0; i < RING_SIZE; i++) {
+            slots[i].sequence = i;
+         }
+         memoryBarrier();
+         ring = slots;
+#if defined (_WIN32)
+         HANDLE thread = (HANDLE)_beginthreadex(NULL, 0, drainMain, NULL, 0, NULL);
+         if (thread != 0) {
+            CloseHandle(thread);
+         }
+#else
+         pthread_t thread;
+         if (pthread_create(&thread, NULL, drainMain, NULL) == 0) {
+            pthread_detach(thread);
+         }
+#endif
+         atexit(flushAtExit);
+         if (config->isVerbose()) {
+            fprintf(stderr, "recording profile to %s\n", path);
+         }
+      }
+   }
+   memoryBarrier();
+   initialized = true;
+}
+
+bool Profiler::isEnabled() {
+   return(ring != NULL);
+}
+
+/**
+ * put the timestamps of a completed event in the ring. Never blocks, the event is dropped if the ring is full or 
+ * carries no profiling info.
+ *
+ * @param type READ, EXECUTE or WRITE, UNKNOWN to take it from the command of the event
+ */
+void Profiler::record(cl_event event, jint type, const char* name, const char* kernel, const void* context, jint pass, jlong run,
+      jint sampleInterval) {
+   ProfileSlot* slots = ring;
+   if (slots == NULL || event == NULL) {
+      return;
+   }
+   cl_ulong queued = 0;
+   cl_ulong submit = 0;
+   cl_ulong start = 0;
+   cl_ulong end = 0;
+   if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, NULL) != CL_SUCCESS
+         || clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(submit), &submit, NULL) != CL_SUCCESS
+         || clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL) != CL_SUCCESS
+         || clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL) != CL_SUCCESS) {
+      return;
+   }
+   cl_command_queue queue = NULL;
+   clGetEventInfo(event, CL_EVENT_COMMAND_QUEUE, sizeof(queue), &queue, NULL);
+
+   jlong position = 0;
+   ProfileSlot* slot = claim(slots, position);
+   if (slot == NULL) {
+      return;
+   }
+
+   ProfileRecord* record = &slot->record;
+   record->context = (jlong)context;
+   record->queue = (jlong)queue;
+   record->run = run;
+   record->queued = (jlong)queued;
+   record->submit = (jlong)submit;
+   record->start = (jlong)start;
+   record->end = (jlong)end;
+   record->type = (type == UNKNOWN) ? commandType(event) : type;
+   record->pass = pass;
+   copyName(record->name, sizeof(record->name), name);
+   copyName(record->kernel, sizeof(record->kernel), kernel);
+   record->sampleInterval = sampleInterval;
+   record->reserved = 0;
+   memoryBarrier();
+   slot->sequence = position + 1;
+}
+
+/**
+ * put a host phase in the ring, its times already mapped onto the device clock
+ */
+void Profiler::recordHost(const char* name, jlong start, jlong end, const char* kernel, const void* context, jlong run,
+      jint sampleInterval) {
+   ProfileSlot* slots = ring;
+   if (slots == NULL) {
+      return;
+   }
+   jlong position = 0;
+   ProfileSlot* slot = claim(slots, position);
+   if (slot == NULL) {
+      return;
+   }
+
+   ProfileRecord* record = &slot->record;
+   record->context = (jlong)context;
+   record->queue = 0;
+   record->run = run;
+   record->queued = start;
+   record->submit = start;
+   record->start = start;
+   record->end = end;
+   record->type = HOST;
+   record->pass = 0;
+   copyName(record->name, sizeof(record->name), name);
+   copyName(record->kernel, sizeof(record->kernel), kernel);
+   record->sampleInterval = sampleInterval;
+   record->reserved = 0;
+   memoryBarrier();
+   slot->sequence = position + 1;
+}
+
+/**
+ * write out everything recorded so far
+ */
+void Profiler::flush() {
+   if (ring == NULL) {
+      return;
+   }
+   ScopedLock lock(profilerLock);
+   drain();
+   fflush(file);
+}
+
+/**
+ * @return the events which found the ring full
+ */
+jlong Profiler::getDropped() {
+   return(dropped);
+}
@@ -0,0 +1,89 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Common.h"
+
+/**
+ * One event as written to the profile file. The layout is fixed (256 bytes, native byte order) and is read by 
+ * com.amd.aparapi.internal.tool.ProfileTraceConverter, keep the two in step.
+ */
+struct ProfileRecord {
+   jlong context;       // the JNIContext or program which enqueued the event
+   jlong queue;         // the cl_command_queue it ran on, 0 for a host phase
+   jlong run;           // the execution of the context it belongs to
+   jlong queued;        // device timestamps, nanoseconds. Host phases are mapped onto the device clock
+   jlong submit;
+   jlong start;
+   jlong end;
+   jint type;           // as ProfileInfo, 0 read, 1 execute, 2 write, 3 host phase
+   jint pass;
+   char name[64];       // arg name, device name for a NUMA node execute or the phase of a host phase
+   char kernel[120];    // kernel class or OpenCL kernel name
+   jint sampleInterval; // the run was profiled as one in this many, 1 unless profiling is sampled
+   jint reserved;
+};
+
+/**
+ * Records the write, execute and read events of every kernel to the file named by -Dcom.amd.aparapi.profileFile,
+ * along with the host phases of each run.
+ *
+ * Events are put in a fixed size ring by the threads which release them, without locking, and written out by a 
+ * background thread. Events recorded whilst the ring is full are dropped and counted rather than waiting.
+ */
+class Profiler{
+   public:
+   static const jint READ = 0;
+   static const jint EXECUTE = 1;
+   static const jint WRITE = 2;
+   static const jint HOST = 3;
+   static const jint UNKNOWN = -1;     // take the type from the command of the event
+   static const jint RING_SIZE = 1 << 14;
+
+   static void init();
+   static bool isEnabled();
+   static void record(cl_event event, jint type, const char* name, const char* kernel, const void* context, jint pass, jlong run,
+         jint sampleInterval = 1);
+   static void recordHost(const char* name, jlong start, jlong end, const char* kernel, const void* context, jlong run,
+         jint sampleInterval = 1);
+   static void flush();
+   static jlong getDropped();
+};
+
+#endif // PROFILER_H
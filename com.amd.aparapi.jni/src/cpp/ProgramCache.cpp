@@ -0,0 +1,338 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#define PROGRAMCACHE_SOURCE
+#include "ProgramCache.h"
+#include "Config.h"
+#include "Mutex.h"
+
+#include <string>
+
+#if defined (_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/time.h>
+#endif
+
+jlong ProgramCache::hits = 0;
+jlong ProgramCache::misses = 0;
+jlong ProgramCache::stores = 0;
+jlong ProgramCache::invalidBinaries = 0;
+jlong ProgramCache::buildNanos = 0;
+jlong ProgramCache::loadNanos = 0;
+
+static const char CACHE_MAGIC[8] = { 'A', 'P', 'A', 'R', 'B', 'I', 'N', '2' };
+
+jlong ProgramCache::nanoTime() {
+#if defined (_WIN32)
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return (jlong)((counter.QuadPart * 1000000000.0) / frequency.QuadPart);
+#else
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return ((jlong)tv.tv_sec * 1000000000L) + ((jlong)tv.tv_usec * 1000L);
+#endif
+}
+
+/**
+ * FNV-1a over a nul terminated string (including the terminator so adjacent strings can't alias)
+ */
+static unsigned long long hashString(unsigned long long hash, const char* str) {
+   const unsigned char* bytes = (const unsigned char*)(str == NULL ? "" : str);
+   do {
+      hash ^= *bytes;
+      hash *= 1099511628211ULL;
+   } while (*bytes++ != '\0');
+   return hash;
+}
+
+unsigned long long ProgramCache::hash(const char* str) {
+   return hashString(14695981039346656037ULL, str);
+}
+
+static void appendDeviceInfo(std::string& key, cl_device_id deviceId, cl_device_info param) {
+   char value[1024] = "";
+   clGetDeviceInfo(deviceId, param, sizeof(value) - 1, value, NULL);
+   key.append(value, strlen(value) + 1);
+}
+
+static void appendPlatformInfo(std::string& key, cl_platform_id platformId, cl_platform_info param) {
+   char value[1024] = "";
+   clGetPlatformInfo(platformId, param, sizeof(value) - 1, value, NULL);
+   key.append(value, strlen(value) + 1);
+}
+
+/**
+ * everything that identifies a program binary, nul separated: the build options, the name, driver and platform 
+ * of each device, then the source. The whole key is stored in the entry and compared on load, its hash only 
+ * names the file, so colliding programs miss rather than load each other's binaries.
+ */
+static std::string cacheKey(size_t deviceCount, cl_device_id* deviceIds, const char* source, const char* options) {
+   std::string key;
+   key.append(options == NULL ? "" : options);
+   key.push_back('\0');
+   for (size_t i = 0; i < deviceCount; i++) {
+      cl_platform_id platformId = NULL;
+      clGetDeviceInfo(deviceIds[i], CL_DEVICE_PLATFORM, sizeof(platformId), &platformId, NULL);
+      appendDeviceInfo(key, deviceIds[i], CL_DEVICE_NAME);
+      appendDeviceInfo(key, deviceIds[i], CL_DRIVER_VERSION);
+      appendDeviceInfo(key, deviceIds[i], CL_DEVICE_VERSION);
+      appendPlatformInfo(key, platformId, CL_PLATFORM_NAME);
+      appendPlatformInfo(key, platformId, CL_PLATFORM_VERSION);
+   }
+   key.append(source);
+   return key;
+}
+
+/**
+ * the path of the cache entry for this key, NULL if the cache is disabled
+ */
+static char* cachePath(const std::string& key) {
+   if (config == NULL || config->getProgramCacheDir() == NULL) {
+      return NULL;
+   }
+
+   unsigned long long hash = 14695981039346656037ULL;
+   for (size_t i = 0; i < key.size(); i++) {
+      hash ^= (unsigned char)key[i];
+      hash *= 1099511628211ULL;
+   }
+
+   const char* dir = config->getProgramCacheDir();
+   char* path = new char[strlen(dir) + 64];
+   sprintf(path, "%s/%016llx.bin", dir, hash);
+   return path;
+}
+
+/**
+ * @return true if the next bytes of file are the length of key followed by key itself
+ */
+static bool readKey(FILE* file, const std::string& key) {
+   unsigned long long keyLength = 0;
+   if (fread(&keyLength, sizeof(keyLength), 1, file) != 1 || keyLength != key.size()) {
+      return false;
+   }
+   char* stored = new char[key.size()];
+   bool same = fread(stored, key.size(), 1, file) == 1 && memcmp(stored, key.data(), key.size()) == 0;
+   delete[] stored;
+   return same;
+}
+
+/**
+ * create a program from the cached binaries of source for each device, NULL on a miss or if the cache is disabled.
+ * Binaries the platform rejects (CL_INVALID_BINARY) or which fail to build are treated as a miss, the caller 
+ * builds from source and the entry is replaced.
+ */
+cl_program ProgramCache::load(cl_context context, size_t deviceCount, cl_device_id* deviceIds, const char* source, const char* options) {
+   if (config == NULL || config->getProgramCacheDir() == NULL) {
+      return NULL;
+   }
+   std::string key = cacheKey(deviceCount, deviceIds, source, options);
+   char* path = cachePath(key);
+
+   jlong loadStart = nanoTime();
+   cl_program program = NULL;
+   size_t* lengths = new size_t[deviceCount];
+   unsigned char** binaries = new unsigned char*[deviceCount];
+   for (size_t i = 0; i < deviceCount; i++) {
+      lengths[i] = 0;
+      binaries[i] = NULL;
+   }
+
+   bool complete = false;
+   FILE* file = fopen(path, "rb");
+   if (file != NULL) {
+      char magic[sizeof(CACHE_MAGIC)];
+      unsigned int count = 0;
+      complete = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0
+         && readKey(file, key)
+         && fread(&count, sizeof(count), 1, file) == 1 && count == deviceCount;
+      for (size_t i = 0; complete && i < deviceCount; i++) {
+         unsigned long long length = 0;
+         complete = fread(&length, sizeof(length), 1, file) == 1 && length > 0;
+         if (complete) {
+            lengths[i] = (size_t)length;
+            binaries[i] = new unsigned char[lengths[i]];
+            complete = fread(binaries[i], lengths[i], 1, file) == 1;
+         }
+      }
+      fclose(file);
+      if (!complete && config->isVerbose()) {
+         fprintf(stderr, "cached program %s is stale or belongs to another program, building from source\n", path);
+      }
+   }
+
+   if (complete) {
+      cl_int status = CL_SUCCESS;
+      program = clCreateProgramWithBinary(context, (cl_uint)deviceCount, deviceIds, lengths, 
+            (const unsigned char**)binaries, NULL, &status);
+      if (status == CL_SUCCESS) {
+         status = clBuildProgram(program, (cl_uint)deviceCount, deviceIds, options, NULL, NULL);
+      }
+      if (status != CL_SUCCESS) {
+         if (config->isVerbose()) {
+            fprintf(stderr, "cached program %s rejected (%d), building from source\n", path, status);
+         }
+         if (program != NULL) {
+            clReleaseProgram(program);
+            program = NULL;
+         }
+         atomicAdd(&invalidBinaries, 1);
+      }
+   }
+
+   for (size_t i = 0; i < deviceCount; i++) {
+      delete[] binaries[i];
+   }
+   delete[] binaries;
+   delete[] lengths;
+
+   if (program != NULL) {
+      atomicAdd(&hits, 1);
+      atomicAdd(&loadNanos, nanoTime() - loadStart);
+      if (config->isVerbose()) {
+         fprintf(stderr, "loaded program from %s\n", path);
+      }
+   } else {
+      atomicAdd(&misses, 1);
+   }
+   delete[] path;
+   return program;
+}
+
+/**
+ * write the binaries of a program just built from source to the cache.
+ * The entry is written to a file unique to this process then renamed over the entry, so readers 
+ * only ever see a complete entry. Failures are ignored, the cache is only an optimization.
+ */
+void ProgramCache::store(cl_program program, size_t deviceCount, cl_device_id* deviceIds, const char* source, const char* options) {
+   if (config == NULL || config->getProgramCacheDir() == NULL) {
+      return;
+   }
+   std::string key = cacheKey(deviceCount, deviceIds, source, options);
+   char* path = cachePath(key);
+
+   // the program holds a binary for every device in its context, we want ours in our order
+   cl_uint programDeviceCount = 0;
+   clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(programDeviceCount), &programDeviceCount, NULL);
+   cl_device_id* programDevices = new cl_device_id[programDeviceCount];
+   size_t* programLengths = new size_t[programDeviceCount];
+   unsigned char** programBinaries = new unsigned char*[programDeviceCount];
+   clGetProgramInfo(program, CL_PROGRAM_DEVICES, sizeof(cl_device_id) * programDeviceCount, programDevices, NULL);
+   cl_int status = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * programDeviceCount, programLengths, NULL);
+   for (cl_uint i = 0; i < programDeviceCount; i++) {
+      programBinaries[i] = (status == CL_SUCCESS && programLengths[i] > 0) ? new unsigned char[programLengths[i]] : NULL;
+   }
+   if (status == CL_SUCCESS) {
+      status = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*) * programDeviceCount, programBinaries, NULL);
+   }
+
+   // threads storing the same program each write their own file
+   static volatile jlong sequence = 0;
+   int unique = (int)atomicAdd(&sequence, 1);
+   char* tmpPath = new char[strlen(path) + 64];
+#if defined (_WIN32)
+   sprintf(tmpPath, "%s.%lu.%d.tmp", path, (unsigned long)GetCurrentProcessId(), unique);
+   _mkdir(config->getProgramCacheDir());
+#else
+   sprintf(tmpPath, "%s.%lu.%d.tmp", path, (unsigned long)getpid(), unique);
+   mkdir(config->getProgramCacheDir(), 0755);
+#endif
+
+   FILE* file = (status == CL_SUCCESS) ? fopen(tmpPath, "wb") : NULL;
+   bool written = file != NULL;
+   if (written) {
+      unsigned long long keyLength = key.size();
+      unsigned int count = (unsigned int)deviceCount;
+      written = fwrite(CACHE_MAGIC, sizeof(CACHE_MAGIC), 1, file) == 1
+         && fwrite(&keyLength, sizeof(keyLength), 1, file) == 1
+         && fwrite(key.data(), key.size(), 1, file) == 1
+         && fwrite(&count, sizeof(count), 1, file) == 1;
+      for (size_t i = 0; written && i < deviceCount; i++) {
+         int index = -1;
+         for (cl_uint j = 0; j < programDeviceCount; j++) {
+            if (programDevices[j] == deviceIds[i] && programBinaries[j] != NULL) {
+               index = j;
+            }
+         }
+         unsigned long long length = (index < 0) ? 0 : programLengths[index];
+         written = length > 0 && fwrite(&length, sizeof(length), 1, file) == 1
+            && fwrite(programBinaries[index], programLengths[index], 1, file) == 1;
+      }
+      written = (fclose(file) == 0) && written;
+   }
+
+   if (written) {
+#if defined (_WIN32)
+      written = MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+      written = rename(tmpPath, path) == 0;
+#endif
+   }
+   if (written) {
+      atomicAdd(&stores, 1);
+      if (config->isVerbose()) {
+         fprintf(stderr, "stored program in %s\n", path);
+      }
+   } else if (file != NULL) {
+      remove(tmpPath);
+   }
+
+   for (cl_uint i = 0; i < programDeviceCount; i++) {
+      delete[] programBinaries[i];
+   }
+   delete[] programBinaries;
+   delete[] programLengths;
+   delete[] programDevices;
+   delete[] tmpPath;
+   delete[] path;
+}
+
+/**
+ * @return {hits, misses, stores, invalidBinaries, buildNanos, loadNanos}
+ */
+jlongArray ProgramCache::getCounters(JNIEnv *jenv) {
+   jlong counters[] = { hits, misses, stores, invalidBinaries, buildNanos, loadNanos };
+   jlongArray array = jenv->NewLongArray(6);
+   jenv->SetLongArrayRegion(array, 0, 6, counters);
+   return array;
+}
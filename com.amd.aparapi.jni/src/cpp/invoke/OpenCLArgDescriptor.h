@@ -18,6 +18,9 @@ class OpenCLArgDescriptor{
       static void setMemInstance(JNIEnv *jenv, jobject argInstance, jobject memInstance){
          JNIHelper::setInstanceField<jobject>(jenv, argInstance, "memVal", OpenCLMemClassArg, memInstance);
       }
+      static jstring getName(JNIEnv *jenv, jobject argInstance){
+         return((jstring)JNIHelper::getInstanceField<jobject>(jenv, argInstance, "name", StringClassArg));
+      }
       static void describe(JNIEnv *jenv, jobject argDef, jint argIndex){
          jlong argBits = OpenCLArgDescriptor::getBits(jenv, argDef);
          fprintf(stderr, " %d ", argIndex);
@@ -45,6 +45,11 @@
 #include "OpenCLMem.h"
 #include "OpenCLProgram.h"
 #include "JavaArgs.h"
+#include "Config.h"
+#include "ProgramCache.h"
+#include "DeviceRegistry.h"
+#include "Profiler.h"
+#include "Mutex.h"
 #include <iostream>
 
 #include "com_amd_aparapi_internal_jni_OpenCLJNI.h"
@@ -90,8 +95,6 @@ void OpenCLRange::fill(JNIEnv *jenv, jobject rangeInstance, jint dims, size_t* o
 JNI_JAVA(jobject, OpenCLJNI, createProgram)
    (JNIEnv *jenv, jobject jobj, jobject deviceInstance, jstring source) {
 
-      jobject platformInstance = OpenCLDevice::getPlatformInstance(jenv, deviceInstance);
-      cl_platform_id platformId = OpenCLPlatform::getPlatformId(jenv, platformInstance);
       cl_device_id deviceId = OpenCLDevice::getDeviceId(jenv, deviceInstance);
       cl_int status = CL_SUCCESS;
       cl_device_type deviceType;
@@ -99,17 +102,18 @@ JNI_JAVA(jobject, OpenCLJNI, createProgram)
       if(0)fprintf(stderr, "device[%ld] CL_DEVICE_TYPE = %lx\n", (unsigned long)deviceId, (unsigned long)deviceType);
 
 
-      cl_context_properties cps[3] = { CL_CONTEXT_PLATFORM, (cl_context_properties)platformId, 0 };
-      cl_context_properties* cprops = (NULL == platformId) ? NULL : cps;
-      cl_context context = clCreateContextFromType( cprops, deviceType, NULL, NULL, &status);
+      cl_context context = DeviceRegistry::acquireContext(deviceId, &status);
 
 
+      Config::init(jenv);
+      Profiler::init();
+
       jstring log=NULL;
-      cl_program program = CLHelper::compile(jenv, context, 1, &deviceId, source, &log, &status);
+      cl_program program = DeviceRegistry::acquireProgram(jenv, context, deviceId, source, &log, &status);
       cl_command_queue queue = NULL;
       if(status == CL_SUCCESS) {
          cl_command_queue_properties queue_props = CL_QUEUE_PROFILING_ENABLE;
-         queue = clCreateCommandQueue(context, deviceId, queue_props, &status);
+         queue = DeviceRegistry::acquireQueue(context, deviceId, queue_props, &status);
       }else{
          fprintf(stderr, "queue creation seems to have failed\n");
 
@@ -250,6 +254,19 @@ void getArg(JNIEnv *jenv, cl_context context, cl_command_queue commandQueue, cl_
    }
 }
 
+/**
+ * delete a NULL terminated profile info list as stored on an OpenCLProgram, the list owns the labels
+ */
+void disposeProfileInfo(ProfileInfo **profileInfoArr){
+   if (profileInfoArr != NULL){
+      for (int i=0; profileInfoArr[i] != NULL; i++){
+          free(profileInfoArr[i]->name);
+          delete profileInfoArr[i];
+      }
+      delete[] profileInfoArr;
+   }
+}
+
 JNI_JAVA(jobject, OpenCLJNI, getProfileInfo)
    (JNIEnv *jenv, jobject jobj, jobject programInstance) {
    jobject returnList = JNIHelper::createInstance(jenv, ArrayListClass, VoidReturn );
@@ -267,19 +284,14 @@ JNI_JAVA(void, OpenCLJNI, disposeProgram)
    (JNIEnv *jenv, jobject jobj, jobject programInstance) {
       //fprintf(stderr, "dispose program \n");
       cl_program program = OpenCLProgram::getProgram(jenv, programInstance);
-      clReleaseProgram(program);
+      DeviceRegistry::releaseProgram(program);
       cl_command_queue commandQueue = OpenCLProgram::getCommandQueue(jenv, programInstance);
-      clReleaseCommandQueue(commandQueue);
-      cl_context context = OpenCLProgram::getContext(jenv, programInstance);
-      clReleaseContext(context);
-   ProfileInfo **profileInfoArr = OpenCLProgram::getProfileInfo(jenv, programInstance);
-   if (profileInfoArr != NULL){
-      for (int i=0; profileInfoArr[i] != NULL; i++){
-          //fprintf(stdout, "removed prev profile %d\n", i);
-          delete profileInfoArr[i];
+      if (commandQueue != NULL) {
+         DeviceRegistry::releaseQueue(commandQueue);
       }
-      delete[] profileInfoArr;
-   }
+      cl_context context = OpenCLProgram::getContext(jenv, programInstance);
+      DeviceRegistry::releaseContext(context);
+   disposeProfileInfo(OpenCLProgram::getProfileInfo(jenv, programInstance));
 }
 
 JNI_JAVA(void, OpenCLJNI, disposeKernel)
@@ -313,6 +325,26 @@ JNI_JAVA(void, OpenCLJNI, disposeKernel)
 
 extern cl_int profile(ProfileInfo *profileInfo, cl_event *event, jint type, char* name, cl_ulong profileBaseTime );
 
+// numbers the invokes in the profile
+static volatile jlong invokes = 0;
+
+/**
+ * @return a copy of a label for a profile info, to be freed
+ */
+static char* copyLabel(JNIEnv *jenv, jstring label){
+   if (label == NULL){
+      return(strdup("unknown"));
+   }
+   const char *chars = jenv->GetStringUTFChars(label, NULL);
+   char *copy = strdup(chars);
+   jenv->ReleaseStringUTFChars(label, chars);
+   return(copy);
+}
+
+static char* copyArgLabel(JNIEnv *jenv, jobjectArray argDefsArray, jint argIndex){
+   return(copyLabel(jenv, OpenCLArgDescriptor::getName(jenv, jenv->GetObjectArrayElement(argDefsArray, argIndex))));
+}
+
 /**
  */
 JNI_JAVA(void, OpenCLJNI, invoke)
@@ -349,13 +381,18 @@ JNI_JAVA(void, OpenCLJNI, invoke)
 
       if (0) fprintf(stderr, "reads=%d writes=%d\n", reads, writes);
       cl_event * events = new cl_event[reads+writes+1];
+      jint * eventArgs = new jint[reads+writes+1]; // the arg of each event, -1 for the execute
 
       jint eventc = 0;
 
       for (jsize argIndex = 0; argIndex < argc; argIndex++){
          jobject argDef = jenv->GetObjectArrayElement(argDefsArray, argIndex);
          jobject arg = jenv->GetObjectArrayElement(argArray, argIndex+1);
+         jint firstEvent = eventc;
          putArg(jenv, context, kernel, commandQueue, events, &eventc, argIndex, argDef, arg);
+         for (jint i = firstEvent; i < eventc; i++){
+            eventArgs[i] = argIndex;
+         }
       }
 
       jobject rangeInstance = jenv->GetObjectArrayElement(argArray, 0);
@@ -369,6 +406,8 @@ JNI_JAVA(void, OpenCLJNI, invoke)
       cl_int status = CL_SUCCESS;
 
       if(0) fprintf(stderr, "Exec %d\n", eventc);
+      jint executeEvent = eventc;
+      eventArgs[eventc] = -1;
       status = clEnqueueNDRangeKernel(
             commandQueue,
             kernel,
@@ -389,32 +428,32 @@ JNI_JAVA(void, OpenCLJNI, invoke)
       for (jsize argIndex = 0; argIndex < argc; argIndex++){
          jobject argDef = jenv->GetObjectArrayElement(argDefsArray, argIndex);
          jobject arg = jenv->GetObjectArrayElement(argArray, argIndex+1);
+         jint firstEvent = eventc;
          getArg(jenv, context, commandQueue, events, &eventc, argIndex, argDef, arg);
-      }
-      status = clWaitForEvents(eventc, events);
-      ProfileInfo **profileInfoArr = OpenCLProgram::getProfileInfo(jenv, programInstance);
-      if (profileInfoArr != NULL){
-         for (int i=0; profileInfoArr[i] != NULL; i++){
-              //fprintf(stdout, "removed prev profile %d\n", i);
-              delete profileInfoArr[i];
+         for (jint i = firstEvent; i < eventc; i++){
+            eventArgs[i] = argIndex;
          }
-         //fprintf(stdout, "removed prev profile list\n");
-         delete[] profileInfoArr;
-      }else{
-         //fprintf(stdout, "prev profile list was NULL\n");
       }
-      profileInfoArr = NULL;
+      status = clWaitForEvents(eventc, events);
+      disposeProfileInfo(OpenCLProgram::getProfileInfo(jenv, programInstance));
   
-      profileInfoArr = new ProfileInfo*[eventc+1]; // add NULL to end!
+      ProfileInfo **profileInfoArr = new ProfileInfo*[eventc+1]; // add NULL to end!
       //fprintf(stdout, "allocated a new list %d\n", eventc+1);
+      jlong invokeId = atomicAdd(&invokes, 1);
+      char* kernelName = copyLabel(jenv, OpenCLKernel::getName(jenv, kernelInstance));
       for (int i=0;i<eventc; i++){
         profileInfoArr[i] = new ProfileInfo();
         //fprintf(stdout, "allocated a new ProfileInfo for %d\n", i);
-        int type = (i>(writes+1))?2:((i>writes)?1:0);
-        profile(profileInfoArr[i], &events[i], type, "unknown", 0L);
-        //fprintf(stdout, "type = %d\n", type);
+        // the writes were enqueued first, then the execute, then the reads
+        jint type = (i < executeEvent) ? Profiler::WRITE : ((i == executeEvent) ? Profiler::EXECUTE : Profiler::READ);
+        char* name = (eventArgs[i] < 0) ? strdup(kernelName) : copyArgLabel(jenv, argDefsArray, eventArgs[i]);
+        profile(profileInfoArr[i], &events[i], type, name, 0L);
+        profileInfoArr[i]->name = name;
+        Profiler::record(events[i], type, name, kernelName, kernel, 0, invokeId);
         clReleaseEvent(events[i]);
       }
+      free(kernelName);
+      delete[] eventArgs;
       profileInfoArr[eventc]=NULL;
       OpenCLProgram::setProfileInfo(jenv, programInstance, profileInfoArr);
       if (status != CL_SUCCESS) {
@@ -422,6 +461,226 @@ JNI_JAVA(void, OpenCLJNI, invoke)
       }
    }
 
+/**
+ * A global array arg of an async invoke. The array is copied into its own buffer when the invoke is 
+ * enqueued and mapped results are copied back by invokeComplete, so no array stays pinned.
+ */
+struct AsyncInvokeArg {
+   jarray array;        // global ref to the java array
+   cl_mem mem;
+   size_t sizeInBytes;
+   jboolean written;    // true if the kernel writes this arg, so it has to be copied back
+   jint argIndex;
+   void *mapped;        // host view of the results while they are copied back
+};
+
+/**
+ * An invoke enqueued by invokeAsync, completed by invokeComplete on an OpenCL callback thread.
+ */
+struct AsyncInvoke {
+   JavaVM *jvm;
+   jobject programInstance;  // global ref, receives the profile info
+   jobject future;           // global ref to the CompletionFuture to complete
+   cl_event *events;         // the execute event followed by one map event per written arg
+   char **eventNames;        // the label of each event, handed to its profile info on completion
+   jint eventc;
+   AsyncInvokeArg *args;
+   jint argc;
+};
+
+/**
+ * Called by OpenCL once the last event of an async invoke has completed. The queue is in order, so
+ * every event of the invoke has completed too.
+ */
+void CL_CALLBACK invokeComplete(cl_event, cl_int eventStatus, void *userData){
+   AsyncInvoke *invoke = (AsyncInvoke *)userData;
+   bool attached = false;
+   JNIEnv *jenv = JNIHelper::attachCurrentThread(invoke->jvm, attached);
+   if (jenv == NULL){
+      return;
+   }
+   cl_command_queue commandQueue = OpenCLProgram::getCommandQueue(jenv, invoke->programInstance);
+
+   jint status = (eventStatus < 0) ? eventStatus : CL_SUCCESS;
+   for (jint i = 0; i < invoke->argc; i++){
+      AsyncInvokeArg *arg = &invoke->args[i];
+      if (arg->mapped != NULL){
+         if (status == CL_SUCCESS){
+            void *ptr = jenv->GetPrimitiveArrayCritical(arg->array, NULL);
+            memcpy(ptr, arg->mapped, arg->sizeInBytes);
+            jenv->ReleasePrimitiveArrayCritical(arg->array, ptr, 0);
+         }
+         clEnqueueUnmapMemObject(commandQueue, arg->mem, arg->mapped, 0, NULL, NULL);
+      }
+      clReleaseMemObject(arg->mem);
+      jenv->DeleteGlobalRef(arg->array);
+   }
+
+   disposeProfileInfo(OpenCLProgram::getProfileInfo(jenv, invoke->programInstance));
+   ProfileInfo **profileInfoArr = new ProfileInfo*[invoke->eventc+1]; // add NULL to end!
+   jlong invokeId = atomicAdd(&invokes, 1);
+   for (int i = 0; i < invoke->eventc; i++){
+      profileInfoArr[i] = new ProfileInfo();
+      // the execute event comes first, then the reads
+      jint type = (i == 0) ? Profiler::EXECUTE : Profiler::READ;
+      profile(profileInfoArr[i], &invoke->events[i], type, invoke->eventNames[i], 0L);
+      profileInfoArr[i]->name = invoke->eventNames[i];
+      Profiler::record(invoke->events[i], type, invoke->eventNames[i], invoke->eventNames[0], NULL, 0, invokeId);
+      clReleaseEvent(invoke->events[i]);
+   }
+   profileInfoArr[invoke->eventc] = NULL;
+   OpenCLProgram::setProfileInfo(jenv, invoke->programInstance, profileInfoArr);
+
+   if (status != CL_SUCCESS){
+      fprintf(stderr, "async invoke failed %s!\n", CLHelper::errString(status));
+   }
+   JNIHelper::callVoid(jenv, invoke->future, "complete", ArgsVoidReturn(IntArg), status);
+
+   jenv->DeleteGlobalRef(invoke->future);
+   jenv->DeleteGlobalRef(invoke->programInstance);
+   delete[] invoke->events;
+   delete[] invoke->eventNames;
+   delete[] invoke->args;
+   JavaVM *jvm = invoke->jvm;
+   delete invoke;
+
+   JNIHelper::detachCurrentThread(jvm, attached);
+}
+
+/**
+ * Same as invoke but returns as soon as the work is enqueued, the future is completed by invokeComplete.
+ * Global arrays are copied into buffers created for this invoke (CL_MEM_COPY_HOST_PTR) rather than 
+ * wrapping the pinned array, and results are mapped rather than read, so nothing is left pinned on return.
+ *
+ * @return CL_SUCCESS if the invoke was enqueued, otherwise the future is never completed
+ */
+JNI_JAVA(jint, OpenCLJNI, invokeAsync)
+   (JNIEnv *jenv, jobject jobj, jobject kernelInstance, jobjectArray argArray, jobject future) {
+      cl_kernel kernel = OpenCLKernel::getKernel(jenv, kernelInstance);
+      jobject programInstance = OpenCLKernel::getProgramInstance(jenv, kernelInstance);
+      jobjectArray argDefsArray = OpenCLKernel::getArgsArray(jenv, kernelInstance);
+
+      cl_context context = OpenCLProgram::getContext(jenv, programInstance);
+      cl_command_queue commandQueue = OpenCLProgram::getCommandQueue(jenv, programInstance);
+
+      jsize argc = jenv->GetArrayLength(argDefsArray);
+      AsyncInvoke *invoke = new AsyncInvoke();
+      jenv->GetJavaVM(&invoke->jvm);
+      invoke->args = new AsyncInvokeArg[argc];
+      invoke->argc = 0;
+      invoke->events = new cl_event[argc+1];
+      invoke->eventNames = new char*[argc+1];
+      invoke->eventc = 0;
+
+      cl_int status = CL_SUCCESS;
+      for (jsize argIndex = 0; argIndex < argc && status == CL_SUCCESS; argIndex++){
+         jobject argDef = jenv->GetObjectArrayElement(argDefsArray, argIndex);
+         jobject arg = jenv->GetObjectArrayElement(argArray, argIndex+1);
+         jlong argBits = OpenCLArgDescriptor::getBits(jenv, argDef);
+         if (argisset(argBits, ARRAY) && argisset(argBits, GLOBAL)){ 
+            AsyncInvokeArg *asyncArg = &invoke->args[invoke->argc];
+            asyncArg->sizeInBytes = OpenCLMem::getArraySizeInBytes(jenv, (jarray)arg, argBits);
+            asyncArg->written = argisset(argBits, WRITEONLY) | argisset(argBits, READWRITE);
+            asyncArg->argIndex = argIndex;
+            asyncArg->mapped = NULL;
+            cl_mem_flags mask = (OpenCLMem::bitsToOpenCLMask(argBits) & ~CL_MEM_USE_HOST_PTR) | CL_MEM_ALLOC_HOST_PTR;
+            if (argisset(argBits, READONLY) | argisset(argBits, READWRITE)) {
+               // the copy is made by clCreateBuffer, so the array is only pinned for this call
+               void *ptr = OpenCLMem::pin(jenv, (jarray)arg, NULL); 
+               asyncArg->mem = clCreateBuffer(context, mask | CL_MEM_COPY_HOST_PTR, asyncArg->sizeInBytes, ptr, &status);
+               jenv->ReleasePrimitiveArrayCritical((jarray)arg, ptr, JNI_ABORT);
+            } else {
+               asyncArg->mem = clCreateBuffer(context, mask, asyncArg->sizeInBytes, NULL, &status);
+            }
+            if (status != CL_SUCCESS) {
+               fprintf(stderr, "error creating async buffer %s!\n",  CLHelper::errString(status));
+               break;
+            }
+            asyncArg->array = (jarray)jenv->NewGlobalRef(arg);
+            invoke->argc++;
+            status = clSetKernelArg(kernel, argIndex, sizeof(cl_mem), (void *)&(asyncArg->mem));          
+            if (status != CL_SUCCESS) {
+               fprintf(stderr, "error setting arg %d %s!\n",  argIndex, CLHelper::errString(status));
+            }
+         } else {
+            // local and primitive args don't touch java memory past this call
+            putArg(jenv, context, kernel, commandQueue, NULL, NULL, argIndex, argDef, arg);
+         }
+      }
+
+      if (status == CL_SUCCESS){
+         jobject rangeInstance = jenv->GetObjectArrayElement(argArray, 0);
+         jint dims = OpenCLRange::getDims(jenv, rangeInstance);
+
+         size_t *offsets = new size_t[dims];
+         size_t *globalDims = new size_t[dims];
+         size_t *localDims = new size_t[dims];
+         OpenCLRange::fill(jenv, rangeInstance, dims, offsets, globalDims, localDims);
+
+         status = clEnqueueNDRangeKernel(commandQueue, kernel, dims, offsets, globalDims, localDims,
+               0, NULL, &invoke->events[invoke->eventc]);
+         delete[] offsets;
+         delete[] globalDims;
+         delete[] localDims;
+         if (status != CL_SUCCESS) {
+            fprintf(stderr, "error enqueuing execute %s !\n", CLHelper::errString(status));
+         } else {
+            invoke->eventNames[invoke->eventc] = copyLabel(jenv, OpenCLKernel::getName(jenv, kernelInstance));
+            invoke->eventc++;
+         }
+      }
+
+      for (jint i = 0; i < invoke->argc && status == CL_SUCCESS; i++){
+         AsyncInvokeArg *asyncArg = &invoke->args[i];
+         if (asyncArg->written){
+            asyncArg->mapped = clEnqueueMapBuffer(commandQueue, asyncArg->mem, CL_FALSE, CL_MAP_READ, 0, 
+                  asyncArg->sizeInBytes, 1, invoke->events, &invoke->events[invoke->eventc], &status);
+            if (status != CL_SUCCESS) {
+               fprintf(stderr, "error enqueuing map %s!\n",  CLHelper::errString(status));
+               asyncArg->mapped = NULL;
+            } else {
+               invoke->eventNames[invoke->eventc] = copyArgLabel(jenv, argDefsArray, asyncArg->argIndex);
+               invoke->eventc++;
+            }
+         }
+      }
+
+      if (status == CL_SUCCESS){
+         invoke->programInstance = jenv->NewGlobalRef(programInstance);
+         invoke->future = jenv->NewGlobalRef(future);
+         status = clSetEventCallback(invoke->events[invoke->eventc-1], CL_COMPLETE, invokeComplete, invoke);
+         if (status != CL_SUCCESS) {
+            fprintf(stderr, "error setting invoke callback %s!\n",  CLHelper::errString(status));
+            jenv->DeleteGlobalRef(invoke->programInstance);
+            jenv->DeleteGlobalRef(invoke->future);
+         }
+      }
+
+      if (status != CL_SUCCESS){
+         // nothing will complete this invoke, drain the queue and clean up here
+         clFinish(commandQueue);
+         for (jint i = 0; i < invoke->argc; i++){
+            if (invoke->args[i].mapped != NULL){
+               clEnqueueUnmapMemObject(commandQueue, invoke->args[i].mem, invoke->args[i].mapped, 0, NULL, NULL);
+            }
+            clReleaseMemObject(invoke->args[i].mem);
+            jenv->DeleteGlobalRef(invoke->args[i].array);
+         }
+         for (jint i = 0; i < invoke->eventc; i++){
+            clReleaseEvent(invoke->events[i]);
+            free(invoke->eventNames[i]);
+         }
+         delete[] invoke->events;
+         delete[] invoke->eventNames;
+         delete[] invoke->args;
+         delete invoke;
+         return(status);
+      }
+
+      clFlush(commandQueue);
+      return(CL_SUCCESS);
+   }
+
 JNI_JAVA(jobject, OpenCLJNI, getPlatforms)
    (JNIEnv *jenv, jobject jobj) {
       jobject platformListInstance = JNIHelper::createInstance(jenv, ArrayListClass, VoidReturn);
@@ -553,3 +812,12 @@ JNI_JAVA(jobject, OpenCLJNI, getPlatforms)
       return (platformListInstance);
    }
 
+JNI_JAVA(jlongArray, OpenCLJNI, getProgramCacheCounters)
+   (JNIEnv *jenv, jobject jobj) {
+      return (ProgramCache::getCounters(jenv));
+   }
+
+JNI_JAVA(jlongArray, OpenCLJNI, getDeviceRegistryCounters)
+   (JNIEnv *jenv, jobject jobj) {
+      return (DeviceRegistry::getCounters(jenv));
+   }
@@ -18,6 +18,10 @@ class OpenCLKernel{
          return((cl_kernel) JNIHelper::getInstanceField<jlong>(jenv, kernelInstance, "kernelId"));
       }
 
+      static jstring getName(JNIEnv *jenv, jobject kernelInstance){
+         return((jstring)JNIHelper::getInstanceField<jobject>(jenv, kernelInstance, "kernelName", StringClassArg));
+      }
+
       static jobject getProgramInstance(JNIEnv *jenv, jobject kernelInstance){
          return(JNIHelper::getInstanceField<jobject>(jenv, kernelInstance, "program", OpenCLProgramClassArg));
       }
@@ -44,10 +44,15 @@
 #include "Aparapi.h"
 #include "Config.h"
 #include "ProfileInfo.h"
+#include "Profiler.h"
 #include "ArrayBuffer.h"
 #include "AparapiBuffer.h"
 #include "CLHelper.h"
-#include "List.h"
+#include "DeviceRegistry.h"
+#include "KernelGraph.h"
+#include "LocalSizeTuner.h"
+#include "DispatchPlan.h"
+#include "ResourceTracker.h"
 #include <algorithm>
 
 
@@ -105,12 +110,18 @@ inline size_t argSize(KernelArg* arg)
    return 0;
 }
 
+/**
+ * true if arg is transferred chunk by chunk (rather than as a whole) during a chunked execution
+ */
+inline bool isChunkedTransfer(KernelArg* arg)
+{
+   return(arg->isChunked() && arg->isArray() && arg->isGlobal() && arg->isImplicit() && arg->chunkStride > 0 && argSize(arg) > 0);
+}
+
 
 JNI_JAVA(jint, KernelRunnerJNI, disposeJNI)
    (JNIEnv *jenv, jobject jobj, jlong jniContextHandle) {
-      if (config== NULL){
-         config = new Config(jenv);
-      }
+      Config::init(jenv);
       cl_int status = CL_SUCCESS;
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
       if (jniContext != NULL){
@@ -143,25 +154,26 @@ jint writeProfileInfo(JNIContext* jniContext){
    int pos = 1;
 
    if (jniContext->firstRun) {
-      fprintf(jniContext->profileFile, "# PROFILE Name, queued, submit, start, end (microseconds)\n");
+      fprintf(jniContext->profileFile, "# PROFILE Name, queued, submit, start, end (microseconds), ..., sample interval\n");
    }       
 
    // A read by a user kernel means the OpenCL layer wrote to the kernel and vice versa
    for (int i=0; i< jniContext->argc; i++){
       KernelArg *arg=jniContext->args[i];
-      if (arg->isBackedByArray() && arg->isReadByKernel()){
+      if ((arg->isBackedByArray() || (arg->isAparapiBuffer() && arg->isGlobal())) && arg->isReadByKernel()){
+         ProfileInfo* write = arg->isAparapiBuffer() ? &arg->aparapiBuffer->write : &arg->arrayBuffer->write;
 
          // Initialize the base time for this sample
          if (currSampleBaseTime == -1) {
-            currSampleBaseTime = arg->arrayBuffer->write.queued;
+            currSampleBaseTime = write->queued;
          } 
          fprintf(jniContext->profileFile, "%d write %s,", pos++, arg->name);
 
          fprintf(jniContext->profileFile, "%lu,%lu,%lu,%lu,",  
-        	(unsigned long)(arg->arrayBuffer->write.queued - currSampleBaseTime)/1000,
-        	(unsigned long)(arg->arrayBuffer->write.submit - currSampleBaseTime)/1000,
-        	(unsigned long)(arg->arrayBuffer->write.start - currSampleBaseTime)/1000,
-        	(unsigned long)(arg->arrayBuffer->write.end - currSampleBaseTime)/1000);
+        	(unsigned long)(write->queued - currSampleBaseTime)/1000,
+        	(unsigned long)(write->submit - currSampleBaseTime)/1000,
+        	(unsigned long)(write->start - currSampleBaseTime)/1000,
+        	(unsigned long)(write->end - currSampleBaseTime)/1000);
       }
    }
 
@@ -188,27 +200,158 @@ jint writeProfileInfo(JNIContext* jniContext){
    } else { 
       for (int i=0; i< jniContext->argc; i++){
          KernelArg *arg=jniContext->args[i];
-         if (arg->isBackedByArray() && arg->isMutableByKernel()){
+         if ((arg->isBackedByArray() || (arg->isAparapiBuffer() && arg->isGlobal())) && arg->isMutableByKernel()){
+            ProfileInfo* read = arg->isAparapiBuffer() ? &arg->aparapiBuffer->read : &arg->arrayBuffer->read;
 
             // Initialize the base time for this sample
             if (currSampleBaseTime == -1) {
-               currSampleBaseTime = arg->arrayBuffer->read.queued;
+               currSampleBaseTime = read->queued;
             }
 
             fprintf(jniContext->profileFile, "%d read %s,", pos++, arg->name);
 
             fprintf(jniContext->profileFile, "%lu,%lu,%lu,%lu,",  
-            	(unsigned long)(arg->arrayBuffer->read.queued - currSampleBaseTime)/1000,
-            	(unsigned long)(arg->arrayBuffer->read.submit - currSampleBaseTime)/1000,
-            	(unsigned long)(arg->arrayBuffer->read.start - currSampleBaseTime)/1000,
-            	(unsigned long)(arg->arrayBuffer->read.end - currSampleBaseTime)/1000);
+            	(unsigned long)(read->queued - currSampleBaseTime)/1000,
+            	(unsigned long)(read->submit - currSampleBaseTime)/1000,
+            	(unsigned long)(read->start - currSampleBaseTime)/1000,
+            	(unsigned long)(read->end - currSampleBaseTime)/1000);
+         }
+      }
+   }
+
+   // host phases are on the device clock too, but may start before the first event
+   HostTiming& timing = jniContext->hostTiming;
+   if (timing.isEnabled() && timing.calibrated) {
+      for (size_t i = 0; i < timing.intervals.size(); i++) {
+         HostTiming::Interval& interval = timing.intervals[i];
+         if (interval.end == 0) {
+            continue;
+         }
+         jlong start = timing.toDevice(interval.start, jniContext->profileBaseTime);
+         jlong end = timing.toDevice(interval.end, jniContext->profileBaseTime);
+         if (currSampleBaseTime == -1) {
+            currSampleBaseTime = (cl_ulong)start;
          }
+         fprintf(jniContext->profileFile, "%d host %s,", pos++, interval.label);
+         fprintf(jniContext->profileFile, "%ld,%ld,%ld,%ld,",
+               (long)(start - (jlong)currSampleBaseTime)/1000,
+               (long)(start - (jlong)currSampleBaseTime)/1000,
+               (long)(start - (jlong)currSampleBaseTime)/1000,
+               (long)(end - (jlong)currSampleBaseTime)/1000);
       }
    }
-   fprintf(jniContext->profileFile, "\n");
+   // the row stands for this many runs when profiling is sampled
+   fprintf(jniContext->profileFile, "%d\n", jniContext->sampler.getSampledInterval());
    return(0);
 }
 
+/**
+ * put a completed event of this context in the profile, if one is being recorded and this run is sampled
+ */
+inline void recordEvent(JNIContext* jniContext, cl_event event, jint type, const char* name, jint pass) {
+   if (Profiler::isEnabled() && jniContext->profilingRun) {
+      Profiler::record(event, type, name, jniContext->kernelName, jniContext, pass, jniContext->runs,
+            jniContext->sampler.getSampledInterval());
+   }
+}
+
+/**
+ * put a completed read or write event of this context in the profile, named after the arg it moved.
+ * The event args are only kept whilst profiling, so they are only looked at once we know the profile is recorded.
+ */
+inline void recordArgEvent(JNIContext* jniContext, cl_event event, jint type, const jint* eventArgs, int i, jint pass) {
+   if (Profiler::isEnabled() && eventArgs != NULL) {
+      recordEvent(jniContext, event, type, jniContext->args[eventArgs[i]]->name, pass);
+   }
+}
+
+/**
+ * @return true if the device times of the current run go in the latency histograms. Profiled runs have them, 
+ * other runs only if device timing (or local size tuning) asks for timestamps on every run.
+ */
+inline bool isTimedRun(JNIContext* jniContext) {
+   return(jniContext->timedQueues
+         && (jniContext->profilingRun || config->isDeviceTimingEnabled() || config->isLocalSizeTuningEnabled()));
+}
+
+/**
+ * start the per run state of a context, profiling the run if it is sampled.
+ * A run which is not sampled leaves the profile of the last sampled run for getProfileInfo.
+ */
+void startRun(JNIContext* jniContext, bool sampled) {
+   jniContext->profilingRun = sampled;
+   if (sampled || !config->isProfilingEnabled()) {
+      jniContext->hostTiming.reset(sampled);
+   } else {
+      jniContext->hostTiming.suspend();
+   }
+   jniContext->runTotals.clear();
+   jniContext->transferLog.clear(config->isTransferLogEnabled());
+}
+
+/**
+ * @return the device time an event of this context took, 0 unless its queues give event timestamps
+ */
+jlong eventNanos(JNIContext* jniContext, cl_event event) {
+   if (!isTimedRun(jniContext) || event == NULL) {
+      return(0);
+   }
+   cl_ulong start = 0;
+   cl_ulong end = 0;
+   if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL) != CL_SUCCESS
+         || clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL) != CL_SUCCESS) {
+      return(0);
+   }
+   return((end > start) ? (jlong)(end - start) : 0);
+}
+
+/**
+ * count a transfer of arg to (upload) or from the device and add it to the transfer log
+ */
+void countTransfer(JNIContext* jniContext, KernelArg* arg, jint argIdx, bool upload, bool isExplicit, jlong bytes, const char* reason) {
+   jniContext->transfers.add(upload ? TransferCounters::BYTES_UPLOADED : TransferCounters::BYTES_DOWNLOADED, bytes);
+   jniContext->transfers.add(isExplicit ? TransferCounters::EXPLICIT_TRANSFERS : TransferCounters::IMPLICIT_TRANSFERS);
+   jniContext->transferLog.add(argIdx, arg->name, upload ? "upload" : "download", reason, bytes);
+}
+
+/**
+ * @return the position of arg in the argument array of the context
+ */
+jint argIndexOf(JNIContext* jniContext, KernelArg* arg) {
+   for (jint i = 0; i < jniContext->argc; i++) {
+      if (jniContext->args[i] == arg) {
+         return(i);
+      }
+   }
+   return(-1);
+}
+
+/**
+ * put the host phases of the run just completed in the profile, and print how long each took if verbose
+ */
+void reportHostTiming(JNIContext* jniContext) {
+   HostTiming& timing = jniContext->hostTiming;
+   if (!timing.isEnabled() || !timing.calibrated) {
+      return;
+   }
+   if (Profiler::isEnabled()) {
+      for (size_t i = 0; i < timing.intervals.size(); i++) {
+         HostTiming::Interval& interval = timing.intervals[i];
+         if (interval.end != 0) {
+            Profiler::recordHost(interval.label, timing.toDevice(interval.start, 0), timing.toDevice(interval.end, 0), 
+                  jniContext->kernelName, jniContext, jniContext->runs, jniContext->sampler.getSampledInterval());
+         }
+      }
+   }
+   if (config->isVerbose()) {
+      fprintf(stderr, "host phases (us):");
+      for (jint phase = 0; phase < HostTiming::PHASES; phase++) {
+         fprintf(stderr, " %s %ld,", HostTiming::phaseName(phase), (long)(timing.getExclusiveNanos(phase) / 1000));
+      }
+      fprintf(stderr, "\n");
+   }
+}
+
 // Should failed profiling abort the run and return early?
 cl_int profile(ProfileInfo *profileInfo, cl_event *event, jint type, char* name, cl_ulong profileBaseTime ) {
 
@@ -259,6 +402,7 @@ cl_int profile(ProfileInfo *profileInfo, cl_event *event, jint type, char* name,
 jint updateNonPrimitiveReferences(JNIEnv *jenv, jobject jobj, JNIContext* jniContext) {
    cl_int status = CL_SUCCESS;
    if (jniContext != NULL){
+      HostPhase phase(jniContext->hostTiming, HostTiming::SYNC_REFS);
       for (jint i = 0; i < jniContext->argc; i++){ 
          KernelArg *arg = jniContext->args[i];
 
@@ -294,13 +438,13 @@ jint updateNonPrimitiveReferences(JNIEnv *jenv, jobject jobj, JNIContext* jniCon
                // need to free opencl buffers, run will reallocate later
                if (arg->arrayBuffer->mem != 0) {
                   //fprintf(stderr, "-->releaseMemObject[%d]\n", i);
-                  if (config->isTrackingOpenCLResources()){
-                     memList.remove(arg->arrayBuffer->mem,__LINE__, __FILE__);
-                  }
+                  memTracker.remove(arg->arrayBuffer->mem,__LINE__, __FILE__);
+                  jniContext->forgetKernelArg(arg->arrayBuffer->mem);
                   status = clReleaseMemObject((cl_mem)arg->arrayBuffer->mem);
                   //fprintf(stderr, "<--releaseMemObject[%d]\n", i);
                   if(status != CL_SUCCESS) throw CLException(status, "clReleaseMemObject()");
                   arg->arrayBuffer->mem = (cl_mem)0;
+                  jniContext->transfers.add(TransferCounters::BUFFERS_RELEASED);
                }
 
                arg->arrayBuffer->addr = NULL;
@@ -332,6 +476,7 @@ jint updateNonPrimitiveReferences(JNIEnv *jenv, jobject jobj, JNIContext* jniCon
 
 /**
  * if we are profiling events the test a first event, and report profiling info.
+ * The marker also maps the host clock onto the device clock for the host phase timing.
  *
  * @param jniContest the context holding the information we got form Java
  *
@@ -341,7 +486,9 @@ void profileFirstRun(JNIContext* jniContext) {
    cl_event firstEvent;
    int status = CL_SUCCESS;
 
+   jlong beforeMarker = HostTiming::now();
    status = enqueueMarker(jniContext->commandQueue, &firstEvent);
+   jlong afterMarker = HostTiming::now();
    if (status != CL_SUCCESS) throw CLException(status, "clEnqueueMarker endOfTxfers");
 
    status = clWaitForEvents(1, &firstEvent);
@@ -356,6 +503,10 @@ void profileFirstRun(JNIContext* jniContext) {
    if (config->isVerbose()) {
       fprintf(stderr, "profileBaseTime %lu \n", (unsigned long)jniContext->profileBaseTime);
    }
+
+   // the marker was queued whilst we were enqueueing it
+   jniContext->hostTiming.calibrate(jniContext->deviceId, beforeMarker + (afterMarker - beforeMarker) / 2, 
+         jniContext->profileBaseTime);
 }
 
 
@@ -373,7 +524,10 @@ void updateArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argP
 	   mask |= CL_MEM_WRITE_ONLY;
 
    void * host_ptr = NULL;
-   if ((mask & CL_MEM_READ_WRITE)  || (mask & CL_MEM_READ_ONLY) )
+   if (arg->isDeviceResident()) {
+      // the buffer owns its storage for the life of the kernel, the java array is copied in and out of it
+      mask |= CL_MEM_ALLOC_HOST_PTR;
+   } else if ((mask & CL_MEM_READ_WRITE)  || (mask & CL_MEM_READ_ONLY) )
    {
 	   mask |= CL_MEM_USE_HOST_PTR;
 	   host_ptr = arg->arrayBuffer->addr;
@@ -383,7 +537,7 @@ void updateArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argP
    arg->arrayBuffer->memMask = mask;
 
    if (config->isVerbose()) {
-      strcpy(arg->arrayBuffer->memSpec,"CL_MEM_USE_HOST_PTR");
+      strcpy(arg->arrayBuffer->memSpec,(mask & CL_MEM_ALLOC_HOST_PTR)?"CL_MEM_ALLOC_HOST_PTR":"CL_MEM_USE_HOST_PTR");
       if (mask & CL_MEM_READ_WRITE) strcat(arg->arrayBuffer->memSpec,"|CL_MEM_READ_WRITE");
       if (mask & CL_MEM_READ_ONLY) strcat(arg->arrayBuffer->memSpec,"|CL_MEM_READ_ONLY");
       if (mask & CL_MEM_WRITE_ONLY) strcat(arg->arrayBuffer->memSpec,"|CL_MEM_WRITE_ONLY");
@@ -392,16 +546,18 @@ void updateArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argP
             argIdx, arg->arrayBuffer->memSpec, (unsigned long)arg->arrayBuffer->lengthInBytes, arg->arrayBuffer->addr);
    }
 
-   arg->arrayBuffer->mem = clCreateBuffer(jniContext->context, arg->arrayBuffer->memMask, 
-         arg->arrayBuffer->lengthInBytes, host_ptr, &status);
+   {
+      HostPhase phase(jniContext->hostTiming, HostTiming::CREATE_BUFFER, arg->name);
+      arg->arrayBuffer->mem = clCreateBuffer(jniContext->context, arg->arrayBuffer->memMask, 
+            arg->arrayBuffer->lengthInBytes, host_ptr, &status);
+   }
 
    if(status != CL_SUCCESS) throw CLException(status,"clCreateBuffer");
 
-   if (config->isTrackingOpenCLResources()){
-      memList.add(arg->arrayBuffer->mem, __LINE__, __FILE__);
-   }
+   memTracker.add(arg->arrayBuffer->mem, arg->arrayBuffer->lengthInBytes, __LINE__, __FILE__);
+   jniContext->transfers.add(TransferCounters::BUFFERS_CREATED);
 
-   status = clSetKernelArg(jniContext->kernel, argPos, sizeof(cl_mem), (void *)&(arg->arrayBuffer->mem));
+   status = jniContext->setKernelArg(argPos, sizeof(cl_mem), (void *)&(arg->arrayBuffer->mem));
    if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (array)");
 
    // Add the array length if needed
@@ -409,7 +565,7 @@ void updateArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argP
       argPos++;
       arg->syncJavaArrayLength(jenv);
 
-      status = clSetKernelArg(jniContext->kernel, argPos, sizeof(jint), &(arg->arrayBuffer->length));
+      status = jniContext->setKernelArg(argPos, sizeof(jint), &(arg->arrayBuffer->length));
       if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (array length)");
 
       if (config->isVerbose()){
@@ -422,22 +578,25 @@ void updateBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& arg
 
    AparapiBuffer* buffer = arg->aparapiBuffer;
    cl_int status = CL_SUCCESS;
-   cl_uint mask = CL_MEM_USE_HOST_PTR;
+   // not CL_MEM_USE_HOST_PTR, pack() writes data into the buffer and a read copies it back
+   cl_uint mask = 0;
    if (arg->isReadByKernel() && arg->isMutableByKernel()) mask |= CL_MEM_READ_WRITE;
    else if (arg->isReadByKernel() && !arg->isMutableByKernel()) mask |= CL_MEM_READ_ONLY;
    else if (arg->isMutableByKernel()) mask |= CL_MEM_WRITE_ONLY;
    buffer->memMask = mask;
 
-   buffer->mem = clCreateBuffer(jniContext->context, buffer->memMask, 
-         buffer->lengthInBytes, buffer->data, &status);
+   if (buffer->mem == 0) {
+      HostPhase phase(jniContext->hostTiming, HostTiming::CREATE_BUFFER, arg->name);
+      buffer->mem = clCreateBuffer(jniContext->context, buffer->memMask, 
+            buffer->lengthInBytes, NULL, &status);
 
-   if(status != CL_SUCCESS) throw CLException(status,"clCreateBuffer");
+      if(status != CL_SUCCESS) throw CLException(status,"clCreateBuffer");
 
-   if (config->isTrackingOpenCLResources()){
-      memList.add(buffer->mem, __LINE__, __FILE__);
+      memTracker.add(buffer->mem, buffer->lengthInBytes, __LINE__, __FILE__);
+      jniContext->transfers.add(TransferCounters::BUFFERS_CREATED);
    }
 
-   status = clSetKernelArg(jniContext->kernel, argPos, sizeof(cl_mem), (void *)&(buffer->mem));
+   status = jniContext->setKernelArg(argPos, sizeof(cl_mem), (void *)&(buffer->mem));
    if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (buffer)");
 
    // Add the array length if needed
@@ -445,47 +604,46 @@ void updateBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& arg
 
       for(int i = 0; i < buffer->numDims; i++) {
          argPos++;
-         status = clSetKernelArg(jniContext->kernel, argPos, sizeof(cl_uint), &(buffer->lens[i]));
+         status = jniContext->setKernelArg(argPos, sizeof(cl_uint), &(buffer->lens[i]));
          if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (buffer length)");
          if (config->isVerbose()){
             fprintf(stderr, "runKernel arg %d %s, length = %d\n", argIdx, arg->name, buffer->lens[i]);
          }
          argPos++;
-         status = clSetKernelArg(jniContext->kernel, argPos, sizeof(cl_uint), &(buffer->dims[i]));
+         status = jniContext->setKernelArg(argPos, sizeof(cl_uint), &(buffer->dims[i]));
          if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (buffer dimension)");
          if (config->isVerbose()){
             fprintf(stderr, "runKernel arg %d %s, dim = %d\n", argIdx, arg->name, buffer->dims[i]);
          }
       }
    }
-}
 
+   // jagged arrays pass where each row starts after the lengths and dimensions
+   if (buffer->offsets != NULL) {
+      if (buffer->offsetsMem == 0) {
+         HostPhase phase(jniContext->hostTiming, HostTiming::CREATE_BUFFER, arg->name);
+         buffer->offsetsMem = clCreateBuffer(jniContext->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+               (buffer->lens[0] + 1) * sizeof(jint), buffer->offsets, &status);
+         if(status != CL_SUCCESS) throw CLException(status,"clCreateBuffer (row offsets)");
 
-/**
- * manages the memory of KernelArgs that are object.  i.e. handels pinning, and moved objects.
- * currently the only objects supported are arrays.
- *
- * @param jenv the java environment
- * @param jniContext the context we got from java
- * @param arg the argument we're processing
- * @param argPos out: the position of arg in the opencl argument list
- * @param argIdx the position of arg in the argument array
- *
- * @throws CLException
- */
-void processObject(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
-    if(arg->isArray()) {
-       processArray(jenv, jniContext, arg, argPos, argIdx);
-    } else if(arg->isAparapiBuffer()) {
-       processBuffer(jenv, jniContext, arg, argPos, argIdx);
-    }
+         memTracker.add(buffer->offsetsMem, (buffer->lens[0] + 1) * sizeof(jint), __LINE__, __FILE__);
+         jniContext->transfers.add(TransferCounters::BUFFERS_CREATED);
+      }
+      argPos++;
+      status = jniContext->setKernelArg(argPos, sizeof(cl_mem), (void *)&(buffer->offsetsMem));
+      if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (row offsets)");
+      if (config->isVerbose()){
+         fprintf(stderr, "runKernel arg %d %s, %d jagged rows of %d elements\n", argIdx, arg->name, buffer->lens[0], buffer->offsets[buffer->lens[0]]);
+      }
+   }
 }
 
+
 void processArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
 
    cl_int status = CL_SUCCESS;
 
-   if (config->isProfilingEnabled()){
+   if (jniContext->profilingRun){
       arg->arrayBuffer->read.valid = false;
       arg->arrayBuffer->write.valid = false;
    }
@@ -495,7 +653,10 @@ void processArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& arg
    // get the C memory address for the region being transferred
    // this uses different JNI calls for arrays vs. directBufs
    void * prevAddr =  arg->arrayBuffer->addr;
-   arg->pin(jenv);
+   {
+      HostPhase phase(jniContext->hostTiming, HostTiming::PIN, arg->name);
+      arg->pin(jenv);
+   }
 
    if (config->isVerbose()) {
       fprintf(stderr, "runKernel: arrayOrBuf ref %p, oldAddr=%p, newAddr=%p, ref.mem=%p isCopy=%s\n",
@@ -523,11 +684,18 @@ void processArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& arg
    }
 
    if (jniContext->firstRun || (arg->arrayBuffer->mem == 0) || objectMoved ){
+      const char* reason = "first run";
+      if (!jniContext->firstRun) {
+         // a buffer released by updateNonPrimitiveReferences was for a new java array
+         TransferCounters::Counter cause = (arg->arrayBuffer->mem == 0) ? TransferCounters::REALLOC_NEW_ARRAY
+               : (arg->arrayBuffer->isCopy ? TransferCounters::REALLOC_COPIED : TransferCounters::REALLOC_MOVED);
+         jniContext->transfers.add(cause);
+         reason = TransferCounters::reasonOf(cause);
+      }
       if (arg->arrayBuffer->mem != 0 && objectMoved) {
          // we need to release the old buffer 
-         if (config->isTrackingOpenCLResources()) {
-            memList.remove((cl_mem)arg->arrayBuffer->mem, __LINE__, __FILE__);
-         }
+         memTracker.remove((cl_mem)arg->arrayBuffer->mem, __LINE__, __FILE__);
+         jniContext->forgetKernelArg(arg->arrayBuffer->mem);
          status = clReleaseMemObject((cl_mem)arg->arrayBuffer->mem);
          //fprintf(stdout, "dispose arg %d %0lx\n", i, arg->arrayBuffer->mem);
 
@@ -535,24 +703,121 @@ void processArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& arg
          CLException::checkCLError(status, "clReleaseMemObject()");
 
          arg->arrayBuffer->mem = (cl_mem)0;
+         jniContext->transfers.add(TransferCounters::BUFFERS_RELEASED);
       }
 
       updateArray(jenv, jniContext, arg, argPos, argIdx);
+      jniContext->transferLog.add(argIdx, arg->name, "create buffer", reason, arg->arrayBuffer->lengthInBytes);
+
+   } else {
+      // Keep the arg position in sync if no updates were required
+      if (arg->usesArrayLength()){
+         argPos++;
+      }
+      jniContext->transferLog.add(argIdx, arg->name, "reuse buffer", "array not moved", arg->arrayBuffer->lengthInBytes);
+   }
+
+}
 
+/**
+ * manages the memory of array KernelArgs held in device resident buffers.
+ * The java array is never left pinned, so the buffer is only (re)created when the java array reference
+ * changes (updateNonPrimitiveReferences releases it) and a GC move of the array does not touch OpenCL state.
+ *
+ * @param jenv the java environment
+ * @param jniContext the context we got from java
+ * @param arg the argument we're processing
+ * @param argPos out: the position of arg in the opencl argument list
+ * @param argIdx the position of arg in the argument array
+ *
+ * @throws CLException
+ */
+void processDeviceResidentArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
+
+   if (jniContext->profilingRun){
+      arg->arrayBuffer->read.valid = false;
+      arg->arrayBuffer->write.valid = false;
+   }
+
+   if (config->isVerbose()) {
+      fprintf(stderr, "runKernel: device resident array ref %p, ref.mem=%p\n",
+            arg->arrayBuffer->javaArray, 
+            arg->arrayBuffer->mem);
+   }
+
+   if (arg->arrayBuffer->mem == 0){
+      if (!jniContext->firstRun) {
+         jniContext->transfers.add(TransferCounters::REALLOC_NEW_ARRAY);
+      }
+      updateArray(jenv, jniContext, arg, argPos, argIdx);
+      if (jniContext->subDeviceCount > 1) {
+         placeOnSubDevices(jniContext, arg);
+      }
+      jniContext->transferLog.add(argIdx, arg->name, "create buffer", 
+            jniContext->firstRun ? "first run" : "new java array or made device resident", arg->arrayBuffer->lengthInBytes);
    } else {
       // Keep the arg position in sync if no updates were required
       if (arg->usesArrayLength()){
          argPos++;
       }
+      jniContext->transferLog.add(argIdx, arg->name, "reuse buffer", "device resident", arg->arrayBuffer->lengthInBytes);
+   }
+}
+
+/**
+ * first touch a newly created device resident buffer from the NUMA nodes which will use it.
+ * Each node fills the share of the buffer matching its share of the range (see enqueueSubDeviceKernels),
+ * so CPU runtimes which allocate lazily place that staging memory local to the node.
+ *
+ * @param jniContext the context we got from java
+ * @param arg the device resident KernelArg whose buffer was just created
+ *
+ * @throws CLException
+ */
+void placeOnSubDevices(JNIContext* jniContext, KernelArg* arg) {
+   cl_uint nodes = jniContext->subDeviceCount;
+   size_t length = arg->arrayBuffer->lengthInBytes;
+   cl_event* fillEvents = new cl_event[nodes];
+   cl_uint fillEventCount = 0;
+   cl_char zero = 0;
+
+   cl_int status = CL_SUCCESS;
+   for (cl_uint node = 0; node < nodes && status == CL_SUCCESS; node++) {
+      size_t first = (length * node) / nodes;
+      size_t last = (length * (node + 1)) / nodes;
+      if (last > first) {
+         status = CLHelper::enqueueFillBuffer(jniContext->subDeviceQueues[node], arg->arrayBuffer->mem, &zero, sizeof(zero),
+               first, last - first, 0, NULL, &fillEvents[fillEventCount]);
+         if (status == CL_SUCCESS) {
+            fillEventCount++;
+            status = clFlush(jniContext->subDeviceQueues[node]);
+         }
+      }
+   }
+
+   // the array is copied in on the main queue, which does not order against the node queues
+   if (fillEventCount > 0) {
+      cl_int waitStatus = clWaitForEvents(fillEventCount, fillEvents);
+      if (status == CL_SUCCESS) {
+         status = waitStatus;
+      }
    }
+   for (cl_uint i = 0; i < fillEventCount; i++) {
+      clReleaseEvent(fillEvents[i]);
+   }
+   delete[] fillEvents;
+   if (status != CL_SUCCESS) throw CLException(status, "clEnqueueFillBuffer() NUMA placement");
 
+   if (config->isVerbose()){
+      fprintf(stderr, "placed %s across %u NUMA nodes\n", arg->name, nodes);
+   }
 }
 
 void processBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
 
    cl_int status = CL_SUCCESS;
 
-   if (config->isProfilingEnabled()){
+   if (jniContext->profilingRun){
       arg->aparapiBuffer->read.valid = false;
       arg->aparapiBuffer->write.valid = false;
    }
@@ -575,10 +840,11 @@ void processBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& ar
       }
    }
 
-   if (arg->aparapiBuffer->mem != 0) {
-      if (config->isTrackingOpenCLResources()) {
-         memList.remove((cl_mem)arg->aparapiBuffer->mem, __LINE__, __FILE__);
-      }
+   // the buffer is kept between runs unless the java array changed shape
+   bool resized = arg->aparapiBuffer->resize(jenv, arg);
+   if (resized && arg->aparapiBuffer->mem != 0) {
+      memTracker.remove((cl_mem)arg->aparapiBuffer->mem, __LINE__, __FILE__);
+      jniContext->forgetKernelArg(arg->aparapiBuffer->mem);
       status = clReleaseMemObject((cl_mem)arg->aparapiBuffer->mem);
       //fprintf(stdout, "dispose arg %d %0lx\n", i, arg->aparapiBuffer->mem);
 
@@ -586,13 +852,82 @@ void processBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& ar
       CLException::checkCLError(status, "clReleaseMemObject()");
 
       arg->aparapiBuffer->mem = (cl_mem)0;
+      jniContext->transfers.add(TransferCounters::BUFFERS_RELEASED);
+      jniContext->transfers.add(TransferCounters::REALLOC_RESIZED);
+   }
+   if (resized && arg->aparapiBuffer->offsetsMem != 0) {
+      memTracker.remove((cl_mem)arg->aparapiBuffer->offsetsMem, __LINE__, __FILE__);
+      jniContext->forgetKernelArg(arg->aparapiBuffer->offsetsMem);
+      status = clReleaseMemObject((cl_mem)arg->aparapiBuffer->offsetsMem);
+      CLException::checkCLError(status, "clReleaseMemObject()");
+      arg->aparapiBuffer->offsetsMem = (cl_mem)0;
+      jniContext->transfers.add(TransferCounters::BUFFERS_RELEASED);
    }
 
+   if (arg->aparapiBuffer->mem == 0) {
+      jniContext->transferLog.add(argIdx, arg->name, "create buffer", resized ? TransferCounters::reasonOf(TransferCounters::REALLOC_RESIZED)
+            : "first run", arg->aparapiBuffer->lengthInBytes);
+   } else {
+      jniContext->transferLog.add(argIdx, arg->name, "reuse buffer", "same shape", arg->aparapiBuffer->lengthInBytes);
+   }
    updateBuffer(jenv, jniContext, arg, argPos, argIdx);
 
 }
 
 
+/**
+ * copies a java array into its device resident buffer. 
+ * The buffer is mapped (blocking) and the array is only pinned for the memcpy into the mapped region.
+ *
+ * @param jenv the java envrionment
+ * @param jniContext the context we got from java
+ * @param arg the device resident KernelArg to write
+ * @param event out: the event for the unmap which completes the transfer
+ *
+ * @throws CLException
+ */
+cl_int writeDeviceResidentArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, cl_event* event) {
+
+   cl_int status = CL_SUCCESS;
+
+   // the whole buffer is overwritten so the runtime needn't make the old contents visible to us,
+   // but a 1.1 device rejects the 1.2 flag saying so
+   cl_map_flags flags = (jniContext->deviceVersion >= 12) ? CL_MAP_WRITE_INVALIDATE_REGION : CL_MAP_WRITE;
+   void* mapped = clEnqueueMapBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, CL_TRUE, flags, 
+         0, arg->arrayBuffer->lengthInBytes, 0, NULL, NULL, &status);
+   if(status != CL_SUCCESS) throw CLException(status,"clEnqueueMapBuffer() write");
+
+   arg->arrayBuffer->copyIn(jenv, mapped);
+
+   status = clEnqueueUnmapMemObject(jniContext->commandQueue, arg->arrayBuffer->mem, mapped, 0, NULL, event);
+   return status;
+}
+
+/**
+ * copies device resident buffers mapped by getReadEvents back into their java arrays and unmaps them.
+ * Must only be called once the read (map) events have completed.
+ *
+ * @param jenv the java envrionment
+ * @param jniContext the context we got from java
+ *
+ * @throws CLException
+ */
+void readDeviceResidentArrays(JNIEnv* jenv, JNIContext* jniContext) {
+
+   cl_int status = CL_SUCCESS;
+
+   for (int i=0; i< jniContext->argc; i++) {
+      KernelArg *arg = jniContext->args[i];
+      if (arg->isDeviceResident() && arg->arrayBuffer->mapped != NULL) {
+         arg->arrayBuffer->copyOut(jenv, arg->arrayBuffer->mapped, arg->arrayBuffer->mappedStart, arg->arrayBuffer->mappedBytes);
+
+         status = clEnqueueUnmapMemObject(jniContext->commandQueue, arg->arrayBuffer->mem, arg->arrayBuffer->mapped, 0, NULL, NULL);
+         arg->arrayBuffer->mapped = NULL;
+         if(status != CL_SUCCESS) throw CLException(status,"clEnqueueUnmapMemObject()");
+      }
+   }
+}
+
 /**
  * keeps track of write events for KernelArgs.
  *
@@ -607,6 +942,7 @@ void processBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& ar
 void updateWriteEvents(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int argIdx, int& writeEventCount) {
 
    cl_int status = CL_SUCCESS;
+   HostPhase phase(jniContext->hostTiming, HostTiming::WRITE, arg->name);
 
    // we only enqueue a write if we know the kernel actually reads the buffer 
    // or if there is an explicit write pending
@@ -616,20 +952,26 @@ void updateWriteEvents(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int
       jniContext->writeEventArgs[writeEventCount] = argIdx;
    }
 
-   if(arg->isArray()) {
+   if(arg->isDeviceResident()) {
+      status = writeDeviceResidentArray(jenv, jniContext, arg, &(jniContext->writeEvents[writeEventCount]));
+   } else if(arg->isArray()) {
 	  status = clEnqueueWriteBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, CL_FALSE, 0, 
 			 arg->arrayBuffer->lengthInBytes, arg->arrayBuffer->addr, 0, NULL, &(jniContext->writeEvents[writeEventCount]));
    } else if(arg->isAparapiBuffer()) {
-      status = clEnqueueWriteBuffer(jniContext->commandQueue, arg->aparapiBuffer->mem, CL_FALSE, 0, 
-         arg->aparapiBuffer->lengthInBytes, arg->aparapiBuffer->data, 0, NULL, &(jniContext->writeEvents[writeEventCount]));
+      // rows are written as they are packed, the marker completes once they have all landed
+      status = arg->aparapiBuffer->pack(jenv, arg, jniContext->commandQueue);
+      if(status != CL_SUCCESS) throw CLException(status,"clEnqueueWriteBuffer (packed rows)");
+      status = enqueueMarker(jniContext->commandQueue, &(jniContext->writeEvents[writeEventCount]));
    }
    if(status != CL_SUCCESS) throw CLException(status,"clEnqueueWriteBuffer");
 
-   if (config->isTrackingOpenCLResources()){
-      writeEventList.add(jniContext->writeEvents[writeEventCount],__LINE__, __FILE__);
-   }
+   writeEventTracker.add(jniContext->writeEvents[writeEventCount],__LINE__, __FILE__);
    writeEventCount++;
-   if (arg->isExplicit() && arg->isExplicitWrite()){
+   jlong bytes = arg->isAparapiBuffer() ? arg->aparapiBuffer->lengthInBytes : arg->arrayBuffer->lengthInBytes;
+   jniContext->runTotals.uploadBytes += bytes;
+   bool isExplicit = arg->isExplicit() && arg->isExplicitWrite();
+   countTransfer(jniContext, arg, argIdx, true, isExplicit, bytes, isExplicit ? "explicit put" : "read by kernel");
+   if (isExplicit){
       if (config->isVerbose()){
          fprintf(stderr, "clearing explicit buffer bit %d %s\n", argIdx, arg->name);
       }
@@ -640,41 +982,32 @@ void updateWriteEvents(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int
 
 /**
  * sets the opencl kernel arguement for local args.
+ * They are set every run, setKernelArg skips them unless the java array changed size.
  *
  * @param jenv the java envrionment
  * @param jniContext the context we got from java
  * @param arg the KernelArg to create a write event for
- * @param argPos out: the position of arg in the opencl argument list
+ * @param argPos the position of arg in the opencl argument list
  * @param argIdx the position of arg in the argument array
  *
  * @throws CLException
  */
-void processLocalArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
+void processLocalArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int argPos, int argIdx) {
 
-   cl_int status = CL_SUCCESS;
-   // what if local buffer size has changed?  We need a check for resize here.
-   if (jniContext->firstRun) {
-      status = arg->setLocalBufferArg(jenv, argIdx, argPos, config->isVerbose() );
-      if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg() (local)");
-
-      // Add the array length if needed
-      if (arg->usesArrayLength()) {
-         arg->syncJavaArrayLength(jenv);
-
-         status = clSetKernelArg(jniContext->kernel, argPos, sizeof(jint), &(arg->arrayBuffer->length));
+   cl_int status = arg->setLocalBufferArg(jenv, argIdx, argPos, config->isVerbose() );
+   if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg() (local)");
 
-         if (config->isVerbose()){
-            fprintf(stderr, "runKernel arg %d %s, javaArrayLength = %d\n", argIdx, arg->name, arg->arrayBuffer->length);
-         }
+   // Add the array length if needed
+   if (arg->usesArrayLength()) {
+      arg->syncJavaArrayLength(jenv);
 
-         if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (array length)");
+      status = jniContext->setKernelArg(argPos + 1, sizeof(jint), &(arg->arrayBuffer->length));
 
+      if (config->isVerbose()){
+         fprintf(stderr, "runKernel arg %d %s, javaArrayLength = %d\n", argIdx, arg->name, arg->arrayBuffer->length);
       }
-   } else {
-      // Keep the arg position in sync if no updates were required
-      if (arg->usesArrayLength()) {
-         argPos++;
-      }
+
+      if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (array length)");
    }
 }
 
@@ -684,67 +1017,57 @@ void processLocalArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int
  * @param jenv the java envrionment
  * @param jniContext the context we got from java
  * @param arg the KernelArg to create a write event for
- * @param argPos out: the position of arg in the opencl argument list
+ * @param argPos the position of arg in the opencl argument list
  * @param argIdx the position of arg in the argument array
  *
  * @throws CLException
  */
-void processLocalBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
+void processLocalBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int argPos, int argIdx) {
 
-   cl_int status = CL_SUCCESS;
-   // what if local buffer size has changed?  We need a check for resize here.
-   if (jniContext->firstRun) {
-      status = arg->setLocalBufferArg(jenv, argIdx, argPos, config->isVerbose());
-      if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg() (local)");
-
-      // Add the array length if needed
-      if (arg->usesArrayLength()) {
-         arg->syncJavaArrayLength(jenv);
-
-         for(int i = 0; i < arg->aparapiBuffer->numDims; i++)
-         {
-             int length = arg->aparapiBuffer->lens[i];
-             status = clSetKernelArg(jniContext->kernel, argPos, sizeof(jint), &length);
-             if (config->isVerbose()){
-                fprintf(stderr, "runKernel arg %d %s, javaArrayLength = %d\n", argIdx, arg->name, length);
-             }
-             if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (array length)");
-         }
-      }
-   } else {
-      // Keep the arg position in sync if no updates were required
-      if (arg->usesArrayLength()) {
-         argPos += arg->aparapiBuffer->numDims;
+   cl_int status = arg->setLocalAparapiBufferArg(jenv, argIdx, argPos, config->isVerbose());
+   if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg() (local)");
+
+   // Add the array length if needed
+   if (arg->usesArrayLength()) {
+      for(int i = 0; i < arg->aparapiBuffer->numDims; i++)
+      {
+          int length = arg->aparapiBuffer->lens[i];
+          status = jniContext->setKernelArg(argPos + 1 + i, sizeof(jint), &length);
+          if (config->isVerbose()){
+             fprintf(stderr, "runKernel arg %d %s, javaArrayLength = %d\n", argIdx, arg->name, length);
+          }
+          if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg (array length)");
       }
    }
 }
 
-void processLocal(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx) {
-   if(arg->isArray()) processLocalArray(jenv,jniContext,arg,argPos,argIdx);
-   if(arg->isAparapiBuffer()) processLocalBuffer(jenv,jniContext,arg,argPos,argIdx);
-}
-
 
 /**
- * processes all of the arguments for the OpenCL Kernel that we got from the JNIContext
+ * processes all of the arguments for the OpenCL Kernel by running the dispatch plan setArgsJNI compiled
  *
  * @param jenv the java environment
  * @param jniContext the context with the arguements
  * @param writeEventCount out: the number of arguements that could be written to
  * @param argPos out: the absolute position of the last argument
+ * @param chunked true if chunked args will be written chunk by chunk by enqueueChunkedKernel
  *
  * @throws CLException
  */
-int processArgs(JNIEnv* jenv, JNIContext* jniContext, int& argPos, int& writeEventCount) {
+int processArgs(JNIEnv* jenv, JNIContext* jniContext, int& argPos, int& writeEventCount, bool chunked) {
 
    cl_int status = CL_SUCCESS;
+   DispatchPlan* plan = jniContext->plan;
+   if (plan == NULL) throw CLException(CL_INVALID_KERNEL_ARGS, "processArgs() args were never set");
+   HostPhase phase(jniContext->hostTiming, HostTiming::ARGS);
+
+   for (size_t i = 0; i < plan->ops.size(); i++) {
 
-   // argPos is used to keep track of the kernel arg position, it can 
-   // differ from "argIdx" due to insertion of javaArrayLength args which are not
-   // fields read from the kernel object.
-   for (int argIdx = 0; argIdx < jniContext->argc; argIdx++, argPos++) {
+      const DispatchPlan::Op& op = plan->ops[i];
+      KernelArg *arg = op.arg;
+      int argIdx = op.argIdx;
 
-      KernelArg *arg = jniContext->args[argIdx];
+      // the process functions step their own copy of the position over the hidden args
+      int opPos = op.argPos;
 
       // make sure that the JNI arg reflects the latest type info from the instance.
       // For example if the buffer is tagged as explicit and needs to be pushed
@@ -754,32 +1077,75 @@ int processArgs(JNIEnv* jenv, JNIContext* jniContext, int& argPos, int& writeEve
          fprintf(stderr, "got type for arg %d, %s, type=%08x\n", argIdx, arg->name, arg->type);
       }
 
-      if (!arg->isPrimitive() && !arg->isLocal()) {
-          processObject(jenv, jniContext, arg, argPos, argIdx);
-
-          if (arg->needToEnqueueWrite() && (!arg->isConstant() || arg->isExplicitWrite())) {
-              if (config->isVerbose()) {
-                  fprintf(stderr, "%swriting %s%sbuffer argIndex=%d argPos=%d %s\n",  
-                        (arg->isExplicit() ? "explicitly " : ""), 
-                        (arg->isConstant() ? "constant " : ""), 
-                        (arg->isLocal() ? "local " : ""), 
-                        argIdx,
-                        argPos,
-                        arg->name);
-              }
-              updateWriteEvents(jenv, jniContext, arg, argIdx, writeEventCount);
-          }
-      } else if (arg->isLocal()) {
-          processLocal(jenv, jniContext, arg, argPos, argIdx);
-      } else {  // primitive arguments
-         status = arg->setPrimitiveArg(jenv, argIdx, argPos, config->isVerbose());
-         if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg()");
+      switch (op.kind) {
+         case DispatchPlan::OP_ARRAY:
+            if (arg->isDeviceResident()) {
+               processDeviceResidentArray(jenv, jniContext, arg, opPos, argIdx);
+            } else {
+               processArray(jenv, jniContext, arg, opPos, argIdx);
+            }
+            break;
+         case DispatchPlan::OP_BUFFER:
+            processBuffer(jenv, jniContext, arg, opPos, argIdx);
+            break;
+         case DispatchPlan::OP_LOCAL_ARRAY:
+            processLocalArray(jenv, jniContext, arg, opPos, argIdx);
+            break;
+         case DispatchPlan::OP_LOCAL_BUFFER:
+            processLocalBuffer(jenv, jniContext, arg, opPos, argIdx);
+            break;
+         case DispatchPlan::OP_PRIMITIVE:
+            status = arg->setPrimitiveArg(jenv, argIdx, opPos, config->isVerbose());
+            if(status != CL_SUCCESS) throw CLException(status,"clSetKernelArg()");
+            break;
+      }
+
+      if (op.kind != DispatchPlan::OP_ARRAY && op.kind != DispatchPlan::OP_BUFFER) {
+         continue;
+      }
+      if (!arg->needToEnqueueWrite() || (arg->isConstant() && !arg->isExplicitWrite()) || (chunked && isChunkedTransfer(arg))) {
+         if (jniContext->transferLog.isEnabled()) {
+            const char* reason = (chunked && isChunkedTransfer(arg)) ? "written chunk by chunk"
+                  : (arg->isExplicit() ? "explicit, no put pending"
+                  : (arg->isConstant() ? "constant" : "not read by kernel"));
+            jniContext->transferLog.add(argIdx, arg->name, "skip upload", reason, 0);
+         }
+      } else {
+         if (config->isVerbose()) {
+            fprintf(stderr, "%swriting %s%sbuffer argIndex=%d argPos=%d %s\n",  
+                  (arg->isExplicit() ? "explicitly " : ""), 
+                  (arg->isConstant() ? "constant " : ""), 
+                  (arg->isLocal() ? "local " : ""), 
+                  argIdx,
+                  op.argPos,
+                  arg->name);
+         }
+         updateWriteEvents(jenv, jniContext, arg, argIdx, writeEventCount);
       }
+   }  // for each op
 
-   }  // for each arg
+   argPos = plan->argCount;
    return status;
 }
 
+/**
+ * fix for Mac OSX CPU driver (and possibly others) 
+ * which fail to give correct maximum work group info
+ * while using clGetDeviceInfo
+ * see: http://www.openwall.com/lists/john-dev/2012/04/10/4
+ *
+ * The work group size is cached per kernel by the context, so this only queries the driver once.
+ *
+ * @param jniContext the context with the kernel
+ * @param range in/out: the range whose local size is clamped to the kernel's work group size
+ */
+void clampLocalSize(JNIContext* jniContext, Range& range) {
+   size_t maxGroupSize = jniContext->getWorkGroupSize(jniContext->kernel);
+   if (maxGroupSize > 0) {
+      range.localDims[0] = std::min(range.localDims[0], maxGroupSize);
+   }
+}
+
 /**
  * enqueus the current kernel to run on opencl 
  * 
@@ -792,6 +1158,8 @@ int processArgs(JNIEnv* jenv, JNIContext* jniContext, int& argPos, int& writeEve
  * @throws CLException
  */
 void enqueueKernel(JNIContext* jniContext,  Range& range, int passes, int argPos, int writeEventCount){
+   HostPhase phase(jniContext->hostTiming, HostTiming::ENQUEUE);
+
    // We will need to revisit the execution of multiple devices.  
    // POssibly cloning the range per device and mutating each to handle a unique subrange (of global) and
    // maybe even pushing the offset into the range class.
@@ -800,22 +1168,54 @@ void enqueueKernel(JNIContext* jniContext,  Range& range, int passes, int argPos
    //   size_t localSize_0AsSizeT = range.localDims[0];
 
    // To support multiple passes we add a 'secret' final arg called 'passid' and just schedule multiple enqueuendrange kernels.  Each of which having a separate value of passid
+   // clSetKernelArg is captured by each enqueue, so passid is just a launch parameter of its pass.
+   // Each pass waits on the one before through its event rather than us waiting on the host, the host only waits
+   // once for the reads (or the last pass) in waitForReadEvents.
 
 
    // delete the last set
-   if (jniContext->exec) {
-      delete jniContext->exec;
+   releaseSubDeviceEvents(jniContext);
+   releasePassEvents(jniContext);
+   // a run which is not profiled keeps the profile of the last one that was, unless the passes changed
+   bool keepProfile = !jniContext->profilingRun && jniContext->exec != NULL && jniContext->passes == passes;
+   if (jniContext->exec && !keepProfile) {
+      delete[] jniContext->exec;
       jniContext->exec = NULL;
    } 
    jniContext->passes = passes;
-   jniContext->exec = new ProfileInfo[passes];
+   if (!keepProfile) {
+      jniContext->exec = new ProfileInfo[passes];
+   }
+
+   if (jniContext->subDeviceCount > 1) {
+      if (!keepProfile || jniContext->subDeviceExec == NULL) {
+         delete[] jniContext->subDeviceExec;
+         jniContext->subDeviceExec = new ProfileInfo[passes * jniContext->subDeviceCount];
+      }
+      jniContext->subDeviceEvents = new cl_event[passes * jniContext->subDeviceCount];
+      for (cl_uint i = 0; i < passes * jniContext->subDeviceCount; i++) {
+         jniContext->subDeviceEvents[i] = NULL;
+      }
+   }
+
+   // the queue is in order so a single device only needs the events of earlier passes to profile them,
+   // the nodes of a NUMA split device run on their own queues so each pass must wait on the last
+   bool keepPassEvents = passes > 1 && (jniContext->profilingRun || jniContext->subDeviceCount > 1);
+   if (keepPassEvents) {
+      jniContext->passEvents = new cl_event[passes - 1];
+      for (int i = 0; i < passes - 1; i++) {
+         jniContext->passEvents[i] = NULL;
+      }
+   }
 
    cl_kernel kernel = jniContext->kernel;
 
+   clampLocalSize(jniContext, range);
+   size_t* localDims = LocalSizeTuner::choose(jniContext, range);
+
    cl_int status = CL_SUCCESS;
    for (int passid=0; passid < passes; passid++) {
 
-      //size_t offset = 1; // (size_t)((range.globalDims[0]/jniContext->deviceIdc)*dev);
       status = clSetKernelArg(kernel, argPos, sizeof(passid), &(passid));
       if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() (passid)");
 
@@ -824,523 +1224,1353 @@ void enqueueKernel(JNIContext* jniContext,  Range& range, int passes, int argPos
       // list of events to wait for
       cl_event* writeEvents = NULL;
 
-
-
-      // -----------
-      // fix for Mac OSX CPU driver (and possibly others) 
-      // which fail to give correct maximum work group info
-      // while using clGetDeviceInfo
-      // see: http://www.openwall.com/lists/john-dev/2012/04/10/4
-      cl_uint max_group_size[3];
-      status = clGetKernelWorkGroupInfo(kernel,
-                                        (cl_device_id)jniContext->deviceId,
-                                        CL_KERNEL_WORK_GROUP_SIZE,
-                                        sizeof(max_group_size),
-                                        &max_group_size, NULL);
-      
-      if (status != CL_SUCCESS) {
-         CLException(status, "clGetKernelWorkGroupInfo()").printError();
-      } else {
-         range.localDims[0] = std::min((cl_uint)range.localDims[0], max_group_size[0]);
-      }
-
-      // ------ end fix
-
-        
-      // two options here due to passid
-      // there may be 1 or more passes
-      // enqueue depends on write enqueues 
-      // we don't block but and we populate the executeEvents
+      // the first pass depends on the write enqueues, later passes on the pass before
       if (passid == 0) {
-
          writeCount = writeEventCount;
          if(writeEventCount > 0) {
             writeEvents = jniContext->writeEvents;
          }
+      } else if (keepPassEvents) {
+         writeCount = 1;
+         writeEvents = &jniContext->passEvents[passid - 1];
+      }
 
-      // we are in some passid > 0 pass 
-      // maybe middle or last!
-      // we don't depend on write enqueues
-      // we block and do supply executeEvents 
-      } else {
-         //fprintf(stderr, "setting passid to %d of %d not first not last\n", passid, passes);
-         
-         status = clWaitForEvents(1, &jniContext->executeEvents[0]);
-         if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() execute event");
-
-         if (config->isTrackingOpenCLResources()) {
-            executeEventList.remove(jniContext->executeEvents[0],__LINE__, __FILE__);
-         }
+      // the last pass fills executeEvents[0] which the reads wait on
+      bool lastPass = (passid == passes - 1);
+      cl_event* executeEvent = lastPass ? &jniContext->executeEvents[0] : (keepPassEvents ? &jniContext->passEvents[passid] : NULL);
 
-         status = clReleaseEvent(jniContext->executeEvents[0]);
-         if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
+      if (jniContext->subDeviceCount > 1 && jniContext->rangeSplittable) {
+         status = enqueueSubDeviceKernels(jniContext, range, passid, writeCount, writeEvents, executeEvent);
+      } else {
+         status = clEnqueueNDRangeKernel(
+               jniContext->commandQueue,
+               kernel,
+               range.dims,
+               range.offsets,
+               range.globalDims,
+               localDims,
+               writeCount,
+               writeEvents,
+               executeEvent);
+      }
 
-         // We must capture any profile info for passid-1  so we must wait for the last execution to complete
-         if (passid == 1 && config->isProfilingEnabled()) {
+      if (status != CL_SUCCESS) {
 
-            // Now we can profile info for passid-1 
-            status = profile(&jniContext->exec[passid-1], &jniContext->executeEvents[0], 1, NULL, jniContext->profileBaseTime);
-            if (status != CL_SUCCESS) throw CLException(status,"");
+         for(int i = 0; i<range.dims;i++) {
+            fprintf(stderr, "after clEnqueueNDRangeKernel, globalSize[%d] = %d, localSize[%d] = %d\n",
+                  i, (int)range.globalDims[i], i, (int)range.localDims[i]);
          }
+         throw CLException(status, "clEnqueueNDRangeKernel()");
+      }
 
+      if (executeEvent != NULL){
+         executeEventTracker.add(*executeEvent,__LINE__, __FILE__);
       }
+    
+   }
 
+   LocalSizeTuner::track(jniContext, jniContext->executeEvents[0]);
+}
+
+/**
+ * profiles and releases the execute events of the passes before the last of a multi pass execution.
+ * Only called once the execution has completed (or failed), never waits.
+ *
+ * @param jniContext the context with the events
+ */
+void releasePassEvents(JNIContext* jniContext) {
+   if (jniContext->passEvents == NULL) {
+      return;
+   }
+   for (int pass = 0; pass < jniContext->passes - 1; pass++) {
+      cl_event* event = &jniContext->passEvents[pass];
+      if (*event == NULL) {
+         continue;
+      }
+      if (jniContext->profilingRun && jniContext->exec != NULL) {
+         profile(&jniContext->exec[pass], event, 1, NULL, jniContext->profileBaseTime);
+      }
+      recordEvent(jniContext, *event, Profiler::EXECUTE, NULL, pass);
+      jniContext->runTotals.executeNanos += eventNanos(jniContext, *event);
+      executeEventTracker.remove(*event, __LINE__, __FILE__);
+      clReleaseEvent(*event);
+      *event = NULL;
+   }
+   delete[] jniContext->passEvents;
+   jniContext->passEvents = NULL;
+}
+
+// a slice enqueued at a global offset sees its own global size and group count, and group ids counted from its 
+// first group, rather than those of the whole range
+static const char* RANGE_MARKERS[] = { "get_global_size", "get_num_groups", "get_group_id", NULL };
+
+/**
+ * check whether the program reads any builtin which differs between the whole range and a slice of it, 
+ * only programs which don't are split across NUMA nodes, chunks or devices
+ */
+void inspectRangeBuiltins(JNIEnv* jenv, JNIContext* jniContext, jstring source) {
+   const char* sourceChars = jenv->GetStringUTFChars(source, NULL);
+   jniContext->rangeSplittable = true;
+   for (int i = 0; RANGE_MARKERS[i] != NULL; i++) {
+      if (strstr(sourceChars, RANGE_MARKERS[i]) != NULL) {
+         jniContext->rangeSplittable = false;
+      }
+   }
+   jenv->ReleaseStringUTFChars(source, sourceChars);
+   if (!jniContext->rangeSplittable && config->isVerbose()) {
+      fprintf(stderr, "kernel uses its global size, group count or group ids, its range is never split\n");
+   }
+}
+
+/**
+ * enqueues one pass of the current kernel split across the NUMA nodes of a CPU device.
+ * The work groups of the outermost dimension are shared evenly between the nodes, so each node gets a contiguous
+ * block of rows. A marker on the main queue joins the nodes, its event stands for the whole pass so the reads and
+ * profiling which follow are unchanged. The node events are kept for releaseSubDeviceEvents.
+ *
+ * @param jniContext the context with the arguements
+ * @param range the range that the kernel is running over, left unchanged
+ * @param passid the pass being enqueued
+ * @param writeCount the number of events in writeEvents
+ * @param writeEvents the events the pass depends on
+ * @param executeEvent out: the event of the marker joining the nodes
+ *
+ * @return the status of the first enqueue which failed
+ */
+cl_int enqueueSubDeviceKernels(JNIContext* jniContext, Range& range, int passid, int writeCount, cl_event* writeEvents, cl_event* executeEvent) {
+   cl_int status = CL_SUCCESS;
+   cl_uint nodes = jniContext->subDeviceCount;
+   int dim = range.dims - 1;
+   size_t offset = range.offsets[dim];
+   size_t globalSize = range.globalDims[dim];
+   size_t localSize = range.localDims[dim];
+   size_t groups = globalSize / localSize;
+   cl_event* passEvents = &jniContext->subDeviceEvents[passid * nodes];
+   cl_event* joinEvents = new cl_event[nodes];
+   cl_uint joinEventCount = 0;
+
+   for (cl_uint node = 0; node < nodes && status == CL_SUCCESS; node++) {
+      size_t first = (groups * node) / nodes;
+      size_t last = (groups * (node + 1)) / nodes;
+      if (last == first) {
+         continue;
+      }
+      range.offsets[dim] = offset + first * localSize;
+      range.globalDims[dim] = (last - first) * localSize;
       status = clEnqueueNDRangeKernel(
-            jniContext->commandQueue,
-            kernel,
+            jniContext->subDeviceQueues[node],
+            jniContext->kernel,
             range.dims,
             range.offsets,
             range.globalDims,
             range.localDims,
             writeCount,
             writeEvents,
-            &jniContext->executeEvents[0]);
+            &passEvents[node]);
+      if (status == CL_SUCCESS) {
+         joinEvents[joinEventCount++] = passEvents[node];
+         status = clFlush(jniContext->subDeviceQueues[node]);
+      }
+   }
+   range.offsets[dim] = offset;
+   range.globalDims[dim] = globalSize;
 
-      if (status != CL_SUCCESS) {
+   if (status == CL_SUCCESS) {
+      status = CLHelper::enqueueMarkerWithWaitList(jniContext->commandQueue, joinEventCount, joinEvents, executeEvent);
+   }
+   delete[] joinEvents;
+   return status;
+}
 
-         for(int i = 0; i<range.dims;i++) {
-            fprintf(stderr, "after clEnqueueNDRangeKernel, globalSize[%d] = %d, localSize[%d] = %d\n",
-                  i, (int)range.globalDims[i], i, (int)range.localDims[i]);
+/**
+ * profiles and releases the node execute events of the last execution of a NUMA split context.
+ * The execute profile of each pass is widened to span all of its nodes.
+ * Only called once the execution has completed (or failed), never waits.
+ *
+ * @param jniContext the context with the events
+ */
+void releaseSubDeviceEvents(JNIContext* jniContext) {
+   if (jniContext->subDeviceEvents == NULL) {
+      return;
+   }
+   cl_uint nodes = jniContext->subDeviceCount;
+   for (int pass = 0; pass < jniContext->passes; pass++) {
+      cl_ulong start = 0;
+      cl_ulong end = 0;
+      for (cl_uint node = 0; node < nodes; node++) {
+         cl_event* event = &jniContext->subDeviceEvents[pass * nodes + node];
+         if (*event == NULL) {
+            continue;
          }
-         throw CLException(status, "clEnqueueNDRangeKernel()");
+         if (jniContext->profilingRun) {
+            ProfileInfo* nodeExec = &jniContext->subDeviceExec[pass * nodes + node];
+            if (profile(nodeExec, event, 1, jniContext->subDeviceNames[node], jniContext->profileBaseTime) == CL_SUCCESS) {
+               if (end == 0 || nodeExec->start < start) {
+                  start = nodeExec->start;
+               }
+               if (nodeExec->end > end) {
+                  end = nodeExec->end;
+               }
+            }
+         }
+         recordEvent(jniContext, *event, Profiler::EXECUTE, jniContext->subDeviceNames[node], pass);
+         clReleaseEvent(*event);
+         *event = NULL;
+      }
+      if (end > 0 && jniContext->exec != NULL) {
+         jniContext->exec[pass].start = start;
+         jniContext->exec[pass].end = end;
       }
+   }
+   delete[] jniContext->subDeviceEvents;
+   jniContext->subDeviceEvents = NULL;
+}
+
 
-      if(config->isTrackingOpenCLResources()){
-         executeEventList.add(jniContext->executeEvents[0],__LINE__, __FILE__);
+/**
+ * set readEvents and readArgEvents
+ * readEvents[] will be populated with the event's that we will wait on below.  
+ * readArgEvents[] will map the readEvent to the arg that originated it
+ * So if we had
+ *     arg[0]  read_write array
+ *     arg[1]  read array
+ *     arg[2]  write array
+ *     arg[3]  primitive
+ *     arg[4]  read array
+ * At the end of the call
+ *     readCount=3
+ *     readEvent[0] = new read event for arg0
+ *     readArgEvent[0] = 0
+ *     readEvent[1] = new read event for arg1
+ *     readArgEvent[1] = 1
+ *     readEvent[2] = new read event for arg4
+ *     readArgEvent[2] = 4
+ *
+ * @param jniContext the context we got from Java
+ * @param chunked true if chunked args have already been read back chunk by chunk by enqueueChunkedKernel
+ *
+ * @return number of reads. 
+ * It will never be > jniContext->argc which is the size of readEvents[] and readEventArgs[]
+ *
+ * @throws CLException
+ */
+int getReadEvents(JNIEnv* jenv, JNIContext* jniContext, bool chunked) {
+
+   int readEventCount = 0; 
+   HostPhase phase(jniContext->hostTiming, HostTiming::READ);
+
+   cl_int status = CL_SUCCESS;
+   for (int i=0; i< jniContext->argc; i++) {
+      KernelArg *arg = jniContext->args[i];
+
+      if (!arg->isExplicit() && arg->needToEnqueueRead() && !(chunked && isChunkedTransfer(arg))){
+         if (arg->isConstant()){
+            fprintf(stderr, "reading %s\n", arg->name);
+         }
+         if (config->isProfilingEnabled()) {
+            jniContext->readEventArgs[readEventCount] = i;
+         }
+         if (config->isVerbose()){
+            fprintf(stderr, "reading buffer %d %s\n", i, arg->name);
+         }
+
+         if(arg->isDeviceResident()) {
+            // we map rather than read, checkEvents copies the mapped region back into the java array
+            arg->arrayBuffer->mappedStart = 0;
+            arg->arrayBuffer->mappedBytes = arg->arrayBuffer->lengthInBytes;
+            arg->arrayBuffer->mapped = clEnqueueMapBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, 
+                CL_FALSE, CL_MAP_READ, 0, arg->arrayBuffer->lengthInBytes, 1, 
+                jniContext->executeEvents, &(jniContext->readEvents[readEventCount]), &status);
+         } else if(arg->isArray()) {
+            status = clEnqueueReadBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, 
+                CL_FALSE, 0, arg->arrayBuffer->lengthInBytes, arg->arrayBuffer->addr, 1, 
+                jniContext->executeEvents, &(jniContext->readEvents[readEventCount]));
+         } else if(arg->isAparapiBuffer()) {
+            // checkEvents inflates the java array once all the reads have completed
+            status = clEnqueueReadBuffer(jniContext->commandQueue, arg->aparapiBuffer->mem, 
+                CL_FALSE, 0, arg->aparapiBuffer->lengthInBytes, arg->aparapiBuffer->data, 1, 
+                jniContext->executeEvents, &(jniContext->readEvents[readEventCount]));
+            arg->aparapiBuffer->readPending = true;
+         }
+
+         if (status != CL_SUCCESS) throw CLException(status, "clEnqueueReadBuffer()");
+
+         readEventTracker.add(jniContext->readEvents[readEventCount],__LINE__, __FILE__);
+         readEventCount++;
+         jlong bytes = arg->isAparapiBuffer() ? arg->aparapiBuffer->lengthInBytes : arg->arrayBuffer->lengthInBytes;
+         jniContext->runTotals.readbackBytes += bytes;
+         countTransfer(jniContext, arg, i, false, false, bytes, "written by kernel");
+      } else if (jniContext->transferLog.isEnabled() && (arg->isArray() || arg->isAparapiBuffer()) && arg->isGlobal()) {
+         const char* reason = arg->isExplicit() ? "explicit, left for get"
+               : ((chunked && isChunkedTransfer(arg)) ? "read chunk by chunk" : "not written by kernel");
+         jniContext->transferLog.add(i, arg->name, "skip download", reason, 0);
       }
-    
    }
+   return readEventCount;
 }
 
+/**
+ * wait for and release all the read events
+ *
+ * @param jniContext the context we got from Java
+ * @param readEventCount the number of read events to wait for
+ * @param passes the number of passes for the kernel
+ *
+ * @throws CLException
+ */
+void waitForReadEvents(JNIContext* jniContext, int readEventCount, int passes) {
+
+   // don't change the order here
+   // We wait for the reads which each depend on the execution, which depends on the writes ;)
+   // So after the reads have completed, we can release the execute and writes.
+   
+   cl_int status = CL_SUCCESS;
+
+   {
+      HostPhase phase(jniContext->hostTiming, HostTiming::WAIT);
+      if (readEventCount > 0){
+         status = clWaitForEvents(readEventCount, jniContext->readEvents);
+         if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() read events");
+      } else {
+         // if readEventCount == 0 then we don't need any reads so we just wait for the executions to complete
+         status = clWaitForEvents(1, jniContext->executeEvents);
+         if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() execute event");
+      }
+   }
+
+   releaseReadEvents(jniContext, readEventCount, passes);
+}
 
 /**
- * enqueus the current kernel to run on opencl - temporary hack to run a named kernel
- * "proper" implementation should have some way of passing a handle back to java app
- * 
- * @param jniContext the context with the arguements
- * @param range the range that the kernel is running over
+ * profile and release the (completed) read events and profile the execution.
+ * This never waits so it is safe to call from an event callback.
+ *
+ * @param jniContext the context we got from Java
+ * @param readEventCount the number of read events to release
  * @param passes the number of passes for the kernel
- * @param argPos the number of arguments we passed to the kernel
- * @param writeEventCount the number of arguement that will be updated
  *
  * @throws CLException
  */
-/*
-void enqueueKernel(JNIContext* jniContext, const char* name , Range& range, int passes, int argPos, int writeEventCount){
-   // We will need to revisit the execution of multiple devices.  
-   // POssibly cloning the range per device and mutating each to handle a unique subrange (of global) and
-   // maybe even pushing the offset into the range class.
+void releaseReadEvents(JNIContext* jniContext, int readEventCount, int passes) {
 
-   //   size_t globalSize_0AsSizeT = (range.globalDims[0] /jniContext->deviceIdc);
-   //   size_t localSize_0AsSizeT = range.localDims[0];
+   cl_int status = CL_SUCCESS;
 
-   // To support multiple passes we add a 'secret' final arg called 'passid' and just schedule multiple enqueuendrange kernels.  Each of which having a separate value of passid
+   for (int i=0; i < readEventCount; i++){
 
+      if (jniContext->profilingRun) {
 
-   // delete the last set
-   if (jniContext->exec) {
-      delete jniContext->exec;
+         KernelArg* arg = jniContext->args[jniContext->readEventArgs[i]];
+         ProfileInfo* read = arg->isAparapiBuffer() ? &arg->aparapiBuffer->read : &arg->arrayBuffer->read;
+         status = profile(read, &jniContext->readEvents[i], 0, arg->name, jniContext->profileBaseTime);
+         if (status != CL_SUCCESS) throw CLException(status, "");
+      }
+      recordArgEvent(jniContext, jniContext->readEvents[i], Profiler::READ, jniContext->readEventArgs, i, passes - 1);
+      jniContext->runTotals.readbackNanos += eventNanos(jniContext, jniContext->readEvents[i]);
+      status = clReleaseEvent(jniContext->readEvents[i]);
+      if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
+
+      readEventTracker.remove(jniContext->readEvents[i],__LINE__, __FILE__);
+   }
+
+   executeEventTracker.remove(jniContext->executeEvents[0],__LINE__, __FILE__);
+   if (jniContext->profilingRun) {
+      status = profile(&jniContext->exec[passes-1], &jniContext->executeEvents[0], 1, NULL, jniContext->profileBaseTime); // multi gpu ?
+      if (status != CL_SUCCESS) throw CLException(status, "");
+   }
+   recordEvent(jniContext, jniContext->executeEvents[0], Profiler::EXECUTE, NULL, passes - 1);
+   jniContext->runTotals.executeNanos += eventNanos(jniContext, jniContext->executeEvents[0]);
+
+   LocalSizeTuner::complete(jniContext);
+   releasePassEvents(jniContext);
+   releaseSubDeviceEvents(jniContext);
+}
+
+/**
+ * check to make sure opencl exited correctly and update java memory.
+ *
+ * @param jenv the java environment
+ * @param jniContext the context we got from Java
+ * @param writeEventCount the number of write events to wait for
+ *
+ * @throws CLException
+ */
+void checkEvents(JNIEnv* jenv, JNIContext* jniContext, int writeEventCount) {
+   // extract the execution status from the executeEvent
+   cl_int status;
+   cl_int executeStatus;
+   {
+      HostPhase phase(jniContext->hostTiming, HostTiming::COMPLETE);
+
+      status = clGetEventInfo(jniContext->executeEvents[0], CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &executeStatus, NULL);
+      if (status != CL_SUCCESS) throw CLException(status, "clGetEventInfo() execute event");
+      if (executeStatus != CL_COMPLETE) throw CLException(executeStatus, "Execution status of execute event");
+
+      status = clReleaseEvent(jniContext->executeEvents[0]);
+      if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
+
+      for (int i = 0; i < writeEventCount; i++) {
+
+         if (jniContext->profilingRun) {
+            KernelArg* arg = jniContext->args[jniContext->writeEventArgs[i]];
+            ProfileInfo* write = arg->isAparapiBuffer() ? &arg->aparapiBuffer->write : &arg->arrayBuffer->write;
+            profile(write, &jniContext->writeEvents[i], 2, arg->name, jniContext->profileBaseTime);
+         }
+         recordArgEvent(jniContext, jniContext->writeEvents[i], Profiler::WRITE, jniContext->writeEventArgs, i, 0);
+         jniContext->runTotals.uploadNanos += eventNanos(jniContext, jniContext->writeEvents[i]);
+
+         status = clReleaseEvent(jniContext->writeEvents[i]);
+         if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() write event");
+
+         writeEventTracker.remove(jniContext->writeEvents[i],__LINE__, __FILE__);
+      }
+
+      readDeviceResidentArrays(jenv, jniContext);
+      AparapiBuffer::inflateAll(jenv, jniContext->args, jniContext->argc, jniContext->rowCopyJobs);
+      jniContext->unpinAll(jenv);
+   }
+
+   reportHostTiming(jniContext);
+   jniContext->latency.recordRun(jniContext->runTotals, isTimedRun(jniContext));
+   if (config->isProfilingCSVEnabled() && jniContext->profilingRun) {
+      writeProfileInfo(jniContext);
+   }
+   jniContext->firstRun = false;
+}
+
+/**
+ * determine whether this execution can be split into chunks over the global range.
+ * We only chunk single pass 1D executions which have at least one chunked arg, and whose global size is still a
+ * whole number of work groups once the local size is clamped to the kernel's limit (chunks are cut at group
+ * boundaries, so a partial last group would never be enqueued). Kernels reading their global size, group count or
+ * group ids run whole, a chunk would see its own.
+ *
+ * @param jniContext the context we got from Java
+ * @param range the range that the kernel is running over
+ * @param passes the number of passes for the kernel
+ * @param chunks the number of chunks requested
+ */
+bool canRunChunked(JNIContext* jniContext, Range& range, int passes, int chunks) {
+   // NUMA split contexts already run the nodes side by side
+   if (chunks < 2 || passes != 1 || range.dims != 1 || jniContext->subDeviceCount > 1) {
+      return false;
+   }
+   if (!jniContext->rangeSplittable) {
+      if (config->isVerbose()){
+         fprintf(stderr, "not chunking, kernel uses its global size, group count or group ids\n");
+      }
+      return false;
+   }
+   bool hasChunkedArg = false;
+   for (int i=0; i< jniContext->argc && !hasChunkedArg; i++) {
+      hasChunkedArg = isChunkedTransfer(jniContext->args[i]);
+   }
+   if (!hasChunkedArg) {
+      return false;
+   }
+   clampLocalSize(jniContext, range);
+   if (range.globalDims[0] % range.localDims[0] != 0) {
+      if (config->isVerbose()){
+         fprintf(stderr, "not chunking, global size %d is not a multiple of local size %d\n", 
+               (int)range.globalDims[0], (int)range.localDims[0]);
+      }
+      return false;
+   }
+   return true;
+}
+
+/**
+ * compute the byte range of a chunked arg touched by work items [offset, offset+count)
+ *
+ * @param arg the chunked arg
+ * @param offset the first global id of the chunk
+ * @param count the number of work items in the chunk
+ * @param start out: the first byte touched
+ * @param bytes out: the number of bytes touched
+ *
+ * @return false if the chunk does not touch this arg at all
+ */
+bool chunkSlice(KernelArg* arg, size_t offset, size_t count, size_t& start, size_t& bytes) {
+   return rangeSlice(arg, arg->chunkStride, offset, count, start, bytes);
+}
+
+/**
+ * compute the byte range of an array arg touched by work items [offset, offset+count) 
+ * when each work item touches stride elements
+ *
+ * @param arg the array arg
+ * @param stride the number of elements per work item
+ * @param offset the first global id
+ * @param count the number of work items
+ * @param start out: the first byte touched
+ * @param bytes out: the number of bytes touched
+ *
+ * @return false if the work items do not touch this arg at all
+ */
+bool rangeSlice(KernelArg* arg, size_t stride, size_t offset, size_t count, size_t& start, size_t& bytes) {
+   size_t elementBytes = argSize(arg) * stride;
+   size_t lengthInBytes = (size_t)arg->arrayBuffer->lengthInBytes;
+   start = offset * elementBytes;
+   if (start >= lengthInBytes) {
+      return false;
+   }
+   bytes = std::min(count * elementBytes, lengthInBytes - start);
+   return true;
+}
+
+/**
+ * enqueues a single pass execution split into chunks over the global range.
+ * Chunked args are written on jniContext->writeQueue, executed on jniContext->commandQueue and read back on 
+ * jniContext->readQueue so the transfers of one chunk overlap with the execution of its neighbours.
+ * All other args are written/read as a whole by processArgs/getReadEvents as usual.
+ *
+ * On return jniContext->executeEvents[0] holds the execution event of the last chunk, 
+ * the remaining events are in jniContext->chunkEvents and are released by waitForChunkEvents.
+ *
+ * @param jenv the java environment
+ * @param jniContext the context with the arguements
+ * @param range the range that the kernel is running over
+ * @param chunks the number of chunks to split the range into
+ * @param argPos the number of arguments we passed to the kernel
+ * @param writeEventCount the number of whole arg writes that the first chunk must wait for
+ *
+ * @throws CLException
+ */
+void enqueueChunkedKernel(JNIEnv* jenv, JNIContext* jniContext, Range& range, int chunks, int argPos, int writeEventCount) {
+
+   cl_int status = CL_SUCCESS;
+   HostPhase phase(jniContext->hostTiming, HostTiming::ENQUEUE);
+
+   releasePassEvents(jniContext);
+   bool keepProfile = !jniContext->profilingRun && jniContext->exec != NULL && jniContext->passes == 1;
+   if (jniContext->exec && !keepProfile) {
+      delete[] jniContext->exec;
       jniContext->exec = NULL;
    } 
-   jniContext->passes = passes;
-   jniContext->exec = new ProfileInfo[passes];
+   jniContext->passes = 1;
+   if (!keepProfile) {
+      jniContext->exec = new ProfileInfo[1];
+   }
 
-   JNIContext::KernelMap::iterator it = jniContext->kernelMap.find(name);
-   if (it == jniContext->kernelMap.end() ) 
-	     throw CLException(0, "KernelMap name is not known");
-   
-   cl_kernel kernel = it->second;
+   int passid = 0;
+   status = clSetKernelArg(jniContext->kernel, argPos, sizeof(passid), &(passid));
+   if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() (passid)");
+
+   // canRunChunked has already clamped the local size to one which divides the global size
+
+   if (jniContext->writeQueue == 0) {
+      cl_command_queue_properties queue_props = 0;
+      if (jniContext->timedQueues) {
+         queue_props |= CL_QUEUE_PROFILING_ENABLE;
+      }
+
+      jniContext->writeQueue = DeviceRegistry::acquireQueue(jniContext->context, (cl_device_id)jniContext->deviceId, queue_props, &status);
+      if(status != CL_SUCCESS) throw CLException(status,"clCreateCommandQueue()");
+      commandQueueTracker.add(jniContext->writeQueue, __LINE__, __FILE__);
+
+      jniContext->readQueue = DeviceRegistry::acquireQueue(jniContext->context, (cl_device_id)jniContext->deviceId, queue_props, &status);
+      if(status != CL_SUCCESS) throw CLException(status,"clCreateCommandQueue()");
+      commandQueueTracker.add(jniContext->readQueue, __LINE__, __FILE__);
+   }
+
+   int chunkedArgs = 0;
+   for (int i=0; i< jniContext->argc; i++) {
+      KernelArg *arg = jniContext->args[i];
+      if (isChunkedTransfer(arg)) {
+         chunkedArgs++;
+         // device resident arrays are not left pinned by processArgs, chunks are copied straight from the java array
+         if (!arg->arrayBuffer->isPinned) {
+            HostPhase phase(jniContext->hostTiming, HostTiming::PIN, arg->name);
+            arg->pin(jenv);
+         }
+      }
+   }
+
+   size_t localSize = range.localDims[0];
+   size_t groups = range.globalDims[0] / localSize;
+   size_t groupsPerChunk = (groups + chunks - 1) / chunks;
+
+   jniContext->chunkEvents = new cl_event[chunks * (2 * chunkedArgs + 1)];
+   jniContext->chunkEventCount = 0;
+   cl_event* waitEvents = new cl_event[writeEventCount + chunkedArgs];
+   cl_event executeEvent = NULL;
+
+   try {
+      for (size_t firstGroup = 0; firstGroup < groups; firstGroup += groupsPerChunk) {
+         size_t offset = range.offsets[0] + firstGroup * localSize;
+         size_t count = std::min(groupsPerChunk, groups - firstGroup) * localSize;
+         size_t start = 0;
+         size_t bytes = 0;
+
+         // the first chunk also waits for the args written as a whole
+         int waitCount = 0;
+         if (firstGroup == 0) {
+            for (int i = 0; i < writeEventCount; i++) {
+               waitEvents[waitCount++] = jniContext->writeEvents[i];
+            }
+         }
+
+         for (int i=0; i< jniContext->argc; i++) {
+            KernelArg *arg = jniContext->args[i];
+            if (isChunkedTransfer(arg) && arg->needToEnqueueWrite() && chunkSlice(arg, offset, count, start, bytes)) {
+               status = clEnqueueWriteBuffer(jniContext->writeQueue, arg->arrayBuffer->mem, CL_FALSE, start, bytes,
+                     (char*)arg->arrayBuffer->addr + start, 0, NULL, &waitEvents[waitCount]);
+               if (status != CL_SUCCESS) throw CLException(status, "clEnqueueWriteBuffer() (chunk)");
+               jniContext->runTotals.uploadBytes += bytes;
+               countTransfer(jniContext, arg, i, true, false, bytes, "chunk read by kernel");
+               jniContext->chunkEvents[jniContext->chunkEventCount++] = waitEvents[waitCount++];
+            }
+         }
+
+         // all but the last execute event are released with the transfer events
+         if (executeEvent != NULL) {
+            jniContext->chunkEvents[jniContext->chunkEventCount++] = executeEvent;
+         }
+
+         status = clEnqueueNDRangeKernel(jniContext->commandQueue, jniContext->kernel, 1, &offset, &count, &localSize,
+               waitCount, (waitCount > 0) ? waitEvents : NULL, &executeEvent);
+         if (status != CL_SUCCESS) {
+            fprintf(stderr, "after clEnqueueNDRangeKernel, chunk offset = %d, globalSize = %d, localSize = %d\n",
+                  (int)offset, (int)count, (int)localSize);
+            throw CLException(status, "clEnqueueNDRangeKernel() (chunk)");
+         }
+
+         for (int i=0; i< jniContext->argc; i++) {
+            KernelArg *arg = jniContext->args[i];
+            if (isChunkedTransfer(arg) && arg->needToEnqueueRead() && chunkSlice(arg, offset, count, start, bytes)) {
+               status = clEnqueueReadBuffer(jniContext->readQueue, arg->arrayBuffer->mem, CL_FALSE, start, bytes,
+                     (char*)arg->arrayBuffer->addr + start, 1, &executeEvent, &jniContext->chunkEvents[jniContext->chunkEventCount]);
+               if (status != CL_SUCCESS) throw CLException(status, "clEnqueueReadBuffer() (chunk)");
+               jniContext->runTotals.readbackBytes += bytes;
+               countTransfer(jniContext, arg, i, false, false, bytes, "chunk written by kernel");
+               jniContext->chunkEventCount++;
+            }
+         }
+
+         if (config->isVerbose()){
+            fprintf(stderr, "enqueued chunk offset=%d globalSize=%d\n", (int)offset, (int)count);
+         }
+
+         // make sure this chunk is submitted before we enqueue the next one
+         clFlush(jniContext->writeQueue);
+         clFlush(jniContext->commandQueue);
+         clFlush(jniContext->readQueue);
+      }
+   } catch(CLException& cle) {
+      delete[] waitEvents;
+      if (executeEvent != NULL) {
+         jniContext->chunkEvents[jniContext->chunkEventCount++] = executeEvent;
+      }
+      throw;
+   }
+
+   delete[] waitEvents;
+
+   jniContext->executeEvents[0] = executeEvent;
+   executeEventTracker.add(jniContext->executeEvents[0],__LINE__, __FILE__);
+}
+
+/**
+ * add the device time of a completed chunk event to the run totals of the transfer or execution it was
+ */
+void addChunkNanos(JNIContext* jniContext, cl_event event) {
+   jlong nanos = eventNanos(jniContext, event);
+   if (nanos == 0) {
+      return;
+   }
+   cl_command_type command = 0;
+   clGetEventInfo(event, CL_EVENT_COMMAND_TYPE, sizeof(command), &command, NULL);
+   if (command == CL_COMMAND_WRITE_BUFFER) {
+      jniContext->runTotals.uploadNanos += nanos;
+   } else if (command == CL_COMMAND_READ_BUFFER) {
+      jniContext->runTotals.readbackNanos += nanos;
+   } else if (command == CL_COMMAND_NDRANGE_KERNEL) {
+      jniContext->runTotals.executeNanos += nanos;
+   }
+}
+
+/**
+ * wait for and release the transfer and execute events of a chunked execution
+ *
+ * @param jniContext the context we got from Java
+ *
+ * @throws CLException
+ */
+void waitForChunkEvents(JNIContext* jniContext) {
 
    cl_int status = CL_SUCCESS;
-   for (int passid=0; passid < passes; passid++) {
 
-      //size_t offset = 1; // (size_t)((range.globalDims[0]/jniContext->deviceIdc)*dev);
-      status = clSetKernelArg(kernel, argPos, sizeof(passid), &(passid));
-      if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() (passid)");
+   if (jniContext->chunkEvents == NULL) {
+      return;
+   }
 
-      // wait for this event count
-      int writeCount = 0;
-      // list of events to wait for
-      cl_event* writeEvents = NULL;
+   if (jniContext->chunkEventCount > 0) {
+      HostPhase phase(jniContext->hostTiming, HostTiming::WAIT);
+      status = clWaitForEvents(jniContext->chunkEventCount, jniContext->chunkEvents);
+   }
 
+   for (int i = 0; i < jniContext->chunkEventCount; i++) {
+      if (status == CL_SUCCESS) {
+         // transfers and executes are interleaved, the type comes from each event's command
+         recordEvent(jniContext, jniContext->chunkEvents[i], Profiler::UNKNOWN, NULL, 0);
+         addChunkNanos(jniContext, jniContext->chunkEvents[i]);
+      }
+      clReleaseEvent(jniContext->chunkEvents[i]);
+   }
+   delete[] jniContext->chunkEvents;
+   jniContext->chunkEvents = NULL;
+   jniContext->chunkEventCount = 0;
 
+   if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() chunk events");
+}
 
-      // -----------
-      // fix for Mac OSX CPU driver (and possibly others) 
-      // which fail to give correct maximum work group info
-      // while using clGetDeviceInfo
-      // see: http://www.openwall.com/lists/john-dev/2012/04/10/4
-      cl_uint max_group_size[3];
-      status = clGetKernelWorkGroupInfo(kernel,
-                                        (cl_device_id)jniContext->deviceId,
-                                        CL_KERNEL_WORK_GROUP_SIZE,
-                                        sizeof(max_group_size),
-                                        &max_group_size, NULL);
-      
-      if (status != CL_SUCCESS) {
-         CLException(status, "clGetKernelWorkGroupInfo()").printError();
-      } else {
-         range.localDims[0] = std::min((cl_uint)range.localDims[0], max_group_size[0]);
+/**
+ * runs the kernel, either as a whole or (if requested and possible) split into chunks over the global range.
+ *
+ * @param jenv the java environment
+ * @param jobj the KernelRunner
+ * @param jniContext the context we got from Java
+ * @param range the range that the kernel is running over
+ * @param needSync true if the array refs may have changed since the last run
+ * @param passes the number of passes for the kernel
+ * @param chunks the number of chunks requested, less than 2 runs the kernel as a whole
+ */
+jint runKernel(JNIEnv *jenv, jobject jobj, JNIContext* jniContext, Range& range, jboolean needSync, jint passes, jint chunks) {
+
+   cl_int status = CL_SUCCESS;
+   jlong started = HostTiming::now();
+   jniContext->runs++;
+
+   if (jniContext->firstRun && config->isProfilingEnabled()){
+      try {
+         profileFirstRun(jniContext);
+      } catch(CLException& cle) {
+         cle.printError();
+         return 0L;
       }
-      // ------ end fix
+   }
+   startRun(jniContext, config->isProfilingEnabled() && jniContext->sampler.sample());
 
-        
-      // two options here due to passid
-      // there may be 1 or more passes
-      // enqueue depends on write enqueues 
-      // we don't block but and we populate the executeEvents
-      if (passid == 0) {
 
-         writeCount = writeEventCount;
-         if(writeEventCount > 0) {
-            writeEvents = jniContext->writeEvents;
-         }
+   int argPos = 0;
+   // Need to capture array refs
+   if (jniContext->firstRun || needSync) {
+      try {
+         updateNonPrimitiveReferences(jenv, jobj, jniContext);
+      } catch (CLException& cle) {
+          cle.printError();
+      }
+      if (config->isVerbose()){
+         fprintf(stderr, "back from updateNonPrimitiveReferences\n");
+      }
+   }
 
-      // we are in some passid > 0 pass 
-      // maybe middle or last!
-      // we don't depend on write enqueues
-      // we block and do supply executeEvents 
+
+   try {
+      int writeEventCount = 0;
+      if (jniContext->subDeviceCount > 1 || jniContext->zeroCopy) {
+         // the staging buffers are placed on the nodes which use them, zero copy devices use them for every array
+         makeArraysDeviceResident(jniContext, false);
       } else {
-         //fprintf(stderr, "setting passid to %d of %d not first not last\n", passid, passes);
-         
-         status = clWaitForEvents(1, &jniContext->executeEvents[0]);
-         if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() execute event");
+         endAsyncResidency(jniContext);
+      }
+      bool chunked = canRunChunked(jniContext, range, passes, chunks);
+      processArgs(jenv, jniContext, argPos, writeEventCount, chunked);
+      if (chunked) {
+         enqueueChunkedKernel(jenv, jniContext, range, chunks, argPos, writeEventCount);
+      } else {
+         enqueueKernel(jniContext, range, passes, argPos, writeEventCount);
+      }
+      int readEventCount = getReadEvents(jenv, jniContext, chunked);
+      waitForReadEvents(jniContext, readEventCount, passes);
+      waitForChunkEvents(jniContext);
+      checkEvents(jenv, jniContext, writeEventCount);
+   }
+   catch(CLException& cle) {
+      cle.printError();
+      try {
+         waitForChunkEvents(jniContext);
+      } catch(CLException& chunkCle) {
+         chunkCle.printError();
+      }
+      jniContext->unpinAll(jenv);
+      return cle.status();
+   }
+
+   jlong nanos = HostTiming::now() - started;
+   jniContext->latency.record(KernelLatency::RUN_NANOS, nanos);
+   jniContext->sampler.completed(jniContext->profilingRun, nanos);
+   //fprintf(stderr, "About to return %d from exec\n", status);
+   return(status);
+}
 
-         if (config->isTrackingOpenCLResources()) {
-            executeEventList.remove(jniContext->executeEvents[0],__LINE__, __FILE__);
+/**
+ * release the buffer of an array arg so processArgs recreates it, as it moves in or out of device residency
+ */
+void releaseArrayBuffer(JNIContext* jniContext, KernelArg* arg) {
+   memTracker.remove(arg->arrayBuffer->mem,__LINE__, __FILE__);
+   jniContext->forgetKernelArg(arg->arrayBuffer->mem);
+   cl_int status = clReleaseMemObject((cl_mem)arg->arrayBuffer->mem);
+   if(status != CL_SUCCESS) throw CLException(status, "clReleaseMemObject()");
+   arg->arrayBuffer->mem = (cl_mem)0;
+   jniContext->transfers.add(TransferCounters::BUFFERS_RELEASED);
+}
+
+/**
+ * switch array args over to device resident buffers so that no java array is left pinned (or in use by
+ * the device through CL_MEM_USE_HOST_PTR) once we return to java.
+ * Buffers created around a pinned array are released, processDeviceResidentArray recreates them.
+ *
+ * @param jniContext the context we got from Java
+ * @param async true if only the async execution being started needs them, the next synchronous execution
+ *        goes back to the configured mode (see endAsyncResidency)
+ *
+ * @throws CLException
+ */
+void makeArraysDeviceResident(JNIContext* jniContext, bool async) {
+   for (int i = 0; i < jniContext->argc; i++) {
+      KernelArg *arg = jniContext->args[i];
+      if (!arg->isBackedByArray()) {
+         continue;
+      }
+      bool resident = arg->isDeviceResident();
+      if (!resident) {
+         if (arg->arrayBuffer->mem != 0) {
+            releaseArrayBuffer(jniContext, arg);
+         }
+         if (config->isVerbose()){
+            fprintf(stderr, "making %s device resident\n", arg->name);
          }
+      }
+      if (!async) {
+         arg->arrayBuffer->deviceResident = true;
+         arg->arrayBuffer->asyncResident = false;
+      } else if (!resident) {
+         arg->arrayBuffer->asyncResident = true;
+      }
+   }
+}
 
-         status = clReleaseEvent(jniContext->executeEvents[0]);
-         if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
+/**
+ * put array args made device resident by an async execution back in the configured mode, so a synchronous
+ * execution transfers them as it would have had no async execution come before it.
+ * Only called once any async execution has completed.
+ *
+ * @param jniContext the context we got from Java
+ *
+ * @throws CLException
+ */
+void endAsyncResidency(JNIContext* jniContext) {
+   for (int i = 0; i < jniContext->argc; i++) {
+      KernelArg *arg = jniContext->args[i];
+      if (!arg->isBackedByArray() || !arg->arrayBuffer->asyncResident) {
+         continue;
+      }
+      arg->arrayBuffer->asyncResident = false;
+      if (!arg->isDeviceResident() && arg->arrayBuffer->mem != 0) {
+         releaseArrayBuffer(jniContext, arg);
+      }
+   }
+}
 
-         // We must capture any profile info for passid-1  so we must wait for the last execution to complete
-         if (passid == 1 && config->isProfilingEnabled()) {
+/**
+ * called by OpenCL once the marker behind an async execution has completed.
+ * Does what waitForReadEvents and checkEvents do for a synchronous execution, without waiting,
+ * then completes the java future.
+ *
+ * @param event the marker event
+ * @param eventStatus CL_COMPLETE or a negative error if the execution was abnormally terminated
+ * @param userData the AsyncRun
+ */
+void CL_CALLBACK asyncRunComplete(cl_event, cl_int eventStatus, void* userData) {
+   AsyncRun* run = (AsyncRun*)userData;
+
+   bool attached = false;
+   JNIEnv* jenv = JNIHelper::attachCurrentThread(run->jvm, attached);
+   if (jenv == NULL) {
+      // the future can't be completed from here (nor its global ref deleted), so leave the failure on the
+      // context where KernelRunner.awaitPendingExecution polls for it
+      fprintf(stderr, "!!!!!!! async execution callback could not attach to the jvm\n");
+      try {
+         releaseReadEvents(run->jniContext, run->readEventCount, run->passes);
+      } catch(CLException& cle) {
+         cle.printError();
+      }
+      clReleaseEvent(run->marker);
+      JNIContext* jniContext = run->jniContext;
+      delete run;
+      memoryBarrier();
+      jniContext->asyncFailure = (eventStatus < 0) ? eventStatus : CL_OUT_OF_RESOURCES;
+      return;
+   }
 
-            // Now we can profile info for passid-1 
-            status = profile(&jniContext->exec[passid-1], &jniContext->executeEvents[0], 1, NULL, jniContext->profileBaseTime);
-            if (status != CL_SUCCESS) throw CLException(status,"");
-         }
+   jint status = (eventStatus < 0) ? eventStatus : CL_SUCCESS;
+   try {
+      releaseReadEvents(run->jniContext, run->readEventCount, run->passes);
+      checkEvents(jenv, run->jniContext, run->writeEventCount);
+   } catch(CLException& cle) {
+      cle.printError();
+      run->jniContext->unpinAll(jenv);
+      status = cle.status();
+   }
+
+   clReleaseEvent(run->marker);
+   if (status == CL_SUCCESS) {
+      jlong nanos = HostTiming::now() - run->started;
+      run->jniContext->latency.record(KernelLatency::RUN_NANOS, nanos);
+      run->jniContext->sampler.completedAsync(run->jniContext->profilingRun, nanos);
+   }
+
+   if (config->isVerbose()){
+      fprintf(stderr, "async execution completed with status %d\n", status);
+   }
+
+   JNIHelper::callVoid(jenv, run->future, "complete", ArgsVoidReturn(IntArg), status);
+   jenv->DeleteGlobalRef(run->future);
+   JavaVM* jvm = run->jvm;
+   delete run;
 
+   JNIHelper::detachCurrentThread(jvm, attached);
+}
+
+/**
+ * enqueue the writes, the execution and the reads without waiting for them.
+ * A marker enqueued behind the reads calls asyncRunComplete which releases the events, captures the 
+ * profile, copies the results back into the java arrays and completes the future.
+ * Chunked execution is not supported, the range runs as a whole.
+ *
+ * @param jenv the java environment
+ * @param jobj the KernelRunner
+ * @param jniContext the context we got from Java
+ * @param range the range that the kernel is running over
+ * @param needSync true if the array refs may have changed since the last run
+ * @param passes the number of passes for the kernel
+ * @param future the CompletionFuture to complete
+ * @return CL_SUCCESS if the execution was enqueued, otherwise the future is never completed
+ */
+jint runKernelAsync(JNIEnv *jenv, jobject jobj, JNIContext* jniContext, Range& range, jboolean needSync, jint passes, jobject future) {
+
+   cl_int status = CL_SUCCESS;
+   jlong started = HostTiming::now();
+   jniContext->runs++;
+
+   if (jniContext->firstRun && config->isProfilingEnabled()){
+      try {
+         profileFirstRun(jniContext);
+      } catch(CLException& cle) {
+         cle.printError();
+         return cle.status();
       }
+   }
+   startRun(jniContext, config->isProfilingEnabled() && jniContext->sampler.sample());
 
-      status = clEnqueueNDRangeKernel(
-            jniContext->commandQueue,
-            kernel,
-            range.dims,
-            range.offsets,
-            range.globalDims,
-            range.localDims,
-            writeCount,
-            writeEvents,
-            &jniContext->executeEvents[0]);
+   // Need to capture array refs
+   if (jniContext->firstRun || needSync) {
+      try {
+         updateNonPrimitiveReferences(jenv, jobj, jniContext);
+      } catch (CLException& cle) {
+          cle.printError();
+      }
+   }
 
+   jniContext->asyncFailure = 0;
+   AsyncRun* run = new AsyncRun();
+   jenv->GetJavaVM(&run->jvm);
+   run->started = started;
+   run->jniContext = jniContext;
+   run->future = NULL;
+   run->passes = passes;
+
+   try {
+      int argPos = 0;
+      int writeEventCount = 0;
+      makeArraysDeviceResident(jniContext, true);
+      processArgs(jenv, jniContext, argPos, writeEventCount, false);
+      enqueueKernel(jniContext, range, passes, argPos, writeEventCount);
+      run->writeEventCount = writeEventCount;
+      run->readEventCount = getReadEvents(jenv, jniContext, false);
+
+      // the queue is in order, so the marker completes after everything enqueued above
+      status = enqueueMarker(jniContext->commandQueue, &run->marker);
+      if (status != CL_SUCCESS) throw CLException(status, "clEnqueueMarker() async execution");
+
+      run->future = jenv->NewGlobalRef(future);
+      status = clSetEventCallback(run->marker, CL_COMPLETE, asyncRunComplete, run);
       if (status != CL_SUCCESS) {
+         jenv->DeleteGlobalRef(run->future);
+         clReleaseEvent(run->marker);
+         throw CLException(status, "clSetEventCallback() async execution");
+      }
+   }
+   catch(CLException& cle) {
+      cle.printError();
+      // nothing will complete this execution, so let whatever was enqueued drain before java falls back
+      clFinish(jniContext->commandQueue);
+      jniContext->unpinAll(jenv);
+      delete run;
+      return cle.status();
+   }
 
-         for(int i = 0; i<range.dims;i++) {
-            fprintf(stderr, "after clEnqueueNDRangeKernel, globalSize[%d] = %d, localSize[%d] = %d\n",
-                  i, (int)range.globalDims[i], i, (int)range.localDims[i]);
+   // run now belongs to asyncRunComplete, make sure the work is submitted
+   status = clFlush(jniContext->commandQueue);
+   if (status != CL_SUCCESS) {
+      fprintf(stderr, "clFlush() async execution failed %s\n", CLHelper::errString(status));
+   }
+
+   return(CL_SUCCESS);
+}
+
+/**
+ * determine whether an execution can be split across several device contexts.
+ * We only split single pass 1D executions without explicit buffers, whose outputs are
+ * all @Kernel.Chunked primitive arrays. Those declare which slice each work item writes, we can't tell which
+ * elements a scatter or reduction writes, so merging by slice would drop its writes outside the slice.
+ * Kernels reading their global size, group count or group ids run on one device, a share would see its own.
+ *
+ * @param jniContexts the device contexts, all sharing the same args
+ * @param contextCount the number of device contexts
+ * @param range the range that the kernel is running over
+ * @param passes the number of passes for the kernel
+ */
+bool canRunMultiDevice(JNIContext** jniContexts, int contextCount, Range& range, int passes) {
+   if (contextCount < 2 || passes != 1 || range.dims != 1) {
+      return false;
+   }
+   for (int i = 0; i < contextCount; i++) {
+      if (!jniContexts[i]->rangeSplittable) {
+         if (config->isVerbose()){
+            fprintf(stderr, "not splitting across devices, kernel uses its global size, group count or group ids\n");
          }
-         throw CLException(status, "clEnqueueNDRangeKernel()");
+         return false;
       }
-
-      if(config->isTrackingOpenCLResources()){
-         executeEventList.add(jniContext->executeEvents[0],__LINE__, __FILE__);
+   }
+   JNIContext* jniContext = jniContexts[0];
+   for (int i=0; i< jniContext->argc; i++) {
+      KernelArg *arg = jniContext->args[i];
+      if (arg->isExplicit()) {
+         return false;
+      }
+      if (arg->isAparapiBuffer() && arg->isMutableByKernel()) {
+         return false;
+      }
+      if (arg->needToEnqueueRead() && (argSize(arg) == 0 || !arg->isChunked() || arg->chunkStride <= 0)) {
+         if (config->isVerbose()){
+            fprintf(stderr, "not splitting across devices, %s is written but not chunked\n", arg->name);
+         }
+         return false;
       }
-    
    }
+   return true;
 }
-*/
 
 /**
- * set readEvents and readArgEvents
- * readEvents[] will be populated with the event's that we will wait on below.  
- * readArgEvents[] will map the readEvent to the arg that originated it
- * So if we had
- *     arg[0]  read_write array
- *     arg[1]  read array
- *     arg[2]  write array
- *     arg[3]  primitive
- *     arg[4]  read array
- * At the end of the call
- *     readCount=3
- *     readEvent[0] = new read event for arg0
- *     readArgEvent[0] = 0
- *     readEvent[1] = new read event for arg1
- *     readArgEvent[1] = 1
- *     readEvent[2] = new read event for arg4
- *     readArgEvent[2] = 4
+ * map the slice of each output array written by work items [offset, offset+count) for reading.
+ * checkEvents copies only that slice back into the java array, so each device of a split 
+ * execution merges its own part of the outputs. All arrays must be device resident, and all outputs 
+ * chunked (see canRunMultiDevice).
  *
- * @param jniContext the context we got from Java
+ * @param jenv the java envrionment
+ * @param jniContext the context of one of the devices
+ * @param offset the first global id run by this device
+ * @param count the number of work items run by this device
  *
- * @return number of reads. 
- * It will never be > jniContext->argc which is the size of readEvents[] and readEventArgs[]
+ * @return the number of read events created
  *
  * @throws CLException
  */
-int getReadEvents(JNIEnv* jenv, JNIContext* jniContext) {
+int getSliceReadEvents(JNIEnv* jenv, JNIContext* jniContext, size_t offset, size_t count) {
 
    int readEventCount = 0; 
+   HostPhase phase(jniContext->hostTiming, HostTiming::READ);
 
    cl_int status = CL_SUCCESS;
    for (int i=0; i< jniContext->argc; i++) {
       KernelArg *arg = jniContext->args[i];
+      size_t start = 0;
+      size_t bytes = 0;
 
-      if (!arg->isExplicit() && arg->needToEnqueueRead()){
-         if (arg->isConstant()){
-            fprintf(stderr, "reading %s\n", arg->name);
-         }
+      if (arg->needToEnqueueRead() && arg->isDeviceResident()
+            && chunkSlice(arg, offset, count, start, bytes)) {
          if (config->isProfilingEnabled()) {
             jniContext->readEventArgs[readEventCount] = i;
          }
          if (config->isVerbose()){
-            fprintf(stderr, "reading buffer %d %s\n", i, arg->name);
-         }
-
-         if(arg->isArray()) {
-            status = clEnqueueReadBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, 
-                CL_FALSE, 0, arg->arrayBuffer->lengthInBytes, arg->arrayBuffer->addr, 1, 
-                jniContext->executeEvents, &(jniContext->readEvents[readEventCount]));
-         } else if(arg->isAparapiBuffer()) {
-            status = clEnqueueReadBuffer(jniContext->commandQueue, arg->aparapiBuffer->mem, 
-                CL_TRUE, 0, arg->aparapiBuffer->lengthInBytes, arg->aparapiBuffer->data, 1, 
-                jniContext->executeEvents, &(jniContext->readEvents[readEventCount]));
-            arg->aparapiBuffer->inflate(jenv, arg);
+            fprintf(stderr, "reading slice %lu+%lu of buffer %d %s\n", (unsigned long)start, (unsigned long)bytes, i, arg->name);
          }
 
-         if (status != CL_SUCCESS) throw CLException(status, "clEnqueueReadBuffer()");
+         arg->arrayBuffer->mappedStart = start;
+         arg->arrayBuffer->mappedBytes = bytes;
+         arg->arrayBuffer->mapped = clEnqueueMapBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, 
+               CL_FALSE, CL_MAP_READ, start, bytes, 1, 
+               jniContext->executeEvents, &(jniContext->readEvents[readEventCount]), &status);
+         if (status != CL_SUCCESS) throw CLException(status, "clEnqueueMapBuffer() (slice)");
 
-         if (config->isTrackingOpenCLResources()){
-            readEventList.add(jniContext->readEvents[readEventCount],__LINE__, __FILE__);
-         }
+         readEventTracker.add(jniContext->readEvents[readEventCount],__LINE__, __FILE__);
          readEventCount++;
+         jniContext->runTotals.readbackBytes += bytes;
+         countTransfer(jniContext, arg, i, false, false, bytes, "slice written by device");
       }
    }
    return readEventCount;
 }
 
 /**
- * wait for and release all the read events
+ * run one execution split across several device contexts, each with its own buffers.
+ * Device d runs work items [offsets[d], offsets[d]+counts[d]) of the 1D range. Every array is made device 
+ * resident, inputs are written to each device and outputs are read back from each device only over the 
+ * slice written by its work items. The devices run concurrently, we only wait once everything is enqueued.
+ * If the execution can't be split the whole range runs on the first context.
  *
- * @param jniContext the context we got from Java
- * @param readEventCount the number of read events to wait for
+ * @param jenv the java environment
+ * @param jobj the KernelRunner
+ * @param jniContexts the device contexts, all built from the same source and args
+ * @param contextCount the number of device contexts
+ * @param range the range that the kernel is running over
+ * @param needSync true if the array refs may have changed since the last run
  * @param passes the number of passes for the kernel
- *
- * @throws CLException
+ * @param offsets the first global id run by each device (relative to the range)
+ * @param counts the number of work items run by each device, a multiple of the local size
  */
-void waitForReadEvents(JNIContext* jniContext, int readEventCount, int passes) {
+jint runKernelMulti(JNIEnv *jenv, jobject jobj, JNIContext** jniContexts, int contextCount, Range& range, jboolean needSync, jint passes, jint* offsets, jint* counts) {
 
-   // don't change the order here
-   // We wait for the reads which each depend on the execution, which depends on the writes ;)
-   // So after the reads have completed, we can release the execute and writes.
-   
-   cl_int status = CL_SUCCESS;
+   if (!canRunMultiDevice(jniContexts, contextCount, range, passes)) {
+      return runKernel(jenv, jobj, jniContexts[0], range, needSync, passes, 1);
+   }
 
-   if (readEventCount > 0){
+   size_t globalOffset = range.offsets[0];
+   size_t globalSize = range.globalDims[0];
+   int* writeEventCounts = new int[contextCount];
+   int* readEventCounts = new int[contextCount];
+   bool* active = new bool[contextCount];
+   for (int d = 0; d < contextCount; d++) {
+      active[d] = false;
+   }
 
-      status = clWaitForEvents(readEventCount, jniContext->readEvents);
-      if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() read events");
+   jint status = CL_SUCCESS;
+   jlong started = HostTiming::now();
+   bool sampled = config->isProfilingEnabled() && jniContexts[0]->sampler.sample();
+   try {
+      for (int d = 0; d < contextCount; d++) {
+         if (counts[d] <= 0) {
+            continue;
+         }
+         JNIContext* jniContext = jniContexts[d];
+         jniContext->runs++;
+         if (jniContext->firstRun && config->isProfilingEnabled()){
+            profileFirstRun(jniContext);
+         }
+         // the devices of a run are profiled together, as sampled by the first
+         startRun(jniContext, sampled);
+         if (jniContext->firstRun || needSync) {
+            updateNonPrimitiveReferences(jenv, jobj, jniContext);
+         }
+         makeArraysDeviceResident(jniContext, false);
 
-      for (int i=0; i < readEventCount; i++){
+         int argPos = 0;
+         writeEventCounts[d] = 0;
+         active[d] = true;
+         processArgs(jenv, jniContext, argPos, writeEventCounts[d], false);
 
-         if (config->isProfilingEnabled()) {
+         range.offsets[0] = globalOffset + offsets[d];
+         range.globalDims[0] = counts[d];
+         enqueueKernel(jniContext, range, passes, argPos, writeEventCounts[d]);
+         readEventCounts[d] = getSliceReadEvents(jenv, jniContext, range.offsets[0], range.globalDims[0]);
 
-            status = profile(&jniContext->args[jniContext->readEventArgs[i]]->arrayBuffer->read, &jniContext->readEvents[i], 0,jniContext->args[jniContext->readEventArgs[i]]->name, jniContext->profileBaseTime);
-            if (status != CL_SUCCESS) throw CLException(status, "");
-         }
-         status = clReleaseEvent(jniContext->readEvents[i]);
-         if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
+         // get this device going while we upload to the next
+         cl_int flushStatus = clFlush(jniContext->commandQueue);
+         if (flushStatus != CL_SUCCESS) throw CLException(flushStatus, "clFlush()");
+      }
+      range.offsets[0] = globalOffset;
+      range.globalDims[0] = globalSize;
 
-         if (config->isTrackingOpenCLResources()){
-            readEventList.remove(jniContext->readEvents[i],__LINE__, __FILE__);
+      for (int d = 0; d < contextCount; d++) {
+         if (active[d]) {
+            waitForReadEvents(jniContexts[d], readEventCounts[d], passes);
+            checkEvents(jenv, jniContexts[d], writeEventCounts[d]);
          }
       }
-   } else {
-      // if readEventCount == 0 then we don't need any reads so we just wait for the executions to complete
-      status = clWaitForEvents(1, jniContext->executeEvents);
-      if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() execute event");
+      // the kernel's end to end latency is kept by its first context
+      jlong nanos = HostTiming::now() - started;
+      jniContexts[0]->latency.record(KernelLatency::RUN_NANOS, nanos);
+      jniContexts[0]->sampler.completed(sampled, nanos);
    }
-
-   if (config->isTrackingOpenCLResources()){
-      executeEventList.remove(jniContext->executeEvents[0],__LINE__, __FILE__);
-   }
-   if (config->isProfilingEnabled()) {
-      status = profile(&jniContext->exec[passes-1], &jniContext->executeEvents[0], 1, NULL, jniContext->profileBaseTime); // multi gpu ?
-      if (status != CL_SUCCESS) throw CLException(status, "");
+   catch(CLException& cle) {
+      cle.printError();
+      range.offsets[0] = globalOffset;
+      range.globalDims[0] = globalSize;
+      for (int d = 0; d < contextCount; d++) {
+         if (active[d]) {
+            clFinish(jniContexts[d]->commandQueue);
+            jniContexts[d]->unpinAll(jenv);
+         }
+      }
+      status = cle.status();
    }
 
+   delete[] writeEventCounts;
+   delete[] readEventCounts;
+   delete[] active;
+   return(status);
 }
 
-/**
- * check to make sure opencl exited correctly and update java memory.
- *
- * @param jenv the java environment
- * @param jniContext the context we got from Java
- * @param writeEventCount the number of write events to wait for
- *
- * @throws CLException
- */
-void checkEvents(JNIEnv* jenv, JNIContext* jniContext, int writeEventCount) {
-   // extract the execution status from the executeEvent
-   cl_int status;
-   cl_int executeStatus;
-
-   status = clGetEventInfo(jniContext->executeEvents[0], CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &executeStatus, NULL);
-   if (status != CL_SUCCESS) throw CLException(status, "clGetEventInfo() execute event");
-   if (executeStatus != CL_COMPLETE) throw CLException(executeStatus, "Execution status of execute event");
-
-   status = clReleaseEvent(jniContext->executeEvents[0]);
-   if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
-
-   for (int i = 0; i < writeEventCount; i++) {
+JNI_JAVA(jint, KernelRunnerJNI, runKernelJNI)
+   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject _range, jboolean needSync, jint passes) {
+      Config::init(jenv);
 
-      if (config->isProfilingEnabled()) {
-         profile(&jniContext->args[jniContext->writeEventArgs[i]]->arrayBuffer->write, &jniContext->writeEvents[i], 2, jniContext->args[jniContext->writeEventArgs[i]]->name, jniContext->profileBaseTime);
-      }
+      JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
 
-      status = clReleaseEvent(jniContext->writeEvents[i]);
-      if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() write event");
+      Range range(jenv, _range, (jniContext != NULL) ? jniContext->state : NULL);
 
-      if (config->isTrackingOpenCLResources()){
-         writeEventList.remove(jniContext->writeEvents[i],__LINE__, __FILE__);
-      }
+      return runKernel(jenv, jobj, jniContext, range, needSync, passes, 1);
    }
 
-   jniContext->unpinAll(jenv);
+JNI_JAVA(jint, KernelRunnerJNI, runKernelChunkedJNI)
+   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject _range, jboolean needSync, jint passes, jint chunks) {
+      Config::init(jenv);
 
-   if (config->isProfilingCSVEnabled()) {
-      writeProfileInfo(jniContext);
-   }
-   if (config->isTrackingOpenCLResources()){
-      fprintf(stderr, "following execution of kernel{\n");
-      commandQueueList.report(stderr);
-      memList.report(stderr); 
-      readEventList.report(stderr); 
-      executeEventList.report(stderr); 
-      writeEventList.report(stderr); 
-      fprintf(stderr, "}\n");
-   }
+      JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
 
-   jniContext->firstRun = false;
-}
+      Range range(jenv, _range, (jniContext != NULL) ? jniContext->state : NULL);
 
-JNI_JAVA(jint, KernelRunnerJNI, runKernelJNI)
-   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject _range, jboolean needSync, jint passes) {
-      if (config == NULL){
-         config = new Config(jenv);
-      }
+      return runKernel(jenv, jobj, jniContext, range, needSync, passes, chunks);
+   }
 
-      Range range(jenv, _range);
+JNI_JAVA(jint, KernelRunnerJNI, runKernelAsyncJNI)
+   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject _range, jboolean needSync, jint passes, jobject future) {
+      Config::init(jenv);
 
-      cl_int status = CL_SUCCESS;
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
 
+      Range range(jenv, _range, (jniContext != NULL) ? jniContext->state : NULL);
 
-      if (jniContext->firstRun && config->isProfilingEnabled()){
-         try {
-            profileFirstRun(jniContext);
-         } catch(CLException& cle) {
-            cle.printError();
-            return 0L;
-         }
-      }
+      return runKernelAsync(jenv, jobj, jniContext, range, needSync, passes, future);
+   }
 
+JNI_JAVA(jint, KernelRunnerJNI, runKernelMultiJNI)
+   (JNIEnv *jenv, jobject jobj, jlongArray jniContextHandles, jobject _range, jboolean needSync, jint passes, jintArray _offsets, jintArray _counts) {
+      Config::init(jenv);
 
-      int argPos = 0;
-      // Need to capture array refs
-      if (jniContext->firstRun || needSync) {
-         try {
-            updateNonPrimitiveReferences(jenv, jobj, jniContext);
-         } catch (CLException& cle) {
-             cle.printError();
-         }
-         if (config->isVerbose()){
-            fprintf(stderr, "back from updateNonPrimitiveReferences\n");
-         }
+      jsize contextCount = jenv->GetArrayLength(jniContextHandles);
+      JNIContext** jniContexts = new JNIContext*[contextCount];
+      jlong* handles = jenv->GetLongArrayElements(jniContextHandles, NULL);
+      for (jsize i = 0; i < contextCount; i++) {
+         jniContexts[i] = JNIContext::getJNIContext(handles[i]);
       }
+      jenv->ReleaseLongArrayElements(jniContextHandles, handles, JNI_ABORT);
 
+      // every device context shares the state block of the kernel
+      Range range(jenv, _range, (contextCount > 0 && jniContexts[0] != NULL) ? jniContexts[0]->state : NULL);
 
-      try {
-         int writeEventCount = 0;
-         processArgs(jenv, jniContext, argPos, writeEventCount);
-         enqueueKernel(jniContext, range, passes, argPos, writeEventCount);
-         int readEventCount = getReadEvents(jenv, jniContext);
-         waitForReadEvents(jniContext, readEventCount, passes);
-         checkEvents(jenv, jniContext, writeEventCount);
-      }
-      catch(CLException& cle) {
-         cle.printError();
-         jniContext->unpinAll(jenv);
-         return cle.status();
-      }
-
+      jint* offsets = jenv->GetIntArrayElements(_offsets, NULL);
+      jint* counts = jenv->GetIntArrayElements(_counts, NULL);
 
+      jint status = runKernelMulti(jenv, jobj, jniContexts, contextCount, range, needSync, passes, offsets, counts);
 
+      jenv->ReleaseIntArrayElements(_offsets, offsets, JNI_ABORT);
+      jenv->ReleaseIntArrayElements(_counts, counts, JNI_ABORT);
+      delete[] jniContexts;
+      return status;
+   }
 
-      //fprintf(stderr, "About to return %d from exec\n", status);
-      return(status);
+/**
+ * Puts back the kernel a named dispatch swapped out, however runKernelNameJNI leaves.
+ */
+class EntrypointRestorer {
+   JNIContext* jniContext;
+   cl_kernel kernel;
+public:
+   EntrypointRestorer(JNIContext* _jniContext, cl_kernel entrypointKernel)
+      : jniContext(_jniContext), kernel(_jniContext->kernel) {
+      jniContext->kernel = entrypointKernel;
+   }
+   ~EntrypointRestorer() {
+      jniContext->kernel = kernel;
    }
+};
 
-/*
 JNI_JAVA(jint, KernelRunnerJNI, runKernelNameJNI)
    (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jstring kernelName, jobject _range, jboolean needSync, jint passes) {
-      if (config == NULL){
-         config = new Config(jenv);
-      }
+      Config::init(jenv);
 
-      Range range(jenv, _range);
-
-      cl_int status = CL_SUCCESS;
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
+      if (jniContext == NULL){
+         return CL_INVALID_CONTEXT;
+      }
 
+      Range range(jenv, _range, jniContext->state);
 
-      if (jniContext->firstRun && config->isProfilingEnabled()){
-         try {
-            profileFirstRun(jniContext);
-         } catch(CLException& cle) {
-            cle.printError();
-            return 0L;
-         }
+      const char* name = jenv->GetStringUTFChars(kernelName, NULL);
+      JNIContext::KernelMap::iterator it = jniContext->kernelMap.find(name);
+      if (it == jniContext->kernelMap.end()) {
+         fprintf(stderr, "!!!!!!! no entrypoint %s in program\n", name);
+         jenv->ReleaseStringUTFChars(kernelName, name);
+         return CL_INVALID_KERNEL_NAME;
       }
+      jenv->ReleaseStringUTFChars(kernelName, name);
+
+      // the args are set on every entrypoint, so only the dispatched kernel changes
+      EntrypointRestorer restorer(jniContext, it->second);
+      return runKernel(jenv, jobj, jniContext, range, needSync, passes, 1);
+   }
 
 
-      int argPos = 0;
-      // Need to capture array refs
-      if (jniContext->firstRun || needSync) {
-         try {
-            updateNonPrimitiveReferences(jenv, jobj, jniContext);
-         } catch (CLException& cle) {
-             cle.printError();
-         }
-         if (config->isVerbose()){
-            fprintf(stderr, "back from updateNonPrimitiveReferences\n");
-         }
-      }
 
+JNI_JAVA(jlong, KernelRunnerJNI, createGraphJNI)
+   (JNIEnv *jenv, jobject jobj, jlongArray jniContextHandles, jobjectArray entrypoints) {
+      Config::init(jenv);
+
+      jsize nodeCount = jenv->GetArrayLength(jniContextHandles);
+      JNIContext** jniContexts = new JNIContext*[nodeCount];
+      jlong* handles = jenv->GetLongArrayElements(jniContextHandles, NULL);
+      for (jsize i = 0; i < nodeCount; i++) {
+         jniContexts[i] = JNIContext::getJNIContext(handles[i]);
+      }
+      jenv->ReleaseLongArrayElements(jniContextHandles, handles, JNI_ABORT);
 
+      KernelGraph* graph = new KernelGraph();
       try {
-         int writeEventCount = 0;
-         processArgs(jenv, jniContext, argPos, writeEventCount);
-		 const char* p_name = jenv->GetStringUTFChars(kernelName, NULL);
-         enqueueKernel(jniContext, p_name, range, passes, argPos, writeEventCount);
-         int readEventCount = getReadEvents(jenv, jniContext);
-         waitForReadEvents(jniContext, readEventCount, passes);
-         checkEvents(jenv, jniContext, writeEventCount);
-      }
-      catch(CLException& cle) {
+         graph->build(jenv, nodeCount, jniContexts, entrypoints);
+      } catch(CLException& cle) {
          cle.printError();
-         jniContext->unpinAll(jenv);
-         return cle.status();
+         graph->dispose(jenv);
+         delete graph;
+         graph = NULL;
       }
+      delete[] jniContexts;
+      return((jlong)graph);
+   }
 
+JNI_JAVA(jint, KernelRunnerJNI, runGraphJNI)
+   (JNIEnv *jenv, jobject jobj, jlong graphHandle, jobjectArray ranges, jintArray _passes, jobjectArray inputs, jobjectArray outputs) {
+      Config::init(jenv);
 
+      KernelGraph* graph = KernelGraph::getKernelGraph(graphHandle);
+      if (graph == NULL) {
+         return CL_INVALID_VALUE;
+      }
 
-
-      //fprintf(stderr, "About to return %d from exec\n", status);
-      return(status);
+      jint status = CL_SUCCESS;
+      jint* passes = jenv->GetIntArrayElements(_passes, NULL);
+      try {
+         graph->run(jenv, jobj, ranges, passes, inputs, outputs);
+      } catch(CLException& cle) {
+         cle.printError();
+         status = cle.status();
+      }
+      jenv->ReleaseIntArrayElements(_passes, passes, JNI_ABORT);
+      return status;
    }
-*/
 
+JNI_JAVA(jint, KernelRunnerJNI, disposeGraphJNI)
+   (JNIEnv *jenv, jobject jobj, jlong graphHandle) {
+      Config::init(jenv);
 
+      KernelGraph* graph = KernelGraph::getKernelGraph(graphHandle);
+      if (graph != NULL) {
+         graph->dispose(jenv);
+         delete graph;
+      }
+      return CL_SUCCESS;
+   }
 
 // we return the JNIContext from here 
 JNI_JAVA(jlong, KernelRunnerJNI, initJNI)
@@ -1348,9 +2578,8 @@ JNI_JAVA(jlong, KernelRunnerJNI, initJNI)
       if (openCLDeviceObject == NULL){
          fprintf(stderr, "no device object!\n");
       }
-      if (config == NULL){
-         config = new Config(jenv);
-      }
+      Config::init(jenv);
+      Profiler::init();
       cl_int status = CL_SUCCESS;
       JNIContext* jniContext = new JNIContext(jenv, kernelObject, openCLDeviceObject, flags);
 
@@ -1413,41 +2642,83 @@ JNI_JAVA(jlong, KernelRunnerJNI, buildProgramJNI)
       try {
          cl_int status = CL_SUCCESS;
 
-         jniContext->program = CLHelper::compile(jenv, jniContext->context,  1, &jniContext->deviceId, source, NULL, &status);
+         if (jniContext->subDeviceCount > 1) {
+            // the nodes run the kernel too
+            cl_device_id* devices = new cl_device_id[jniContext->subDeviceCount + 1];
+            devices[0] = jniContext->deviceId;
+            for (cl_uint i = 0; i < jniContext->subDeviceCount; i++) {
+               devices[i + 1] = jniContext->subDeviceIds[i];
+            }
+            jniContext->program = CLHelper::compile(jenv, jniContext->context, jniContext->subDeviceCount + 1, devices, source, NULL, &status);
+            delete[] devices;
+         } else {
+            // shared with every other kernel built from the same source for this device
+            jniContext->program = DeviceRegistry::acquireProgram(jenv, jniContext->context, jniContext->deviceId, source, NULL, &status);
+         }
 
          if(status == CL_BUILD_PROGRAM_FAILURE) throw CLException(status, "");
 
-		 /*cl_uint num_kernels;
+         // every entrypoint in the program, run() is dispatched unless a named entrypoint is requested
+         cl_uint kernelCount = 0;
+         status = clCreateKernelsInProgram(jniContext->program, 0, NULL, &kernelCount);
+         if(status != CL_SUCCESS) throw CLException(status,"clCreateKernelsInProgram()");
+
+         cl_kernel* kernels = new cl_kernel[kernelCount];
+         status = clCreateKernelsInProgram(jniContext->program, kernelCount, kernels, NULL);
+         if(status != CL_SUCCESS) {
+            delete[] kernels;
+            throw CLException(status,"clCreateKernelsInProgram()");
+         }
+
+         for (cl_uint i = 0; i < kernelCount; i++) {
+            char name[256];
+            status = clGetKernelInfo(kernels[i], CL_KERNEL_FUNCTION_NAME, sizeof(name), name, NULL);
+            if(status != CL_SUCCESS) {
+               name[0] = '\0';
+               CLException(status, "clGetKernelInfo()").printError();
+            }
+            jniContext->kernelMap.insert(JNIContext::KernelMap::value_type(name, kernels[i]));
+            if (config->isVerbose()){
+               fprintf(stderr, "program entrypoint %s\n", name);
+            }
+         }
+         delete[] kernels;
 
-		 clCreateKernelsInProgram(jniContext->program, 0, NULL, &num_kernels);
-		 cl_kernel* p_kernels = new cl_kernel[ num_kernels];
+         JNIContext::KernelMap::iterator run = jniContext->kernelMap.find("run");
+         if (run != jniContext->kernelMap.end()) {
+            jniContext->kernel = run->second;
+         } else if (!jniContext->kernelMap.empty()) {
+            jniContext->kernel = jniContext->kernelMap.begin()->second;
+         } else {
+            throw CLException(CL_INVALID_KERNEL_NAME, "clCreateKernelsInProgram() no entrypoints");
+         }
 
-		 status = clCreateKernelsInProgram(jniContext->program, num_kernels, p_kernels, NULL);
-		if(status != CL_SUCCESS) throw CLException(status,"clCreateKernel()");
 
-		 for (size_t i = 0; i < num_kernels; ++i ) 
-		 {
-			 size_t len;
-			 char id[256];
-			 clGetKernelInfo( p_kernels[i], CL_KERNEL_FUNCTION_NAME, 256, id, &len);
-			 jniContext->kernelMap.insert( JNIContext::KernelMap::value_type( id, p_kernels[i] ) );
-		 }
-		 */
-		 
-		 jniContext->kernel = clCreateKernel(jniContext->program, "run", &status);
 
+         LocalSizeTuner::inspect(jenv, jniContext, source);
+         inspectRangeBuiltins(jenv, jniContext, source);
 
+         // the tuner times executions with their profiling info, the latency histograms take device times from it
          cl_command_queue_properties queue_props = 0;
-         if (config->isProfilingEnabled()) {
+         if (config->isProfilingEnabled() || config->isLocalSizeTuningEnabled() || config->isDeviceTimingEnabled()) {
             queue_props |= CL_QUEUE_PROFILING_ENABLE;
+            jniContext->timedQueues = true;
          }
 
-         jniContext->commandQueue = clCreateCommandQueue(jniContext->context, (cl_device_id)jniContext->deviceId,
+         jniContext->commandQueue = DeviceRegistry::acquireQueue(jniContext->context, (cl_device_id)jniContext->deviceId,
                queue_props,
                &status);
          if(status != CL_SUCCESS) throw CLException(status,"clCreateCommandQueue()");
 
-         commandQueueList.add(jniContext->commandQueue, __LINE__, __FILE__);
+         commandQueueTracker.add(jniContext->commandQueue, __LINE__, __FILE__);
+
+         for (cl_uint i = 0; i < jniContext->subDeviceCount; i++) {
+            jniContext->subDeviceQueues[i] = clCreateCommandQueue(jniContext->context, jniContext->subDeviceIds[i],
+                  queue_props, &status);
+            if(status != CL_SUCCESS) throw CLException(status,"clCreateCommandQueue() NUMA node");
+
+            commandQueueTracker.add(jniContext->subDeviceQueues[i], __LINE__, __FILE__);
+         }
 
          if (config->isProfilingCSVEnabled()) {
             writeProfile(jenv, jniContext);
@@ -1464,21 +2735,37 @@ JNI_JAVA(jlong, KernelRunnerJNI, buildProgramJNI)
 
 // this is called once when the arg list is first determined for this kernel
 JNI_JAVA(jint, KernelRunnerJNI, setArgsJNI)
-   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobjectArray argArray, jint argc) {
-      if (config == NULL) {
-         config = new Config(jenv);
-      }
+   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobjectArray argArray, jint argc, jobject stateBuffer) {
+      Config::init(jenv);
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
       cl_int status = CL_SUCCESS;
       if (jniContext != NULL){      
          jniContext->argc = argc;
          jniContext->args = new KernelArg*[jniContext->argc];
+         jniContext->rowCopyJobs = new RowCopyJob*[jniContext->argc];
          jniContext->firstRun = true;
 
+         // the state block is only trusted if it is direct and holds a record for every arg
+         if (stateBuffer != NULL){
+            char* state = (char*)jenv->GetDirectBufferAddress(stateBuffer);
+            jlong capacity = jenv->GetDirectBufferCapacity(stateBuffer);
+            if (state != NULL && capacity >= com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_HEADER_SIZE
+                  + (jlong)argc * com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_SIZE){
+               jniContext->stateBuffer = jenv->NewGlobalRef(stateBuffer);
+               jniContext->state = state;
+            }else if (config->isVerbose()){
+               fprintf(stderr, "state buffer not usable, reading args through JNI\n");
+            }
+         }
+
          // Step through the array of KernelArg's to capture the type data for the Kernel's data members.
          for (jint i = 0; i < jniContext->argc; i++){ 
             jobject argObj = jenv->GetObjectArrayElement(argArray, i);
             KernelArg* arg = jniContext->args[i] = new KernelArg(jenv, jniContext, argObj);
+            if (jniContext->state != NULL){
+               arg->state = jniContext->state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_HEADER_SIZE
+                     + i * com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_SIZE;
+            }
             if (config->isVerbose()){
                if (arg->isExplicit()){
                   fprintf(stderr, "%s is explicit!\n", arg->name);
@@ -1506,6 +2793,9 @@ JNI_JAVA(jint, KernelRunnerJNI, setArgsJNI)
             }
 
          }
+         // the kernel arg position of every arg is fixed from here on
+         jniContext->plan = new DispatchPlan(jniContext);
+
          // we will need an executeEvent buffer for all devices
          jniContext->executeEvents = new cl_event[1];
 
@@ -1524,11 +2814,100 @@ JNI_JAVA(jint, KernelRunnerJNI, setArgsJNI)
 
 
 
+JNI_JAVA(jstring, KernelRunnerJNI, getResourceReportJNI)
+   (JNIEnv *jenv, jobject jobj) {
+      std::string report = ResourceTracker::reportAll();
+      return(jenv->NewStringUTF(report.c_str()));
+   }
+
+JNI_JAVA(jlongArray, KernelRunnerJNI, getLatencyJNI)
+   (JNIEnv *jenv, jobject jobj, jlongArray jniContextHandles) {
+      const jint fields = 6;
+      jlong values[KernelLatency::METRICS * fields];
+      jsize contextCount = jenv->GetArrayLength(jniContextHandles);
+      jlong* handles = jenv->GetLongArrayElements(jniContextHandles, NULL);
+      for (jint metric = 0; metric < KernelLatency::METRICS; metric++) {
+         // the contexts of a multi device kernel are read as one
+         LatencyHistogram merged;
+         for (jsize i = 0; i < contextCount; i++) {
+            JNIContext* jniContext = JNIContext::getJNIContext(handles[i]);
+            if (jniContext != NULL) {
+               jniContext->latency.histograms[metric].drainInto(merged);
+            }
+         }
+         LatencyHistogram::Summary summary = merged.summarize();
+         jlong* metricValues = &values[metric * fields];
+         metricValues[0] = summary.count;
+         metricValues[1] = summary.p50;
+         metricValues[2] = summary.p90;
+         metricValues[3] = summary.p99;
+         metricValues[4] = summary.max;
+         metricValues[5] = summary.total;
+      }
+      jenv->ReleaseLongArrayElements(jniContextHandles, handles, JNI_ABORT);
+
+      jlongArray result = jenv->NewLongArray(KernelLatency::METRICS * fields);
+      if (result != NULL) {
+         jenv->SetLongArrayRegion(result, 0, KernelLatency::METRICS * fields, values);
+      }
+      return(result);
+   }
+
+JNI_JAVA(jlongArray, KernelRunnerJNI, getTransferCountersJNI)
+   (JNIEnv *jenv, jobject jobj, jlongArray jniContextHandles) {
+      jlong values[TransferCounters::COUNTERS];
+      for (jint counter = 0; counter < TransferCounters::COUNTERS; counter++) {
+         values[counter] = 0;
+      }
+      jsize contextCount = jenv->GetArrayLength(jniContextHandles);
+      jlong* handles = jenv->GetLongArrayElements(jniContextHandles, NULL);
+      for (jsize i = 0; i < contextCount; i++) {
+         JNIContext* jniContext = JNIContext::getJNIContext(handles[i]);
+         if (jniContext != NULL) {
+            for (jint counter = 0; counter < TransferCounters::COUNTERS; counter++) {
+               values[counter] += jniContext->transfers.get((TransferCounters::Counter)counter);
+            }
+            // each array keeps the time it has been held pinned rather than paying for an atomic per unpin
+            for (jint a = 0; a < jniContext->argc; a++) {
+               KernelArg* arg = jniContext->args[a];
+               if (arg->isBackedByArray()) {
+                  values[TransferCounters::CRITICAL_NANOS] += arg->arrayBuffer->criticalNanos;
+               }
+            }
+         }
+      }
+      jenv->ReleaseLongArrayElements(jniContextHandles, handles, JNI_ABORT);
+
+      jlongArray result = jenv->NewLongArray(TransferCounters::COUNTERS);
+      if (result != NULL) {
+         jenv->SetLongArrayRegion(result, 0, TransferCounters::COUNTERS, values);
+      }
+      return(result);
+   }
+
+JNI_JAVA(jstring, KernelRunnerJNI, getTransferLogJNI)
+   (JNIEnv *jenv, jobject jobj, jlongArray jniContextHandles) {
+      std::string log;
+      jsize contextCount = jenv->GetArrayLength(jniContextHandles);
+      jlong* handles = jenv->GetLongArrayElements(jniContextHandles, NULL);
+      for (jsize i = 0; i < contextCount; i++) {
+         JNIContext* jniContext = JNIContext::getJNIContext(handles[i]);
+         if (jniContext != NULL) {
+            if (contextCount > 1) {
+               char line[64];
+               sprintf(line, "device context %d:\n", (int)i);
+               log += line;
+            }
+            jniContext->transferLog.report(log);
+         }
+      }
+      jenv->ReleaseLongArrayElements(jniContextHandles, handles, JNI_ABORT);
+      return(jenv->NewStringUTF(log.c_str()));
+   }
+
 JNI_JAVA(jstring, KernelRunnerJNI, getExtensionsJNI)
    (JNIEnv *jenv, jobject jobj, jlong jniContextHandle) {
-      if (config == NULL){
-         config = new Config(jenv);
-      }
+      Config::init(jenv);
       jstring jextensions = NULL;
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
       if (jniContext != NULL){
@@ -1591,9 +2970,7 @@ KernelArg* getArgForBuffer(JNIEnv* jenv, JNIContext* jniContext, jobject buffer)
 // Called as a result of Kernel.get(someArray)
 JNI_JAVA(jint, KernelRunnerJNI, getJNI)
    (JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject buffer) {
-      if (config == NULL){
-         config = new Config(jenv);
-      }
+      Config::init(jenv);
       cl_int status = CL_SUCCESS;
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
       if (jniContext != NULL){
@@ -1602,7 +2979,36 @@ JNI_JAVA(jint, KernelRunnerJNI, getJNI)
             if (config->isVerbose()){
                fprintf(stderr, "explicitly reading buffer %s\n", arg->name);
             }
-            if(arg->isArray()) {
+            if(arg->isDeviceResident()) {
+
+               try {
+                  void* mapped = clEnqueueMapBuffer(jniContext->commandQueue, arg->arrayBuffer->mem, 
+                                                    CL_TRUE, CL_MAP_READ, 0, 
+                                                    arg->arrayBuffer->lengthInBytes, 0, NULL, 
+                                                    &jniContext->readEvents[0], &status);
+                  if (status != CL_SUCCESS) throw CLException(status, "clEnqueueMapBuffer()");
+
+                  if (config->isProfilingEnabled()) {
+                     status = profile(&arg->arrayBuffer->read, &jniContext->readEvents[0], 0,
+                                      arg->name, jniContext->profileBaseTime);
+                     if (status != CL_SUCCESS) throw CLException(status, "profile ");
+                  }
+
+                  status = clReleaseEvent(jniContext->readEvents[0]);
+                  if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
+
+                  arg->arrayBuffer->copyOut(jenv, mapped);
+
+                  status = clEnqueueUnmapMemObject(jniContext->commandQueue, arg->arrayBuffer->mem, mapped, 0, NULL, NULL);
+                  if (status != CL_SUCCESS) throw CLException(status, "clEnqueueUnmapMemObject()");
+                  countTransfer(jniContext, arg, argIndexOf(jniContext, arg), false, true, arg->arrayBuffer->lengthInBytes, "explicit get");
+
+               //something went wrong print the error and exit
+               } catch(CLException& cle) {
+                  cle.printError();
+                  return status;
+               }
+            } else if(arg->isArray()) {
                arg->pin(jenv);
 
                try {
@@ -1633,6 +3039,7 @@ JNI_JAVA(jint, KernelRunnerJNI, getJNI)
                   // since this is an explicit buffer get, 
                   // we expect the buffer to have changed so we commit
                   arg->unpin(jenv); // was unpinCommit
+                  countTransfer(jniContext, arg, argIndexOf(jniContext, arg), false, true, arg->arrayBuffer->lengthInBytes, "explicit get");
 
                //something went wrong print the error and exit
                } catch(CLException& cle) {
@@ -1667,6 +3074,7 @@ JNI_JAVA(jint, KernelRunnerJNI, getJNI)
                   if (status != CL_SUCCESS) throw CLException(status, "clReleaseEvent() read event");
 
                   arg->aparapiBuffer->inflate(jenv,arg);
+                  countTransfer(jniContext, arg, argIndexOf(jniContext, arg), false, true, arg->aparapiBuffer->lengthInBytes, "explicit get");
 
                //something went wrong print the error and exit
                } catch(CLException& cle) {
@@ -1687,9 +3095,7 @@ JNI_JAVA(jint, KernelRunnerJNI, getJNI)
 JNI_JAVA(jint, KernelRunnerJNI, writeMapJNI)(JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject buffer,  jint start, jint length) 
 {
 	void * mapped = NULL;
-	if (config == NULL){
-			config = new Config(jenv);
-		}
+	Config::init(jenv);
 	cl_int status = CL_SUCCESS;
 	JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
 	if (jniContext != NULL){
@@ -1716,6 +3122,7 @@ JNI_JAVA(jint, KernelRunnerJNI, writeMapJNI)(JNIEnv *jenv, jobject jobj, jlong j
 			status = clEnqueueUnmapMemObject(jniContext->commandQueue, arg->arrayBuffer->mem, mapped, 0, 0, 0);
 			if (status != CL_SUCCESS) throw CLException(status, "clEnqueueUnmapMemObject()");
 			arg->unpinAbort(jenv);
+			countTransfer(jniContext, arg, argIndexOf(jniContext, arg), true, true, length * size, "explicit mapped put");
 		} 
 		catch(CLException& cle) {
 			cle.printError();
@@ -1728,9 +3135,7 @@ JNI_JAVA(jint, KernelRunnerJNI, writeMapJNI)(JNIEnv *jenv, jobject jobj, jlong j
 // Called as a result of Kernel.get(someArray, int, int)
 JNI_JAVA(jint, KernelRunnerJNI, readMapJNI)
 	(JNIEnv *jenv, jobject jobj, jlong jniContextHandle, jobject buffer,  jint start, jint length) {
-		if (config == NULL){
-			config = new Config(jenv);
-		}
+		Config::init(jenv);
 		cl_int status = CL_SUCCESS;
 		JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
 		if (jniContext != NULL){
@@ -1791,6 +3196,7 @@ JNI_JAVA(jint, KernelRunnerJNI, readMapJNI)
 					// since this is an explicit buffer get, 
 					// we expect the buffer to have changed so we commit
 					arg->unpin(jenv); // was unpinCommit
+					countTransfer(jniContext, arg, argIndexOf(jniContext, arg), false, true, length * arg_len, "explicit mapped get");
 
 					//something went wrong print the error and exit
 				} catch(CLException& cle) {
@@ -1803,42 +3209,98 @@ JNI_JAVA(jint, KernelRunnerJNI, readMapJNI)
 }
 
 
-JNI_JAVA(jobject, KernelRunnerJNI, getProfileInfoJNI)
+JNI_JAVA(jlong, KernelRunnerJNI, getExecutionTimeJNI)
+   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle) {
+      JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
+      if (jniContext != NULL && jniContext->exec != NULL && jniContext->passes > 0) {
+         ProfileInfo* exec = &jniContext->exec[jniContext->passes-1];
+         if (exec->valid) {
+            return((jlong)(exec->end - exec->start));
+         }
+      }
+      return(-1L);
+   }
+
+JNI_JAVA(jint, KernelRunnerJNI, getAsyncFailureJNI)
    (JNIEnv *jenv, jobject jobj, jlong jniContextHandle) {
-      if (config == NULL){
-         config = new Config(jenv);
+      JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
+      if (jniContext != NULL) {
+         jint status = jniContext->asyncFailure;
+         memoryBarrier();
+         return(status);
       }
+      return(0);
+   }
+
+JNI_JAVA(jobject, KernelRunnerJNI, getProfileInfoJNI)
+   (JNIEnv *jenv, jobject jobj, jlong jniContextHandle) {
+      Config::init(jenv);
       cl_int status = CL_SUCCESS;
       JNIContext* jniContext = JNIContext::getJNIContext(jniContextHandle);
       jobject returnList = NULL;
       if (jniContext != NULL){
          returnList = JNIHelper::createInstance(jenv, ArrayListClass, VoidReturn );
          if (config->isProfilingEnabled()){
+            // everything listed is from the last sampled run, which stands for this many
+            jint sampleInterval = jniContext->sampler.getSampledInterval();
 
             for (jint i = 0; i < jniContext->argc; i++){ 
                KernelArg *arg = jniContext->args[i];
-               if (arg->isArray()){
-                  if (arg->isMutableByKernel() && arg->arrayBuffer->write.valid){
-                     jobject writeProfileInfo = arg->arrayBuffer->write.createProfileInfoInstance(jenv);
+               if (arg->isArray() || arg->isAparapiBuffer()){
+                  ProfileInfo* write = arg->isAparapiBuffer() ? &arg->aparapiBuffer->write : &arg->arrayBuffer->write;
+                  if (arg->isMutableByKernel() && write->valid){
+                     jobject writeProfileInfo = write->createProfileInfoInstance(jenv, sampleInterval);
                      JNIHelper::callVoid(jenv, returnList, "add", ArgsBooleanReturn(ObjectClassArg), writeProfileInfo);
                   }
                }
             }
 
             for (jint pass = 0; pass < jniContext->passes; pass++){
-               jobject executeProfileInfo = jniContext->exec[pass].createProfileInfoInstance(jenv);
-               JNIHelper::callVoid(jenv, returnList, "add", ArgsBooleanReturn(ObjectClassArg), executeProfileInfo);
+               if (jniContext->exec[pass].valid) {
+                  jobject executeProfileInfo = jniContext->exec[pass].createProfileInfoInstance(jenv, sampleInterval);
+                  JNIHelper::callVoid(jenv, returnList, "add", ArgsBooleanReturn(ObjectClassArg), executeProfileInfo);
+               }
+            }
+
+            // NUMA split executions also report each node
+            if (jniContext->subDeviceExec != NULL) {
+               for (jint i = 0; i < jniContext->passes * (jint)jniContext->subDeviceCount; i++){
+                  if (jniContext->subDeviceExec[i].valid) {
+                     jobject nodeProfileInfo = jniContext->subDeviceExec[i].createProfileInfoInstance(jenv, sampleInterval);
+                     JNIHelper::callVoid(jenv, returnList, "add", ArgsBooleanReturn(ObjectClassArg), nodeProfileInfo);
+                  }
+               }
             }
 
             for (jint i = 0; i < jniContext->argc; i++){ 
                KernelArg *arg = jniContext->args[i];
-               if (arg->isArray()){
-                  if (arg->isReadByKernel() && arg->arrayBuffer->read.valid){
-                     jobject readProfileInfo = arg->arrayBuffer->read.createProfileInfoInstance(jenv);
+               if (arg->isArray() || arg->isAparapiBuffer()){
+                  ProfileInfo* read = arg->isAparapiBuffer() ? &arg->aparapiBuffer->read : &arg->arrayBuffer->read;
+                  if (arg->isReadByKernel() && read->valid){
+                     jobject readProfileInfo = read->createProfileInfoInstance(jenv, sampleInterval);
                      JNIHelper::callVoid(jenv, returnList, "add", ArgsBooleanReturn(ObjectClassArg), readProfileInfo);
                   }
                }
             }
+
+            // then each host phase of the run, mapped onto the same device clock
+            HostTiming& timing = jniContext->hostTiming;
+            if (timing.calibrated) {
+               for (size_t i = 0; i < timing.intervals.size(); i++) {
+                  HostTiming::Interval& interval = timing.intervals[i];
+                  if (interval.end != 0) {
+                     ProfileInfo host;
+                     host.type = 3;
+                     host.name = interval.label;
+                     host.start = (cl_ulong)timing.toDevice(interval.start, jniContext->profileBaseTime);
+                     host.end = (cl_ulong)timing.toDevice(interval.end, jniContext->profileBaseTime);
+                     host.queued = host.start;
+                     host.submit = host.start;
+                     jobject hostProfileInfo = host.createProfileInfoInstance(jenv, sampleInterval);
+                     JNIHelper::callVoid(jenv, returnList, "add", ArgsBooleanReturn(ObjectClassArg), hostProfileInfo);
+                  }
+               }
+            }
          }
       }
       return returnList;
@@ -68,27 +68,70 @@ void profileFirstRun(JNIContext* jniContext);
 void updateArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
 void updateBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
 
-void processObject(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
 void processArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
 void processBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
+void processDeviceResidentArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
+
+cl_int writeDeviceResidentArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, cl_event* event);
+void readDeviceResidentArrays(JNIEnv* jenv, JNIContext* jniContext);
 
 void updateWriteEvents(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int argIdx, int& writeEventCount);
 
-void processLocal(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
-void processLocalArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
-void processLocalBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int& argPos, int argIdx);
+void processLocalArray(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int argPos, int argIdx);
+void processLocalBuffer(JNIEnv* jenv, JNIContext* jniContext, KernelArg* arg, int argPos, int argIdx);
+
+int processArgs(JNIEnv* jenv, JNIContext* jniContext, int& argPos, int& writeEventCount, bool chunked);
 
-int processArgs(JNIEnv* jenv, JNIContext* jniContext, int& argPos, int& writeEventCount);
+void clampLocalSize(JNIContext* jniContext, Range& range);
 
 void enqueueKernel(JNIContext* jniContext, Range& range, int passes, int argPos, int writeEventCount);
+void releasePassEvents(JNIContext* jniContext);
 void enqueueKernel(JNIContext* jniContext, const char* kernelName, Range& range, int passes, int argPos, int writeEventCount);
 
-int getReadEvents(JNIContext* jniContext);
+bool canRunChunked(JNIContext* jniContext, Range& range, int passes, int chunks);
+bool chunkSlice(KernelArg* arg, size_t offset, size_t count, size_t& start, size_t& bytes);
+bool rangeSlice(KernelArg* arg, size_t stride, size_t offset, size_t count, size_t& start, size_t& bytes);
+void enqueueChunkedKernel(JNIEnv* jenv, JNIContext* jniContext, Range& range, int chunks, int argPos, int writeEventCount);
+void waitForChunkEvents(JNIContext* jniContext);
+
+int getReadEvents(JNIEnv* jenv, JNIContext* jniContext, bool chunked);
 
 void waitForReadEvents(JNIContext* jniContext, int readEventCount, int passes);
+void releaseReadEvents(JNIContext* jniContext, int readEventCount, int passes);
 
 void checkEvents(JNIEnv* jenv, JNIContext* jniContext, int writeEventCount);
 
+jint runKernel(JNIEnv *jenv, jobject jobj, JNIContext* jniContext, Range& range, jboolean needSync, jint passes, jint chunks);
+
+/**
+ * an execution enqueued by runKernelAsync, completed by asyncRunComplete on an OpenCL callback thread
+ */
+struct AsyncRun {
+   JavaVM* jvm;
+   jlong started;          // HostTiming::now() when the execution was requested
+   JNIContext* jniContext;
+   jobject future;         // global ref to the CompletionFuture to complete
+   cl_event marker;        // enqueued behind the reads, its completion means the whole execution is done
+   jint passes;
+   jint readEventCount;
+   jint writeEventCount;
+};
+
+void makeArraysDeviceResident(JNIContext* jniContext, bool async);
+
+void endAsyncResidency(JNIContext* jniContext);
+
+void inspectRangeBuiltins(JNIEnv* jenv, JNIContext* jniContext, jstring source);
+void placeOnSubDevices(JNIContext* jniContext, KernelArg* arg);
+cl_int enqueueSubDeviceKernels(JNIContext* jniContext, Range& range, int passid, int writeCount, cl_event* writeEvents, cl_event* executeEvent);
+void releaseSubDeviceEvents(JNIContext* jniContext);
+
+bool canRunMultiDevice(JNIContext** jniContexts, int contextCount, Range& range, int passes);
+int getSliceReadEvents(JNIEnv* jenv, JNIContext* jniContext, size_t offset, size_t count);
+jint runKernelMulti(JNIEnv *jenv, jobject jobj, JNIContext** jniContexts, int contextCount, Range& range, jboolean needSync, jint passes, jint* offsets, jint* counts);
+void CL_CALLBACK asyncRunComplete(cl_event event, cl_int eventStatus, void* userData);
+jint runKernelAsync(JNIEnv *jenv, jobject jobj, JNIContext* jniContext, Range& range, jboolean needSync, jint passes, jobject future);
+
 void writeProfile(JNIEnv* jenv, JNIContext* jniContext);
 
 KernelArg* getArgForBuffer(JNIEnv* jenv, JNIContext* jniContext, jobject buffer);
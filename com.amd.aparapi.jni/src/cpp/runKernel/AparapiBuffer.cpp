@@ -38,1520 +38,529 @@
 #define APARAPIBUFFER_SOURCE
 #include "AparapiBuffer.h"
 #include "KernelArg.h"
-
-AparapiBuffer::AparapiBuffer():
-   javaObject((jobject) 0),
-   numDims(0),
-   dims(NULL),
-   lengthInBytes(0),
-   mem((cl_mem) 0),
-   data(NULL),
-   memMask((cl_uint)0) {
-   }
-
-AparapiBuffer::AparapiBuffer(void* _data, cl_uint* _lens, cl_uint _numDims, long _lengthInBytes, jobject _javaObject) :
-   data(_data),
-   lens(_lens),
-   numDims(_numDims),
-   lengthInBytes(_lengthInBytes),
-   javaObject(_javaObject),
-   mem((cl_mem) 0),
-   memMask((cl_uint)0)
-{
-   dims = new cl_uint[_numDims];
-   for(int i = 0; i < _numDims; i++) {
-      dims[i] = 1;
-      for(int j = i+1; j < _numDims; j++) {
-         dims[i] *= lens[j];
-      }
-   }
-}
-
-jobject AparapiBuffer::getJavaObject(JNIEnv* env, KernelArg* arg) {
-   return JNIHelper::getInstanceField<jobject>(env, arg->javaArg, "javaBuffer", ObjectClassArg);
-}
-
-
-AparapiBuffer* AparapiBuffer::flatten(JNIEnv* env, jobject arg, int type) {
-   int numDims = JNIHelper::getInstanceField<jint>(env, arg, "numDims", IntArg);
-   if(numDims == 2 && isBoolean(type)) {
-      return AparapiBuffer::flattenBoolean2D(env,arg);
-   } else if(numDims == 2 && isByte(type)) {
-      return AparapiBuffer::flattenByte2D(env,arg);
-   } else if(numDims == 2 && isShort(type)) {
-      return AparapiBuffer::flattenShort2D(env,arg);
-   } else if(numDims == 2 && isInt(type)) {
-      return AparapiBuffer::flattenInt2D(env,arg);
-   } else if(numDims == 2 && isLong(type)) {
-      return AparapiBuffer::flattenLong2D(env,arg);
-   } else if(numDims == 2 && isFloat(type)) {
-      return AparapiBuffer::flattenFloat2D(env,arg);
-   } else if(numDims == 2 && isDouble(type)) {
-      return AparapiBuffer::flattenDouble2D(env,arg);
-   } else if(numDims == 3 && isBoolean(type)) {
-      return AparapiBuffer::flattenBoolean3D(env,arg);
-   } else if(numDims == 3 && isByte(type)) {
-      return AparapiBuffer::flattenByte3D(env,arg);
-   } else if(numDims == 3 && isShort(type)) {
-      return AparapiBuffer::flattenShort3D(env,arg);
-   } else if(numDims == 3 && isInt(type)) {
-      return AparapiBuffer::flattenInt3D(env,arg);
-   } else if(numDims == 3 && isLong(type)) {
-      return AparapiBuffer::flattenLong3D(env,arg);
-   } else if(numDims == 3 && isFloat(type)) {
-      return AparapiBuffer::flattenFloat3D(env,arg);
-   } else if(numDims == 3 && isDouble(type)) {
-      return AparapiBuffer::flattenDouble3D(env,arg);
-   }
-   return new AparapiBuffer();
-}
-
-
-AparapiBuffer* AparapiBuffer::flattenBoolean2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jbooleanArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jboolean);
-
-   jboolean* array = new jboolean[totalSize];
-   /*
-   jbooleanArray* jArray = new jbooleanArray[dims[0]];
-   jboolean** elems = new jboolean*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jbooleanArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetBooleanArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseBooleanArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jbooleanArray jArray = (jbooleanArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jboolean* elems = env->GetBooleanArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseBooleanArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenByte2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jbyteArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jbyte);
-
-   jbyte* array = new jbyte[totalSize];
-   /*
-   jbyteArray* jArray = new jbyteArray[dims[0]];
-   jbyte** elems = new jbyte*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jbyteArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetByteArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseByteArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jbyteArray jArray = (jbyteArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jbyte* elems = env->GetByteArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseByteArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenShort2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jshortArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jshort);
-
-   jshort* array = new jshort[totalSize];
-   /*
-   jshortArray* jArray = new jshortArray[dims[0]];
-   jshort** elems = new jshort*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jshortArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetShortArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseShortArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jshortArray jArray = (jshortArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jshort* elems = env->GetShortArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseShortArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenInt2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jintArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jint);
-
-   jint* array = new jint[totalSize];
-   /*
-   jintArray* jArray = new jintArray[dims[0]];
-   jint** elems = new jint*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jintArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetIntArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseIntArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jintArray jArray = (jintArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jint* elems = env->GetIntArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseIntArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenLong2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jlongArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jlong);
-
-   jlong* array = new jlong[totalSize];
-   /*
-   jlongArray* jArray = new jlongArray[dims[0]];
-   jlong** elems = new jlong*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jlongArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetLongArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseLongArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jlongArray jArray = (jlongArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jlong* elems = env->GetLongArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseLongArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenFloat2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jfloatArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jfloat);
-
-   jfloat* array = new jfloat[totalSize];
-   /*
-   jfloatArray* jArray = new jfloatArray[dims[0]];
-   jfloat** elems = new jfloat*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jfloatArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetFloatArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseFloatArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jfloatArray jArray = (jfloatArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jfloat* elems = env->GetFloatArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseFloatArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenDouble2D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[2];
-   dims[0] = env->GetArrayLength((jobjectArray)javaBuffer);
-   dims[1] = env->GetArrayLength((jdoubleArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, 0));
-   int totalSize = dims[0] * dims[1];
-   long bitSize = totalSize * sizeof(jdouble);
-
-   jdouble* array = new jdouble[totalSize];
-   /*
-   jdoubleArray* jArray = new jdoubleArray[dims[0]];
-   jdouble** elems = new jdouble*[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = (jdoubleArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      elems[i] = env->GetDoubleArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[i][j];
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      env->ReleaseDoubleArrayElements(jArray[i], elems[i], 0);
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jdoubleArray jArray = (jdoubleArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      jdouble* elems = env->GetDoubleArrayElements(jArray,0);
-
-      for(int j = 0; j < (int)dims[1]; j++) {
-         array[i*dims[1] + j] = elems[j];
-      }
-      env->ReleaseDoubleArrayElements(jArray, elems, 0);
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 2, bitSize, javaBuffer);
-}
-
-
-AparapiBuffer* AparapiBuffer::flattenBoolean3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jbooleanArray j2 = (jbooleanArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   long bitSize = totalSize * sizeof(jboolean);
-
-   jboolean* array = new jboolean[totalSize];
-   /*
-   jbooleanArray** jArray = new jbooleanArray*[dims[0]];
-   jboolean*** elems = new jboolean**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jbooleanArray[dims[1]];
-      elems[i] = new jboolean*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jbooleanArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetBooleanArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
-         }
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseBooleanArrayElements(jArray[i][j], elems[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jbooleanArray jArray = (jbooleanArray)env->GetObjectArrayElement(jrow, j);
-         jboolean* elems = env->GetBooleanArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[k];
-         }
-         env->ReleaseBooleanArrayElements(jArray, elems, 0);
-      }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenByte3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jbyteArray j2 = (jbyteArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   long bitSize = totalSize * sizeof(jbyte);
-
-   jbyte* array = new jbyte[totalSize];
-   /*
-   jbyteArray** jArray = new jbyteArray*[dims[0]];
-   jbyte*** elems = new jbyte**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jbyteArray[dims[1]];
-      elems[i] = new jbyte*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jbyteArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetByteArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
-         }
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseByteArrayElements(jArray[i][j], elems[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jbyteArray jArray = (jbyteArray)env->GetObjectArrayElement(jrow, j);
-         jbyte* elems = env->GetByteArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[k];
+#include "WorkerPool.h"
+
+/**
+ * rows are packed and uploaded in chunks of about this many bytes
+ */
+static const size_t CHUNK_BYTES = 1 << 20;
+
+/**
+ * The bulk copies between one innermost java array and the packed buffer for each element type. The JVM copies
+ * regions with its own (vectorized) arraycopy, without pinning or copying the whole array the way
+ * Get<Type>ArrayElements may.
+ */
+template <typename T> class ArrayRegion;
+
+#define ARRAY_REGION(Type, ArrayType, Name) \
+template <> class ArrayRegion<Type>{ \
+   public: \
+      static void get(JNIEnv* env, jarray row, jsize length, Type* data) { \
+         env->Get##Name##ArrayRegion((ArrayType)row, 0, length, data); \
+      } \
+      static void set(JNIEnv* env, jarray row, jsize length, Type* data) { \
+         env->Set##Name##ArrayRegion((ArrayType)row, 0, length, data); \
+      } \
+};
+
+ARRAY_REGION(jboolean, jbooleanArray, Boolean)
+ARRAY_REGION(jbyte, jbyteArray, Byte)
+ARRAY_REGION(jchar, jcharArray, Char)
+ARRAY_REGION(jshort, jshortArray, Short)
+ARRAY_REGION(jint, jintArray, Int)
+ARRAY_REGION(jlong, jlongArray, Long)
+ARRAY_REGION(jfloat, jfloatArray, Float)
+ARRAY_REGION(jdouble, jdoubleArray, Double)
+
+#undef ARRAY_REGION
+
+/**
+ * Copies the innermost rows of a java array of rank 2 or more to or from the packed buffer. The rows are split
+ * into chunks which the worker pool copies in parallel, when packing with a command queue each chunk is written to
+ * the device as soon as it is packed.
+ *
+ * This holds everything which doesn't depend on the element type or rank, RowCopy below walks the arrays.
+ */
+class RowCopyJob{
+   public:
+      jobjectArray array;       // global ref to the outermost java array
+      cl_uint numDims;
+      cl_uint* lens;
+      jint* offsets;            // the first element of each row of a jagged array, NULL if every row is lens[numDims-1] long
+      jlong* rowsPer;           // rows held by one element at each outer level
+      size_t elementSize;
+      char* data;
+      jlong rows;
+      jlong elements;
+      jlong rowsPerChunk;
+      cl_command_queue commandQueue;
+      cl_mem mem;
+      cl_int* status;           // one per chunk so workers never share a slot
+
+      RowCopyJob(AparapiBuffer* buffer, size_t _elementSize):
+         array(NULL),
+         numDims(buffer->numDims),
+         lens(buffer->lens),
+         offsets(buffer->offsets),
+         elementSize(_elementSize),
+         data((char*)buffer->data),
+         commandQueue(0),
+         mem(0),
+         status(NULL) {
+         rowsPer = new jlong[numDims - 1];
+         rows = 1;
+         for (int d = numDims - 2; d >= 0; d--) {
+            rowsPer[d] = rows;
+            rows *= lens[d];
          }
-         env->ReleaseByteArrayElements(jArray, elems, 0);
+         elements = getRowStart(rows);
+         // chunks hold about CHUNK_BYTES on average, jagged rows may make some bigger than others
+         size_t rowBytes = (rows == 0) ? 0 : (size_t)((elements * elementSize + rows - 1) / rows);
+         rowsPerChunk = (rowBytes == 0 || rowBytes >= CHUNK_BYTES) ? 1 : (jlong)(CHUNK_BYTES / rowBytes);
       }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
 
-AparapiBuffer* AparapiBuffer::flattenShort3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jshortArray j2 = (jshortArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   long bitSize = totalSize * sizeof(jshort);
-
-   jshort* array = new jshort[totalSize];
-   /*
-   jshortArray** jArray = new jshortArray*[dims[0]];
-   jshort*** elems = new jshort**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jshortArray[dims[1]];
-      elems[i] = new jshort*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jshortArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetShortArrayElements(jArray[i][j],0);
+      /**
+       * @return the offset in elements of a row in the packed buffer, or the end of the buffer for row == rows
+       */
+      jlong getRowStart(jlong row) {
+         return((offsets != NULL) ? (jlong)offsets[row] : row * lens[numDims - 1]);
       }
-   }
 
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
-         }
+      virtual ~RowCopyJob() {
+         delete[] rowsPer;
+         delete[] status;
       }
-   }
 
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseShortArrayElements(jArray[i][j], elems[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jshortArray jArray = (jshortArray)env->GetObjectArrayElement(jrow, j);
-         jshort* elems = env->GetShortArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[k];
-         }
-         env->ReleaseShortArrayElements(jArray, elems, 0);
-      }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenInt3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jintArray j2 = (jintArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   long bitSize = totalSize * sizeof(jint);
+      /**
+       * copy the rows in [first, last)
+       * @return false if java threw
+       */
+      virtual bool copyRows(JNIEnv* env, jlong first, jlong last) = 0;
 
-   jint* array = new jint[totalSize];
-   /*
-   jintArray** jArray = new jintArray*[dims[0]];
-   jint*** elems = new jint**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jintArray[dims[1]];
-      elems[i] = new jint*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jintArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetIntArrayElements(jArray[i][j],0);
+      jint getChunks() {
+         return((elements == 0) ? 0 : (jint)((rows + rowsPerChunk - 1) / rowsPerChunk));
       }
-   }
 
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
+      static void copyChunk(JNIEnv* env, void* _job, jint chunk) {
+         RowCopyJob* job = (RowCopyJob*)_job;
+         jlong first = chunk * job->rowsPerChunk;
+         jlong last = first + job->rowsPerChunk;
+         if (last > job->rows) {
+            last = job->rows;
          }
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseIntArrayElements(jArray[i][j], elems[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jintArray jArray = (jintArray)env->GetObjectArrayElement(jrow, j);
-         jint* elems = env->GetIntArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[k];
+         job->status[chunk] = CL_SUCCESS;
+         if (!job->copyRows(env, first, last)) {
+            env->ExceptionDescribe();
+            job->status[chunk] = CL_OUT_OF_HOST_MEMORY;
+            return;
          }
-         env->ReleaseIntArrayElements(jArray, elems, 0);
-      }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenLong3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jlongArray j2 = (jlongArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   jlong bitSize = totalSize * sizeof(jlong);
-
-   jlong* array = new jlong[totalSize];
-   /*
-   jlongArray** jArray = new jlongArray*[dims[0]];
-   jlong*** elems = new jlong**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jlongArray[dims[1]];
-      elems[i] = new jlong*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jlongArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetLongArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
+         size_t start = job->getRowStart(first) * job->elementSize;
+         size_t end = job->getRowStart(last) * job->elementSize;
+         if (job->commandQueue != 0 && end > start) {
+            job->status[chunk] = clEnqueueWriteBuffer(job->commandQueue, job->mem, CL_FALSE, start, end - start,
+                  job->data + start, 0, NULL, NULL);
          }
       }
-   }
 
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseLongArrayElements(jArray[i][j], elems[i][j], 0);
+      void start(JNIEnv* env, jobject javaArray) {
+         status = new cl_int[getChunks()];
+         array = (jobjectArray)env->NewGlobalRef(javaArray);
       }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
 
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jlongArray jArray = (jlongArray)env->GetObjectArrayElement(jrow, j);
-         jlong* elems = env->GetLongArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[k];
+      /**
+       * @return the first failing status of a chunk, CL_SUCCESS if none failed
+       */
+      cl_int finish(JNIEnv* env) {
+         env->DeleteGlobalRef(array);
+         array = NULL;
+         for (jint i = 0; i < getChunks(); i++) {
+            if (status[i] != CL_SUCCESS) {
+               return(status[i]);
+            }
          }
-         env->ReleaseLongArrayElements(jArray, elems, 0);
-      }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenFloat3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jfloatArray j2 = (jfloatArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   long bitSize = totalSize * sizeof(jfloat);
-
-   jfloat* array = new jfloat[totalSize];
-   /*
-   jfloatArray** jArray = new jfloatArray*[dims[0]];
-   jfloat*** elems = new jfloat**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jfloatArray[dims[1]];
-      elems[i] = new jfloat*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jfloatArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetFloatArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
+         return(CL_SUCCESS);
+      }
+
+      cl_int run(JNIEnv* env, jobject javaArray) {
+         start(env, javaArray);
+         WorkerPool::run(env, copyChunk, this, getChunks());
+         return(finish(env));
+      }
+};
+
+/**
+ * Walks the object array levels of a java array down to its rows, Levels is the number of levels left to walk or 0
+ * when the rank is only known at run time. For the ranks instantiated with a fixed Levels the recursion, the leaf test
+ * and the row offsets (sizeof(T) * row length) fold at compile time.
+ */
+template <typename T, bool Pack, int Levels> class RowWalker{
+   public:
+      static bool walk(RowCopyJob* job, JNIEnv* env, jobjectArray outer, int d, jlong rowBase, jlong first, jlong last) {
+         jsize length = env->GetArrayLength(outer);
+         if (length > (jsize)job->lens[d]) {
+            length = job->lens[d];
          }
-      }
-   }
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseFloatArrayElements(jArray[i][j], elems[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jfloatArray jArray = (jfloatArray)env->GetObjectArrayElement(jrow, j);
-         jfloat* elems = env->GetFloatArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[k];
+         const bool leaf = (Levels == 1) || (Levels == 0 && d == (int)job->numDims - 2);
+         const jlong per = leaf ? 1 : job->rowsPer[d];
+         jsize i = (first > rowBase) ? (jsize)((first - rowBase) / per) : 0;
+         for (; i < length && rowBase + i * per < last; i++) {
+            jobject element = env->GetObjectArrayElement(outer, i);
+            if (env->ExceptionCheck()) {
+               return(false);
+            }
+            if (element == NULL) {
+               // a missing row is left as it is in the buffer
+               continue;
+            }
+            bool ok = true;
+            jlong row = rowBase + i * per;
+            if (leaf) {
+               jsize rowLength = env->GetArrayLength((jarray)element);
+               jlong rowStart = job->getRowStart(row);
+               jsize width = (job->offsets != NULL) ? (jsize)(job->offsets[row + 1] - rowStart) : (jsize)job->lens[d + 1];
+               if (rowLength > width) {
+                  rowLength = width;
+               }
+               T* rowData = ((T*)job->data) + rowStart;
+               if (Pack) {
+                  ArrayRegion<T>::get(env, (jarray)element, rowLength, rowData);
+               } else {
+                  ArrayRegion<T>::set(env, (jarray)element, rowLength, rowData);
+               }
+               ok = !env->ExceptionCheck();
+            } else {
+               ok = RowWalker<T, Pack, (Levels > 1) ? Levels - 1 : 0>::walk(job, env, (jobjectArray)element, d + 1, row, first, last);
+            }
+            env->DeleteLocalRef(element);
+            if (!ok) {
+               return(false);
+            }
          }
-         env->ReleaseFloatArrayElements(jArray, elems, 0);
-      }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
-
-AparapiBuffer* AparapiBuffer::flattenDouble3D(JNIEnv* env, jobject arg) {
-
-   jobject javaBuffer = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
-   cl_uint* dims = new cl_uint[3];
-   jobjectArray j0 = (jobjectArray)javaBuffer;
-   jobjectArray j1 = (jobjectArray)env->GetObjectArrayElement(j0, 0);
-   jdoubleArray j2 = (jdoubleArray)env->GetObjectArrayElement(j1, 0);
-   dims[0] = env->GetArrayLength(j0);
-   dims[1] = env->GetArrayLength(j1);
-   dims[2] = env->GetArrayLength(j2);
-
-   int totalSize = dims[0] * dims[1] * dims[2];
-   long bitSize = totalSize * sizeof(jdouble);
-
-   jdouble* array = new jdouble[totalSize];
-   /*
-   jdoubleArray** jArray = new jdoubleArray*[dims[0]];
-   jdouble*** elems = new jdouble**[dims[0]];
-
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jArray[i] = new jdoubleArray[dims[1]];
-      elems[i] = new jdouble*[dims[1]];
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jArray[i][j] = (jdoubleArray)env->GetObjectArrayElement(jrow, j);
-         elems[i][j] = env->GetDoubleArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[2] + k] = elems[i][j][k];
+         return(true);
+      }
+};
+
+template <typename T, bool Pack, int Levels> class RowCopy : public RowCopyJob{
+   public:
+      RowCopy(AparapiBuffer* buffer):
+         RowCopyJob(buffer, sizeof(T)) {
+      }
+
+      virtual bool copyRows(JNIEnv* env, jlong first, jlong last) {
+         return(RowWalker<T, Pack, Levels>::walk(this, env, array, 0, 0, first, last));
+      }
+};
+
+/**
+ * the 2D, 3D and 4D walks are specialized, higher ranks use the run time walk
+ */
+template <typename T, bool Pack> RowCopyJob* createRowCopy(AparapiBuffer* buffer) {
+   switch (buffer->numDims) {
+      case 2:
+         return(new RowCopy<T, Pack, 1>(buffer));
+      case 3:
+         return(new RowCopy<T, Pack, 2>(buffer));
+      case 4:
+         return(new RowCopy<T, Pack, 3>(buffer));
+      default:
+         return(new RowCopy<T, Pack, 0>(buffer));
+   }
+}
+
+template <bool Pack> RowCopyJob* createRowCopy(int type, AparapiBuffer* buffer) {
+   if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_BOOLEAN) {
+      return(createRowCopy<jboolean, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_BYTE) {
+      return(createRowCopy<jbyte, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_CHAR) {
+      return(createRowCopy<jchar, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_SHORT) {
+      return(createRowCopy<jshort, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_INT) {
+      return(createRowCopy<jint, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_LONG) {
+      return(createRowCopy<jlong, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_FLOAT) {
+      return(createRowCopy<jfloat, Pack>(buffer));
+   } else if (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_DOUBLE) {
+      return(createRowCopy<jdouble, Pack>(buffer));
+   }
+   return(NULL);
+}
+
+/**
+ * @return the size of the elements of an arg, 0 if they aren't a primitive we can pack
+ */
+static size_t getElementSize(int type) {
+   if (type & (com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_BOOLEAN | com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_BYTE)) {
+      return(1);
+   } else if (type & (com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_CHAR | com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_SHORT)) {
+      return(2);
+   } else if (type & (com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_INT | com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_FLOAT)) {
+      return(4);
+   } else if (type & (com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_LONG | com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_DOUBLE)) {
+      return(8);
+   }
+   return(0);
+}
+
+/**
+ * Several row copies handed to the worker pool as one job, so the chunks of small buffers run alongside each other
+ * rather than one buffer at a time.
+ */
+class RowCopyJobs{
+   public:
+      RowCopyJob** jobs;
+      jint* firstChunk;         // the job index of the first chunk of each job, with the total at [count]
+      int count;
+
+      RowCopyJobs(RowCopyJob** _jobs, int _count):
+         jobs(_jobs),
+         count(_count) {
+         firstChunk = new jint[count + 1];
+         firstChunk[0] = 0;
+         for (int i = 0; i < count; i++) {
+            firstChunk[i + 1] = firstChunk[i] + jobs[i]->getChunks();
          }
       }
-   }
 
-   for(int i = 0; i < (int)dims[0]; i++) {
-      for(int j = 0; j < (int)dims[1]; j++) {
-         env->ReleaseDoubleArrayElements(jArray[i][j], elems[i][j], 0);
+      ~RowCopyJobs() {
+         delete[] firstChunk;
       }
-      delete[] jArray[i];
-      delete[] elems[i];
-   }
-   delete[] jArray;
-   delete[] elems;
-   */
 
-   for(int i = 0; i < (int)dims[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
-      for(int j = 0; j < (int)dims[1]; j++) {
-         jdoubleArray jArray = (jdoubleArray)env->GetObjectArrayElement(jrow, j);
-         jdouble* elems = env->GetDoubleArrayElements(jArray,0);
-         for(int k = 0; k < (int)dims[2]; k++) {
-            array[i*dims[1]*dims[2] + j*dims[1] + k] = elems[k];
+      static void copyChunk(JNIEnv* env, void* _jobs, jint index) {
+         RowCopyJobs* jobs = (RowCopyJobs*)_jobs;
+         int i = 0;
+         while (index >= jobs->firstChunk[i + 1]) {
+            i++;
          }
-         env->ReleaseDoubleArrayElements(jArray, elems, 0);
-      }
-   }
-  
-   return new AparapiBuffer((void*)array, (cl_uint*)dims, 3, bitSize, javaBuffer);
-}
-
-
-
-void AparapiBuffer::inflate(JNIEnv* env, KernelArg* arg) {
-   javaObject = JNIHelper::getInstanceField<jobject>(env, arg->javaArg, "javaBuffer", ObjectClassArg);
-   if(numDims == 2 && arg->isBoolean()) {
-      AparapiBuffer::inflateBoolean2D(env, arg);
-   } else if(numDims == 2 && arg->isByte()) {
-      AparapiBuffer::inflateByte2D(env, arg);
-   } else if(numDims == 2 && arg->isShort()) {
-      AparapiBuffer::inflateShort2D(env, arg);
-   } else if(numDims == 2 && arg->isInt()) {
-      AparapiBuffer::inflateInt2D(env, arg);
-   } else if(numDims == 2 && arg->isLong()) {
-      AparapiBuffer::inflateLong2D(env, arg);
-   } else if(numDims == 2 && arg->isFloat()) {
-      AparapiBuffer::inflateFloat2D(env, arg);
-   } else if(numDims == 2 && arg->isDouble()) {
-      AparapiBuffer::inflateDouble2D(env, arg);
-   } else if(numDims == 3 && arg->isBoolean()) {
-      AparapiBuffer::inflateBoolean3D(env, arg);
-   } else if(numDims == 3 && arg->isByte()) {
-      AparapiBuffer::inflateByte3D(env, arg);
-   } else if(numDims == 3 && arg->isShort()) {
-      AparapiBuffer::inflateShort3D(env, arg);
-   } else if(numDims == 3 && arg->isInt()) {
-      AparapiBuffer::inflateInt3D(env, arg);
-   } else if(numDims == 3 && arg->isLong()) {
-      AparapiBuffer::inflateLong3D(env, arg);
-   } else if(numDims == 3 && arg->isFloat()) {
-      AparapiBuffer::inflateFloat3D(env, arg);
-   } else if(numDims == 3 && arg->isDouble()) {
-      AparapiBuffer::inflateDouble3D(env, arg);
-   } else {
-       return;
-   }
-
-   deleteBuffer(arg);
-}
-
-
-void AparapiBuffer::inflateBoolean2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jboolean* array = (jboolean*)data;
-   /*
-   jbooleanArray* jArray = new jbooleanArray[lens[0]];
-   jboolean** body =  new jboolean*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jbooleanArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetBooleanArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseBooleanArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jbooleanArray jArray = (jbooleanArray)env->GetObjectArrayElement(buffer, i);
-      jboolean* body = env->GetBooleanArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
-      }
-      env->ReleaseBooleanArrayElements(jArray, body, 0);
-   }
-}
-
-void AparapiBuffer::inflateByte2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jbyte* array = (jbyte*)data;
-   /*
-   jbyteArray* jArray = new jbyteArray[lens[0]];
-   jbyte** body =  new jbyte*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jbyteArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetByteArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseByteArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jbyteArray jArray = (jbyteArray)env->GetObjectArrayElement(buffer, i);
-      jbyte* body = env->GetByteArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
-      }
-      env->ReleaseByteArrayElements(jArray, body, 0);
-   }
-}
-
-void AparapiBuffer::inflateShort2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jshort* array = (jshort*)data;
-   /*
-   jshortArray* jArray = new jshortArray[lens[0]];
-   jshort** body =  new jshort*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jshortArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetShortArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseShortArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jshortArray jArray = (jshortArray)env->GetObjectArrayElement(buffer, i);
-      jshort* body = env->GetShortArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
-      }
-      env->ReleaseShortArrayElements(jArray, body, 0);
-   }
-}
-
-void AparapiBuffer::inflateInt2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jint* array = (jint*)data;
-   /*
-   jintArray* jArray = new jintArray[lens[0]];
-   jint** body =  new jint*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jintArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetIntArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseIntArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jintArray jArray = (jintArray)env->GetObjectArrayElement(buffer, i);
-      jint* body = env->GetIntArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
-      }
-      env->ReleaseIntArrayElements(jArray, body, 0);
-   }
-}
-
-void AparapiBuffer::inflateLong2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jlong* array = (jlong*)data;
-   /*
-   jlongArray* jArray = new jlongArray[lens[0]];
-   jlong** body =  new jlong*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jlongArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetLongArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseLongArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jlongArray jArray = (jlongArray)env->GetObjectArrayElement(buffer, i);
-      jlong* body = env->GetLongArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
-      }
-      env->ReleaseLongArrayElements(jArray, body, 0);
-   }
-}
-
-void AparapiBuffer::inflateFloat2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jfloat* array = (jfloat*)data;
-   /*
-   jfloatArray* jArray = new jfloatArray[lens[0]];
-   jfloat** body =  new jfloat*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jfloatArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetFloatArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseFloatArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jfloatArray jArray = (jfloatArray)env->GetObjectArrayElement(buffer, i);
-      jfloat* body = env->GetFloatArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
-      }
-      env->ReleaseFloatArrayElements(jArray, body, 0);
-   }
-}
-
-void AparapiBuffer::inflateDouble2D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jdouble* array = (jdouble*)data;
-   /*
-   jdoubleArray* jArray = new jdoubleArray[lens[0]];
-   jdouble** body =  new jdouble*[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jArray[i] = (jdoubleArray)env->GetObjectArrayElement(buffer, i);
-      body[i] = env->GetDoubleArrayElements(jArray[i],0);
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         body[i][j] = array[i*dims[0] + j];
+         RowCopyJob::copyChunk(env, jobs->jobs[i], index - jobs->firstChunk[i]);
       }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      env->ReleaseDoubleArrayElements(jArray[i], body[i], 0);
-   }
-   delete[] jArray;
-   delete[] body;
-   */
 
-   for(int i = 0; i < lens[0]; i++) {
-      jdoubleArray jArray = (jdoubleArray)env->GetObjectArrayElement(buffer, i);
-      jdouble* body = env->GetDoubleArrayElements(jArray,0);
-      for(int j = 0; j < lens[1]; j++) {
-         body[j] = array[i*dims[0] + j];
+      void run(JNIEnv* env) {
+         WorkerPool::run(env, copyChunk, this, firstChunk[count]);
       }
-      env->ReleaseDoubleArrayElements(jArray, body, 0);
-   }
-}
-
-
-void AparapiBuffer::inflateBoolean3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jboolean* array = (jboolean*)data;
-   /*
-   jbooleanArray** jArray = new jbooleanArray*[lens[0]];
-   jboolean*** body =  new jboolean**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jbooleanArray[lens[0]];
-      body[i] =  new jboolean*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jbooleanArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetBooleanArrayElements(jArray[i][j],0);
-      }
-   }
+};
 
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
+/**
+ * read the length of each dimension of a java array, following the first element at each level
+ */
+static void getLens(JNIEnv* env, jobject javaBuffer, cl_uint numDims, cl_uint* lens) {
+   jobject level = javaBuffer;
+   for (cl_uint d = 0; d < numDims; d++) {
+      lens[d] = (level == NULL) ? 0 : env->GetArrayLength((jarray)level);
+      if (d < numDims - 1) {
+         jobject next = (lens[d] == 0) ? NULL : env->GetObjectArrayElement((jobjectArray)level, 0);
+         if (level != javaBuffer) {
+            env->DeleteLocalRef(level);
          }
+         level = next;
       }
    }
-
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseBooleanArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jbooleanArray jArray = (jbooleanArray)env->GetObjectArrayElement(jrow, j);
-         jboolean* body = env->GetBooleanArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseBooleanArrayElements(jArray, body, 0);
-      }
+   if (level != NULL && level != javaBuffer) {
+      env->DeleteLocalRef(level);
    }
 }
 
-void AparapiBuffer::inflateByte3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jbyte* array = (jbyte*)data;
-   /*
-   jbyteArray** jArray = new jbyteArray*[lens[0]];
-   jbyte*** body =  new jbyte**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jbyteArray[lens[0]];
-      body[i] =  new jbyte*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jbyteArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetByteArrayElements(jArray[i][j],0);
+/**
+ * read the row lengths of a jagged 2D java array as CSR style offsets, lens gets the row count and longest row
+ *
+ * @return offsets[i] is the first element of row i in the packed buffer, offsets[rows] the total element count
+ */
+static jint* getOffsets(JNIEnv* env, jobject javaBuffer, cl_uint* lens) {
+   lens[0] = (javaBuffer == NULL) ? 0 : env->GetArrayLength((jarray)javaBuffer);
+   lens[1] = 0;
+   jint* offsets = new jint[lens[0] + 1];
+   offsets[0] = 0;
+   for (cl_uint i = 0; i < lens[0]; i++) {
+      jobject row = env->GetObjectArrayElement((jobjectArray)javaBuffer, i);
+      jint length = (row == NULL) ? 0 : env->GetArrayLength((jarray)row);
+      if (row != NULL) {
+         env->DeleteLocalRef(row);
       }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
-         }
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseByteArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jbyteArray jArray = (jbyteArray)env->GetObjectArrayElement(jrow, j);
-         jbyte* body = env->GetByteArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseByteArrayElements(jArray, body, 0);
+      if ((cl_uint)length > lens[1]) {
+         lens[1] = length;
       }
+      offsets[i + 1] = offsets[i] + length;
    }
+   return(offsets);
 }
 
-void AparapiBuffer::inflateShort3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jshort* array = (jshort*)data;
-   /*
-   jshortArray** jArray = new jshortArray*[lens[0]];
-   jshort*** body =  new jshort**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jshortArray[lens[0]];
-      body[i] =  new jshort*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jshortArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetShortArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
-         }
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseShortArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jshortArray jArray = (jshortArray)env->GetObjectArrayElement(jrow, j);
-         jshort* body = env->GetShortArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseShortArrayElements(jArray, body, 0);
+AparapiBuffer::AparapiBuffer():
+   javaObject((jobject) 0),
+   numDims(0),
+   dims(NULL),
+   lens(NULL),
+   lengthInBytes(0),
+   mem((cl_mem) 0),
+   data(NULL),
+   memMask((cl_uint)0),
+   readPending(false),
+   offsets(NULL),
+   offsetsMem((cl_mem) 0) {
+   }
+
+/**
+ * take ownership of new dimension lengths and work out the offset of each dimension from them
+ */
+void AparapiBuffer::setLens(cl_uint* _lens) {
+   lens = _lens;
+   dims = new cl_uint[numDims];
+   for(int i = 0; i < numDims; i++) {
+      dims[i] = 1;
+      for(int j = i+1; j < numDims; j++) {
+         dims[i] *= lens[j];
       }
    }
 }
 
-void AparapiBuffer::inflateInt3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jint* array = (jint*)data;
-   /*
-   jintArray** jArray = new jintArray*[lens[0]];
-   jint*** body =  new jint**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jintArray[lens[0]];
-      body[i] =  new jint*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jintArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetIntArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
-         }
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseIntArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jintArray jArray = (jintArray)env->GetObjectArrayElement(jrow, j);
-         jint* body = env->GetIntArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseIntArrayElements(jArray, body, 0);
-      }
-   }
+jobject AparapiBuffer::getJavaObject(JNIEnv* env, KernelArg* arg) {
+   return JNIHelper::getInstanceField<jobject>(env, arg->javaArg, "javaBuffer", ObjectClassArg);
 }
 
-void AparapiBuffer::inflateLong3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jlong* array = (jlong*)data;
-   /*
-   jlongArray** jArray = new jlongArray*[lens[0]];
-   jlong*** body =  new jlong**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jlongArray[lens[0]];
-      body[i] =  new jlong*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jlongArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetLongArrayElements(jArray[i][j],0);
-      }
-   }
 
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
-         }
-      }
+/**
+ * Allocate the packed buffer for a multi-dimensional array arg. The dimensions are taken from the first element at
+ * each level, or from every row for a jagged array. The contents are packed by pack() before each upload.
+ */
+AparapiBuffer* AparapiBuffer::flatten(JNIEnv* env, jobject arg, int type) {
+   int numDims = JNIHelper::getInstanceField<jint>(env, arg, "numDims", IntArg);
+   size_t elementSize = getElementSize(type);
+   AparapiBuffer* buffer = new AparapiBuffer();
+   if (numDims < 2 || elementSize == 0) {
+      return buffer;
+   }
+
+   buffer->numDims = numDims;
+   buffer->javaObject = JNIHelper::getInstanceField<jobject>(env, arg, "javaBuffer", ObjectClassArg);
+   buffer->update(env, buffer->javaObject, elementSize, numDims == 2 && (type & com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_JAGGED) != 0);
+   return buffer;
+}
+
+/**
+ * Compare the shape of a java array with the packed buffer, reallocating the buffer if they differ.
+ *
+ * @return true if the packed buffer was reallocated
+ */
+bool AparapiBuffer::update(JNIEnv* env, jobject javaBuffer, size_t elementSize, bool jagged) {
+   cl_uint* current = new cl_uint[numDims];
+   jint* currentOffsets = NULL;
+   if (jagged) {
+      currentOffsets = getOffsets(env, javaBuffer, current);
+   } else {
+      getLens(env, javaBuffer, numDims, current);
    }
-
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseLongArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
+   if (lens != NULL && memcmp(current, lens, numDims * sizeof(cl_uint)) == 0
+         && (!jagged || memcmp(currentOffsets, offsets, (lens[0] + 1) * sizeof(jint)) == 0)) {
+      delete[] current;
+      delete[] currentOffsets;
+      return(false);
    }
-   delete[] jArray;
-   delete[] body;
-   */
 
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jlongArray jArray = (jlongArray)env->GetObjectArrayElement(jrow, j);
-         jlong* body = env->GetLongArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseLongArrayElements(jArray, body, 0);
-      }
+   deleteBuffer(NULL);
+   setLens(current);
+   offsets = currentOffsets;
+   long totalSize = 1;
+   if (jagged) {
+      totalSize = offsets[lens[0]];
+   } else {
+      for (int d = 0; d < numDims; d++) {
+         totalSize *= lens[d];
+      }
+   }
+   lengthInBytes = totalSize * elementSize;
+   data = new char[lengthInBytes]();
+   return(true);
+}
+
+/**
+ * Copy the current contents of the java array into the packed buffer. If commandQueue is not 0 each chunk of rows
+ * is also written to mem as soon as it is packed, so the upload overlaps the packing of the remaining rows; the
+ * caller orders later commands after the writes with a marker.
+ *
+ * @return CL_SUCCESS or the first failing status
+ */
+cl_int AparapiBuffer::pack(JNIEnv* env, KernelArg* arg, cl_command_queue commandQueue) {
+   RowCopyJob* job = (data == NULL || numDims < 2) ? NULL : createRowCopy<true>(arg->type, this);
+   if (job == NULL) {
+      return(CL_SUCCESS);
+   }
+   job->commandQueue = commandQueue;
+   job->mem = mem;
+   cl_int status = job->run(env, getJavaObject(env, arg));
+   delete job;
+   return(status);
+}
+
+/**
+ * Check the dimensions of the java array, which may have been replaced or had rows replaced since the last run. If
+ * they changed the packed buffer is reallocated to match, and the caller must replace mem and offsetsMem.
+ *
+ * @return true if the packed buffer was reallocated
+ */
+bool AparapiBuffer::resize(JNIEnv* env, KernelArg* arg) {
+   size_t elementSize = getElementSize(arg->type);
+   if (elementSize == 0 || numDims < 2) {
+      return(false);
+   }
+   return(update(env, getJavaObject(env, arg), elementSize, numDims == 2 && arg->isJagged()));
+}
+
+/**
+ * Copy the packed buffer, just read back from the device, into the java array.
+ */
+void AparapiBuffer::inflate(JNIEnv* env, KernelArg* arg) {
+   javaObject = getJavaObject(env, arg);
+   RowCopyJob* job = (data == NULL || numDims < 2) ? NULL : createRowCopy<false>(arg->type, this);
+   if (job != NULL) {
+      job->run(env, javaObject);
+      delete job;
    }
 }
 
-void AparapiBuffer::inflateFloat3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jfloat* array = (jfloat*)data;
-   /*
-   jfloatArray** jArray = new jfloatArray*[lens[0]];
-   jfloat*** body =  new jfloat**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jfloatArray[lens[0]];
-      body[i] =  new jfloat*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jfloatArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetFloatArrayElements(jArray[i][j],0);
-      }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
-         }
-      }
-   }
-
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseFloatArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
-   }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jfloatArray jArray = (jfloatArray)env->GetObjectArrayElement(jrow, j);
-         jfloat* body = env->GetFloatArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseFloatArrayElements(jArray, body, 0);
+/**
+ * Copy every buffer with a completed non-blocking read back into its java array, the rows of all the buffers are
+ * shared across the worker pool. jobs has room for argc jobs and is reused from run to run.
+ */
+void AparapiBuffer::inflateAll(JNIEnv* env, KernelArg** args, int argc, RowCopyJob** jobs) {
+   int count = 0;
+   for (int i = 0; i < argc; i++) {
+      KernelArg* arg = args[i];
+      if (!arg->isAparapiBuffer() || !arg->aparapiBuffer->readPending) {
+         continue;
       }
-   }
-}
-
-void AparapiBuffer::inflateDouble3D(JNIEnv *env, KernelArg* arg) {
-   
-   jobjectArray buffer = (jobjectArray)javaObject;
-   jdouble* array = (jdouble*)data;
-   /*
-   jdoubleArray** jArray = new jdoubleArray*[lens[0]];
-   jdouble*** body =  new jdouble**[lens[0]];
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      jArray[i] = new jdoubleArray[lens[0]];
-      body[i] =  new jdouble*[lens[0]];
-      for(int j = 0; j < lens[1]; j++) {
-         jArray[i][j] = (jdoubleArray)env->GetObjectArrayElement(jrow, j);
-         body[i][j] = env->GetDoubleArrayElements(jArray[i][j],0);
+      AparapiBuffer* buffer = arg->aparapiBuffer;
+      buffer->readPending = false;
+      if (buffer->data == NULL || buffer->numDims < 2) {
+         continue;
       }
-   }
-
-   #pragma omp parallel for
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         for(int k = 0; k < lens[2]; k++) {
-            body[i][j][k] = array[i*dims[0] + j*dims[1] + k];
-         }
+      jobs[count] = createRowCopy<false>(arg->type, buffer);
+      if (jobs[count] == NULL) {
+         continue;
       }
+      buffer->javaObject = buffer->getJavaObject(env, arg);
+      jobs[count]->start(env, buffer->javaObject);
+      count++;
    }
 
-   for(int i = 0; i < lens[0]; i++) {
-      for(int j = 0; j < lens[1]; j++) {
-         env->ReleaseDoubleArrayElements(jArray[i][j], body[i][j], 0);
-      }
-      delete[] jArray[i];
-      delete[] body[i];
+   if (count > 0) {
+      RowCopyJobs all(jobs, count);
+      all.run(env);
    }
-   delete[] jArray;
-   delete[] body;
-   */
-
-   for(int i = 0; i < lens[0]; i++) {
-      jobjectArray jrow = (jobjectArray)env->GetObjectArrayElement(buffer, i);
-      for(int j = 0; j < lens[1]; j++) {
-         jdoubleArray jArray = (jdoubleArray)env->GetObjectArrayElement(jrow, j);
-         jdouble* body = env->GetDoubleArrayElements(jArray,0);
-         for(int k = 0; k < lens[2]; k++) {
-            body[k] = array[i*dims[0] + j*dims[1] + k];
-         }
-         env->ReleaseDoubleArrayElements(jArray, body, 0);
-      }
+   for (int i = 0; i < count; i++) {
+      jobs[i]->finish(env);
+      delete jobs[i];
    }
 }
 
 void AparapiBuffer::deleteBuffer(KernelArg* arg)
 {
-      delete[] dims;
-      delete[] lens;
-   if(arg->isBoolean()) {
-      delete[] (jboolean*)data;
-   } else if(arg->isByte()) {
-      delete[] (jbyte*)data;
-   } else if(arg->isShort()) {
-      delete[] (jshort*)data;
-   } else if(arg->isInt()) {
-      delete[] (jint*)data;
-   } else if(arg->isLong()) {
-      delete[] (jlong*)data;
-   } else if(arg->isFloat()) {
-      delete[] (jfloat*)data;
-   } else if(arg->isDouble()) {
-      delete[] (jdouble*)data;
-   }
+   delete[] dims;
+   delete[] lens;
+   delete[] (char*)data;
+   delete[] offsets;
+   dims = NULL;
+   lens = NULL;
+   data = NULL;
+   offsets = NULL;
 }
@@ -43,32 +43,14 @@
 #include "com_amd_aparapi_internal_jni_KernelRunnerJNI.h"
 
 class KernelArg;
+class RowCopyJob;
 
 class AparapiBuffer{
 
 private:
 
-   static int isFloat(int type){
-      return(type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_FLOAT);
-   }
-   static int isLong(int type){
-      return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_LONG);
-   }
-   static int isInt(int type){
-      return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_INT);
-   }
-   static int isDouble(int type){
-      return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_DOUBLE);
-   }
-   static int isBoolean(int type){
-      return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_BOOLEAN);
-   }
-   static int isByte(int type){
-      return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_BYTE);
-   }
-   static int isShort(int type){
-      return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_SHORT);
-   }
+   void setLens(cl_uint* _lens);
+   bool update(JNIEnv *env, jobject javaBuffer, size_t elementSize, bool jagged);
 
 public:
       jobject javaObject;       // The java array that this arg is mapped to 
@@ -81,51 +63,23 @@ public:
       cl_uint memMask;          // the mask used for createBuffer
       ProfileInfo read;
       ProfileInfo write;
+      bool readPending;         // a non-blocking read into data has been enqueued and not yet inflated
+      jint* offsets;            // for a jagged array the first element of each row in data, followed by the total
+      cl_mem offsetsMem;        // the opencl buffer holding offsets, passed to the kernel after the lens and dims
 
       AparapiBuffer();
-      AparapiBuffer(void* _data, cl_uint* _dims, cl_uint _numDims, long _lengthInBytes, jobject _javaObject);
 
       void deleteBuffer(KernelArg* arg);
 
       static AparapiBuffer* flatten(JNIEnv *env, jobject arg, int type);
 
-      static AparapiBuffer* flattenBoolean2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenChar2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenByte2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenShort2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenInt2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenLong2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenFloat2D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenDouble2D(JNIEnv *env, jobject arg);
-
-      static AparapiBuffer* flattenBoolean3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenChar3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenByte3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenShort3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenInt3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenLong3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenFloat3D(JNIEnv *env, jobject arg);
-      static AparapiBuffer* flattenDouble3D(JNIEnv *env, jobject arg);
+      bool resize(JNIEnv *env, KernelArg* arg);
+
+      cl_int pack(JNIEnv *env, KernelArg* arg, cl_command_queue commandQueue);
 
       void inflate(JNIEnv *env, KernelArg* arg);
 
-      void inflateBoolean2D(JNIEnv *env, KernelArg* arg);
-      void inflateChar2D(JNIEnv *env, KernelArg* arg);
-      void inflateByte2D(JNIEnv *env, KernelArg* arg);
-      void inflateShort2D(JNIEnv *env, KernelArg* arg);
-      void inflateInt2D(JNIEnv *env, KernelArg* arg);
-      void inflateLong2D(JNIEnv *env, KernelArg* arg);
-      void inflateFloat2D(JNIEnv *env, KernelArg* arg);
-      void inflateDouble2D(JNIEnv *env, KernelArg* arg);
-
-      void inflateBoolean3D(JNIEnv *env, KernelArg* arg);
-      void inflateChar3D(JNIEnv *env, KernelArg* arg);
-      void inflateByte3D(JNIEnv *env, KernelArg* arg);
-      void inflateShort3D(JNIEnv *env, KernelArg* arg);
-      void inflateInt3D(JNIEnv *env, KernelArg* arg);
-      void inflateLong3D(JNIEnv *env, KernelArg* arg);
-      void inflateFloat3D(JNIEnv *env, KernelArg* arg);
-      void inflateDouble3D(JNIEnv *env, KernelArg* arg);
+      static void inflateAll(JNIEnv *env, KernelArg** args, int argc, RowCopyJob** jobs);
 
       jobject getJavaObject(JNIEnv* env, KernelArg* arg);
 };
@@ -37,6 +37,7 @@
    */
 #define ARRAYBUFFER_SOURCE
 #include "ArrayBuffer.h"
+#include "HostTiming.h"
 
 ArrayBuffer::ArrayBuffer():
    javaArray((jobject) 0),
@@ -46,19 +47,56 @@ ArrayBuffer::ArrayBuffer():
    addr(NULL),
    memMask((cl_uint)0),
    isCopy(false),
-   isPinned(false){
+   isPinned(false),
+   mapped(NULL),
+   mappedStart(0),
+   mappedBytes(0),
+   deviceResident(false),
+   asyncResident(false),
+   pinnedAt(0),
+   criticalNanos(0){
    }
 
 void ArrayBuffer::unpinAbort(JNIEnv *jenv){
    jenv->ReleasePrimitiveArrayCritical((jarray)javaArray, addr,JNI_ABORT);
    isPinned = JNI_FALSE;
+   criticalNanos += HostTiming::now() - pinnedAt;
 }
 void ArrayBuffer::unpinCommit(JNIEnv *jenv){
    jenv->ReleasePrimitiveArrayCritical((jarray)javaArray, addr, 0);
    isPinned = JNI_FALSE;
+   criticalNanos += HostTiming::now() - pinnedAt;
 }
 void ArrayBuffer::pin(JNIEnv *jenv){
    void *ptr = addr;
    addr = jenv->GetPrimitiveArrayCritical((jarray)javaArray,&isCopy);
    isPinned = JNI_TRUE;
+   pinnedAt = HostTiming::now();
+}
+
+/**
+ * Copy the java array into dst (a mapped view of a device resident buffer).
+ * The array is only held in a critical region for the duration of the memcpy.
+ */
+void ArrayBuffer::copyIn(JNIEnv *jenv, void *dst){
+   pin(jenv);
+   memcpy(dst, addr, lengthInBytes);
+   unpinAbort(jenv);
+}
+
+/**
+ * Copy src (a mapped view of a device resident buffer) back into the java array.
+ * The array is only held in a critical region for the duration of the memcpy.
+ */
+void ArrayBuffer::copyOut(JNIEnv *jenv, void *src){
+   copyOut(jenv, src, 0, lengthInBytes);
+}
+
+/**
+ * Copy bytes from src (a mapped view of part of a device resident buffer) back into the java array at byte offset start.
+ */
+void ArrayBuffer::copyOut(JNIEnv *jenv, void *src, size_t start, size_t bytes){
+   pin(jenv);
+   memcpy((char *)addr + start, src, bytes);
+   unpinCommit(jenv);
 }
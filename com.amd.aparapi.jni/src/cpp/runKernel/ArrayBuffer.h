@@ -52,6 +52,13 @@ class ArrayBuffer{
       jboolean isCopy;
       jboolean isPinned;
       char memSpec[128];        // The string form of the mask we used for create buffer. for debugging
+      void *mapped;             // host view of a device resident buffer while a readback is in flight
+      size_t mappedStart;       // the byte offset of mapped within the buffer
+      size_t mappedBytes;       // the number of bytes mapped
+      jboolean deviceResident;  // forced device resident (NUMA, zero copy or split contexts) regardless of config
+      jboolean asyncResident;   // device resident for an async execution, until the next synchronous one
+      jlong pinnedAt;           // when the array was last pinned (HostTiming::now())
+      jlong criticalNanos;      // the total time the array has been held pinned
       ProfileInfo read;
       ProfileInfo write;
 
@@ -59,6 +66,9 @@ class ArrayBuffer{
       void unpinAbort(JNIEnv *jenv);
       void unpinCommit(JNIEnv *jenv);
       void pin(JNIEnv *jenv);
+      void copyIn(JNIEnv *jenv, void *dst);
+      void copyOut(JNIEnv *jenv, void *src);
+      void copyOut(JNIEnv *jenv, void *src, size_t start, size_t bytes);
 };
 
 #endif // ARRAYBUFFER_H
@@ -37,14 +37,49 @@
    */
 #define CONFIG_SOURCE
 #include "Config.h"
+#include "Mutex.h"
+
+static Mutex configLock;
 
 jboolean Config::getBoolean(JNIEnv *jenv, const char *fieldName){
    jfieldID fieldID = jenv->GetStaticFieldID(configClass, fieldName, "Z");
    return(jenv->GetStaticBooleanField(configClass, fieldID));
 }
 
+jint Config::getInt(JNIEnv *jenv, const char *fieldName){
+   jfieldID fieldID = jenv->GetStaticFieldID(configClass, fieldName, "I");
+   return(jenv->GetStaticIntField(configClass, fieldID));
+}
+
+char* Config::getString(JNIEnv *jenv, const char *fieldName){
+   char* value = NULL;
+   jfieldID fieldID = jenv->GetStaticFieldID(configClass, fieldName, "Ljava/lang/String;");
+   jstring str = (jstring)jenv->GetStaticObjectField(configClass, fieldID);
+   if (str != NULL) {
+      const char* chars = jenv->GetStringUTFChars(str, NULL);
+      if (strlen(chars) > 0) {
+         value = strdup(chars);
+      }
+      jenv->ReleaseStringUTFChars(str, chars);
+   }
+   return(value);
+}
+
 Config::Config(JNIEnv *jenv){
    enableVerboseJNI = false;
+   enableDeviceResidentBuffers = false;
+   enableNUMAFission = false;
+   programCacheDir = NULL;
+   maxCachedPrograms = 64;
+   enableLocalSizeTuning = false;
+   localSizeTuningFile = NULL;
+   localSizeTuningTrials = 2;
+   enableZeroCopyCPU = false;
+   profileFile = NULL;
+   enableDeviceTiming = false;
+   enableTransferLog = false;
+   profilingSampleInterval = 1;
+   profilingOverheadPercent = 0;
    configClass = jenv->FindClass("com/amd/aparapi/internal/jni/ConfigJNI");
    if (configClass == NULL ||  jenv->ExceptionCheck()) {
       jenv->ExceptionDescribe(); 
@@ -55,6 +90,23 @@ Config::Config(JNIEnv *jenv){
       enableVerboseJNIOpenCLResourceTracking = getBoolean(jenv, "enableVerboseJNIOpenCLResourceTracking");
       enableProfiling = getBoolean(jenv, "enableProfiling");
       enableProfilingCSV = getBoolean(jenv, "enableProfilingCSV");
+      enableDeviceResidentBuffers = getBoolean(jenv, "enableDeviceResidentBuffers");
+      enableNUMAFission = getBoolean(jenv, "enableNUMAFission");
+      maxCachedPrograms = getInt(jenv, "maxCachedPrograms");
+      programCacheDir = getString(jenv, "programCacheDir");
+      enableLocalSizeTuning = getBoolean(jenv, "enableLocalSizeTuning");
+      localSizeTuningFile = getString(jenv, "localSizeTuningFile");
+      localSizeTuningTrials = getInt(jenv, "localSizeTuningTrials");
+      enableZeroCopyCPU = getBoolean(jenv, "enableZeroCopyCPU");
+      profileFile = getString(jenv, "profileFile");
+      enableDeviceTiming = getBoolean(jenv, "enableDeviceTiming");
+      enableTransferLog = getBoolean(jenv, "enableTransferLog");
+      profilingSampleInterval = getInt(jenv, "profilingSampleInterval");
+      profilingOverheadPercent = getInt(jenv, "profilingOverheadPercent");
+      if (profileFile != NULL) {
+         // the profiler needs the timestamps of every event
+         enableProfiling = true;
+      }
    }
 
    //fprintf(stderr, "Config::enableVerboseJNI=%s\n",enableVerboseJNI?"true":"false");
@@ -63,6 +115,20 @@ Config::Config(JNIEnv *jenv){
    //fprintf(stderr, "Config::enableProfilingCSV=%s\n",enableProfilingCSV?"true":"false");
 }
 
+/**
+ * create the shared config on first use. Only the first callers take the lock, once config is published it is never replaced.
+ */
+void Config::init(JNIEnv *jenv){
+   if (config == NULL){
+      ScopedLock lock(configLock);
+      if (config == NULL){
+         Config* created = new Config(jenv);
+         memoryBarrier();
+         config = created;
+      }
+   }
+}
+
 jboolean Config::isVerbose(){
    return enableVerboseJNI;
 }
@@ -76,3 +142,42 @@ jboolean Config::isTrackingOpenCLResources(){
 jboolean Config::isProfilingEnabled(){
    return enableProfiling;
 }
+jboolean Config::isDeviceResidentBuffersEnabled(){
+   return enableDeviceResidentBuffers;
+}
+jboolean Config::isNUMAFissionEnabled(){
+   return enableNUMAFission;
+}
+const char* Config::getProgramCacheDir(){
+   return programCacheDir;
+}
+jint Config::getMaxCachedPrograms(){
+   return maxCachedPrograms;
+}
+jboolean Config::isLocalSizeTuningEnabled(){
+   return enableLocalSizeTuning;
+}
+const char* Config::getLocalSizeTuningFile(){
+   return localSizeTuningFile;
+}
+jint Config::getLocalSizeTuningTrials(){
+   return localSizeTuningTrials;
+}
+jboolean Config::isZeroCopyCPUEnabled(){
+   return enableZeroCopyCPU;
+}
+const char* Config::getProfileFile(){
+   return profileFile;
+}
+jboolean Config::isDeviceTimingEnabled(){
+   return enableDeviceTiming;
+}
+jboolean Config::isTransferLogEnabled(){
+   return enableTransferLog;
+}
+jint Config::getProfilingSampleInterval(){
+   return profilingSampleInterval;
+}
+jint Config::getProfilingOverheadPercent(){
+   return profilingOverheadPercent;
+}
@@ -47,13 +47,42 @@ class Config{
       jboolean enableVerboseJNIOpenCLResourceTracking;
       jboolean enableProfiling;
       jboolean enableProfilingCSV;
+      jboolean enableDeviceResidentBuffers;
+      jboolean enableNUMAFission;
+      char* programCacheDir;
+      jint maxCachedPrograms;
+      jboolean enableLocalSizeTuning;
+      char* localSizeTuningFile;
+      jint localSizeTuningTrials;
+      jboolean enableZeroCopyCPU;
+      char* profileFile;
+      jboolean enableDeviceTiming;
+      jboolean enableTransferLog;
+      jint profilingSampleInterval;
+      jint profilingOverheadPercent;
 
       jboolean getBoolean(JNIEnv *jenv, const char *fieldName);
+      jint getInt(JNIEnv *jenv, const char *fieldName);
+      char* getString(JNIEnv *jenv, const char *fieldName);
       Config(JNIEnv *jenv);
+      static void init(JNIEnv *jenv);
       jboolean isVerbose();
       jboolean isProfilingCSVEnabled();
       jboolean isTrackingOpenCLResources();
       jboolean isProfilingEnabled();
+      jboolean isDeviceResidentBuffersEnabled();
+      jboolean isNUMAFissionEnabled();
+      const char* getProgramCacheDir();
+      jint getMaxCachedPrograms();
+      jboolean isLocalSizeTuningEnabled();
+      const char* getLocalSizeTuningFile();
+      jint getLocalSizeTuningTrials();
+      jboolean isZeroCopyCPUEnabled();
+      const char* getProfileFile();
+      jboolean isDeviceTimingEnabled();
+      jboolean isTransferLogEnabled();
+      jint getProfilingSampleInterval();
+      jint getProfilingOverheadPercent();
 };
 
 #ifdef CONFIG_SOURCE
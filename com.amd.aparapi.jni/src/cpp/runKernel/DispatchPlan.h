@@ -0,0 +1,87 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef DISPATCH_PLAN_H
+#define DISPATCH_PLAN_H
+
+#include "Common.h"
+#include "KernelArg.h"
+#include <vector>
+
+class JNIContext;
+
+/**
+ * The args of a kernel in the order processArgs sets them, compiled once by setArgsJNI. 
+ * Each op knows what kind of arg it sets and the kernel arg position it starts at, so a run neither 
+ * re-derives what each arg is nor counts the hidden length, dimension and row offset args.
+ */
+class DispatchPlan{
+   public:
+      enum OpKind {
+         OP_ARRAY,          // global or constant java array, possibly device resident
+         OP_BUFFER,         // multi dimensional array flattened into an AparapiBuffer
+         OP_LOCAL_ARRAY,
+         OP_LOCAL_BUFFER,
+         OP_PRIMITIVE
+      };
+
+      class Op{
+         public:
+            OpKind kind;
+            KernelArg* arg;
+            jint argIdx;    // position of arg in the args of the JNIContext
+            jint argPos;    // kernel arg position of arg, its hidden args follow it
+
+            Op(OpKind kind, KernelArg* arg, jint argIdx, jint argPos):
+               kind(kind),
+               arg(arg),
+               argIdx(argIdx),
+               argPos(argPos){
+            }
+      };
+
+      std::vector<Op> ops;
+      jint argCount;        // kernel arg positions taken by the args, passid is set after them
+
+      DispatchPlan(JNIContext* jniContext);
+
+   private:
+      static jint getArgSpan(KernelArg* arg);
+};
+
+#endif // DISPATCH_PLAN_H
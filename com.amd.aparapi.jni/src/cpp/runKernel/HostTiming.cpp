@@ -0,0 +1,169 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "HostTiming.h"
+#include "Config.h"
+#include "CLHelper.h"
+
+#if defined (_WIN32)
+// QueryPerformanceCounter comes with windows.h
+#elif defined (__APPLE__)
+#include <mach/mach_time.h>
+#endif
+
+#if defined (_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#endif
+
+static const char* phaseNames[HostTiming::PHASES] = {
+   "sync refs", "args", "pin", "create buffer", "set arg", "write", "enqueue", "read", "wait", "complete", "unpin"
+};
+
+// clGetDeviceAndHostTimer is OpenCL 2.1, we find it at runtime so older runtimes and headers still work
+typedef cl_int (CL_API_CALL *GetDeviceAndHostTimer)(cl_device_id device, cl_ulong* deviceTimestamp, cl_ulong* hostTimestamp);
+
+HostTiming::HostTiming():
+   offset(0),
+   calibrated(false),
+   enabled(false),
+   depth(0){
+}
+
+jlong HostTiming::now() {
+#if defined (_WIN32)
+   static LARGE_INTEGER frequency = { 0 };
+   if (frequency.QuadPart == 0) {
+      QueryPerformanceFrequency(&frequency);
+   }
+   LARGE_INTEGER counter;
+   QueryPerformanceCounter(&counter);
+   return((jlong)((counter.QuadPart * 1000000000.0) / frequency.QuadPart));
+#elif defined (__APPLE__)
+   static mach_timebase_info_data_t timebase = { 0, 0 };
+   if (timebase.denom == 0) {
+      mach_timebase_info(&timebase);
+   }
+   return((jlong)(mach_absolute_time() * timebase.numer / timebase.denom));
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return(((jlong)ts.tv_sec * 1000000000L) + (jlong)ts.tv_nsec);
+#endif
+}
+
+const char* HostTiming::phaseName(jint phase) {
+   return((phase >= 0 && phase < PHASES) ? phaseNames[phase] : "unknown");
+}
+
+void HostTiming::reset(bool enable) {
+   enabled = enable;
+   depth = 0;
+   intervals.clear();
+}
+
+/**
+ * @return the index of the new interval to end, -1 once a run holds MAX_INTERVALS
+ */
+jint HostTiming::begin(jint phase, const char* name) {
+   if (intervals.size() >= (size_t)MAX_INTERVALS) {
+      return(-1);
+   }
+   intervals.push_back(Interval());
+   Interval& interval = intervals.back();
+   interval.phase = phase;
+   interval.depth = depth++;
+   if (name != NULL) {
+      snprintf(interval.label, sizeof(interval.label), "%s %s", phaseName(phase), name);
+   } else {
+      snprintf(interval.label, sizeof(interval.label), "%s", phaseName(phase));
+   }
+   interval.end = 0;
+   interval.start = now();
+   return((jint)intervals.size() - 1);
+}
+
+void HostTiming::end(jint index) {
+   jlong time = now();
+   // a reset between begin and end leaves nothing to close
+   if ((size_t)index < intervals.size()) {
+      intervals[index].end = time;
+      depth--;
+   }
+}
+
+void HostTiming::calibrate(cl_device_id device, jlong markerHostNanos, cl_ulong markerQueued) {
+   static GetDeviceAndHostTimer deviceAndHostTimer = (GetDeviceAndHostTimer)CLHelper::getEntryPoint("clGetDeviceAndHostTimer");
+   const char* method = "marker";
+   offset = (jlong)markerQueued - markerHostNanos;
+
+   if (deviceAndHostTimer != NULL) {
+      // the runtime's host timestamp is on its own clock, so take ours either side of the call
+      cl_ulong deviceTimestamp = 0;
+      cl_ulong hostTimestamp = 0;
+      jlong before = now();
+      cl_int status = deviceAndHostTimer(device, &deviceTimestamp, &hostTimestamp);
+      jlong after = now();
+      if (status == CL_SUCCESS && deviceTimestamp != 0) {
+         offset = (jlong)deviceTimestamp - (before + (after - before) / 2);
+         method = "clGetDeviceAndHostTimer";
+      }
+   }
+   calibrated = true;
+
+   if (config->isVerbose()) {
+      fprintf(stderr, "host clock offset %ld from %s\n", (long)offset, method);
+   }
+}
+
+jlong HostTiming::getExclusiveNanos(jint phase) {
+   jlong nanos = 0;
+   for (size_t i = 0; i < intervals.size(); i++) {
+      Interval& interval = intervals[i];
+      if (interval.phase != phase || interval.end == 0) {
+         continue;
+      }
+      nanos += interval.end - interval.start;
+      // the intervals nested directly in this one follow it, until one at its depth or above
+      for (size_t j = i + 1; j < intervals.size() && intervals[j].depth > interval.depth; j++) {
+         if (intervals[j].depth == interval.depth + 1 && intervals[j].end != 0) {
+            nanos -= intervals[j].end - intervals[j].start;
+         }
+      }
+   }
+   return(nanos);
+}
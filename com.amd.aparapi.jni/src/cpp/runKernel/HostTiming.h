@@ -0,0 +1,157 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef HOST_TIMING_H
+#define HOST_TIMING_H
+
+#include "Common.h"
+#include <vector>
+
+/**
+ * Times the host side phases of an execution: syncing array refs, pinning, creating buffers, setting args, 
+ * enqueueing, waiting and unpinning. Phases nest (a pin is timed inside the args phase) and are kept as 
+ * intervals on a monotonic host clock, calibrate() maps them onto the device clock of the profiling events.
+ *
+ * Each JNIContext owns one, it is only used by the thread running the context.
+ */
+class HostTiming{
+   public:
+      enum Phase {
+         SYNC_REFS,       // updateNonPrimitiveReferences
+         ARGS,            // processArgs, holds the next four
+         PIN,
+         CREATE_BUFFER,
+         SET_ARG,
+         WRITE,           // enqueueing a write
+         ENQUEUE,         // enqueueing the kernel
+         READ,            // enqueueing the reads
+         WAIT,
+         COMPLETE,        // releasing the events and copying results back to java, holds UNPIN
+         UNPIN,
+         PHASES
+      };
+
+      static const jint MAX_INTERVALS = 512;
+
+      struct Interval {
+         jint phase;
+         jint depth;      // phases open around this one
+         jlong start;     // host nanoseconds
+         jlong end;
+         char label[64];  // the phase name and arg name
+      };
+
+      std::vector<Interval> intervals; // of the current run, in the order they were entered
+      jlong offset;                    // device clock minus host clock
+      bool calibrated;
+
+      HostTiming();
+
+      /**
+       * @return a monotonic host clock in nanoseconds
+       */
+      static jlong now();
+
+      static const char* phaseName(jint phase);
+
+      bool isEnabled(){
+         return(enabled);
+      }
+
+      /**
+       * forget the intervals of the previous run, called as each run starts
+       */
+      void reset(bool enable);
+
+      /**
+       * stop timing but keep the intervals of the last timed run, for a run which is not profiled
+       */
+      void suspend(){
+         enabled = false;
+      }
+
+      jint begin(jint phase, const char* name);
+
+      void end(jint index);
+
+      /**
+       * measure the offset between the host and device clocks, with clGetDeviceAndHostTimer if the OpenCL runtime
+       * has it, otherwise from a marker whose queued time is known and the host time it was enqueued at.
+       *
+       * @param markerHostNanos host time half way through enqueueing the marker
+       * @param markerQueued device time the marker was queued at
+       */
+      void calibrate(cl_device_id device, jlong markerHostNanos, cl_ulong markerQueued);
+
+      /**
+       * @return host nanoseconds on the device clock, relative to base
+       */
+      jlong toDevice(jlong hostNanos, cl_ulong base){
+         return(hostNanos + offset - (jlong)base);
+      }
+
+      /**
+       * @return the time spent in phase during the current run, less any phases nested in it
+       */
+      jlong getExclusiveNanos(jint phase);
+
+   private:
+      bool enabled;
+      jint depth;
+};
+
+/**
+ * Times one phase for as long as it is in scope, does nothing unless the timing is enabled.
+ */
+class HostPhase{
+   private:
+      HostTiming& timing;
+      jint index;
+   public:
+      HostPhase(HostTiming& _timing, jint phase, const char* name = NULL):
+         timing(_timing),
+         index(_timing.isEnabled() ? _timing.begin(phase, name) : -1){
+      }
+      ~HostPhase(){
+         if (index >= 0) {
+            timing.end(index);
+         }
+      }
+};
+
+#endif // HOST_TIMING_H
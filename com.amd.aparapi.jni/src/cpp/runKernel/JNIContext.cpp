@@ -1,6 +1,10 @@
 #include "JNIContext.h"
 #include "OpenCLJNI.h"
-#include "List.h"
+#include "ResourceTracker.h"
+#include "DeviceRegistry.h"
+#include "DispatchPlan.h"
+#include "Profiler.h"
+#include "CLHelper.h"
 
 JNIContext::JNIContext(JNIEnv *jenv, jobject _kernelObject, jobject _openCLDeviceObject, jint _flags): 
       kernelObject(jenv->NewGlobalRef(_kernelObject)),
@@ -10,13 +14,41 @@ JNIContext::JNIContext(JNIEnv *jenv, jobject _kernelObject, jobject _openCLDevic
       profileBaseTime(0),
       passes(0),
       exec(NULL),
+      passEvents(NULL),
+      sourceHash(0),
+      localSizeTunable(false),
+      rangeSplittable(false),
+      tuningEntry(NULL),
+      tuningLocalSize(0),
+      tuningEvent((cl_event)0),
+      writeQueue((cl_command_queue)0),
+      readQueue((cl_command_queue)0),
+      kernel((cl_kernel)0),
+      chunkEvents(NULL),
+      chunkEventCount(0),
+      asyncFailure(0),
       deviceType(((flags&com_amd_aparapi_internal_jni_KernelRunnerJNI_JNI_FLAG_USE_GPU)==com_amd_aparapi_internal_jni_KernelRunnerJNI_JNI_FLAG_USE_GPU)?CL_DEVICE_TYPE_GPU:CL_DEVICE_TYPE_CPU),
       profileFile(NULL), 
+      zeroCopy(false),
+      subDeviceCount(0),
+      subDeviceIds(NULL),
+      subDeviceQueues(NULL),
+      subDeviceEvents(NULL),
+      subDeviceExec(NULL),
+      subDeviceNames(NULL),
+      stateBuffer(NULL),
+      state(NULL),
+      plan(NULL),
+      kernelName(NULL),
+      runs(0),
+      timedQueues(false),
+      profilingRun(false),
       valid(JNI_FALSE){
    cl_int status = CL_SUCCESS;
    jobject platformInstance = OpenCLDevice::getPlatformInstance(jenv, openCLDeviceObject);
    cl_platform_id platformId = OpenCLPlatform::getPlatformId(jenv, platformInstance);
    deviceId = OpenCLDevice::getDeviceId(jenv, openCLDeviceObject);
+   deviceVersion = CLHelper::getVersion(deviceId);
    cl_device_type returnedDeviceType;
    clGetDeviceInfo(deviceId, CL_DEVICE_TYPE,  sizeof(returnedDeviceType), &returnedDeviceType, NULL);
    //fprintf(stderr, "device[%d] CL_DEVICE_TYPE = %x\n", deviceId, returnedDeviceType);
@@ -24,51 +56,178 @@ JNIContext::JNIContext(JNIEnv *jenv, jobject _kernelObject, jobject _openCLDevic
 
    cl_context_properties cps[3] = { CL_CONTEXT_PLATFORM, (cl_context_properties)platformId, 0 };
    cl_context_properties* cprops = (NULL == platformId) ? NULL : cps;
-   context = clCreateContextFromType( cprops, returnedDeviceType, NULL, NULL, &status); 
-   CLException::checkCLError(status, "clCreateContextFromType()");
+
+   if (returnedDeviceType == CL_DEVICE_TYPE_CPU && config->isNUMAFissionEnabled()) {
+      createSubDevices();
+   }
+
+   // the device works on host memory, so the driver's own (page aligned) allocation is used for every array and
+   // the java arrays are copied into and out of it through maps rather than being shadow copied by the driver
+   if (returnedDeviceType == CL_DEVICE_TYPE_CPU && config->isZeroCopyCPUEnabled()) {
+      zeroCopy = true;
+      if (config->isVerbose()){
+         fprintf(stderr, "zero copy buffers for cpu device\n");
+      }
+   }
+
+   if (Profiler::isEnabled()) {
+      jmethodID getNameID = jenv->GetMethodID(jenv->FindClass("java/lang/Class"), "getName", "()Ljava/lang/String;");
+      jstring className = (jstring)jenv->CallObjectMethod(kernelClass, getNameID);
+      const char* classNameChars = jenv->GetStringUTFChars(className, NULL);
+      kernelName = strdup(classNameChars);
+      jenv->ReleaseStringUTFChars(className, classNameChars);
+   }
+
+   if (subDeviceCount > 1) {
+      // the whole device handles transfers and unsplit executions, the nodes run the split ones
+      cl_device_id* devices = new cl_device_id[subDeviceCount + 1];
+      devices[0] = deviceId;
+      for (cl_uint i = 0; i < subDeviceCount; i++) {
+         devices[i + 1] = subDeviceIds[i];
+      }
+      context = clCreateContext(cprops, subDeviceCount + 1, devices, NULL, NULL, &status);
+      delete[] devices;
+      CLException::checkCLError(status, "clCreateContext()");
+   } else {
+      // kernels on the same device share its context (and so can share its programs and buffers)
+      context = DeviceRegistry::acquireContext(deviceId, &status); 
+      CLException::checkCLError(status, "clCreateContext()");
+   }
    if (status == CL_SUCCESS){
       valid = JNI_TRUE;
    }
 }
 
+void JNIContext::createSubDevices() {
+   // the 1.2 calls the split needs are only there if the runtime we were loaded against is 1.2
+   if (CLHelper::createSubDevices == NULL || CLHelper::releaseDevice == NULL || CLHelper::enqueueFillBuffer == NULL
+         || CLHelper::enqueueMarkerWithWaitList == NULL || deviceVersion < 12) {
+      if (config->isVerbose()){
+         fprintf(stderr, "NUMA fission needs OpenCL 1.2, using the whole device\n");
+      }
+      return;
+   }
+
+   intptr_t properties[] = {
+      CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0
+   };
+   cl_uint count = 0;
+   cl_int status = CLHelper::createSubDevices(deviceId, properties, 0, NULL, &count);
+   if (status != CL_SUCCESS || count < 2) {
+      if (config->isVerbose()){
+         fprintf(stderr, "NUMA fission not available (status %d, %u nodes), using the whole device\n", status, count);
+      }
+      return;
+   }
+
+   subDeviceIds = new cl_device_id[count];
+   status = CLHelper::createSubDevices(deviceId, properties, count, subDeviceIds, NULL);
+   if (status != CL_SUCCESS) {
+      CLException::checkCLError(status, "clCreateSubDevices()");
+      delete[] subDeviceIds;
+      subDeviceIds = NULL;
+      return;
+   }
+
+   subDeviceCount = count;
+   subDeviceQueues = new cl_command_queue[count];
+   subDeviceNames = new char*[count];
+   for (cl_uint i = 0; i < count; i++) {
+      subDeviceQueues[i] = (cl_command_queue)0;
+      subDeviceNames[i] = new char[32];
+      sprintf(subDeviceNames[i], "exec(node %u)", i);
+   }
+   if (config->isVerbose()){
+      fprintf(stderr, "split cpu device into %u NUMA nodes\n", count);
+   }
+}
+
 void JNIContext::dispose(JNIEnv *jenv, Config* config) {
    //fprintf(stdout, "dispose()\n");
    cl_int status = CL_SUCCESS;
    jenv->DeleteGlobalRef(kernelObject);
    jenv->DeleteGlobalRef(kernelClass);
+   if (kernelName != NULL){
+      free(kernelName);
+      kernelName = NULL;
+      // the events of this kernel are written out before it goes
+      Profiler::flush();
+   }
+   if (stateBuffer != NULL){
+      jenv->DeleteGlobalRef(stateBuffer);
+      stateBuffer = NULL;
+      state = NULL;
+   }
    if (context != 0){
-      status = clReleaseContext(context);
+      DeviceRegistry::releaseContext(context);
       //fprintf(stdout, "dispose context %0lx\n", context);
-      CLException::checkCLError(status, "clReleaseContext()");
       context = (cl_context)0;
    }
    if (commandQueue != 0){
-      if (config->isTrackingOpenCLResources()){
-         commandQueueList.remove((cl_command_queue)commandQueue, __LINE__, __FILE__);
-      }
-      status = clReleaseCommandQueue((cl_command_queue)commandQueue);
+      commandQueueTracker.remove((cl_command_queue)commandQueue, __LINE__, __FILE__);
+      DeviceRegistry::releaseQueue((cl_command_queue)commandQueue);
       //fprintf(stdout, "dispose commandQueue %0lx\n", commandQueue);
-      CLException::checkCLError(status, "clReleaseCommandQueue()");
       commandQueue = (cl_command_queue)0;
    }
+   if (writeQueue != 0){
+      commandQueueTracker.remove((cl_command_queue)writeQueue, __LINE__, __FILE__);
+      DeviceRegistry::releaseQueue((cl_command_queue)writeQueue);
+      writeQueue = (cl_command_queue)0;
+   }
+   if (readQueue != 0){
+      commandQueueTracker.remove((cl_command_queue)readQueue, __LINE__, __FILE__);
+      DeviceRegistry::releaseQueue((cl_command_queue)readQueue);
+      readQueue = (cl_command_queue)0;
+   }
+   if (subDeviceCount > 0){
+      for (cl_uint i = 0; i < subDeviceCount; i++){
+         if (subDeviceQueues[i] != 0){
+            commandQueueTracker.remove((cl_command_queue)subDeviceQueues[i], __LINE__, __FILE__);
+            status = clReleaseCommandQueue((cl_command_queue)subDeviceQueues[i]);
+            CLException::checkCLError(status, "clReleaseCommandQueue()");
+         }
+         status = CLHelper::releaseDevice(subDeviceIds[i]);
+         CLException::checkCLError(status, "clReleaseDevice()");
+         delete[] subDeviceNames[i];
+      }
+      delete[] subDeviceQueues; subDeviceQueues = NULL;
+      delete[] subDeviceIds; subDeviceIds = NULL;
+      delete[] subDeviceNames; subDeviceNames = NULL;
+      delete[] subDeviceEvents; subDeviceEvents = NULL;
+      delete[] subDeviceExec; subDeviceExec = NULL;
+      subDeviceCount = 0;
+   }
    if (program != 0){
-      status = clReleaseProgram((cl_program)program);
+      DeviceRegistry::releaseProgram((cl_program)program);
       //fprintf(stdout, "dispose program %0lx\n", program);
-      CLException::checkCLError(status, "clReleaseProgram()");
       program = (cl_program)0;
    }
-   if (kernel != 0){
-      status = clReleaseKernel(kernel);
+   if (kernelMap.empty()) {
+      if (kernel != 0){
+         status = clReleaseKernel(kernel);
+      }
+   } else {
+      for (KernelMap::iterator it = kernelMap.begin(); it != kernelMap.end(); it++) {
+         status = clReleaseKernel(it->second);
+         CLException::checkCLError(status, "clReleaseKernel()");
+      }
+      kernelMap.clear();
    }
+   kernel = (cl_kernel)0;
+   workGroupSizes.clear();
+   tuningEntries.clear();
+   if (tuningEvent != 0){
+      clReleaseEvent(tuningEvent);
+      tuningEvent = (cl_event)0;
+   }
+   tuningEntry = NULL;
    if (argc > 0){
       for (int i=0; i< argc; i++){
          KernelArg *arg = args[i];
          if (!arg->isPrimitive()){
             if (arg->arrayBuffer != NULL){
                if (arg->arrayBuffer->mem != 0){
-                  if (config->isTrackingOpenCLResources()){
-                     memList.remove((cl_mem)arg->arrayBuffer->mem, __LINE__, __FILE__);
-                  }
+                  memTracker.remove((cl_mem)arg->arrayBuffer->mem, __LINE__, __FILE__);
                   status = clReleaseMemObject((cl_mem)arg->arrayBuffer->mem);
                   //fprintf(stdout, "dispose arg %d %0lx\n", i, arg->arrayBuffer->mem);
                   CLException::checkCLError(status, "clReleaseMemObject()");
@@ -80,6 +239,23 @@ void JNIContext::dispose(JNIEnv *jenv, Config* config) {
                delete arg->arrayBuffer;
                arg->arrayBuffer = NULL;
             }
+            if (arg->aparapiBuffer != NULL){
+               if (arg->aparapiBuffer->mem != 0){
+                  memTracker.remove((cl_mem)arg->aparapiBuffer->mem, __LINE__, __FILE__);
+                  status = clReleaseMemObject((cl_mem)arg->aparapiBuffer->mem);
+                  CLException::checkCLError(status, "clReleaseMemObject()");
+                  arg->aparapiBuffer->mem = (cl_mem)0;
+               }
+               if (arg->aparapiBuffer->offsetsMem != 0){
+                  memTracker.remove((cl_mem)arg->aparapiBuffer->offsetsMem, __LINE__, __FILE__);
+                  status = clReleaseMemObject((cl_mem)arg->aparapiBuffer->offsetsMem);
+                  CLException::checkCLError(status, "clReleaseMemObject()");
+                  arg->aparapiBuffer->offsetsMem = (cl_mem)0;
+               }
+               arg->aparapiBuffer->deleteBuffer(arg);
+               delete arg->aparapiBuffer;
+               arg->aparapiBuffer = NULL;
+            }
          }
          if (arg->name != NULL){
             free(arg->name); arg->name = NULL;
@@ -90,11 +266,22 @@ void JNIContext::dispose(JNIEnv *jenv, Config* config) {
          delete arg; arg=args[i]=NULL;
       }
       delete[] args; args=NULL;
+      delete[] rowCopyJobs; rowCopyJobs = NULL;
+      delete plan; plan = NULL;
+      argSlots.clear();
 
       // do we need to call clReleaseEvent on any of these that are still retained....
       delete[] readEvents; readEvents = NULL;
       delete[] writeEvents; writeEvents = NULL;
       delete[] executeEvents; executeEvents = NULL;
+      if (passEvents != NULL) {
+         for (int i = 0; i < passes - 1; i++) {
+            if (passEvents[i] != NULL) {
+               clReleaseEvent(passEvents[i]);
+            }
+         }
+         delete[] passEvents; passEvents = NULL;
+      }
 
       if (config->isProfilingEnabled()) {
          if (config->isProfilingCSVEnabled()) {
@@ -107,22 +294,76 @@ void JNIContext::dispose(JNIEnv *jenv, Config* config) {
       } 
    }
    if (config->isTrackingOpenCLResources()){
-      fprintf(stderr, "after dispose{ \n");
-      commandQueueList.report(stderr);
-      memList.report(stderr); 
-      readEventList.report(stderr); 
-      executeEventList.report(stderr); 
-      writeEventList.report(stderr); 
-      fprintf(stderr, "}\n");
+      fprintf(stderr, "after dispose{\n%s}\n", ResourceTracker::reportAll().c_str());
    }
 }
 
 void JNIContext::unpinAll(JNIEnv* jenv) {
+   HostPhase phase(hostTiming, HostTiming::UNPIN);
    for (int i=0; i< argc; i++){
       KernelArg *arg = args[i];
-      if (arg->isBackedByArray()) {
+      // device resident arrays are only pinned whilst being copied so may not be pinned here
+      if (arg->isBackedByArray() && arg->arrayBuffer->isPinned) {
          arg->unpin(jenv);
       }
    }
 }
 
+
+cl_int JNIContext::setKernelArg(cl_uint argPos, size_t size, const void* value) {
+   if (argPos >= argSlots.size()) {
+      argSlots.resize(argPos + 1);
+   }
+   KernelArgSlot& slot = argSlots[argPos];
+   bool cacheable = (value == NULL) || (size <= sizeof(slot.value));
+   if (slot.valid && cacheable && slot.size == size && slot.isNull == (value == NULL)
+         && (value == NULL || memcmp(&slot.value, value, size) == 0)) {
+      return(CL_SUCCESS);
+   }
+
+   cl_int status = CL_SUCCESS;
+   HostPhase phase(hostTiming, HostTiming::SET_ARG);
+   if (kernelMap.empty()) {
+      status = clSetKernelArg(kernel, argPos, size, value);
+   } else {
+      for (KernelMap::iterator it = kernelMap.begin(); it != kernelMap.end() && status == CL_SUCCESS; it++) {
+         status = clSetKernelArg(it->second, argPos, size, value);
+      }
+   }
+
+   slot.valid = (status == CL_SUCCESS) && cacheable;
+   if (slot.valid) {
+      slot.size = size;
+      slot.isNull = (value == NULL);
+      slot.value = 0;
+      if (value != NULL) {
+         memcpy(&slot.value, value, size);
+      }
+   }
+   return(status);
+}
+
+void JNIContext::forgetKernelArg(cl_mem mem) {
+   for (size_t i = 0; i < argSlots.size(); i++) {
+      KernelArgSlot& slot = argSlots[i];
+      if (slot.valid && !slot.isNull && slot.size == sizeof(cl_mem) && memcmp(&slot.value, &mem, sizeof(cl_mem)) == 0) {
+         slot.valid = false;
+      }
+   }
+}
+
+size_t JNIContext::getWorkGroupSize(cl_kernel kernel) {
+   WorkGroupSizeMap::iterator it = workGroupSizes.find(kernel);
+   if (it != workGroupSizes.end()) {
+      return(it->second);
+   }
+   size_t maxGroupSize = 0;
+   cl_int status = clGetKernelWorkGroupInfo(kernel, deviceId, CL_KERNEL_WORK_GROUP_SIZE,
+         sizeof(maxGroupSize), &maxGroupSize, NULL);
+   if (status != CL_SUCCESS) {
+      CLException(status, "clGetKernelWorkGroupInfo()").printError();
+      maxGroupSize = 0;
+   }
+   workGroupSizes[kernel] = maxGroupSize;
+   return(maxGroupSize);
+}
@@ -5,11 +5,34 @@
 #include "Common.h"
 #include "KernelArg.h"
 #include "ProfileInfo.h"
+#include "HostTiming.h"
+#include "LatencyHistogram.h"
+#include "TransferCounters.h"
+#include "ProfileSampler.h"
 #include "com_amd_aparapi_internal_jni_KernelRunnerJNI.h"
 #include "Config.h"
 
 #include <string>
 #include <map>
+#include <vector>
+
+class TuningEntry;
+class DispatchPlan;
+
+/**
+ * The value last set at a kernel arg position, every value we set fits in a jlong
+ */
+class KernelArgSlot{
+   public:
+      bool valid;
+      size_t size;
+      bool isNull;       // a local arg, only its size is set
+      jlong value;
+
+      KernelArgSlot():
+         valid(false), size(0), isNull(false), value(0){
+      }
+};
 
 class JNIContext {
 private: 
@@ -20,13 +43,21 @@ public:
    jobject openCLDeviceObject;
    jclass kernelClass;
    cl_device_id deviceId;
+   jint deviceVersion;            // OpenCL version of the device, major * 10 + minor
    cl_int deviceType;
    cl_context context;
    cl_command_queue commandQueue;
+   cl_command_queue writeQueue;   // chunked executions upload on this queue
+   cl_command_queue readQueue;    // chunked executions read back on this queue
    cl_program program;
-   cl_kernel kernel;
+   cl_kernel kernel;              // the entrypoint being dispatched, one of kernelMap
+   typedef std::map<std::string, cl_kernel> KernelMap;
+   KernelMap kernelMap;           // every entrypoint in program by name, they all take the same args
    jint argc;
    KernelArg** args;
+   RowCopyJob** rowCopyJobs;      // argc slots for the row copies of AparapiBuffer::inflateAll
+   DispatchPlan* plan;            // compiled from args by setArgsJNI
+   std::vector<KernelArgSlot> argSlots; // what every entrypoint was last given at each arg position
    cl_event* executeEvents;
    cl_event* readEvents;
    cl_ulong profileBaseTime;
@@ -36,7 +67,41 @@ public:
    jboolean firstRun;
    jint passes;
    ProfileInfo *exec;
+   cl_event* passEvents;          // execute events of every pass but the last, profiled once the execution completes
+   typedef std::map<cl_kernel, size_t> WorkGroupSizeMap;
+   WorkGroupSizeMap workGroupSizes; // CL_KERNEL_WORK_GROUP_SIZE of each kernel on this device
+   unsigned long long sourceHash; // of the program source, tuned local sizes are keyed by it
+   bool localSizeTunable;         // the program never depends on its local size
+   bool rangeSplittable;          // the program never reads its global size, group count or group ids, so its 
+                                  // range can be split into slices by global offset
+   typedef std::map<std::pair<cl_kernel, int>, TuningEntry*> TuningEntryMap;
+   TuningEntryMap tuningEntries;  // tuning state of each kernel and global size bucket
+   TuningEntry* tuningEntry;      // the entry timing the current execution, NULL if it isn't timed
+   size_t tuningLocalSize;        // the local size being timed, 0 if the driver chose
+   cl_event tuningEvent;          // the execute event being timed
+   cl_event* chunkEvents;         // events of the current chunked execution, released once it completes
+   jint chunkEventCount;
+   volatile jint asyncFailure;    // status of an async execution whose callback couldn't reach java, 0 otherwise
    FILE* profileFile;
+   bool zeroCopy;                    // a CPU device whose arrays are all held in device resident buffers
+   cl_uint subDeviceCount;           // NUMA nodes the cpu device was split into, 0 unless fission is enabled
+   cl_device_id* subDeviceIds;
+   cl_command_queue* subDeviceQueues; // one queue per node, executions are split across these
+   cl_event* subDeviceEvents;        // execute event of each node for each pass of the current execution
+   ProfileInfo* subDeviceExec;       // execute profile of each node for each pass
+   char** subDeviceNames;            // profile labels of each node
+   jobject stateBuffer;              // direct buffer KernelRunner writes the arg and range state to before each run
+   char* state;                      // address of stateBuffer, NULL if the args and range are read field by field
+   char* kernelName;                 // class name of the kernel, only set whilst the profiler is recording
+   jlong runs;                       // executions started, the profiler numbers the events of each by it
+   HostTiming hostTiming;            // host phases of the current run, timed whilst profiling
+   bool timedQueues;                 // the queues give event timestamps, so device times go in the histograms
+   RunTotals runTotals;              // bytes and device times of the current run
+   KernelLatency latency;            // of every run since the histograms were last read
+   TransferCounters transfers;       // buffers and bytes over the life of the context
+   TransferLog transferLog;          // why each arg was (or wasn't) created and moved in the last run
+   ProfileSampler sampler;           // which runs are profiled
+   bool profilingRun;                // profiling is enabled and the current run was sampled
    
    JNIContext(JNIEnv *jenv, jobject _kernelObject, jobject _openCLDeviceObject, jint _flags);
    
@@ -59,6 +124,29 @@ public:
 
    void dispose(JNIEnv *jenv, Config* config);
 
+   /**
+    * Set an argument on every entrypoint of the program, so a named dispatch sees the same buffers.
+    * The call is skipped if the position already holds the same value.
+    */
+   cl_int setKernelArg(cl_uint argPos, size_t size, const void* value);
+
+   /**
+    * Forget the positions holding a buffer which is being released, a new buffer may get the same handle
+    */
+   void forgetKernelArg(cl_mem mem);
+
+   /**
+    * The largest work group a kernel can be launched with on this device, queried once per kernel
+    *
+    * @return the work group size or 0 if the driver can't tell us
+    */
+   size_t getWorkGroupSize(cl_kernel kernel);
+
+   /**
+    * Split a CPU device into one sub device per NUMA node
+    */
+   void createSubDevices();
+
    /**
     * Release JNI critical pinned arrays before returning to java code
     */
@@ -1,5 +1,6 @@
 #include "KernelArg.h"
 #include "JNIContext.h"
+#include "Mutex.h"
 #include <string>
 #include <iostream>
 
@@ -13,25 +14,39 @@ jfieldID KernelArg::typeFieldID=0;
 jfieldID KernelArg::javaArrayFieldID=0; 
 jfieldID KernelArg::sizeInBytesFieldID=0;
 jfieldID KernelArg::numElementsFieldID=0; 
+jfieldID KernelArg::chunkStrideFieldID=0; 
+
+// guards the first lookup of the field ids above, argClazz is published last
+static Mutex argClassLock;
 
 
 KernelArg::KernelArg(JNIEnv *jenv, JNIContext *jniContext, jobject argObj):
    jniContext(jniContext),
-   argObj(argObj){
+   argObj(argObj),
+   state(NULL),
+   arrayBuffer(NULL),
+   aparapiBuffer(NULL){
       javaArg = jenv->NewGlobalRef(argObj);   // save a global ref to the java Arg Object
       if (argClazz == 0){
-         jclass c = jenv->GetObjectClass(argObj); 
-         nameFieldID = JNIHelper::GetFieldID(jenv, c, "name", "Ljava/lang/String;");
-         typeFieldID = JNIHelper::GetFieldID(jenv, c, "type", "I");
-         javaArrayFieldID = JNIHelper::GetFieldID(jenv, c, "javaArray", "Ljava/lang/Object;");
-         sizeInBytesFieldID = JNIHelper::GetFieldID(jenv, c, "sizeInBytes", "I");
-         numElementsFieldID = JNIHelper::GetFieldID(jenv, c, "numElements", "I");
-         argClazz  = c;
+         ScopedLock lock(argClassLock);
+         if (argClazz == 0){
+            jclass c = jenv->GetObjectClass(argObj); 
+            nameFieldID = JNIHelper::GetFieldID(jenv, c, "name", "Ljava/lang/String;");
+            typeFieldID = JNIHelper::GetFieldID(jenv, c, "type", "I");
+            javaArrayFieldID = JNIHelper::GetFieldID(jenv, c, "javaArray", "Ljava/lang/Object;");
+            sizeInBytesFieldID = JNIHelper::GetFieldID(jenv, c, "sizeInBytes", "I");
+            numElementsFieldID = JNIHelper::GetFieldID(jenv, c, "numElements", "I");
+            chunkStrideFieldID = JNIHelper::GetFieldID(jenv, c, "chunkStride", "I");
+            jclass global = (jclass)jenv->NewGlobalRef(c);
+            memoryBarrier();
+            argClazz = global;
+         }
       }
 
 	  
 
       type = jenv->GetIntField(argObj, typeFieldID);
+      chunkStride = jenv->GetIntField(argObj, chunkStrideFieldID);
       jstring nameString  = (jstring)jenv->GetObjectField(argObj, nameFieldID);
       const char *nameChars = jenv->GetStringUTFChars(nameString, NULL);
       name = strdup(nameChars);
@@ -43,18 +58,25 @@ KernelArg::KernelArg(JNIEnv *jenv, JNIContext *jniContext, jobject argObj):
       }
    }
 
-cl_int KernelArg::setLocalBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose) {
+cl_int KernelArg::setArg(cl_kernel kernel, int argPos, size_t size, const void* value) {
+   if (kernel == NULL) {
+      return(jniContext->setKernelArg(argPos, size, value));
+   }
+   return(clSetKernelArg(kernel, argPos, size, value));
+}
+
+cl_int KernelArg::setLocalBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose, cl_kernel kernel) {
    if (verbose){
        fprintf(stderr, "ISLOCAL, clSetKernelArg(jniContext->kernel, %d, %d, NULL);\n", argIdx, (int) arrayBuffer->lengthInBytes);
    }
-   return(clSetKernelArg(jniContext->kernel, argPos, (int)arrayBuffer->lengthInBytes, NULL));
+   return(setArg(kernel, argPos, (int)arrayBuffer->lengthInBytes, NULL));
 }
 
-cl_int KernelArg::setLocalAparapiBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose) {
+cl_int KernelArg::setLocalAparapiBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose, cl_kernel kernel) {
    if (verbose){
        fprintf(stderr, "ISLOCAL, clSetKernelArg(jniContext->kernel, %d, %d, NULL);\n", argIdx, (int) aparapiBuffer->lengthInBytes);
    }
-   return(clSetKernelArg(jniContext->kernel, argPos, (int)aparapiBuffer->lengthInBytes, NULL));
+   return(setArg(kernel, argPos, (int)aparapiBuffer->lengthInBytes, NULL));
 }
 
 const char* KernelArg::getTypeName() {
@@ -133,37 +155,37 @@ void KernelArg::getStaticPrimitiveValue(JNIEnv *jenv, jdouble* value) {
    *value = jenv->GetStaticDoubleField(jniContext->kernelClass, fieldID);
 }
 
-cl_int KernelArg::setPrimitiveArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose){
+cl_int KernelArg::setPrimitiveArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose, cl_kernel kernel){
    cl_int status = CL_SUCCESS;
    if (isFloat()) {
        jfloat f;
        getPrimitive(jenv, argIdx, argPos, verbose, &f);
-       status = clSetKernelArg(jniContext->kernel, argPos, sizeof(f), &f);
+       status = setArg(kernel, argPos, sizeof(f), &f);
    }
    else if (isInt()) {
        jint i;
        getPrimitive(jenv, argIdx, argPos, verbose, &i);
-       status = clSetKernelArg(jniContext->kernel, argPos, sizeof(i), &i);
+       status = setArg(kernel, argPos, sizeof(i), &i);
    }
    else if (isBoolean()) {
        jboolean z;
        getPrimitive(jenv, argIdx, argPos, verbose, &z);
-       status = clSetKernelArg(jniContext->kernel, argPos, sizeof(z), &z);
+       status = setArg(kernel, argPos, sizeof(z), &z);
    }
    else if (isByte()) {
        jbyte b;
        getPrimitive(jenv, argIdx, argPos, verbose, &b);
-       status = clSetKernelArg(jniContext->kernel, argPos, sizeof(b), &b);
+       status = setArg(kernel, argPos, sizeof(b), &b);
    }
    else if (isLong()) {
        jlong l;
        getPrimitive(jenv, argIdx, argPos, verbose, &l);
-       status = clSetKernelArg(jniContext->kernel, argPos, sizeof(l), &l);
+       status = setArg(kernel, argPos, sizeof(l), &l);
    }
    else if (isDouble()) {
        jdouble d;
        getPrimitive(jenv, argIdx, argPos, verbose, &d);
-       status = clSetKernelArg(jniContext->kernel, argPos, sizeof(d), &d);
+       status = setArg(kernel, argPos, sizeof(d), &d);
    }
    return status;
 }
@@ -9,6 +9,7 @@
 #include "com_amd_aparapi_internal_jni_KernelRunnerJNI.h"
 #include "Config.h"
 #include <iostream>
+#include <string.h>
 
 #ifdef _WIN32
 #define strdup _strdup
@@ -23,6 +24,7 @@ class KernelArg{
       static jfieldID typeFieldID; 
       static jfieldID sizeInBytesFieldID;
       static jfieldID numElementsFieldID;
+      static jfieldID chunkStrideFieldID;
 
       const char* getTypeName();
 
@@ -44,9 +46,16 @@ class KernelArg{
       void getStaticPrimitiveValue(JNIEnv *jenv, jlong *value);
       void getStaticPrimitiveValue(JNIEnv *jenv, jdouble *value);
 
+      jint getStateInt(int offset){
+         return(*(jint*)(state + offset));
+      }
+
       template<typename T> 
       void getPrimitive(JNIEnv *jenv, int argIdx, int argPos, bool verbose, T* value) {
-         if(isStatic()) {
+         if (state != NULL) {
+            memcpy(value, state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_VALUE, sizeof(T));
+         }
+         else if(isStatic()) {
             getStaticPrimitiveValue(jenv, value);
          }
          else {
@@ -68,6 +77,8 @@ class KernelArg{
       jobject javaArg;   // global reference to the corresponding java KernelArg object we grabbed our own global reference so that the object won't be collected until we dispose!
       char *name;        // used for debugging printfs
       jint type;         // a bit mask determining the type of this arg
+      jint chunkStride;  // elements touched by each work item when ARG_CHUNKED is set
+      char *state;       // record of this arg in the state block of the JNIContext, NULL if fields are read through JNI
 
       ArrayBuffer *arrayBuffer;
       AparapiBuffer *aparapiBuffer;
@@ -162,9 +173,18 @@ class KernelArg{
       int isAparapiBuffer(){
          return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_APARAPI_BUFFER);
       }
+      int isChunked(){
+         return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_CHUNKED);
+      }
+      int isJagged(){
+         return (type&com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_JAGGED);
+      }
       int isBackedByArray(){
          return ( (isArray() && (isGlobal() || isConstant())));
       }
+      int isDeviceResident(){
+         return (isBackedByArray() && (config->isDeviceResidentBuffersEnabled() || arrayBuffer->deviceResident || arrayBuffer->asyncResident));
+      }
       int needToEnqueueRead(){
          return(((isArray() && isGlobal()) || ((isAparapiBuffer()&&isGlobal()))) && (isImplicit()&&isMutableByKernel()));
       }
@@ -172,27 +192,45 @@ class KernelArg{
          return ((isImplicit()&&isReadByKernel())||(isExplicit()&&isExplicitWrite()));
       }
       void syncType(JNIEnv* jenv){
-         type = jenv->GetIntField(javaArg, typeFieldID);
+         if (state != NULL){
+            type = getStateInt(com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_TYPE);
+         }else{
+            type = jenv->GetIntField(javaArg, typeFieldID);
+         }
       }
       void syncSizeInBytes(JNIEnv* jenv){
-         arrayBuffer->lengthInBytes = jenv->GetIntField(javaArg, sizeInBytesFieldID);
+         if (state != NULL){
+            arrayBuffer->lengthInBytes = getStateInt(com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_SIZE_IN_BYTES);
+         }else{
+            arrayBuffer->lengthInBytes = jenv->GetIntField(javaArg, sizeInBytesFieldID);
+         }
       }
       void syncJavaArrayLength(JNIEnv* jenv){
-         arrayBuffer->length = jenv->GetIntField(javaArg, numElementsFieldID);
+         if (state != NULL){
+            arrayBuffer->length = getStateInt(com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_NUM_ELEMENTS);
+         }else{
+            arrayBuffer->length = jenv->GetIntField(javaArg, numElementsFieldID);
+         }
       }
       void clearExplicitBufferBit(JNIEnv* jenv){
          type &= ~com_amd_aparapi_internal_jni_KernelRunnerJNI_ARG_EXPLICIT_WRITE;
          jenv->SetIntField(javaArg, typeFieldID,type );
+         if (state != NULL){
+            *(jint*)(state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_ARG_TYPE) = type;
+         }
       }
 
       // Uses JNIContext so can't inline here we below.  
       void syncValue(JNIEnv *jenv);
 
       // Uses JNIContext so can't inline here we below.  
-      cl_int setLocalBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose);
-      cl_int setLocalAparapiBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose);
+      // kernel defaults to every entrypoint of the JNIContext, a graph node passes its own kernel
+      cl_int setLocalBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose, cl_kernel kernel = NULL);
+      cl_int setLocalAparapiBufferArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose, cl_kernel kernel = NULL);
+      // Uses JNIContext so can't inline here we below.  
+      cl_int setPrimitiveArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose, cl_kernel kernel = NULL);
       // Uses JNIContext so can't inline here we below.  
-      cl_int setPrimitiveArg(JNIEnv *jenv, int argIdx, int argPos, bool verbose);
+      cl_int setArg(cl_kernel kernel, int argPos, size_t size, const void* value);
 };
 
 
@@ -0,0 +1,370 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "KernelGraph.h"
+#include "Aparapi.h"
+#include "Config.h"
+#include "ResourceTracker.h"
+#include <algorithm>
+
+KernelGraph::KernelGraph():
+      context((cl_context)0){
+}
+
+void KernelGraph::build(JNIEnv* jenv, jint nodeCount, JNIContext** jniContexts, jobjectArray entrypoints) {
+   cl_int status = CL_SUCCESS;
+
+   for (jint i = 0; i < nodeCount; i++) {
+      JNIContext* jniContext = jniContexts[i];
+      if (jniContext == NULL || jniContext->program == 0) {
+         throw CLException(CL_INVALID_PROGRAM, "graph node has not been built");
+      }
+      // buffers and events are shared between the nodes so they must all be in one context
+      if (i == 0) {
+         context = jniContext->context;
+      } else if (jniContext->context != context) {
+         throw CLException(CL_INVALID_CONTEXT, "graph nodes are not on one device");
+      }
+      if (jniContext->subDeviceCount > 1) {
+         throw CLException(CL_INVALID_CONTEXT, "graph nodes can't run split across NUMA nodes");
+      }
+
+      jstring entrypoint = (jstring)jenv->GetObjectArrayElement(entrypoints, i);
+      const char* name = jenv->GetStringUTFChars(entrypoint, NULL);
+      GraphNode node;
+      node.jniContext = jniContext;
+      node.kernel = clCreateKernel(jniContext->program, name, &status);
+      if (config->isVerbose()){
+         fprintf(stderr, "graph node %d %s\n", i, name);
+      }
+      jenv->ReleaseStringUTFChars(entrypoint, name);
+      jenv->DeleteLocalRef(entrypoint);
+      if (status != CL_SUCCESS) throw CLException(status, "clCreateKernel() graph node");
+      nodes.push_back(node);
+   }
+}
+
+void KernelGraph::run(JNIEnv* jenv, jobject jobj, jobjectArray ranges, jint* passes, jobjectArray inputs, jobjectArray outputs) {
+   cl_int status = CL_SUCCESS;
+   cl_command_queue transferQueue = nodes[0].jniContext->commandQueue;
+
+   // every execute event of this run, released once the whole graph has completed
+   std::vector<cl_event> events;
+
+   try {
+      for (size_t i = 0; i < buffers.size(); i++) {
+         buffers[i]->used = false;
+         buffers[i]->uploaded = false;
+      }
+
+      // bind the array args of every node to the buffer of their java array, inputs are copied in on every run
+      // and other arrays only when the graph first creates their buffer
+      std::vector< std::vector<GraphBuffer*> > nodeBuffers(nodes.size());
+      for (size_t n = 0; n < nodes.size(); n++) {
+         JNIContext* jniContext = nodes[n].jniContext;
+         updateNonPrimitiveReferences(jenv, jobj, jniContext);
+
+         nodeBuffers[n].resize(jniContext->argc, NULL);
+         for (int i = 0; i < jniContext->argc; i++) {
+            KernelArg* arg = jniContext->args[i];
+            if (arg->isPrimitive() || arg->isLocal()) {
+               continue;
+            }
+            if (!arg->isBackedByArray()) {
+               throw CLException(CL_INVALID_ARG_VALUE, "graph nodes only support primitive array args");
+            }
+            GraphBuffer* buffer = bind(jenv, arg);
+            nodeBuffers[n][i] = buffer;
+         }
+      }
+
+      for (size_t i = 0; i < buffers.size(); ) {
+         GraphBuffer* buffer = buffers[i];
+         if (!buffer->used) {
+            // no node references the array any more
+            releaseBuffer(jenv, buffer);
+            buffers.erase(buffers.begin() + i);
+            continue;
+         }
+         if (!buffer->uploaded && contains(jenv, inputs, buffer->javaArray)) {
+            copyIn(jenv, transferQueue, buffer);
+         }
+         i++;
+      }
+
+      for (size_t n = 0; n < nodes.size(); n++) {
+         GraphNode& node = nodes[n];
+         JNIContext* jniContext = node.jniContext;
+         jobject rangeObject = jenv->GetObjectArrayElement(ranges, (jsize)n);
+         Range range(jenv, rangeObject);
+         jenv->DeleteLocalRef(rangeObject);
+
+         std::vector<cl_event> waits;
+         int argPos = 0;
+         for (int i = 0; i < jniContext->argc; i++, argPos++) {
+            KernelArg* arg = jniContext->args[i];
+            if (arg->isPrimitive()) {
+               status = arg->setPrimitiveArg(jenv, i, argPos, config->isVerbose(), node.kernel);
+               if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() graph node");
+            } else if (arg->isLocal()) {
+               status = arg->setLocalBufferArg(jenv, i, argPos, config->isVerbose(), node.kernel);
+               if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() graph node (local)");
+               if (arg->usesArrayLength()) {
+                  argPos++;
+                  arg->syncJavaArrayLength(jenv);
+                  status = clSetKernelArg(node.kernel, argPos, sizeof(jint), &(arg->arrayBuffer->length));
+                  if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() graph node (array length)");
+               }
+            } else {
+               GraphBuffer* buffer = nodeBuffers[n][i];
+               status = clSetKernelArg(node.kernel, argPos, sizeof(cl_mem), &(buffer->mem));
+               if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() graph node (array)");
+               if (arg->usesArrayLength()) {
+                  argPos++;
+                  arg->syncJavaArrayLength(jenv);
+                  status = clSetKernelArg(node.kernel, argPos, sizeof(jint), &(arg->arrayBuffer->length));
+                  if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() graph node (array length)");
+               }
+
+               // wait for the producer, a writer also waits for the readers of the previous contents
+               addWait(waits, buffer->lastWrite);
+               if (arg->isMutableByKernel()) {
+                  for (size_t r = 0; r < buffer->reads.size(); r++) {
+                     addWait(waits, buffer->reads[r]);
+                  }
+               }
+            }
+         }
+
+         size_t maxGroupSize = jniContext->getWorkGroupSize(node.kernel);
+         if (maxGroupSize > 0) {
+            range.localDims[0] = std::min(range.localDims[0], maxGroupSize);
+         }
+
+         cl_event event = NULL;
+         for (int passid = 0; passid < passes[n]; passid++) {
+            status = clSetKernelArg(node.kernel, argPos, sizeof(passid), &passid);
+            if (status != CL_SUCCESS) throw CLException(status, "clSetKernelArg() graph node (passid)");
+
+            // later passes are ordered behind the first by the in order queue, only the last needs an event
+            status = clEnqueueNDRangeKernel(jniContext->commandQueue, node.kernel, range.dims, range.offsets,
+                  range.globalDims, range.localDims, (passid == 0) ? (cl_uint)waits.size() : 0,
+                  (passid == 0 && !waits.empty()) ? &waits[0] : NULL, (passid == passes[n] - 1) ? &event : NULL);
+            if (status != CL_SUCCESS) throw CLException(status, "clEnqueueNDRangeKernel() graph node");
+         }
+         if (event == NULL) {
+            continue;
+         }
+         events.push_back(event);
+
+         for (int i = 0; i < jniContext->argc; i++) {
+            GraphBuffer* buffer = nodeBuffers[n][i];
+            if (buffer != NULL) {
+               if (jniContext->args[i]->isMutableByKernel()) {
+                  buffer->lastWrite = event;
+                  buffer->reads.clear();
+               } else {
+                  buffer->reads.push_back(event);
+               }
+            }
+         }
+
+         // start the node now, the nodes which depend on it are on other queues
+         status = clFlush(jniContext->commandQueue);
+         if (status != CL_SUCCESS) throw CLException(status, "clFlush() graph node");
+      }
+
+      for (size_t i = 0; i < buffers.size(); i++) {
+         if (buffers[i]->lastWrite != NULL && contains(jenv, outputs, buffers[i]->javaArray)) {
+            copyOut(jenv, transferQueue, buffers[i]);
+         }
+      }
+
+      // the buffers are reused by the next run so every node must be done with them
+      if (!events.empty()) {
+         status = clWaitForEvents((cl_uint)events.size(), &events[0]);
+         if (status != CL_SUCCESS) throw CLException(status, "clWaitForEvents() graph");
+      }
+   } catch (CLException& cle) {
+      for (size_t n = 0; n < nodes.size(); n++) {
+         clFinish(nodes[n].jniContext->commandQueue);
+      }
+      for (size_t i = 0; i < events.size(); i++) {
+         clReleaseEvent(events[i]);
+      }
+      for (size_t i = 0; i < buffers.size(); i++) {
+         buffers[i]->lastWrite = NULL;
+         buffers[i]->reads.clear();
+      }
+      throw;
+   }
+
+   for (size_t i = 0; i < events.size(); i++) {
+      status = clReleaseEvent(events[i]);
+      CLException::checkCLError(status, "clReleaseEvent() graph node");
+   }
+   for (size_t i = 0; i < buffers.size(); i++) {
+      buffers[i]->lastWrite = NULL;
+      buffers[i]->reads.clear();
+   }
+}
+
+void KernelGraph::dispose(JNIEnv* jenv) {
+   cl_int status = CL_SUCCESS;
+   for (size_t n = 0; n < nodes.size(); n++) {
+      status = clReleaseKernel(nodes[n].kernel);
+      CLException::checkCLError(status, "clReleaseKernel() graph node");
+   }
+   nodes.clear();
+   for (size_t i = 0; i < buffers.size(); i++) {
+      releaseBuffer(jenv, buffers[i]);
+   }
+   buffers.clear();
+}
+
+/**
+ * find (or create) the graph buffer of the java array of an arg.
+ * A new buffer is copied in straight away, so arrays which are neither inputs nor outputs hold the contents
+ * of the java array when the graph first saw it.
+ *
+ * @throws CLException
+ */
+GraphBuffer* KernelGraph::bind(JNIEnv* jenv, KernelArg* arg) {
+   if (arg->arrayBuffer->javaArray == NULL) {
+      throw CLException(CL_INVALID_ARG_VALUE, "graph node array arg is null");
+   }
+   for (size_t i = 0; i < buffers.size(); i++) {
+      if (jenv->IsSameObject(buffers[i]->javaArray, arg->arrayBuffer->javaArray)) {
+         buffers[i]->used = true;
+         return(buffers[i]);
+      }
+   }
+
+   cl_int status = CL_SUCCESS;
+   GraphBuffer* buffer = new GraphBuffer();
+   buffer->lengthInBytes = arg->arrayBuffer->lengthInBytes;
+   buffer->mem = clCreateBuffer(context, CL_MEM_READ_WRITE, buffer->lengthInBytes, NULL, &status);
+   if (status != CL_SUCCESS) {
+      delete buffer;
+      throw CLException(status, "clCreateBuffer() graph");
+   }
+   memTracker.add(buffer->mem, buffer->lengthInBytes, __LINE__, __FILE__);
+   buffer->javaArray = jenv->NewWeakGlobalRef(arg->arrayBuffer->javaArray);
+   buffer->lastWrite = NULL;
+   buffer->used = true;
+   buffer->uploaded = false;
+   buffers.push_back(buffer);
+
+   if (config->isVerbose()){
+      fprintf(stderr, "graph buffer for %s, %d bytes\n", arg->name, buffer->lengthInBytes);
+   }
+
+   copyIn(jenv, nodes[0].jniContext->commandQueue, buffer);
+   return(buffer);
+}
+
+void KernelGraph::releaseBuffer(JNIEnv* jenv, GraphBuffer* buffer) {
+   memTracker.remove(buffer->mem, __LINE__, __FILE__);
+   cl_int status = clReleaseMemObject(buffer->mem);
+   CLException::checkCLError(status, "clReleaseMemObject() graph");
+   jenv->DeleteWeakGlobalRef((jweak)buffer->javaArray);
+   delete buffer;
+}
+
+/**
+ * blocking copy of a java array into its graph buffer, the array is only pinned for the transfer
+ *
+ * @throws CLException
+ */
+void KernelGraph::copyIn(JNIEnv* jenv, cl_command_queue queue, GraphBuffer* buffer) {
+   jarray array = (jarray)jenv->NewLocalRef(buffer->javaArray);
+   if (array == NULL) {
+      return;
+   }
+   void* addr = jenv->GetPrimitiveArrayCritical(array, NULL);
+   cl_int status = clEnqueueWriteBuffer(queue, buffer->mem, CL_TRUE, 0, buffer->lengthInBytes, addr, 0, NULL, NULL);
+   jenv->ReleasePrimitiveArrayCritical(array, addr, JNI_ABORT);
+   jenv->DeleteLocalRef(array);
+   if (status != CL_SUCCESS) throw CLException(status, "clEnqueueWriteBuffer() graph input");
+   buffer->uploaded = true;
+}
+
+/**
+ * blocking copy of a graph buffer back into its java array once its last writer has completed
+ *
+ * @throws CLException
+ */
+void KernelGraph::copyOut(JNIEnv* jenv, cl_command_queue queue, GraphBuffer* buffer) {
+   jarray array = (jarray)jenv->NewLocalRef(buffer->javaArray);
+   if (array == NULL) {
+      return;
+   }
+   void* addr = jenv->GetPrimitiveArrayCritical(array, NULL);
+   cl_int status = clEnqueueReadBuffer(queue, buffer->mem, CL_TRUE, 0, buffer->lengthInBytes, addr, 1, &(buffer->lastWrite), NULL);
+   jenv->ReleasePrimitiveArrayCritical(array, addr, 0);
+   jenv->DeleteLocalRef(array);
+   if (status != CL_SUCCESS) throw CLException(status, "clEnqueueReadBuffer() graph output");
+}
+
+bool KernelGraph::contains(JNIEnv* jenv, jobjectArray arrays, jobject array) {
+   if (arrays == NULL) {
+      return(false);
+   }
+   jsize count = jenv->GetArrayLength(arrays);
+   for (jsize i = 0; i < count; i++) {
+      jobject element = jenv->GetObjectArrayElement(arrays, i);
+      bool same = (element != NULL) && jenv->IsSameObject(element, array);
+      jenv->DeleteLocalRef(element);
+      if (same) {
+         return(true);
+      }
+   }
+   return(false);
+}
+
+void KernelGraph::addWait(std::vector<cl_event>& waits, cl_event event) {
+   if (event == NULL) {
+      return;
+   }
+   for (size_t i = 0; i < waits.size(); i++) {
+      if (waits[i] == event) {
+         return;
+      }
+   }
+   waits.push_back(event);
+}
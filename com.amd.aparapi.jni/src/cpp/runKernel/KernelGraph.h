@@ -0,0 +1,111 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef KERNEL_GRAPH_H
+#define KERNEL_GRAPH_H
+
+#include "Common.h"
+#include "JNIContext.h"
+#include <vector>
+
+/**
+ * A buffer shared by every node of a graph which references the same java array.
+ * It lives on the device for the life of the graph, the java array is only copied in (inputs) or out (outputs).
+ */
+class GraphBuffer{
+   public:
+      jobject javaArray;            // weak global ref to the java array
+      jint lengthInBytes;
+      cl_mem mem;
+      cl_event lastWrite;           // the last node of the current run to write the buffer
+      std::vector<cl_event> reads;  // nodes of the current run which read the buffer since lastWrite
+      bool used;                    // referenced by a node in the current run
+      bool uploaded;                // already copied in during the current run
+};
+
+/**
+ * One kernel execution of a graph. The node has its own cl_kernel for its entrypoint so that binding 
+ * graph buffers does not disturb the args of the kernels of the JNIContext.
+ */
+class GraphNode{
+   public:
+      JNIContext* jniContext;
+      cl_kernel kernel;
+};
+
+/**
+ * Runs a list of kernel executions as a dependency graph on one device.
+ * 
+ * Dependencies are derived from the array args of each node, in the order the nodes were added: a node waits for 
+ * the last writer of each array it accesses, and a node writing an array also waits for the readers of the previous 
+ * contents. Intermediate arrays never leave the device, only arrays declared as outputs are read back.
+ */
+class KernelGraph{
+   public:
+      cl_context context;
+      std::vector<GraphNode> nodes;
+      std::vector<GraphBuffer*> buffers;
+
+      KernelGraph();
+
+      static KernelGraph* getKernelGraph(jlong graphHandle){
+         return((KernelGraph*)graphHandle);
+      }
+
+      /**
+       * Create the kernels of the nodes, all contexts must share one OpenCL context
+       */
+      void build(JNIEnv* jenv, jint nodeCount, JNIContext** jniContexts, jobjectArray entrypoints);
+
+      /**
+       * Enqueue every node and wait for the graph to complete
+       */
+      void run(JNIEnv* jenv, jobject jobj, jobjectArray ranges, jint* passes, jobjectArray inputs, jobjectArray outputs);
+
+      void dispose(JNIEnv* jenv);
+
+   private:
+      GraphBuffer* bind(JNIEnv* jenv, KernelArg* arg);
+      void releaseBuffer(JNIEnv* jenv, GraphBuffer* buffer);
+      void copyIn(JNIEnv* jenv, cl_command_queue queue, GraphBuffer* buffer);
+      void copyOut(JNIEnv* jenv, cl_command_queue queue, GraphBuffer* buffer);
+      static bool contains(JNIEnv* jenv, jobjectArray arrays, jobject array);
+      static void addWait(std::vector<cl_event>& waits, cl_event event);
+};
+
+#endif // KERNEL_GRAPH_H
@@ -0,0 +1,151 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram():
+   count(0),
+   total(0),
+   max(0){
+   for (jint i = 0; i < BUCKETS; i++) {
+      counts[i] = 0;
+   }
+}
+
+jint LatencyHistogram::bucketOf(jlong value) {
+   if (value < (2 * SUB_BUCKETS)) {
+      return((value < 0) ? 0 : (jint)value);
+   }
+   if (value >= ((jlong)1 << MAX_BITS)) {
+      return(BUCKETS - 1);
+   }
+   // shift the value down until its top SUB_BITS + 1 bits are left, those pick the bucket within its power of two
+   jint shift = 0;
+   while ((value >> shift) >= (2 * SUB_BUCKETS)) {
+      shift++;
+   }
+   return((shift + 1) * SUB_BUCKETS + (jint)((value >> shift) - SUB_BUCKETS));
+}
+
+jlong LatencyHistogram::highestValueOf(jint bucket) {
+   if (bucket < (2 * SUB_BUCKETS)) {
+      return(bucket);
+   }
+   jint shift = (bucket / SUB_BUCKETS) - 1;
+   jlong subBucket = (bucket % SUB_BUCKETS) + SUB_BUCKETS;
+   return(((subBucket + 1) << shift) - 1);
+}
+
+void LatencyHistogram::record(jlong value) {
+   if (value < 0) {
+      value = 0;
+   }
+   atomicAdd(&counts[bucketOf(value)], 1);
+   atomicAdd(&count, 1);
+   atomicAdd(&total, value);
+   jlong current = max;
+   while (value > current && !atomicCompareAndSwap(&max, current, value)) {
+      current = max;
+   }
+}
+
+void LatencyHistogram::drainInto(LatencyHistogram& to) {
+   // each value is taken back out of this histogram rather than zeroed, so a racing record is kept for the next read
+   for (jint i = 0; i < BUCKETS; i++) {
+      jlong bucketCount = counts[i];
+      if (bucketCount != 0) {
+         atomicAdd(&counts[i], -bucketCount);
+         to.counts[i] += bucketCount;
+      }
+   }
+   jlong drainedCount = count;
+   atomicAdd(&count, -drainedCount);
+   to.count += drainedCount;
+   jlong drainedTotal = total;
+   atomicAdd(&total, -drainedTotal);
+   to.total += drainedTotal;
+   jlong drainedMax = max;
+   atomicCompareAndSwap(&max, drainedMax, 0);
+   if (drainedMax > to.max) {
+      to.max = drainedMax;
+   }
+}
+
+jlong LatencyHistogram::percentile(double fraction) {
+   // the first bucket at which at least fraction of the values have been seen
+   jlong target = (jlong)(fraction * count + 0.5);
+   if (target < 1) {
+      target = 1;
+   }
+   jlong seen = 0;
+   for (jint i = 0; i < BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= target) {
+         jlong value = highestValueOf(i);
+         return((value < max) ? value : max);
+      }
+   }
+   return(max);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize() {
+   Summary summary;
+   summary.count = count;
+   summary.total = total;
+   summary.max = max;
+   if (count > 0) {
+      summary.p50 = percentile(0.50);
+      summary.p90 = percentile(0.90);
+      summary.p99 = percentile(0.99);
+   } else {
+      summary.p50 = 0;
+      summary.p90 = 0;
+      summary.p99 = 0;
+   }
+   return(summary);
+}
+
+void KernelLatency::recordRun(const RunTotals& totals, bool timed) {
+   histograms[UPLOAD_BYTES].record(totals.uploadBytes);
+   histograms[READBACK_BYTES].record(totals.readbackBytes);
+   if (timed) {
+      histograms[EXECUTE_NANOS].record(totals.executeNanos);
+      histograms[UPLOAD_NANOS].record(totals.uploadNanos);
+      histograms[READBACK_NANOS].record(totals.readbackNanos);
+   }
+}
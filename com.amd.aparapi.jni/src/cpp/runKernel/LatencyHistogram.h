@@ -0,0 +1,154 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include "Common.h"
+#include "Mutex.h"
+
+/**
+ * A fixed size HDR style histogram of non negative values (nanoseconds or bytes).
+ *
+ * Each power of two is split into SUB_BUCKETS linear buckets, so a value is held to within 1/SUB_BUCKETS of itself
+ * whatever its size. Values at or above 2^MAX_BITS land in the last bucket. Recording is a few atomic adds and never
+ * allocates, so it can be left on. drain() empties the histogram as it reads it.
+ */
+class LatencyHistogram{
+   public:
+      static const jint SUB_BITS = 5;
+      static const jint SUB_BUCKETS = 1 << SUB_BITS;
+      static const jint MAX_BITS = 40;
+      static const jint BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+      /**
+       * what drain() reports, all values are bucket upper bounds except max and total which are exact
+       */
+      struct Summary {
+         jlong count;
+         jlong p50;
+         jlong p90;
+         jlong p99;
+         jlong max;
+         jlong total;
+      };
+
+      LatencyHistogram();
+
+      void record(jlong value);
+
+      /**
+       * move the counts into another histogram (not shared with any recording thread), emptying this one
+       */
+      void drainInto(LatencyHistogram& to);
+
+      /**
+       * @return the percentiles of everything recorded so far, for a histogram no thread is recording into
+       */
+      Summary summarize();
+
+      static jint bucketOf(jlong value);
+
+      /**
+       * @return the largest value which lands in bucket
+       */
+      static jlong highestValueOf(jint bucket);
+
+   private:
+      volatile jlong counts[BUCKETS];
+      volatile jlong count;
+      volatile jlong total;
+      volatile jlong max;
+
+      jlong percentile(double fraction);
+};
+
+/**
+ * The per run totals a context adds up as its events complete, recorded into its KernelLatency when the run ends.
+ * Times are only collected when the context's queues give event timestamps.
+ */
+struct RunTotals {
+   jlong uploadBytes;
+   jlong uploadNanos;
+   jlong readbackBytes;
+   jlong readbackNanos;
+   jlong executeNanos;
+
+   RunTotals(){
+      clear();
+   }
+
+   void clear(){
+      uploadBytes = 0;
+      uploadNanos = 0;
+      readbackBytes = 0;
+      readbackNanos = 0;
+      executeNanos = 0;
+   }
+};
+
+/**
+ * The latency histograms of one kernel context. The order of the metrics matches LatencySummary.METRIC in java.
+ */
+class KernelLatency{
+   public:
+      enum Metric {
+         RUN_NANOS,       // end to end, from the java call until the results are back in java
+         EXECUTE_NANOS,   // device time of the execute commands of a run
+         UPLOAD_NANOS,
+         UPLOAD_BYTES,
+         READBACK_NANOS,
+         READBACK_BYTES,
+         METRICS
+      };
+
+      LatencyHistogram histograms[METRICS];
+
+      void record(jint metric, jlong value){
+         histograms[metric].record(value);
+      }
+
+      /**
+       * record a completed run's totals
+       *
+       * @param timed true if the totals hold device times
+       */
+      void recordRun(const RunTotals& totals, bool timed);
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,337 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "LocalSizeTuner.h"
+#include "ProgramCache.h"
+#include "Config.h"
+#include "Mutex.h"
+#include <string>
+#include <map>
+
+#if !defined (_WIN32)
+#include <sys/time.h>
+#endif
+
+typedef std::map<std::string, TuningEntry*> TuningTable;
+
+static TuningTable table;       // every entry known to this JVM by key
+static bool loaded = false;     // the tuning file has been read
+
+// guards the table and the entries in it, only taken whilst a kernel is being tuned or first seen
+static Mutex tunerLock;
+
+static const char* LOCAL_MARKERS[] = { "get_local_id", "get_local_size", "get_group_id", "get_num_groups", "barrier(", "__local", NULL };
+
+/**
+ * hash the program source and check whether it depends on the local size, only programs which don't are tuned
+ */
+void LocalSizeTuner::inspect(JNIEnv* jenv, JNIContext* jniContext, jstring source) {
+   const char* sourceChars = jenv->GetStringUTFChars(source, NULL);
+   jniContext->sourceHash = ProgramCache::hash(sourceChars);
+   jniContext->localSizeTunable = true;
+   for (int i = 0; LOCAL_MARKERS[i] != NULL; i++) {
+      if (strstr(sourceChars, LOCAL_MARKERS[i]) != NULL) {
+         jniContext->localSizeTunable = false;
+      }
+   }
+   jenv->ReleaseStringUTFChars(source, sourceChars);
+   if (config->isLocalSizeTuningEnabled() && !jniContext->localSizeTunable && config->isVerbose()) {
+      fprintf(stderr, "kernel uses local memory or ids, local size is not tuned\n");
+   }
+}
+
+static void makeKey(char* key, unsigned long long sourceHash, unsigned long long deviceHash, const char* name, int bucket) {
+   sprintf(key, "%016llx %016llx %.200s %d", sourceHash, deviceHash, name, bucket);
+}
+
+/**
+ * read the entries of the tuning file which this JVM doesn't know yet
+ */
+static void readFile(const char* path) {
+   FILE* file = fopen(path, "r");
+   if (file == NULL) {
+      return;
+   }
+   char line[512];
+   while (fgets(line, sizeof(line), file) != NULL) {
+      unsigned long long sourceHash = 0;
+      unsigned long long deviceHash = 0;
+      char name[256];
+      int bucket = 0;
+      unsigned long localSize = 0;
+      if (line[0] == '#' || sscanf(line, "%llx %llx %255s %d %lu", &sourceHash, &deviceHash, name, &bucket, &localSize) != 5) {
+         continue;
+      }
+      char key[512];
+      makeKey(key, sourceHash, deviceHash, name, bucket);
+      if (table.find(key) == table.end()) {
+         TuningEntry* entry = new TuningEntry();
+         entry->best = (size_t)localSize;
+         entry->tuned = true;
+         table[key] = entry;
+      }
+   }
+   fclose(file);
+}
+
+void LocalSizeTuner::load() {
+   if (loaded) {
+      return;
+   }
+   loaded = true;
+   if (config->getLocalSizeTuningFile() != NULL) {
+      readFile(config->getLocalSizeTuningFile());
+   }
+}
+
+/**
+ * write every tuned entry to the tuning file, merged with any another JVM has written since we read it.
+ * The file is written to a file unique to this process then renamed over the old one. Failures are ignored.
+ */
+void LocalSizeTuner::store() {
+   const char* path = config->getLocalSizeTuningFile();
+   if (path == NULL) {
+      return;
+   }
+   readFile(path);
+
+   char* tmpPath = new char[strlen(path) + 64];
+#if defined (_WIN32)
+   sprintf(tmpPath, "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId());
+#else
+   sprintf(tmpPath, "%s.%lu.tmp", path, (unsigned long)getpid());
+#endif
+   FILE* file = fopen(tmpPath, "w");
+   bool written = file != NULL;
+   if (written) {
+      written = fprintf(file, "# aparapi tuned local sizes: source hash, device hash, entrypoint, log2(global size), local size (0 = driver)\n") > 0;
+      for (TuningTable::iterator it = table.begin(); written && it != table.end(); it++) {
+         if (it->second->tuned) {
+            written = fprintf(file, "%s %lu\n", it->first.c_str(), (unsigned long)it->second->best) > 0;
+         }
+      }
+      written = (fclose(file) == 0) && written;
+   }
+   if (written) {
+#if defined (_WIN32)
+      written = MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+      written = rename(tmpPath, path) == 0;
+#endif
+   }
+   if (!written && file != NULL) {
+      remove(tmpPath);
+   }
+   delete[] tmpPath;
+}
+
+/**
+ * find (or start) the tuning entry for the current kernel over a global size
+ */
+TuningEntry* LocalSizeTuner::getEntry(JNIContext* jniContext, size_t globalSize, size_t derivedLocalSize) {
+   int bucket = 0;
+   while (((size_t)1 << (bucket + 1)) <= globalSize) {
+      bucket++;
+   }
+   std::pair<cl_kernel, int> contextKey(jniContext->kernel, bucket);
+   JNIContext::TuningEntryMap::iterator found = jniContext->tuningEntries.find(contextKey);
+   if (found != jniContext->tuningEntries.end()) {
+      return found->second;
+   }
+
+   char name[256] = "";
+   clGetKernelInfo(jniContext->kernel, CL_KERNEL_FUNCTION_NAME, sizeof(name) - 1, name, NULL);
+   char device[1024] = "";
+   char driver[256] = "";
+   clGetDeviceInfo(jniContext->deviceId, CL_DEVICE_NAME, sizeof(device) - 1, device, NULL);
+   clGetDeviceInfo(jniContext->deviceId, CL_DRIVER_VERSION, sizeof(driver) - 1, driver, NULL);
+   strncat(device, driver, sizeof(device) - strlen(device) - 1);
+   char key[512];
+   makeKey(key, jniContext->sourceHash, ProgramCache::hash(device), name, bucket);
+
+   ScopedLock lock(tunerLock);
+   load();
+   TuningEntry* entry = NULL;
+   TuningTable::iterator it = table.find(key);
+   if (it != table.end()) {
+      entry = it->second;
+   } else {
+      entry = new TuningEntry();
+      size_t multiple = 0;
+      clGetKernelWorkGroupInfo(jniContext->kernel, jniContext->deviceId, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+            sizeof(multiple), &multiple, NULL);
+      size_t maxGroupSize = jniContext->getWorkGroupSize(jniContext->kernel);
+      if (multiple == 0) {
+         multiple = 1;
+      }
+      if (maxGroupSize == 0) {
+         maxGroupSize = derivedLocalSize;
+      }
+      entry->candidates.push_back(derivedLocalSize);
+      entry->candidates.push_back(0);
+      for (size_t size = multiple; size <= maxGroupSize; size *= 2) {
+         if (size != derivedLocalSize) {
+            entry->candidates.push_back(size);
+         }
+      }
+      entry->best = derivedLocalSize;
+      table[key] = entry;
+      if (config->isVerbose()) {
+         fprintf(stderr, "tuning local size of %s over global sizes 2^%d with %d candidates\n", name, bucket, (int)entry->candidates.size());
+      }
+   }
+   jniContext->tuningEntries[contextKey] = entry;
+   return entry;
+}
+
+/**
+ * pick the local size of the next execution, setting up its timing if the kernel is still being tuned
+ *
+ * @return the local size to enqueue with, NULL to let the driver choose
+ */
+size_t* LocalSizeTuner::choose(JNIContext* jniContext, Range& range) {
+   discard(jniContext);
+   if (!config->isLocalSizeTuningEnabled() || !jniContext->localSizeTunable || range.dims != 1 
+         || !range.localIsDerived || jniContext->subDeviceCount > 1) {
+      return range.localDims;
+   }
+
+   size_t globalSize = range.globalDims[0];
+   TuningEntry* entry = getEntry(jniContext, globalSize, range.localDims[0]);
+
+   if (!entry->tuned) {
+      ScopedLock lock(tunerLock);
+      // the bucket spans global sizes, skip candidates which don't divide this one
+      while (entry->next < entry->candidates.size() && entry->candidates[entry->next] != 0 
+            && (globalSize % entry->candidates[entry->next]) != 0) {
+         entry->next++;
+      }
+      if (entry->next < entry->candidates.size()) {
+         jniContext->tuningEntry = entry;
+         jniContext->tuningLocalSize = entry->candidates[entry->next];
+         if (jniContext->tuningLocalSize == 0) {
+            return NULL;
+         }
+         range.localDims[0] = jniContext->tuningLocalSize;
+         return range.localDims;
+      }
+      memoryBarrier();
+      entry->tuned = true;
+      store();
+   } else {
+      // pairs with the barrier before tuned was set, best is final once tuned is seen
+      memoryBarrier();
+   }
+
+   size_t best = entry->best;
+   if (best == 0) {
+      return NULL;
+   }
+   if ((globalSize % best) == 0) {
+      range.localDims[0] = best;
+   }
+   return range.localDims;
+}
+
+/**
+ * keep the execute event of an execution being timed
+ */
+void LocalSizeTuner::track(JNIContext* jniContext, cl_event executeEvent) {
+   if (jniContext->tuningEntry != NULL && executeEvent != NULL) {
+      clRetainEvent(executeEvent);
+      jniContext->tuningEvent = executeEvent;
+   }
+}
+
+/**
+ * record the time of a completed execution being timed, moving on to the next candidate once it has been timed 
+ * often enough and locking in the fastest once all have been. Never waits.
+ */
+void LocalSizeTuner::complete(JNIContext* jniContext) {
+   TuningEntry* entry = jniContext->tuningEntry;
+   if (entry == NULL || jniContext->tuningEvent == NULL) {
+      discard(jniContext);
+      return;
+   }
+
+   cl_ulong start = 0;
+   cl_ulong end = 0;
+   cl_int status = clGetEventProfilingInfo(jniContext->tuningEvent, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+   if (status == CL_SUCCESS) {
+      status = clGetEventProfilingInfo(jniContext->tuningEvent, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+   }
+   ScopedLock lock(tunerLock);
+   if (status != CL_SUCCESS) {
+      // no timings from this queue, keep the derived local size
+      entry->best = entry->candidates[0];
+      memoryBarrier();
+      entry->tuned = true;
+   } else if (end > start && !entry->tuned) {
+      cl_ulong nanos = end - start;
+      if (entry->bestNanos == 0 || nanos < entry->bestNanos) {
+         entry->best = jniContext->tuningLocalSize;
+         entry->bestNanos = nanos;
+      }
+      // another context may have moved the entry on whilst we ran
+      if (entry->next < entry->candidates.size() && entry->candidates[entry->next] == jniContext->tuningLocalSize
+            && ++entry->trials >= config->getLocalSizeTuningTrials()) {
+         entry->trials = 0;
+         entry->next++;
+      }
+      if (entry->next >= entry->candidates.size()) {
+         memoryBarrier();
+         entry->tuned = true;
+         if (config->isVerbose()) {
+            fprintf(stderr, "tuned local size %lu (%lu ns)\n", (unsigned long)entry->best, (unsigned long)entry->bestNanos);
+         }
+         store();
+      }
+   }
+   discard(jniContext);
+}
+
+/**
+ * forget the timing of the current execution, it failed or has been recorded
+ */
+void LocalSizeTuner::discard(JNIContext* jniContext) {
+   if (jniContext->tuningEvent != NULL) {
+      clReleaseEvent(jniContext->tuningEvent);
+      jniContext->tuningEvent = NULL;
+   }
+   jniContext->tuningEntry = NULL;
+}
@@ -0,0 +1,88 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef LOCAL_SIZE_TUNER_H
+#define LOCAL_SIZE_TUNER_H
+
+#include "Common.h"
+#include "JNIContext.h"
+#include "Range.h"
+#include <vector>
+
+/**
+ * The tuning state of one kernel on one device over global sizes in one power of two bucket.
+ */
+class TuningEntry{
+   public:
+      std::vector<size_t> candidates; // local sizes to time, 0 lets the driver choose
+      size_t next;                    // the candidate being timed
+      jint trials;                    // executions of the current candidate timed so far
+      size_t best;                    // the fastest local size so far
+      cl_ulong bestNanos;             // its fastest execution, 0 until one has been timed
+      volatile bool tuned;            // all candidates have been timed, best is used from now on. Set after a barrier
+                                      // so choose can read best without the lock once it sees it
+
+      TuningEntry():
+         next(0), trials(0), best(0), bestNanos(0), tuned(false){
+      }
+};
+
+/**
+ * Picks the local size of 1D executions whose local size was derived by Aparapi, enabled by 
+ * -Dcom.amd.aparapi.enableLocalSizeTuning=true.
+ *
+ * The first executions of a kernel each time one candidate local size with the profiling info of the execute event,
+ * once every candidate has been timed the fastest is used. Results are keyed by a hash of the program source, the 
+ * device and driver, the entrypoint and the power of two bucket of the global size. They are kept in 
+ * -Dcom.amd.aparapi.localSizeTuningFile if set, so later JVMs start tuned.
+ */
+class LocalSizeTuner{
+   public:
+      static void inspect(JNIEnv* jenv, JNIContext* jniContext, jstring source);
+      static size_t* choose(JNIContext* jniContext, Range& range);
+      static void track(JNIContext* jniContext, cl_event executeEvent);
+      static void complete(JNIContext* jniContext);
+      static void discard(JNIContext* jniContext);
+
+   private:
+      static TuningEntry* getEntry(JNIContext* jniContext, size_t globalSize, size_t derivedLocalSize);
+      static void load();
+      static void store();
+};
+
+#endif // LOCAL_SIZE_TUNER_H
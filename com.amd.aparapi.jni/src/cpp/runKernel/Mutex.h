@@ -0,0 +1,147 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include "Common.h"
+
+#if !defined (_WIN32)
+#include <pthread.h>
+#endif
+
+/**
+ * A plain (non recursive) lock for native state shared by threads running different kernels.
+ */
+class Mutex{
+#if defined (_WIN32)
+   CRITICAL_SECTION section;
+   public:
+   Mutex() { InitializeCriticalSection(&section); }
+   ~Mutex() { DeleteCriticalSection(&section); }
+   void lock() { EnterCriticalSection(&section); }
+   void unlock() { LeaveCriticalSection(&section); }
+#else
+   pthread_mutex_t mutex;
+   public:
+   Mutex() { pthread_mutex_init(&mutex, NULL); }
+   ~Mutex() { pthread_mutex_destroy(&mutex); }
+   void lock() { pthread_mutex_lock(&mutex); }
+   void unlock() { pthread_mutex_unlock(&mutex); }
+#endif
+   private:
+   friend class Condition;
+   Mutex(const Mutex&);
+   Mutex& operator=(const Mutex&);
+};
+
+/**
+ * A condition threads holding a Mutex wait on until another thread signals it. Waits may wake spuriously, 
+ * so callers wait in a loop testing what they are waiting for.
+ */
+class Condition{
+#if defined (_WIN32)
+   CONDITION_VARIABLE condition;
+   public:
+   Condition() { InitializeConditionVariable(&condition); }
+   void wait(Mutex& mutex) { SleepConditionVariableCS(&condition, &mutex.section, INFINITE); }
+   void signalAll() { WakeAllConditionVariable(&condition); }
+#else
+   pthread_cond_t condition;
+   public:
+   Condition() { pthread_cond_init(&condition, NULL); }
+   ~Condition() { pthread_cond_destroy(&condition); }
+   void wait(Mutex& mutex) { pthread_cond_wait(&condition, &mutex.mutex); }
+   void signalAll() { pthread_cond_broadcast(&condition); }
+#endif
+   private:
+   Condition(const Condition&);
+   Condition& operator=(const Condition&);
+};
+
+/**
+ * Holds a Mutex for the rest of the enclosing scope, including when a CLException unwinds it.
+ */
+class ScopedLock{
+   Mutex& mutex;
+   public:
+   ScopedLock(Mutex& _mutex): mutex(_mutex) { mutex.lock(); }
+   ~ScopedLock() { mutex.unlock(); }
+   private:
+   ScopedLock(const ScopedLock&);
+   ScopedLock& operator=(const ScopedLock&);
+};
+
+/**
+ * Add delta to value atomically.
+ *
+ * @return the new value
+ */
+inline jlong atomicAdd(volatile jlong* value, jlong delta) {
+#if defined (_WIN32)
+   return(InterlockedExchangeAdd64((volatile LONGLONG*)value, delta) + delta);
+#else
+   return(__sync_add_and_fetch(value, delta));
+#endif
+}
+
+/**
+ * Set value to replacement if it still holds expected, atomically.
+ *
+ * @return true if value was replaced
+ */
+inline bool atomicCompareAndSwap(volatile jlong* value, jlong expected, jlong replacement) {
+#if defined (_WIN32)
+   return(InterlockedCompareExchange64((volatile LONGLONG*)value, replacement, expected) == expected);
+#else
+   return(__sync_bool_compare_and_swap(value, expected, replacement));
+#endif
+}
+
+/**
+ * Full fence, so state built before it is visible to any thread that sees a pointer or flag published after it.
+ */
+inline void memoryBarrier() {
+#if defined (_WIN32)
+   MemoryBarrier();
+#else
+   __sync_synchronize();
+#endif
+}
+
+#endif // MUTEX_H
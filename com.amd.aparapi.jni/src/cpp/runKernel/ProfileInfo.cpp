@@ -48,14 +48,18 @@ ProfileInfo::ProfileInfo():
    end((cl_ulong)0L) {
 }
 
-jobject ProfileInfo::createProfileInfoInstance(JNIEnv *jenv){
-   jobject profileInstance = JNIHelper::createInstance(jenv, ProfileInfoClass , ArgsVoidReturn(StringClassArg IntArg LongArg LongArg LongArg LongArg), 
+/**
+ * @param sampleInterval the number of runs the profiled run stands for when profiling is sampled
+ */
+jobject ProfileInfo::createProfileInfoInstance(JNIEnv *jenv, jint sampleInterval){
+   jobject profileInstance = JNIHelper::createInstance(jenv, ProfileInfoClass , ArgsVoidReturn(StringClassArg IntArg LongArg LongArg LongArg LongArg IntArg), 
          ((jstring)(name==NULL?NULL:jenv->NewStringUTF(name))),
          ((jint)type), 
          ((jlong)start),
          ((jlong)end),
          ((jlong)queued),
-         ((jlong)submit));
+         ((jlong)submit),
+         sampleInterval);
    return(profileInstance);
 }
 
@@ -50,7 +50,7 @@ class ProfileInfo{
       cl_ulong start;
       cl_ulong end;
       ProfileInfo();
-      jobject createProfileInfoInstance(JNIEnv *jenv);
+      jobject createProfileInfoInstance(JNIEnv *jenv, jint sampleInterval = 1);
 };
 
 #endif
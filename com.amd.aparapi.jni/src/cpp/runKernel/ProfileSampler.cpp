@@ -0,0 +1,99 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "ProfileSampler.h"
+#include "Config.h"
+#include "Mutex.h"
+
+#include <algorithm>
+
+ProfileSampler::ProfileSampler():
+   interval(1),
+   countdown(0),
+   sampledInterval(1),
+   sampledNanos(0),
+   unsampledNanos(0),
+   pending(0){
+   if (config != NULL) {
+      interval = std::max(1, std::min(config->getProfilingSampleInterval(), MAX_INTERVAL));
+      if (config->getProfilingOverheadPercent() > 0) {
+         // the budget needs unprofiled runs to measure the overhead against
+         interval = std::max(interval, 2);
+      }
+   }
+}
+
+bool ProfileSampler::sample() {
+   jlong completedRun = pending;
+   if (completedRun != 0 && atomicCompareAndSwap(&pending, completedRun, 0)) {
+      completed((completedRun & 1) != 0, completedRun >> 1);
+   }
+   if (countdown > 0) {
+      countdown--;
+      return(false);
+   }
+   countdown = interval - 1;
+   sampledInterval = interval;
+   return(true);
+}
+
+void ProfileSampler::average(jlong& average, jlong nanos) {
+   // weights the last eight or so runs
+   average = (average == 0) ? nanos : average + (nanos - average) / 8;
+}
+
+void ProfileSampler::completedAsync(bool sampled, jlong nanos) {
+   // runs of one context never overlap, so at most one is waiting to be taken
+   pending = std::max((jlong)0, nanos) * 2 + (sampled ? 1 : 0);
+}
+
+void ProfileSampler::completed(bool sampled, jlong nanos) {
+   average(sampled ? sampledNanos : unsampledNanos, nanos);
+
+   jint budget = (config != NULL) ? config->getProfilingOverheadPercent() : 0;
+   if (!sampled || budget <= 0 || unsampledNanos <= 0) {
+      return;
+   }
+   jlong overhead = std::max((jlong)0, sampledNanos - unsampledNanos);
+   jlong needed = (overhead * 100 + budget * unsampledNanos - 1) / (budget * unsampledNanos);
+   jint minimum = std::max(2, config->getProfilingSampleInterval());
+   interval = (jint)std::max((jlong)minimum, std::min(needed, (jlong)MAX_INTERVAL));
+   if (config->isVerbose()) {
+      fprintf(stderr, "profiling overhead %ld ns per profiled run, profiling 1 in %d runs\n", (long)overhead, interval);
+   }
+}
@@ -0,0 +1,92 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef PROFILE_SAMPLER_H
+#define PROFILE_SAMPLER_H
+
+#include "Common.h"
+
+/**
+ * Picks which runs of a context are profiled when profiling is enabled, so its cost can be bounded in production.
+ *
+ * One run in every -Dcom.amd.aparapi.profilingSampleInterval=N is profiled (every run by default). With
+ * -Dcom.amd.aparapi.profilingOverheadPercent=P the interval is instead stretched until the extra time a profiled
+ * run takes, spread over the interval, is at most P percent of an unprofiled run. Each profiled run stands for the
+ * interval it was sampled at, which is reported with its results so totals can be scaled back up.
+ */
+class ProfileSampler{
+   public:
+      static const jint MAX_INTERVAL = 1 << 16;
+
+      ProfileSampler();
+
+      /**
+       * decide whether the run about to start is profiled
+       */
+      bool sample();
+
+      /**
+       * note how long a run took, and adjust the interval to the overhead budget
+       */
+      void completed(bool sampled, jlong nanos);
+
+      /**
+       * note how long an async run took, from the thread which completed it. The run is only accounted for by the 
+       * next sample() so everything but this hand off stays on the threads starting runs.
+       */
+      void completedAsync(bool sampled, jlong nanos);
+
+      /**
+       * @return the interval the last profiled run was sampled at, the number of runs it stands for
+       */
+      jint getSampledInterval(){
+         return(sampledInterval);
+      }
+
+   private:
+      jint interval;          // profile one run in this many
+      jint countdown;         // runs to go until the next profiled run
+      jint sampledInterval;
+      jlong sampledNanos;     // moving averages of the run times with and without profiling
+      jlong unsampledNanos;
+      volatile jlong pending; // an async run left for sample(), nanos * 2 + sampled, 0 if none
+
+      static void average(jlong& average, jlong nanos);
+};
+
+#endif // PROFILE_SAMPLER_H
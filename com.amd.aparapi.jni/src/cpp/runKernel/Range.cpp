@@ -1,5 +1,6 @@
 
 #include "Range.h"
+#include "Mutex.h"
 
 jclass Range::rangeClazz = (jclass)0;
 jfieldID  Range::globalSize_0_FieldID=0;
@@ -11,22 +12,48 @@ jfieldID  Range::localSize_2_FieldID=0;
 jfieldID  Range::dimsFieldID=0;
 jfieldID  Range::localIsDerivedFieldID=0; 
 
-Range::Range(JNIEnv *jenv, jobject range):
+// guards the first lookup of the field ids above, rangeClazz is published last
+static Mutex rangeClassLock;
+
+Range::Range(JNIEnv *jenv, jobject range, const char* state):
          range(range),
          dims(0),
          offsets(NULL),
          globalDims(NULL),
          localDims(NULL){
+   if (state != NULL){
+      const jint* globalSizes = (const jint*)(state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_RANGE_GLOBAL_SIZE);
+      const jint* localSizes = (const jint*)(state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_RANGE_LOCAL_SIZE);
+      dims = *(const jint*)(state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_RANGE_DIMS);
+      localIsDerived = (*(const jint*)(state + com_amd_aparapi_internal_jni_KernelRunnerJNI_STATE_RANGE_LOCAL_IS_DERIVED) != 0) ? JNI_TRUE : JNI_FALSE;
+      if (dims > 0){
+         offsets = new size_t[dims];
+         globalDims = new size_t[dims];
+         localDims = new size_t[dims];
+         for (int i = 0; i < dims && i < 3; i++){
+            offsets[i] = 0;
+            globalDims[i] = globalSizes[i];
+            localDims[i] = localSizes[i];
+         }
+      }
+      return;
+   }
    if (rangeClazz ==NULL){
-      jclass rangeClazz = jenv->GetObjectClass(range); 
-      globalSize_0_FieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "globalSize_0", "I");
-      globalSize_1_FieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "globalSize_1", "I");
-      globalSize_2_FieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "globalSize_2", "I");
-      localSize_0_FieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "localSize_0", "I");
-      localSize_1_FieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "localSize_1", "I");
-      localSize_2_FieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "localSize_2", "I");
-      dimsFieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "dims", "I");
-      localIsDerivedFieldID = JNIHelper::GetFieldID(jenv, rangeClazz, "localIsDerived", "Z");
+      ScopedLock lock(rangeClassLock);
+      if (rangeClazz == NULL){
+         jclass c = jenv->GetObjectClass(range);
+         globalSize_0_FieldID = JNIHelper::GetFieldID(jenv, c, "globalSize_0", "I");
+         globalSize_1_FieldID = JNIHelper::GetFieldID(jenv, c, "globalSize_1", "I");
+         globalSize_2_FieldID = JNIHelper::GetFieldID(jenv, c, "globalSize_2", "I");
+         localSize_0_FieldID = JNIHelper::GetFieldID(jenv, c, "localSize_0", "I");
+         localSize_1_FieldID = JNIHelper::GetFieldID(jenv, c, "localSize_1", "I");
+         localSize_2_FieldID = JNIHelper::GetFieldID(jenv, c, "localSize_2", "I");
+         dimsFieldID = JNIHelper::GetFieldID(jenv, c, "dims", "I");
+         localIsDerivedFieldID = JNIHelper::GetFieldID(jenv, c, "localIsDerived", "Z");
+         jclass global = (jclass)jenv->NewGlobalRef(c);
+         memoryBarrier();
+         rangeClazz = global;
+      }
    }
    dims = jenv->GetIntField(range, dimsFieldID);
    localIsDerived = jenv->GetBooleanField(range, localIsDerivedFieldID);
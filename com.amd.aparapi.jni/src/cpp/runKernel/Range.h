@@ -3,6 +3,7 @@
 
 #include "Common.h"
 #include "JNIHelper.h"
+#include "com_amd_aparapi_internal_jni_KernelRunnerJNI.h"
 
 class Range{
    public:
@@ -21,7 +22,8 @@ class Range{
       size_t *globalDims;
       size_t *localDims;
       jboolean localIsDerived;
-      Range(JNIEnv *jenv, jobject range);
+      // state is the header of a JNIContext state block, if given the fields of range are not read
+      Range(JNIEnv *jenv, jobject range, const char* state = NULL);
       ~Range();
 };
 
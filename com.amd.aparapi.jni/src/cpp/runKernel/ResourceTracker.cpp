@@ -0,0 +1,234 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "ResourceTracker.h"
+#include "Config.h"
+
+#if defined (_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#endif
+
+ResourceTracker commandQueueTracker("cl_command_queue");
+ResourceTracker memTracker("cl_mem");
+ResourceTracker readEventTracker("cl_event (read)");
+ResourceTracker executeEventTracker("cl_event (exec)");
+ResourceTracker writeEventTracker("cl_event (write)");
+
+static ResourceTracker* trackers[] = {
+   &commandQueueTracker, &memTracker, &readEventTracker, &executeEventTracker, &writeEventTracker
+};
+
+ResourceTracker::ResourceTracker(const char* _name):
+   name(_name),
+   liveCount(0),
+   liveBytes(0),
+   allocated(0),
+   unmatchedRemoves(0),
+   overflowed(0){
+   memset(slots, 0, sizeof(slots));
+   memset(sites, 0, sizeof(sites));
+}
+
+/**
+ * @return the first slot a handle may go in
+ */
+static int firstSlot(const void* handle) {
+   // handles are allocations so their low bits carry little, mix the rest down
+   size_t bits = (size_t)handle;
+   bits ^= (bits >> 4) ^ (bits >> 12) ^ (bits >> 20);
+   return((int)(bits % ResourceTracker::CAPACITY));
+}
+
+/**
+ * @return the index of the counts of an allocation site, claimed on first use
+ */
+int ResourceTracker::getSite(const char* fileName, int line) {
+   for (int i = 0; i < MAX_SITES - 1; i++) {
+      Site& site = sites[i];
+      // claim it if unused, losing to another thread just means checking what it claimed
+      if (site.ready == 0 && atomicCompareAndSwap(&site.ready, 0, -1)) {
+         site.fileName = fileName;
+         site.line = line;
+         memoryBarrier();
+         site.ready = 1;
+         return(i);
+      }
+      while (site.ready < 0) {
+         // another thread is filling it in
+      }
+      if (site.line == line && (site.fileName == fileName || strcmp(site.fileName, fileName) == 0)) {
+         return(i);
+      }
+   }
+   return(MAX_SITES - 1);
+}
+
+void ResourceTracker::add(const void* handle, size_t bytes, int line, const char* fileName) {
+   int site = getSite(fileName, line);
+   jlong key = (jlong)(size_t)handle;
+   int first = firstSlot(handle);
+
+   // the runtime reused a handle we never saw released, count the old one as gone
+   for (int i = 0; i < PROBES && key != EMPTY; i++) {
+      Slot& slot = slots[(first + i) % CAPACITY];
+      if (slot.handle == key && atomicCompareAndSwap(&slot.handle, key, REMOVED)) {
+         removed(slot.site, (size_t)slot.bytes);
+      }
+   }
+
+   bool placed = false;
+   for (int i = 0; i < PROBES && key != EMPTY && key != REMOVED && !placed; i++) {
+      Slot& slot = slots[(first + i) % CAPACITY];
+      jlong current = slot.handle;
+      if ((current == EMPTY || current == REMOVED) && atomicCompareAndSwap(&slot.handle, current, key)) {
+         slot.bytes = (jlong)bytes;
+         slot.site = site;
+         placed = true;
+      }
+   }
+   if (!placed) {
+      ScopedLock lock(overflowLock);
+      std::map<const void*, Entry>::iterator it = overflow.find(handle);
+      if (it != overflow.end()) {
+         removed(it->second.site, it->second.bytes);
+         overflow.erase(it);
+         atomicAdd(&overflowed, -1);
+      }
+      overflow.insert(std::make_pair(handle, Entry(bytes, site)));
+      atomicAdd(&overflowed, 1);
+   }
+
+   Site& counts = sites[site];
+   atomicAdd(&counts.live, 1);
+   atomicAdd(&counts.bytes, (jlong)bytes);
+   atomicAdd(&counts.allocated, 1);
+   atomicAdd(&liveCount, 1);
+   atomicAdd(&liveBytes, (jlong)bytes);
+   atomicAdd(&allocated, 1);
+}
+
+/**
+ * take a removed handle off the totals
+ */
+void ResourceTracker::removed(int site, size_t bytes) {
+   atomicAdd(&sites[site].live, -1);
+   atomicAdd(&sites[site].bytes, -(jlong)bytes);
+   atomicAdd(&liveCount, -1);
+   atomicAdd(&liveBytes, -(jlong)bytes);
+}
+
+void ResourceTracker::remove(const void* handle, int line, const char* fileName) {
+   jlong key = (jlong)(size_t)handle;
+   int first = firstSlot(handle);
+   for (int i = 0; i < PROBES && key != EMPTY && key != REMOVED; i++) {
+      Slot& slot = slots[(first + i) % CAPACITY];
+      if (slot.handle == key) {
+         // read before the slot is given up, another add may take it straight away
+         int site = slot.site;
+         size_t bytes = (size_t)slot.bytes;
+         if (atomicCompareAndSwap(&slot.handle, key, REMOVED)) {
+            removed(site, bytes);
+            return;
+         }
+      }
+   }
+
+   if (overflowed > 0) {
+      ScopedLock lock(overflowLock);
+      std::map<const void*, Entry>::iterator it = overflow.find(handle);
+      if (it != overflow.end()) {
+         removed(it->second.site, it->second.bytes);
+         overflow.erase(it);
+         atomicAdd(&overflowed, -1);
+         return;
+      }
+   }
+
+   atomicAdd(&unmatchedRemoves, 1);
+   if (config != NULL && config->isTrackingOpenCLResources()) {
+      fprintf(stderr, "FILE %s LINE %d failed to find %s to remove %p\n", fileName, line, name, handle);
+   }
+}
+
+void ResourceTracker::describe(std::string& out, const void* handle, size_t bytes, int site) {
+   char line[512];
+   snprintf(line, sizeof(line), "   live %p %lu bytes from %s:%d\n", handle, (unsigned long)bytes,
+         (sites[site].ready > 0) ? sites[site].fileName : "other sites", sites[site].line);
+   out += line;
+}
+
+void ResourceTracker::report(std::string& out) {
+   char line[512];
+   snprintf(line, sizeof(line), "%s: %lld live, %lld bytes, %lld allocated, %lld unmatched releases\n", name,
+         (long long)liveCount, (long long)liveBytes, (long long)allocated, (long long)unmatchedRemoves);
+   out += line;
+
+   for (int i = 0; i < MAX_SITES; i++) {
+      if (sites[i].ready > 0 || sites[i].allocated > 0) {
+         snprintf(line, sizeof(line), "   %s:%d %lld live, %lld bytes, %lld allocated\n", 
+               (sites[i].ready > 0) ? sites[i].fileName : "other sites", sites[i].line,
+               (long long)sites[i].live, (long long)sites[i].bytes, (long long)sites[i].allocated);
+         out += line;
+      }
+   }
+
+   int reported = 0;
+   for (int i = 0; i < CAPACITY && reported < MAX_REPORTED_HANDLES; i++) {
+      jlong handle = slots[i].handle;
+      if (handle != EMPTY && handle != REMOVED) {
+         describe(out, (const void*)(size_t)handle, (size_t)slots[i].bytes, slots[i].site);
+         reported++;
+      }
+   }
+   if (overflowed > 0) {
+      ScopedLock lock(overflowLock);
+      for (std::map<const void*, Entry>::iterator it = overflow.begin();
+            it != overflow.end() && reported < MAX_REPORTED_HANDLES; it++) {
+         describe(out, it->first, it->second.bytes, it->second.site);
+         reported++;
+      }
+   }
+}
+
+std::string ResourceTracker::reportAll() {
+   std::string out;
+   for (size_t i = 0; i < sizeof(trackers) / sizeof(trackers[0]); i++) {
+      trackers[i]->report(out);
+   }
+   return(out);
+}
@@ -0,0 +1,148 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#ifndef RESOURCE_TRACKER_H
+#define RESOURCE_TRACKER_H
+
+#include "Common.h"
+#include "Mutex.h"
+#include <map>
+#include <string>
+
+/**
+ * Tracks the live OpenCL handles of one type (buffers, queues, events...) along with the source line which 
+ * created each of them.
+ *
+ * Handles live in a fixed size open addressing table claimed with compare and swap, so adding and removing a 
+ * handle takes no lock and kernels running on different threads never wait on each other. Each handle may only 
+ * go in the PROBES slots following its hash, a handle which finds them all taken goes in an overflow map which 
+ * is locked (only ever used with more than a few thousand handles of one type live). Totals and the counts of 
+ * each allocation site are kept with atomic adds. This is cheap enough to be always on, a report of what is still 
+ * live and where it came from is built on demand.
+ */
+class ResourceTracker{
+   public:
+      static const int CAPACITY = 4096;
+
+      // slots a handle may be placed in, starting at its hash
+      static const int PROBES = 16;
+
+      // distinct allocation sites counted per type, the rest are counted under the last
+      static const int MAX_SITES = 64;
+
+      // the handles listed per type in a report, beyond this only the counts are given
+      static const int MAX_REPORTED_HANDLES = 32;
+
+      ResourceTracker(const char* name);
+
+      void add(const void* handle, int line, const char* fileName){
+         add(handle, 0, line, fileName);
+      }
+      void add(const void* handle, size_t bytes, int line, const char* fileName);
+      void remove(const void* handle, int line, const char* fileName);
+
+      jlong getLiveCount(){
+         return(liveCount);
+      }
+      jlong getLiveBytes(){
+         return(liveBytes);
+      }
+
+      /**
+       * append the live counts and bytes, the allocation sites with live handles and the live handles. Taken 
+       * whilst kernels are running it may miss handles added or removed as it is built.
+       */
+      void report(std::string& out);
+
+      /**
+       * report every tracker
+       */
+      static std::string reportAll();
+
+   private:
+      class Site{
+         public:
+            const char* fileName;
+            int line;
+            volatile jlong ready;            // 0 unused, -1 being claimed, 1 once fileName and line may be read
+            volatile jlong live;
+            volatile jlong bytes;
+            volatile jlong allocated;
+      };
+
+      class Slot{
+         public:
+            volatile jlong handle;           // EMPTY, REMOVED or the handle
+            jlong bytes;
+            int site;
+      };
+
+      static const jlong EMPTY = 0;
+      static const jlong REMOVED = -1;
+
+      class Entry{
+         public:
+            size_t bytes;
+            int site;
+            Entry(size_t _bytes, int _site): bytes(_bytes), site(_site){
+            }
+      };
+
+      const char* name;
+      Slot slots[CAPACITY];
+      Site sites[MAX_SITES];
+      volatile jlong liveCount;
+      volatile jlong liveBytes;
+      volatile jlong allocated;
+      volatile jlong unmatchedRemoves;   // removes of handles that were never added (or removed twice)
+      volatile jlong overflowed;         // entries in overflow
+      Mutex overflowLock;
+      std::map<const void*, Entry> overflow;
+
+      int getSite(const char* fileName, int line);
+      void removed(int site, size_t bytes);
+      void describe(std::string& out, const void* handle, size_t bytes, int site);
+};
+
+extern ResourceTracker commandQueueTracker;
+extern ResourceTracker memTracker;
+extern ResourceTracker readEventTracker;
+extern ResourceTracker executeEventTracker;
+extern ResourceTracker writeEventTracker;
+
+#endif // RESOURCE_TRACKER_H
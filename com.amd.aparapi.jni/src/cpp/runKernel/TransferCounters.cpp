@@ -0,0 +1,99 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "TransferCounters.h"
+
+#if defined (_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#endif
+
+TransferCounters::TransferCounters(){
+   for (int i = 0; i < COUNTERS; i++) {
+      counts[i] = 0;
+   }
+}
+
+const char* TransferCounters::reasonOf(Counter realloc) {
+   switch (realloc) {
+      case REALLOC_NEW_ARRAY:
+         return("new java array");
+      case REALLOC_MOVED:
+         return("array moved by GC");
+      case REALLOC_COPIED:
+         return("JNI pinned a copy");
+      case REALLOC_RESIZED:
+         return("array resized");
+      default:
+         return("");
+   }
+}
+
+TransferLog::TransferLog():
+   enabled(false){
+}
+
+void TransferLog::clear(bool enable) {
+   ScopedLock lock(mutex);
+   enabled = enable;
+   entries.clear();
+}
+
+void TransferLog::add(jint argIdx, const char* name, const char* decision, const char* reason, jlong bytes) {
+   if (!enabled) {
+      return;
+   }
+   Entry entry;
+   entry.argIdx = argIdx;
+   entry.name = name;
+   entry.decision = decision;
+   entry.reason = reason;
+   entry.bytes = bytes;
+   ScopedLock lock(mutex);
+   entries.push_back(entry);
+}
+
+void TransferLog::report(std::string& out) {
+   char line[256];
+   ScopedLock lock(mutex);
+   for (size_t i = 0; i < entries.size(); i++) {
+      const Entry& entry = entries[i];
+      snprintf(line, sizeof(line), "arg %d %s: %s (%s) %lld bytes\n", entry.argIdx, entry.name, entry.decision,
+            entry.reason, (long long)entry.bytes);
+      out += line;
+   }
+}
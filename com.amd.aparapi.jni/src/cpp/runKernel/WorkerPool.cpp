@@ -0,0 +1,188 @@
+/*
+   Copyright (c) 2010-2011, Advanced Micro Devices, Inc.
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+   following conditions are met:
+
+   Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+   disclaimer. 
+
+   Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided with the distribution. 
+
+   Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products
+   derived from this software without specific prior written permission. 
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+   WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   If you use the software (in whole or in part), you shall adhere to all applicable U.S., European, and other export
+   laws, including but not limited to the U.S. Export Administration Regulations ("EAR"), (15 C.F.R. Sections 730 
+   through 774), and E.U. Council Regulation (EC) No 1334/2000 of 22 June 2000.  Further, pursuant to Section 740.6 of
+   the EAR, you hereby certify that, except pursuant to a license granted by the United States Department of Commerce
+   Bureau of Industry and Security or as otherwise permitted pursuant to a License Exception under the U.S. Export 
+   Administration Regulations ("EAR"), you will not (1) export, re-export or release to a national of a country in 
+   Country Groups D:1, E:1 or E:2 any restricted technology, software, or source code you receive hereunder, or (2) 
+   export to Country Groups D:1, E:1 or E:2 the direct product of such technology or software, if such foreign produced
+   direct product is subject to national security controls as identified on the Commerce Control List (currently 
+   found in Supplement 1 to Part 774 of EAR).  For the most current Country Group listings, or for additional 
+   information about the EAR or your obligations under those regulations, please refer to the U.S. Bureau of Industry
+   and Security�s website at http://www.bis.doc.gov/. 
+   */
+
+#include "WorkerPool.h"
+#include "Mutex.h"
+
+#if defined (_WIN32)
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// guards the job, workers wait on workAvailable for work and callers on jobDone for completion
+static Mutex poolLock;
+static Condition workAvailable;
+static Condition jobDone;
+static JavaVM* jvm = NULL;
+static jint workerCount = -1;        // -1 until the pool is started
+
+// set without the lock by the caller which owns the pool, others run their jobs themselves
+static volatile jlong busy = 0;
+
+// the current job, guarded by poolLock
+static WorkerPool::Task task = NULL;
+static void* job = NULL;
+static jint count = 0;
+static jint next = 0;                // the next index to hand out
+static jint remaining = 0;           // indices handed out or not which have not completed
+
+/**
+ * take indices of the current job until none are left. Called with poolLock held, returns with it held.
+ */
+static void work(JNIEnv* jenv) {
+   while (task != NULL && next < count) {
+      WorkerPool::Task current = task;
+      void* currentJob = job;
+      jint index = next++;
+      poolLock.unlock();
+      current(jenv, currentJob, index);
+      poolLock.lock();
+      if (--remaining == 0) {
+         jobDone.signalAll();
+      }
+   }
+}
+
+#if defined (_WIN32)
+static unsigned __stdcall workerMain(void*) {
+#else
+static void* workerMain(void*) {
+#endif
+   JNIEnv* jenv = NULL;
+   if (jvm->AttachCurrentThreadAsDaemon((void**)&jenv, NULL) != JNI_OK) {
+      return 0;
+   }
+   // workers live as long as the process
+   ScopedLock lock(poolLock);
+   while (true) {
+      while (task == NULL || next >= count) {
+         workAvailable.wait(poolLock);
+      }
+      work(jenv);
+   }
+   return 0;
+}
+
+static jint processorCount() {
+#if defined (_WIN32)
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return (jint)info.dwNumberOfProcessors;
+#else
+   long processors = sysconf(_SC_NPROCESSORS_ONLN);
+   return (processors > 0) ? (jint)processors : 1;
+#endif
+}
+
+/**
+ * start the workers, called with poolLock held
+ */
+static void start(JNIEnv* jenv) {
+   jenv->GetJavaVM(&jvm);
+   jint threads = processorCount();
+   if (threads > WorkerPool::MAX_WORKERS) {
+      threads = WorkerPool::MAX_WORKERS;
+   }
+   workerCount = 0;
+   for (jint i = 0; i < threads - 1; i++) {
+#if defined (_WIN32)
+      HANDLE thread = (HANDLE)_beginthreadex(NULL, 0, workerMain, NULL, 0, NULL);
+      if (thread == 0) {
+         break;
+      }
+      CloseHandle(thread);
+#else
+      pthread_t thread;
+      if (pthread_create(&thread, NULL, workerMain, NULL) != 0) {
+         break;
+      }
+      pthread_detach(thread);
+#endif
+      workerCount++;
+   }
+}
+
+/**
+ * run task for every index in [0, count) across the pool and the calling thread, returning once all have completed.
+ * A caller which finds the pool serving another kernel runs its job alone rather than queueing behind it, 
+ * without taking the pool lock.
+ */
+void WorkerPool::run(JNIEnv* jenv, Task _task, void* _job, jint _count) {
+   bool owner = _count >= 2 && atomicCompareAndSwap(&busy, 0, 1);
+   bool alone = !owner;
+   if (owner) {
+      ScopedLock lock(poolLock);
+      if (workerCount < 0) {
+         start(jenv);
+      }
+      alone = workerCount == 0;
+      if (!alone) {
+         task = _task;
+         job = _job;
+         count = _count;
+         next = 0;
+         remaining = _count;
+         workAvailable.signalAll();
+
+         work(jenv);
+         while (remaining > 0) {
+            jobDone.wait(poolLock);
+         }
+         task = NULL;
+         job = NULL;
+      }
+   }
+   if (owner) {
+      // released after the lock, so the next owner sees the job cleared
+      busy = 0;
+   }
+   if (alone) {
+      for (jint i = 0; i < _count; i++) {
+         _task(jenv, _job, i);
+      }
+   }
+}
+
+/**
+ * @return the threads sharing a job, including the caller
+ */
+jint WorkerPool::getThreadCount() {
+   return (workerCount < 0) ? 1 : workerCount + 1;
+}
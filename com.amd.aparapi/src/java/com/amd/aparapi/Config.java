@@ -195,6 +195,19 @@ public class Config extends ConfigJNI{
          System.out.println(propPkgName + ".enableVerboseJNI{true|false}=" + enableVerboseJNI);
          System.out.println(propPkgName + ".enableVerboseJNIOpenCLResourceTracking{true|false}="
                + enableVerboseJNIOpenCLResourceTracking);
+         System.out.println(propPkgName + ".enableDeviceResidentBuffers{true|false}=" + enableDeviceResidentBuffers);
+         System.out.println(propPkgName + ".enableNUMAFission{true|false}=" + enableNUMAFission);
+         System.out.println(propPkgName + ".programCacheDir{<directory>}=" + programCacheDir);
+         System.out.println(propPkgName + ".maxCachedPrograms{<count>}=" + maxCachedPrograms);
+         System.out.println(propPkgName + ".enableLocalSizeTuning{true|false}=" + enableLocalSizeTuning);
+         System.out.println(propPkgName + ".localSizeTuningFile{<file>}=" + localSizeTuningFile);
+         System.out.println(propPkgName + ".localSizeTuningTrials{<count>}=" + localSizeTuningTrials);
+         System.out.println(propPkgName + ".enableZeroCopyCPU{true|false}=" + enableZeroCopyCPU);
+         System.out.println(propPkgName + ".profileFile{<file>}=" + profileFile);
+         System.out.println(propPkgName + ".enableDeviceTiming{true|false}=" + enableDeviceTiming);
+         System.out.println(propPkgName + ".enableTransferLog{true|false}=" + enableTransferLog);
+         System.out.println(propPkgName + ".profilingSampleInterval{<count>}=" + profilingSampleInterval);
+         System.out.println(propPkgName + ".profilingOverheadPercent{<percent>}=" + profilingOverheadPercent);
          System.out.println(propPkgName + ".enableShowGeneratedOpenCL{true|false}=" + enableShowGeneratedOpenCL);
          System.out.println(propPkgName + ".enableExecutionModeReporting{true|false}=" + enableExecutionModeReporting);
          System.out.println(propPkgName + ".enableInstructionDecodeViewer{true|false}=" + enableInstructionDecodeViewer);
@@ -48,9 +48,11 @@ import java.util.List;
 import java.util.Map;
 import java.util.concurrent.BrokenBarrierException;
 import java.util.concurrent.CyclicBarrier;
+import java.util.concurrent.Future;
 import java.util.logging.Logger;
 
 import com.amd.aparapi.annotation.Experimental;
+import com.amd.aparapi.device.OpenCLDevice;
 import com.amd.aparapi.exception.DeprecatedException;
 import com.amd.aparapi.internal.kernel.KernelRunner;
 import com.amd.aparapi.internal.model.ClassModel.ConstantPool.MethodReferenceEntry;
@@ -189,6 +191,56 @@ public abstract class Kernel implements Cloneable {
 
    }
 
+   /**
+    *  We can use this Annotation to 'tag' 2D arrays whose rows differ in length. 
+    *  
+    *  Without it every row is assumed to be as long as the first. A jagged array is packed row after row with no padding, 
+    *  along with a table of where each row starts, and the rows are copied back in place after the kernel runs.
+    *  <pre><code>
+    *  &#64Jagged int[][] neighbours = new int[][] { {1, 2}, {0}, {0, 1, 3}, {} };
+    *  </code></pre>
+    *  Only global 2D arrays of primitives may be jagged. 
+    */
+   @Retention(RetentionPolicy.RUNTIME)
+   public @interface Jagged {
+
+   }
+
+   /**
+    *  We can use this Annotation to 'tag' additional entrypoints of a kernel. 
+    *  
+    *  Tagged methods must, like <code>run()</code>, be <code>void</code> and take no arguments. They are compiled into the same 
+    *  OpenCL program as <code>run()</code> and are dispatched by name against the same buffers, so the phases of an 
+    *  algorithm do not need a kernel (and a copy of the data) each.
+    *  <pre><code>
+    *  &#64EntryPoint public void scale() { ... }
+    *  
+    *  kernel.setExplicit(true);
+    *  kernel.put(data).execute(range);            // run()
+    *  kernel.execute("scale", range).get(data);  // no upload between the two
+    *  </code></pre>
+    */
+   @Retention(RetentionPolicy.RUNTIME)
+   public @interface EntryPoint {
+
+   }
+
+   /**
+    *  We can use this Annotation to 'tag' arrays of which work item <code>i</code> only touches elements 
+    *  <code>[i*stride, (i+1)*stride)</code>.
+    *  
+    *  A chunked execution (see {@link #setExecutionChunks(int)}) then only transfers the slice of each chunk, and an execution 
+    *  split across devices (see {@link #setExecutionDevices(OpenCLDevice...)}) reads each output back by the same slices, so it 
+    *  only splits when every array the kernel writes is tagged.
+    *  <pre><code>
+    *  &#64Chunked(stride = 2) float[] xy = new float[size * 2];
+    *  </code></pre>
+    */
+   @Retention(RetentionPolicy.RUNTIME)
+   public @interface Chunked {
+      int stride() default 1;
+   }
+
    /**
     *  We can use this suffix to 'tag' intended local buffers. 
     *  
@@ -1985,6 +2037,53 @@ public abstract class Kernel implements Cloneable {
       return (kernelRunner.execute(_entrypoint, _range, _passes));
    }
 
+   /**
+    * Start execution of <code>_range</code> kernels without waiting for them to complete.
+    * <p>
+    * When the execution mode is <code>CPU</code> or <code>GPU</code> the transfers and the execution are enqueued and this method
+    * returns straight away. The returned <code>Future</code> completes once the results have been copied back into the kernel's 
+    * arrays, the arrays should not be accessed before then. Any later call on this kernel (<code>execute()</code>, <code>get()</code>,
+    * <code>dispose()</code> etc) waits for the pending execution first.
+    * <p>
+    * Other execution modes run to completion before this method returns.
+    * 
+    * @param _range The range of Kernels that we would like to initiate.
+    * @return A future which yields this Kernel once the execution has completed
+    */
+   public synchronized Future<Kernel> executeAsync(Range _range) {
+      return (executeAsync("run", _range, 1));
+   }
+
+   /**
+    * Start execution of <code>_passes</code> iterations of <code>_range</code> kernels without waiting for them to complete.
+    * 
+    * @param _range The range of Kernels that we would like to initiate.
+    * @param _passes The number of passes to make
+    * @return A future which yields this Kernel once the execution has completed
+    * @see #executeAsync(Range)
+    */
+   public synchronized Future<Kernel> executeAsync(Range _range, int _passes) {
+      return (executeAsync("run", _range, _passes));
+   }
+
+   /**
+    * Start execution of <code>_passes</code> iterations over the <code>_range</code> of kernels for the given entrypoint without
+    * waiting for them to complete.
+    * 
+    * @param _entrypoint is the name of the method we wish to use as the entrypoint to the kernel
+    * @param _range The range of Kernels that we would like to initiate.
+    * @param _passes The number of passes to make
+    * @return A future which yields this Kernel once the execution has completed
+    * @see #executeAsync(Range)
+    */
+   public synchronized Future<Kernel> executeAsync(String _entrypoint, Range _range, int _passes) {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner.executeAsync(_entrypoint, _range, _passes));
+   }
+
    /**
     * Release any resources associated with this Kernel.
     * <p>
@@ -2000,6 +2099,17 @@ public abstract class Kernel implements Cloneable {
       }
    }
 
+   /**
+    * @return the runner which executes this kernel, shared with any <code>KernelGraph</code> the kernel is a node of
+    */
+   synchronized KernelRunner getKernelRunner() {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner);
+   }
+
    /**
     * Return the current execution mode.  
     * 
@@ -2184,6 +2294,81 @@ public abstract class Kernel implements Cloneable {
       return (kernelRunner.isExplicit());
    }
 
+   /**
+    * Request that OpenCL executions of this Kernel split a 1D global range into <code>_chunks</code> chunks, so that the transfers 
+    * of arrays annotated with {@link Chunked} overlap with execution of the neighbouring chunks.
+    * 
+    * Values less than 2 disable chunking. Multi pass and multi dimensional executions are never chunked, nor are kernels 
+    * which call {@link #getGlobalSize()}, {@link #getNumGroups()} or {@link #getGroupId()}, as each chunk would see its own 
+    * global size, group count and group ids rather than those of the whole range.
+    * @param _chunks the number of chunks to split the global range into
+    */
+   public void setExecutionChunks(int _chunks) {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      kernelRunner.setExecutionChunks(_chunks);
+   }
+
+   /**
+    * @return the number of chunks OpenCL executions of this Kernel are split into
+    */
+   public int getExecutionChunks() {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner.getExecutionChunks());
+   }
+
+   /**
+    * Request that OpenCL executions of this Kernel split a 1D global range across several devices, each running a share 
+    * of the work groups with its own copy of the buffers. Outputs are merged back into the Java arrays by the slice each
+    * device's work items write, so every array the kernel writes must be annotated with {@link Chunked}.
+    * <p>
+    * Multi pass, multi dimensional and explicit executions, and those writing an array which is not chunked, run on the first device only. Must be called before the first execution.
+    * So do kernels which call {@link #getGlobalSize()}, {@link #getNumGroups()} or {@link #getGroupId()}, as each device would see 
+    * the global size, group count and group ids of its own share rather than those of the whole range.
+    * 
+    * @param _devices the devices to split executions across, the first replaces the device of the range
+    */
+   public void setExecutionDevices(OpenCLDevice... _devices) {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      kernelRunner.setExecutionDevices(_devices);
+   }
+
+   /**
+    * Set the share of the range given to each of the devices passed to {@link #setExecutionDevices(OpenCLDevice...)}.
+    * By default each device's share is proportional to its compute unit count.
+    * 
+    * @param _weights one relative weight per execution device
+    */
+   public void setExecutionDeviceWeights(float... _weights) {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      kernelRunner.setExecutionDeviceWeights(_weights);
+   }
+
+   /**
+    * Rebalance the execution device weights after each split execution from the execute time measured on each device.
+    * Requires profiling to be enabled with <code>-Dcom.amd.aparapi.enableProfiling=true</code>.
+    * 
+    * @param _dynamicRebalancing true to adjust the weights after each execution
+    */
+   public void setDynamicRebalancing(boolean _dynamicRebalancing) {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      kernelRunner.setDynamicRebalancing(_dynamicRebalancing);
+   }
+
    /**
     * Tag this array so that it is explicitly enqueued before the kernel is executed
     * @param array
@@ -2795,6 +2980,69 @@ public abstract class Kernel implements Cloneable {
       return (this);
    }
 
+   /**
+    * Report the OpenCL buffers, queues and events currently held by all kernels: how many of each type are live, 
+    * how many bytes the buffers hold and which native source lines allocated them. Useful to find resources leaked
+    * by kernels which are never disposed.
+    * 
+    * @return the report, empty if OpenCL is not available
+    */
+   public String getOpenCLResourceReport() {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner.getOpenCLResourceReport());
+   }
+
+   /**
+    * Read the latency histograms kept for this kernel since they were last read, then reset them. Cheap enough to
+    * poll from production code, e.g. to check a p99 objective.
+    * <p>
+    * End to end latency and bytes moved are always recorded. Device execute, upload and readback times need event
+    * timestamps, set -Dcom.amd.aparapi.enableDeviceTiming=true (profiling also gives them).
+    * 
+    * @return a summary of each LatencySummary.METRIC, empty if the kernel has not run on an OpenCL device
+    */
+   public List<LatencySummary> getLatencySummaries() {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner.getLatencySummaries());
+   }
+
+   /**
+    * Read the transfer counters of this kernel: OpenCL buffers created, released and recreated (by cause), bytes
+    * moved each way, explicit and implicit transfers, and the time java arrays were held in JNI critical sections.
+    * 
+    * @return counts since the kernel was first executed on an OpenCL device, all zero before then
+    */
+   public TransferCounters getTransferCounters() {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner.getTransferCounters());
+   }
+
+   /**
+    * Describe what the last execution did with each array and buffer arg, whether its OpenCL buffer was created or
+    * reused and whether it was uploaded and read back, each with the reason. Explicit put() and get() calls since
+    * then are included.
+    * <p>
+    * The log is only kept with -Dcom.amd.aparapi.enableTransferLog=true.
+    * 
+    * @return one line per decision, empty if the log is off or the kernel has not run on an OpenCL device
+    */
+   public String getTransferLog() {
+      if (kernelRunner == null) {
+         kernelRunner = new KernelRunner(this);
+      }
+
+      return (kernelRunner.getTransferLog());
+   }
+
    /**
     * Get the profiling information from the last successful call to Kernel.execute().
     * @return A list of ProfileInfo records
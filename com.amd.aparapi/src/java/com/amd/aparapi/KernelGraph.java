@@ -0,0 +1,111 @@
+package com.amd.aparapi;
+
+import com.amd.aparapi.internal.kernel.KernelGraphRunner;
+
+/**
+ * A chain of kernel executions which run as one dependency graph on an OpenCL device.
+ * <p>
+ * Nodes are added in the order they would be executed one by one. When the graph runs, each node only waits for
+ * the nodes which write the arrays it reads (or read the arrays it writes), and arrays shared between nodes are
+ * kept in one device buffer instead of being copied back to the host after every node and written again before the
+ * next.
+ * <ul>
+ * <li>Arrays declared with <code>input()</code> are copied to the device at the start of every run.</li>
+ * <li>Arrays declared with <code>output()</code> are copied back to the host at the end of every run.</li>
+ * <li>Any other array is copied to the device once, when the graph first sees it, and then stays there.</li>
+ * </ul>
+ * <blockquote><pre>
+ * KernelGraph graph = new KernelGraph();
+ * graph.add(blur, range).add(gradient, range).add(threshold, range);
+ * graph.input(image).output(edges);
+ * graph.run();
+ * </pre></blockquote>
+ * The first run executes the nodes in turn, which builds each kernel. All nodes must then run on the same OpenCL
+ * device for the graph to run natively, otherwise the nodes continue to be executed in turn. Dispose the graph before
+ * disposing its kernels.
+ */
+public class KernelGraph{
+
+   private final KernelGraphRunner graphRunner = new KernelGraphRunner();
+
+   /**
+    * Add a node executing <code>run()</code> of a kernel.
+    *
+    * @return this graph so nodes can be chained
+    */
+   public KernelGraph add(Kernel _kernel, Range _range) {
+      return (add(_kernel, "run", _range, 1));
+   }
+
+   /**
+    * Add a node executing an entrypoint of a kernel.
+    *
+    * @param _entrypoint <code>run</code> or a method tagged with <code>&#64;Kernel.EntryPoint</code>
+    * @return this graph so nodes can be chained
+    */
+   public KernelGraph add(Kernel _kernel, String _entrypoint, Range _range) {
+      return (add(_kernel, _entrypoint, _range, 1));
+   }
+
+   /**
+    * Add a node executing an entrypoint of a kernel for a number of passes.
+    *
+    * @param _entrypoint <code>run</code> or a method tagged with <code>&#64;Kernel.EntryPoint</code>
+    * @return this graph so nodes can be chained
+    */
+   public KernelGraph add(Kernel _kernel, String _entrypoint, Range _range, int _passes) {
+      if ((_kernel == null) || (_range == null)) {
+         throw new IllegalArgumentException("graph nodes need a kernel and a range");
+      }
+      graphRunner.addNode(_kernel, _kernel.getKernelRunner(), _entrypoint, _range, _passes);
+      return (this);
+   }
+
+   /**
+    * Declare arrays the host changes between runs, they are copied to the device at the start of every run.
+    *
+    * @return this graph
+    */
+   public KernelGraph input(Object... _arrays) {
+      for (final Object array : _arrays) {
+         graphRunner.addInput(array);
+      }
+      return (this);
+   }
+
+   /**
+    * Declare arrays the host reads after a run, they are copied back from the device at the end of every run.
+    *
+    * @return this graph
+    */
+   public KernelGraph output(Object... _arrays) {
+      for (final Object array : _arrays) {
+         graphRunner.addOutput(array);
+      }
+      return (this);
+   }
+
+   /**
+    * Run every node of the graph and wait for the outputs to be copied back.
+    *
+    * @return this graph
+    */
+   public KernelGraph run() {
+      graphRunner.run();
+      return (this);
+   }
+
+   /**
+    * @return true if runs after the first execute as one OpenCL graph, false if the nodes are executed in turn
+    */
+   public boolean isNative() {
+      return (graphRunner.isNative());
+   }
+
+   /**
+    * Release the device buffers and kernels held by the graph, the kernels of the nodes are not disposed.
+    */
+   public void dispose() {
+      graphRunner.dispose();
+   }
+}
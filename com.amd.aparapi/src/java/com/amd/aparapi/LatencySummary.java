@@ -0,0 +1,111 @@
+package com.amd.aparapi;
+
+/**
+ * The distribution of one latency or size metric over the executions of a kernel since its histograms were last read.
+ * <p>
+ * The native layer keeps a fixed size HDR style histogram per metric, so percentiles are accurate to within about
+ * 3% of their value; count, max and total are exact. Times are nanoseconds and sizes are bytes.
+ * 
+ * @see Kernel#getLatencySummaries()
+ */
+public class LatencySummary{
+
+   /**
+    * The metrics, in the order the native layer reports them.
+    */
+   public enum METRIC {
+      /** From the call into the native layer until the results are back in the java arrays */
+      RUN_NANOS,
+      /** Device time of the execute commands of a run, only with device timing enabled */
+      EXECUTE_NANOS,
+      /** Device time of the uploads of a run, only with device timing enabled */
+      UPLOAD_NANOS,
+      UPLOAD_BYTES,
+      /** Device time of the readbacks of a run, only with device timing enabled */
+      READBACK_NANOS,
+      READBACK_BYTES
+   }
+
+   /**
+    * The number of values the native layer reports for each metric.
+    */
+   public static final int FIELDS = 6;
+
+   private final METRIC metric;
+
+   private final long count;
+
+   private final long p50;
+
+   private final long p90;
+
+   private final long p99;
+
+   private final long max;
+
+   private final long total;
+
+   public LatencySummary(METRIC _metric, long _count, long _p50, long _p90, long _p99, long _max, long _total) {
+      metric = _metric;
+      count = _count;
+      p50 = _p50;
+      p90 = _p90;
+      p99 = _p99;
+      max = _max;
+      total = _total;
+   }
+
+   public METRIC getMetric() {
+      return (metric);
+   }
+
+   /**
+    * @return the number of runs recorded
+    */
+   public long getCount() {
+      return (count);
+   }
+
+   public long getP50() {
+      return (p50);
+   }
+
+   public long getP90() {
+      return (p90);
+   }
+
+   public long getP99() {
+      return (p99);
+   }
+
+   public long getMax() {
+      return (max);
+   }
+
+   /**
+    * @return the sum of every value recorded
+    */
+   public long getTotal() {
+      return (total);
+   }
+
+   @Override public String toString() {
+      final StringBuilder sb = new StringBuilder();
+      sb.append("LatencySummary[");
+      sb.append(metric);
+      sb.append(" count=");
+      sb.append(count);
+      sb.append(", p50=");
+      sb.append(p50);
+      sb.append(", p90=");
+      sb.append(p90);
+      sb.append(", p99=");
+      sb.append(p99);
+      sb.append(", max=");
+      sb.append(max);
+      sb.append(", total=");
+      sb.append(total);
+      sb.append("]");
+      return sb.toString();
+   }
+}
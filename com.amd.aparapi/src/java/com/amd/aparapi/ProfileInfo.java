@@ -42,8 +42,9 @@ public class ProfileInfo{
    private enum TYPE {
       R,
       X,
-      W
-   }; // 0 = write, 1 = execute, 2 = read
+      W,
+      H
+   }; // 0 = read, 1 = execute, 2 = write, 3 = host phase (labelled with the phase, on the same clock as the events)
 
    private final TYPE type;
 
@@ -57,6 +58,8 @@ public class ProfileInfo{
 
    private final long queued;
 
+   private final int sampleInterval;
+
    /**
     * Minimal constructor
     * 
@@ -68,12 +71,20 @@ public class ProfileInfo{
     * @param _queued
     */
    public ProfileInfo(String _label, int _type, long _start, long _end, long _submit, long _queued) {
+      this(_label, _type, _start, _end, _submit, _queued, 1);
+   }
+
+   /**
+    * @param _sampleInterval the number of runs the profiled run stands for, see -Dcom.amd.aparapi.profilingSampleInterval
+    */
+   public ProfileInfo(String _label, int _type, long _start, long _end, long _submit, long _queued, int _sampleInterval) {
       type = TYPE.values()[_type];
       label = _label == null ? "exec()" : _label;
       start = _start;
       end = _end;
       submit = _submit;
       queued = _queued;
+      sampleInterval = _sampleInterval;
    }
 
    public long getStart() {
@@ -100,6 +111,14 @@ public class ProfileInfo{
       return (type);
    }
 
+   /**
+    * When profiling is sampled only one run in this many is profiled, so weight this profile by it when totalling
+    * profiles over many runs. 1 when every run is profiled.
+    */
+   public int getSampleInterval() {
+      return (sampleInterval);
+   }
+
    @Override public String toString() {
       final StringBuilder sb = new StringBuilder();
       sb.append("ProfileInfo[");
@@ -116,6 +135,10 @@ public class ProfileInfo{
       sb.append(queued);
       sb.append(", duration=");
       sb.append((end - start));
+      if (sampleInterval > 1) {
+         sb.append(", 1 in ");
+         sb.append(sampleInterval);
+      }
       sb.append("]");
 
       return sb.toString();
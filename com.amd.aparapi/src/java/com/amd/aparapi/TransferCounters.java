@@ -0,0 +1,73 @@
+package com.amd.aparapi;
+
+/**
+ * What the native layer has done with the buffers of a kernel since its first OpenCL execution: how many OpenCL
+ * buffers it created and released and why it had to create them again, and how many bytes it moved each way.
+ * <p>
+ * The counters are always kept and never reset, take the difference of two snapshots to cover an interval.
+ * 
+ * @see Kernel#getTransferCounters()
+ */
+public class TransferCounters{
+
+   /**
+    * The counters, in the order the native layer reports them.
+    */
+   public enum COUNTER {
+      BUFFERS_CREATED,
+      BUFFERS_RELEASED,
+      /** A buffer recreated because the kernel field was set to another array */
+      REALLOC_NEW_ARRAY,
+      /** A buffer recreated because the garbage collector moved the array */
+      REALLOC_MOVED,
+      /** A buffer recreated because the JVM could only give us a copy of the array */
+      REALLOC_COPIED,
+      /** A buffer recreated because a multi dimension array changed shape */
+      REALLOC_RESIZED,
+      BYTES_UPLOADED,
+      BYTES_DOWNLOADED,
+      /** Transfers asked for with Kernel.put() and Kernel.get() */
+      EXPLICIT_TRANSFERS,
+      /** Transfers of the arrays the kernel reads or writes, made for each execution */
+      IMPLICIT_TRANSFERS,
+      /** The time java arrays have been held in JNI critical sections, which holds off the garbage collector */
+      CRITICAL_NANOS
+   }
+
+   private final long[] values;
+
+   public TransferCounters(long[] _values) {
+      values = new long[COUNTER.values().length];
+      System.arraycopy(_values, 0, values, 0, Math.min(_values.length, values.length));
+   }
+
+   public long get(COUNTER _counter) {
+      return (values[_counter.ordinal()]);
+   }
+
+   /**
+    * @return the counts since an earlier snapshot of the same kernel
+    */
+   public TransferCounters since(TransferCounters _earlier) {
+      final long[] difference = new long[values.length];
+      for (int i = 0; i < values.length; i++) {
+         difference[i] = values[i] - _earlier.values[i];
+      }
+      return (new TransferCounters(difference));
+   }
+
+   @Override public String toString() {
+      final StringBuilder sb = new StringBuilder();
+      sb.append("TransferCounters[");
+      for (final COUNTER counter : COUNTER.values()) {
+         if (counter.ordinal() > 0) {
+            sb.append(", ");
+         }
+         sb.append(counter);
+         sb.append("=");
+         sb.append(values[counter.ordinal()]);
+      }
+      sb.append("]");
+      return sb.toString();
+   }
+}
@@ -38,9 +38,10 @@ public abstract class ConfigJNI{
    @UsedByJNICode public static final boolean enableVerboseJNI = Boolean.getBoolean(propPkgName + ".enableVerboseJNI");
 
    /**
-    * Allows the user to request tracking of opencl resources.
+    * Allows the user to request verbose tracking of opencl resources.
     * 
-    * This is really a debugging option to help locate leaking OpenCL resources, this will be dumped to stderr.
+    * OpenCL resources are always tracked, see <code>Kernel.getOpenCLResourceReport()</code>. This is a debugging option 
+    * which also dumps the report to stderr when a kernel is disposed and warns about releases of untracked resources.
     * 
     * Usage -Dcom.amd.aparapi.enableOpenCLResourceTracking={true|false}
     * 
@@ -48,4 +49,145 @@ public abstract class ConfigJNI{
    @UsedByJNICode public static final boolean enableVerboseJNIOpenCLResourceTracking = Boolean.getBoolean(propPkgName
          + ".enableVerboseJNIOpenCLResourceTracking");
 
+   /**
+    * Allows the user to request that array args are held in device resident buffers.
+    * 
+    * Each array arg then owns a CL_MEM_ALLOC_HOST_PTR buffer for the lifetime of the kernel and the Java array is only pinned 
+    * whilst it is being copied to or from that buffer, so GC moves no longer force the OpenCL buffer to be recreated.
+    * 
+    * Usage -Dcom.amd.aparapi.enableDeviceResidentBuffers={true|false}
+    * 
+    */
+   @UsedByJNICode public static final boolean enableDeviceResidentBuffers = Boolean.getBoolean(propPkgName
+         + ".enableDeviceResidentBuffers");
+
+   /**
+    * Allows the user to request that CPU OpenCL devices are split into one sub device per NUMA node.
+    * 
+    * Executions are then run as one sub range per node, and the buffers each node works on are first touched by that node
+    * so that their storage is allocated in its local memory. Needs an OpenCL 1.2 CPU device.
+    * 
+    * Usage -Dcom.amd.aparapi.enableNUMAFission={true|false}
+    * 
+    */
+   @UsedByJNICode public static final boolean enableNUMAFission = Boolean.getBoolean(propPkgName + ".enableNUMAFission");
+
+   /**
+    * Allows the user to name a directory in which built OpenCL program binaries are cached between runs.
+    * 
+    * Programs are keyed by their source and the device, driver and platform they were built for. The directory may be
+    * shared by several JVMs. Unset (the default) disables the cache.
+    * 
+    * Usage -Dcom.amd.aparapi.programCacheDir=<directory>
+    * 
+    */
+   @UsedByJNICode public static final String programCacheDir = System.getProperty(propPkgName + ".programCacheDir");
+
+   /**
+    * Allows the user to bound the number of built programs kept in memory for reuse by later kernels on the same device.
+    * 
+    * Programs in use are never evicted, unused programs are released least recently used first.
+    * 
+    * Usage -Dcom.amd.aparapi.maxCachedPrograms=<count> (default 64)
+    * 
+    */
+   @UsedByJNICode public static final int maxCachedPrograms = Integer.getInteger(propPkgName + ".maxCachedPrograms", 64);
+
+   /**
+    * Allows the user to request that the local size of 1D executions is tuned for each kernel and device.
+    * 
+    * Only ranges whose local size was derived by Aparapi are tuned, and only for kernels which don't use local memory,
+    * barriers or local/group ids. The first executions of each kernel try multiples of the device's preferred work
+    * group size multiple (and the driver's own choice), the fastest is then used for every later execution over a
+    * similar global size.
+    * 
+    * Usage -Dcom.amd.aparapi.enableLocalSizeTuning={true|false}
+    * 
+    */
+   @UsedByJNICode public static final boolean enableLocalSizeTuning = Boolean.getBoolean(propPkgName + ".enableLocalSizeTuning");
+
+   /**
+    * Allows the user to name a file in which tuned local sizes are kept between runs.
+    * 
+    * Unset (the default) keeps tuned local sizes for the life of the JVM only.
+    * 
+    * Usage -Dcom.amd.aparapi.localSizeTuningFile=<file>
+    * 
+    */
+   @UsedByJNICode public static final String localSizeTuningFile = System.getProperty(propPkgName + ".localSizeTuningFile");
+
+   /**
+    * Allows the user to set how many executions time each candidate local size, the fastest of these is kept.
+    * 
+    * Usage -Dcom.amd.aparapi.localSizeTuningTrials=<count> (default 2)
+    * 
+    */
+   @UsedByJNICode public static final int localSizeTuningTrials = Integer.getInteger(propPkgName + ".localSizeTuningTrials", 2);
+
+   /**
+    * Allows the user to request that every array used by a kernel on a CPU OpenCL device is held in a buffer allocated
+    * by the OpenCL runtime.
+    * 
+    * The java arrays are copied into these buffers through a map before an execution and out of them after, so an
+    * execution makes at most one copy each way and the runtime never shadows the java heap. The arrays are not pinned
+    * while the kernel runs.
+    * 
+    * Usage -Dcom.amd.aparapi.enableZeroCopyCPU={true|false}
+    * 
+    */
+   @UsedByJNICode public static final boolean enableZeroCopyCPU = Boolean.getBoolean(propPkgName + ".enableZeroCopyCPU");
+
+   /**
+    * Allows the user to name a file to which the write, execute and read events of every kernel are recorded.
+    * 
+    * Setting this also enables OpenCL profiling. The file is binary, convert it for chrome://tracing or Perfetto with
+    * com.amd.aparapi.internal.tool.ProfileTraceConverter. Unset (the default) records nothing.
+    * 
+    * Usage -Dcom.amd.aparapi.profileFile=<file>
+    * 
+    */
+   @UsedByJNICode public static final String profileFile = System.getProperty(propPkgName + ".profileFile");
+
+   /**
+    * Allows the user to request event timestamps from every command queue, so the latency histograms of each kernel
+    * (see Kernel.getLatencySummaries()) include device execute, upload and readback times.
+    * 
+    * This costs far less than enableProfiling, no ProfileInfo is collected. Without it only the end to end latency
+    * and the bytes moved are recorded, unless profiling or local size tuning already gives the timestamps.
+    * 
+    * Usage -Dcom.amd.aparapi.enableDeviceTiming={true|false}
+    * 
+    */
+   @UsedByJNICode public static final boolean enableDeviceTiming = Boolean.getBoolean(propPkgName + ".enableDeviceTiming");
+
+   /**
+    * Allows the user to request a log of what each run did with every buffer arg, whether its OpenCL buffer was
+    * created or reused and whether it was written and read back, with the reason (see Kernel.getTransferLog()).
+    * 
+    * The transfer counters (Kernel.getTransferCounters()) are kept whether or not this is set.
+    * 
+    * Usage -Dcom.amd.aparapi.enableTransferLog={true|false}
+    * 
+    */
+   @UsedByJNICode public static final boolean enableTransferLog = Boolean.getBoolean(propPkgName + ".enableTransferLog");
+
+   /**
+    * Allows the user to profile only one run in every N of each kernel when profiling is enabled, to bound its cost.
+    * Events of the other runs are not queried, ProfileInfo.getSampleInterval() tells how many runs a profile stands for.
+    * 
+    * Usage -Dcom.amd.aparapi.profilingSampleInterval=<N> (default 1, every run)
+    * 
+    */
+   @UsedByJNICode public static final int profilingSampleInterval = Integer.getInteger(propPkgName + ".profilingSampleInterval", 1);
+
+   /**
+    * Allows the user to give profiling an overhead budget instead of a fixed interval. Each kernel profiles fewer runs
+    * until the extra time of its profiled runs is at most this percentage of its run time, and never more often than
+    * profilingSampleInterval. 0 (the default) keeps the fixed interval.
+    * 
+    * Usage -Dcom.amd.aparapi.profilingOverheadPercent=<percent>
+    * 
+    */
+   @UsedByJNICode public static final int profilingOverheadPercent = Integer.getInteger(propPkgName + ".profilingOverheadPercent", 0);
+
 }
@@ -74,6 +74,11 @@ public abstract class KernelArgJNI{
     */
    @UsedByJNICode protected int[] dims;
 
+   /**
+    * If this array is tagged ARG_CHUNKED then the number of elements touched by each work item is stored here
+    */
+   @UsedByJNICode protected int chunkStride;
+
    /**
     * If this is an array buffer then the number of elements is stored here.
     * 
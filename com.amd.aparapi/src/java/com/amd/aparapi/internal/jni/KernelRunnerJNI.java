@@ -1,5 +1,6 @@
 package com.amd.aparapi.internal.jni;
 
+import java.nio.ByteBuffer;
 import java.util.List;
 
 import com.amd.aparapi.Kernel;
@@ -9,6 +10,7 @@ import com.amd.aparapi.annotation.Experimental;
 import com.amd.aparapi.device.OpenCLDevice;
 import com.amd.aparapi.internal.annotation.DocMe;
 import com.amd.aparapi.internal.annotation.UsedByJNICode;
+import com.amd.aparapi.internal.util.CompletionFuture;
 
 /**
  * This class is intended to be used as a 'proxy' or 'facade' object for Java code to interact with JNI
@@ -207,6 +209,24 @@ public abstract class KernelRunnerJNI{
     */
    @UsedByJNICode protected static final int ARG_OBJ_ARRAY_STRUCT = 1 << 18;
 
+   /**
+    * This 'bit' indicates that a particular <code>KernelArg</code> has a declared access pattern (work item i touches 
+    * elements [i*chunkStride, (i+1)*chunkStride)) so it can be transferred chunk by chunk.
+    * 
+    * @see com.amd.aparapi.Kernel.Chunked
+    * @see com.amd.aparapi.internal.annotation.UsedByJNICode
+    */
+   @UsedByJNICode protected static final int ARG_CHUNKED = 1 << 19;
+
+   /**
+    * This 'bit' indicates that a particular <code>KernelArg</code> is a 2D array whose rows may differ in length, so it is
+    * packed row after row with a table of where each row starts.
+    * 
+    * @see com.amd.aparapi.Kernel.Jagged
+    * @see com.amd.aparapi.internal.annotation.UsedByJNICode
+    */
+   @UsedByJNICode protected static final int ARG_JAGGED = 1 << 20;
+
 
    /**
     * This 'bit' indicates that a particular <code>KernelArg</code> represents a <code>char</code> type (array or primitive).
@@ -276,6 +296,42 @@ public abstract class KernelRunnerJNI{
     */
    //  @UsedByJNICode @Annotations.Experimental protected static final int JNI_FLAG_ENABLE_VERBOSE_JNI_OPENCL_RESOURCE_TRACKING = 1 << 4;
 
+   /**
+    * Byte offsets into the direct buffer holding the state of every arg and of the range, written by
+    * <code>KernelRunner</code> before each execution so the JNI code reads it as a struct instead of fetching fields.<br/>
+    * A header describing the range is followed by one record per arg.
+    * 
+    * @see com.amd.aparapi.internal.annotation.UsedByJNICode
+    */
+   @UsedByJNICode protected static final int STATE_HEADER_SIZE = 32;
+
+   @UsedByJNICode protected static final int STATE_RANGE_DIMS = 0;
+
+   @UsedByJNICode protected static final int STATE_RANGE_LOCAL_IS_DERIVED = 4;
+
+   /**
+    * Three ints, one per dimension.
+    */
+   @UsedByJNICode protected static final int STATE_RANGE_GLOBAL_SIZE = 8;
+
+   /**
+    * Three ints, one per dimension.
+    */
+   @UsedByJNICode protected static final int STATE_RANGE_LOCAL_SIZE = 20;
+
+   @UsedByJNICode protected static final int STATE_ARG_SIZE = 32;
+
+   @UsedByJNICode protected static final int STATE_ARG_TYPE = 0;
+
+   @UsedByJNICode protected static final int STATE_ARG_SIZE_IN_BYTES = 4;
+
+   @UsedByJNICode protected static final int STATE_ARG_NUM_ELEMENTS = 8;
+
+   /**
+    * 8 byte aligned slot holding the value of a primitive arg in its own type.
+    */
+   @UsedByJNICode protected static final int STATE_ARG_VALUE = 16;
+
    /*
     * Native methods
     */
@@ -298,15 +354,98 @@ public abstract class KernelRunnerJNI{
 
    protected native long buildProgramJNI(long _jniContextHandle, String _source);
 
-   protected native int setArgsJNI(long _jniContextHandle, KernelArgJNI[] _args, int argc);
+   /**
+    * @param _state direct buffer in native order laid out as described by the <code>STATE_</code> offsets, may be null in
+    *           which case the JNI code reads the fields of the args and range
+    */
+   protected native int setArgsJNI(long _jniContextHandle, KernelArgJNI[] _args, int argc, ByteBuffer _state);
 
    protected native int runKernelJNI(long _jniContextHandle, Range _range, boolean _needSync, int _passes);
    
+   protected native int runKernelChunkedJNI(long _jniContextHandle, Range _range, boolean _needSync, int _passes, int _chunks);
+
+   /**
+    * Enqueue an execution without waiting for it to complete. <code>_future</code> is completed from an OpenCL event
+    * callback once the results have been copied back into the Java arrays.
+    * 
+    * @return 0 if the execution was enqueued, otherwise the future will never be completed
+    */
+   protected native int runKernelAsyncJNI(long _jniContextHandle, Range _range, boolean _needSync, int _passes,
+         CompletionFuture<?> _future);
+
+   /**
+    * Run one execution split across several contexts created by <code>initJNI()</code> for different devices with the
+    * same source and args. Device <code>i</code> runs <code>_counts[i]</code> work items starting at global id
+    * <code>_offsets[i]</code> (relative to the range offset), writing back only the slices of the output arrays its work
+    * items own. Executions which can't be split run whole on the first context.
+    */
+   protected native int runKernelMultiJNI(long[] _jniContextHandles, Range _range, boolean _needSync, int _passes,
+         int[] _offsets, int[] _counts);
+
+   /**
+    * @return the profiled execute time (ns) of the last pass of the last execution, or -1 if profiling is disabled
+    */
+   protected native long getExecutionTimeJNI(long _jniContextHandle);
+
+   /**
+    * @return the status of an async execution whose callback could not complete its future, otherwise 0
+    */
+   protected native int getAsyncFailureJNI(long _jniContextHandle);
+
+   /**
+    * Run one of the other entrypoints built into the program by <code>buildProgramJNI()</code>. All entrypoints share
+    * the args (and so the buffers) of the context.
+    * 
+    * @return 0 on success, non zero if the execution failed or <code>_kernel</code> is not an entrypoint of the program
+    */
    protected native int runKernelNameJNI(long _jniContextHandle, String _kernel, Range _range, boolean _needSync, int _passes);
 
+   /**
+    * Create a graph running the given entrypoint of each context in turn. All contexts must have been built on the same
+    * device.
+    * 
+    * @return a handle for <code>runGraphJNI()</code>, or 0 if the contexts can't be run as one graph
+    */
+   protected native long createGraphJNI(long[] _jniContextHandles, String[] _entrypoints);
+
+   /**
+    * Run every node of a graph, each node waits only for the nodes producing or consuming the arrays it touches.
+    * Arrays keep a device buffer for the life of the graph. <code>_inputs</code> are copied in on every run, other
+    * arrays only when the graph first sees them, and only <code>_outputs</code> are copied back.
+    * 
+    * @return 0 once the whole graph has completed, otherwise the OpenCL error status
+    */
+   protected native int runGraphJNI(long _graphHandle, Range[] _ranges, int[] _passes, Object[] _inputs, Object[] _outputs);
+
+   protected native int disposeGraphJNI(long _graphHandle);
+
    protected native int disposeJNI(long _jniContextHandle);
 
    protected native String getExtensionsJNI(long _jniContextHandle);
 
+   /**
+    * @return the live OpenCL buffers, queues and events of every kernel, with the source lines which created them
+    */
+   protected native String getResourceReportJNI();
+
+   /**
+    * Read and reset the latency histograms of a kernel, merging those of its device contexts.
+    * 
+    * @return count, p50, p90, p99, max and total of each LatencySummary.METRIC in turn
+    */
+   protected native long[] getLatencyJNI(long[] _jniContextHandles);
+
+   /**
+    * Read the transfer counters of a kernel, summed over its device contexts.
+    * 
+    * @return the value of each TransferCounters.COUNTER in turn
+    */
+   protected native long[] getTransferCountersJNI(long[] _jniContextHandles);
+
+   /**
+    * @return the transfer log of the last run of each device context of a kernel, one line per entry
+    */
+   protected native String getTransferLogJNI(long[] _jniContextHandles);
+
    protected native synchronized List<ProfileInfo> getProfileInfoJNI(long _jniContextHandle);
 }
@@ -9,6 +9,7 @@ import com.amd.aparapi.internal.opencl.OpenCLKernel;
 import com.amd.aparapi.internal.opencl.OpenCLMem;
 import com.amd.aparapi.internal.opencl.OpenCLPlatform;
 import com.amd.aparapi.internal.opencl.OpenCLProgram;
+import com.amd.aparapi.internal.util.CompletionFuture;
 
 /**
  * This class is intended to be used as a 'proxy' or 'facade' object for Java code to interact with JNI
@@ -23,6 +24,13 @@ public abstract class OpenCLJNI{
 
    protected native void invoke(OpenCLKernel openCLKernel, Object[] args);
 
+   /**
+    * Enqueue an invoke without waiting for it, <code>future</code> is completed from an OpenCL event callback.
+    * 
+    * @return 0 if the invoke was enqueued, otherwise the future will never be completed
+    */
+   protected native int invokeAsync(OpenCLKernel openCLKernel, Object[] args, CompletionFuture<?> future);
+
    protected native void disposeKernel(OpenCLKernel openCLKernel);
 
    protected native void disposeProgram(OpenCLProgram openCLProgram);
@@ -34,4 +42,14 @@ public abstract class OpenCLJNI{
    protected native byte[] getBytes(String className);
 
    protected native void getMem(OpenCLProgram program, OpenCLMem mem);
+
+   /**
+    * @return the program binary cache counters {hits, misses, stores, invalid binaries, build ns, load ns}
+    */
+   protected native long[] getProgramCacheCounters();
+
+   /**
+    * @return the shared device object counters {live contexts, cached programs, contexts created, programs created}
+    */
+   protected native long[] getDeviceRegistryCounters();
 }
@@ -277,6 +277,20 @@ public class KernelArg extends KernelArgJNI{
       this.dims = dims;
    }
 
+   /**
+    * @return the number of elements touched by each work item of a chunked array
+    */
+   protected int getChunkStride() {
+      return chunkStride;
+   }
+
+   /**
+    * @param chunkStride the number of elements touched by each work item of a chunked array
+    */
+   protected void setChunkStride(int chunkStride) {
+      this.chunkStride = chunkStride;
+   }
+
    public void setUpdateRange(int start, int length) {
 	   this.updateStart = start;
 	   this.updateLength = length;
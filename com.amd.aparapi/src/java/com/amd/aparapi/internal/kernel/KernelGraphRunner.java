@@ -0,0 +1,168 @@
+package com.amd.aparapi.internal.kernel;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.logging.Level;
+import java.util.logging.Logger;
+
+import com.amd.aparapi.Config;
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.internal.jni.KernelRunnerJNI;
+
+/**
+ * Runs the nodes of a <code>KernelGraph</code>.
+ * <p>
+ * The first run executes each node in turn the ordinary way, which builds the program and args of every kernel. Later
+ * runs hand the whole graph to the native side, which keeps the arrays on the device between nodes and orders the
+ * nodes with OpenCL events. Graphs which can't run natively (nodes on different devices, nodes which fell back to Java)
+ * keep running their nodes in turn.
+ */
+public class KernelGraphRunner extends KernelRunnerJNI{
+
+   private static Logger logger = Logger.getLogger(Config.getLoggerName());
+
+   private static class Node{
+      private final Kernel kernel;
+
+      private final KernelRunner runner;
+
+      private final String entrypoint;
+
+      private final Range range;
+
+      private final int passes;
+
+      private Node(Kernel _kernel, KernelRunner _runner, String _entrypoint, Range _range, int _passes) {
+         kernel = _kernel;
+         runner = _runner;
+         entrypoint = _entrypoint;
+         range = _range;
+         passes = _passes;
+      }
+   }
+
+   private final List<Node> nodes = new ArrayList<Node>();
+
+   private final List<Object> inputs = new ArrayList<Object>();
+
+   private final List<Object> outputs = new ArrayList<Object>();
+
+   private long graphHandle = 0;
+
+   /**
+    * True once the nodes have been built by a run, the native graph is only created after that.
+    */
+   private boolean built = false;
+
+   public synchronized void addNode(Kernel _kernel, KernelRunner _runner, String _entrypoint, Range _range, int _passes) {
+      nodes.add(new Node(_kernel, _runner, _entrypoint, _range, _passes));
+      disposeGraph();
+      built = false;
+   }
+
+   public synchronized void addInput(Object _array) {
+      add(inputs, _array);
+   }
+
+   public synchronized void addOutput(Object _array) {
+      add(outputs, _array);
+   }
+
+   private static void add(List<Object> _arrays, Object _array) {
+      if ((_array == null) || !_array.getClass().isArray()) {
+         throw new IllegalArgumentException("graph inputs and outputs must be arrays");
+      }
+      for (final Object array : _arrays) {
+         if (array == _array) {
+            return;
+         }
+      }
+      _arrays.add(_array);
+   }
+
+   public synchronized void run() {
+      if (!built) {
+         runNodes();
+         built = true;
+         graphHandle = createGraph();
+         return;
+      }
+
+      if (graphHandle == 0) {
+         runNodes();
+         return;
+      }
+
+      final Range[] ranges = new Range[nodes.size()];
+      final int[] passes = new int[nodes.size()];
+      for (int i = 0; i < nodes.size(); i++) {
+         final Node node = nodes.get(i);
+         if (node.runner.prepareGraphNode() == 0) {
+            logger.warning("graph node " + node.kernel.getClass().getName() + " no longer runs on OpenCL, running nodes in turn");
+            disposeGraph();
+            runNodes();
+            return;
+         }
+         ranges[i] = node.range;
+         passes[i] = node.passes;
+      }
+
+      final int status = runGraphJNI(graphHandle, ranges, passes, inputs.toArray(), outputs.toArray());
+      if (status != 0) {
+         logger.warning("### CL graph exec failed with status " + status + ", running nodes in turn ###");
+         disposeGraph();
+         runNodes();
+      }
+   }
+
+   private void runNodes() {
+      for (final Node node : nodes) {
+         node.kernel.execute(node.entrypoint, node.range, node.passes);
+      }
+   }
+
+   private long createGraph() {
+      final long[] handles = new long[nodes.size()];
+      final String[] entrypoints = new String[nodes.size()];
+      for (int i = 0; i < nodes.size(); i++) {
+         final Node node = nodes.get(i);
+         handles[i] = node.runner.prepareGraphNode();
+         if (handles[i] == 0) {
+            if (logger.isLoggable(Level.FINE)) {
+               logger.fine("graph node " + node.kernel.getClass().getName() + " does not run on OpenCL, running nodes in turn");
+            }
+            return (0);
+         }
+         entrypoints[i] = node.entrypoint;
+      }
+
+      final long handle = createGraphJNI(handles, entrypoints);
+      if (handle == 0) {
+         logger.warning("graph nodes can't run as one OpenCL graph, running nodes in turn");
+      }
+      return (handle);
+   }
+
+   private void disposeGraph() {
+      if (graphHandle != 0) {
+         disposeGraphJNI(graphHandle);
+         graphHandle = 0;
+      }
+   }
+
+   /**
+    * @return true if the graph runs natively, false if its nodes are run in turn
+    */
+   public synchronized boolean isNative() {
+      return (graphHandle != 0);
+   }
+
+   public synchronized void dispose() {
+      disposeGraph();
+      nodes.clear();
+      inputs.clear();
+      outputs.clear();
+      built = false;
+   }
+}
@@ -39,9 +39,13 @@ package com.amd.aparapi.internal.kernel;
 
 import java.lang.reflect.Array;
 import java.lang.reflect.Field;
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
 import java.lang.reflect.Modifier;
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.HashMap;
 import java.util.HashSet;
 import java.util.List;
@@ -51,6 +55,7 @@ import java.util.concurrent.BrokenBarrierException;
 import java.util.concurrent.CyclicBarrier;
 import java.util.concurrent.Executors;
 import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Future;
 import java.util.logging.Level;
 import java.util.logging.Logger;
 
@@ -58,8 +63,11 @@ import com.amd.aparapi.Config;
 import com.amd.aparapi.Kernel;
 import com.amd.aparapi.Kernel.Constant;
 import com.amd.aparapi.Kernel.EXECUTION_MODE;
+import com.amd.aparapi.Kernel.Jagged;
 import com.amd.aparapi.Kernel.KernelState;
 import com.amd.aparapi.Kernel.Local;
+import com.amd.aparapi.LatencySummary;
+import com.amd.aparapi.TransferCounters;
 import com.amd.aparapi.ProfileInfo;
 import com.amd.aparapi.Range;
 import com.amd.aparapi.device.Device;
@@ -70,6 +78,8 @@ import com.amd.aparapi.internal.instruction.InstructionSet.TypeSpec;
 import com.amd.aparapi.internal.jni.KernelRunnerJNI;
 import com.amd.aparapi.internal.model.ClassModel;
 import com.amd.aparapi.internal.model.Entrypoint;
+import com.amd.aparapi.internal.opencl.OpenCLLoader;
+import com.amd.aparapi.internal.util.CompletionFuture;
 import com.amd.aparapi.internal.util.UnsafeWrapper;
 import com.amd.aparapi.internal.writer.KernelWriter;
 import com.amd.aparapi.opencl.OpenCL;
@@ -118,12 +128,35 @@ public class KernelRunner extends KernelRunnerJNI{
     * @see KernelRunnerJNI#disposeJNI()
     */
    public void dispose() {
+      awaitPendingExecution();
       if (kernel.getExecutionMode().isOpenCL()) {
          disposeJNI(jniContextHandle);
+         disposeDeviceContexts();
       }
       threadPool.shutdownNow();
    }
 
+   /**
+    * Refresh the array refs of the args before this kernel runs as a node of a <code>KernelGraph</code>.
+    * 
+    * @return the JNI context of the kernel, or 0 if the kernel has not been built for OpenCL
+    */
+   public synchronized long prepareGraphNode() {
+      awaitPendingExecution();
+      if ((jniContextHandle == 0) || (args == null) || !kernel.getExecutionMode().isOpenCL() || usesOopConversion) {
+         return (0);
+      }
+      try {
+         updateKernelArrayRefs();
+         // the graph passes its own ranges, only the args need refreshing
+         writeArgState(null);
+      } catch (final AparapiException e) {
+         logger.warning("failed to prepare graph node " + kernel.getClass().getName() + ": " + e.getMessage());
+         return (0);
+      }
+      return (jniContextHandle);
+   }
+
    private Set<String> capabilitiesSet;
 
    private long accumulatedExecutionTime = 0;
@@ -219,17 +252,21 @@ public class KernelRunner extends KernelRunnerJNI{
    /**
     * Execute using a Java thread pool. Either because we were explicitly asked to do so, or because we 'fall back' after discovering an OpenCL issue.
     * 
+    * @param _entrypointName
+    *          The name of the method each work item runs, usually <code>run</code>
     * @param _range
     *          The globalSize requested by the user (via <code>Kernel.execute(globalSize)</code>)
     * @param _passes
     *          The # of passes requested by the user (via <code>Kernel.execute(globalSize, passes)</code>). Note this is usually defaulted to 1 via <code>Kernel.execute(globalSize)</code>.
     * @return
     */
-   private long executeJava(final Range _range, final int _passes) {
+   private long executeJava(final String _entrypointName, final Range _range, final int _passes) {
       if (logger.isLoggable(Level.FINE)) {
          logger.fine("executeJava: range = " + _range);
       }
 
+      final Method entrypoint = getEntrypointMethod(_entrypointName);
+
       if (kernel.getExecutionMode().equals(EXECUTION_MODE.SEQ)) {
          /**
           * SEQ mode is useful for testing trivial logic, but kernels which use SEQ mode cannot be used if the
@@ -261,7 +298,7 @@ public class KernelRunner extends KernelRunnerJNI{
             if (_range.getDims() == 1) {
                for (int id = 0; id < _range.getGlobalSize(0); id++) {
                   kernelState.setGlobalId(0, id);
-                  kernelClone.run();
+                  runEntrypoint(kernelClone, entrypoint);
                }
             } else if (_range.getDims() == 2) {
                for (int x = 0; x < _range.getGlobalSize(0); x++) {
@@ -269,7 +306,7 @@ public class KernelRunner extends KernelRunnerJNI{
 
                   for (int y = 0; y < _range.getGlobalSize(1); y++) {
                      kernelState.setGlobalId(1, y);
-                     kernelClone.run();
+                     runEntrypoint(kernelClone, entrypoint);
                   }
                }
             } else if (_range.getDims() == 3) {
@@ -281,10 +318,10 @@ public class KernelRunner extends KernelRunnerJNI{
 
                      for (int z = 0; z < _range.getGlobalSize(2); z++) {
                         kernelState.setGlobalId(2, z);
-                        kernelClone.run();
+                        runEntrypoint(kernelClone, entrypoint);
                      }
 
-                     kernelClone.run();
+                     runEntrypoint(kernelClone, entrypoint);
                   }
                }
             }
@@ -476,7 +513,7 @@ public class KernelRunner extends KernelRunnerJNI{
                            kernelState.setGroupId(2, (globalGroupId / (_range.getNumGroups(0) * _range.getNumGroups(1))));
                         }
 
-                        kernelClone.run();
+                        runEntrypoint(kernelClone, entrypoint);
                      }
 
                      await(joinBarrier); // This thread will rendezvous with dispatch thread here. This is effectively a join.                  
@@ -491,6 +528,48 @@ public class KernelRunner extends KernelRunnerJNI{
       return 0;
    }
 
+   /**
+    * Find the method a work item runs for an entrypoint when executing in Java.
+    * 
+    * @param _entrypointName the name of a no argument method of the kernel
+    * @return the method, or null for <code>run()</code> which is called directly
+    */
+   private Method getEntrypointMethod(String _entrypointName) {
+      if (_entrypointName.equals("run")) {
+         return (null);
+      }
+      for (Class<?> c = kernel.getClass(); (c != null) && (c != Kernel.class); c = c.getSuperclass()) {
+         try {
+            final Method method = c.getDeclaredMethod(_entrypointName);
+            method.setAccessible(true);
+            return (method);
+         } catch (final NoSuchMethodException e) {
+            // keep looking in the superclass
+         }
+      }
+      throw new IllegalStateException("no entrypoint " + _entrypointName + "() in " + kernel.getClass().getName());
+   }
+
+   private static void runEntrypoint(Kernel _kernel, Method _entrypoint) {
+      if (_entrypoint == null) {
+         _kernel.run();
+         return;
+      }
+      try {
+         _entrypoint.invoke(_kernel);
+      } catch (final IllegalAccessException e) {
+         throw new IllegalStateException(e);
+      } catch (final InvocationTargetException e) {
+         final Throwable cause = e.getCause();
+         if (cause instanceof RuntimeException) {
+            throw (RuntimeException) cause;
+         } else if (cause instanceof Error) {
+            throw (Error) cause;
+         }
+         throw new IllegalStateException(cause);
+      }
+   }
+
    private static void await(CyclicBarrier _barrier) {
       try {
          _barrier.await();
@@ -505,6 +584,17 @@ public class KernelRunner extends KernelRunnerJNI{
 
    private KernelArg[] args = null;
 
+   /**
+    * Type, sizes and primitive values of every arg plus the range, laid out as the <code>STATE_</code> offsets describe and
+    * written before each execution so the JNI code doesn't fetch them field by field.
+    */
+   private ByteBuffer argState = null;
+
+   /**
+    * Unsafe offset of each primitive instance field arg, -1 for statics and arrays.
+    */
+   private long[] argStateFieldOffsets = null;
+
    private boolean usesOopConversion = false;
 
    /**
@@ -824,6 +914,87 @@ public class KernelRunner extends KernelRunnerJNI{
       return needsSync;
    }
 
+   private void allocateArgState() {
+      argState = ByteBuffer.allocateDirect(STATE_HEADER_SIZE + (argc * STATE_ARG_SIZE)).order(ByteOrder.nativeOrder());
+      argStateFieldOffsets = new long[argc];
+      for (int i = 0; i < argc; i++) {
+         final KernelArg arg = args[i];
+         if (((arg.getType() & ARG_PRIMITIVE) != 0) && ((arg.getType() & ARG_STATIC) == 0)) {
+            argStateFieldOffsets[i] = UnsafeWrapper.objectFieldOffset(arg.getField());
+         } else {
+            argStateFieldOffsets[i] = -1;
+         }
+      }
+   }
+
+   /**
+    * Copy the current state of the args, and of the range if one is given, into the block the JNI code reads.
+    */
+   private void writeArgState(Range _range) {
+      if (argState == null) {
+         return;
+      }
+      if (_range != null) {
+         argState.putInt(STATE_RANGE_DIMS, _range.getDims());
+         argState.putInt(STATE_RANGE_LOCAL_IS_DERIVED, _range.isLocalIsDerived() ? 1 : 0);
+         argState.putInt(STATE_RANGE_GLOBAL_SIZE, _range.getGlobalSize_0());
+         argState.putInt(STATE_RANGE_GLOBAL_SIZE + 4, _range.getGlobalSize_1());
+         argState.putInt(STATE_RANGE_GLOBAL_SIZE + 8, _range.getGlobalSize_2());
+         argState.putInt(STATE_RANGE_LOCAL_SIZE, _range.getLocalSize_0());
+         argState.putInt(STATE_RANGE_LOCAL_SIZE + 4, _range.getLocalSize_1());
+         argState.putInt(STATE_RANGE_LOCAL_SIZE + 8, _range.getLocalSize_2());
+      }
+      for (int i = 0; i < argc; i++) {
+         final KernelArg arg = args[i];
+         final int record = STATE_HEADER_SIZE + (i * STATE_ARG_SIZE);
+         argState.putInt(record + STATE_ARG_TYPE, arg.getType());
+         argState.putInt(record + STATE_ARG_SIZE_IN_BYTES, arg.getSizeInBytes());
+         argState.putInt(record + STATE_ARG_NUM_ELEMENTS, arg.getNumElements());
+         if ((arg.getType() & ARG_PRIMITIVE) != 0) {
+            writePrimitiveState(arg, argStateFieldOffsets[i], record + STATE_ARG_VALUE);
+         }
+      }
+   }
+
+   private void writePrimitiveState(KernelArg _arg, long _fieldOffset, int _index) {
+      final int type = _arg.getType();
+      if (_fieldOffset >= 0) {
+         if ((type & ARG_FLOAT) != 0) {
+            argState.putFloat(_index, UnsafeWrapper.getFloat(kernel, _fieldOffset));
+         } else if ((type & ARG_INT) != 0) {
+            argState.putInt(_index, UnsafeWrapper.getInt(kernel, _fieldOffset));
+         } else if ((type & ARG_BOOLEAN) != 0) {
+            argState.put(_index, UnsafeWrapper.getBoolean(kernel, _fieldOffset) ? (byte) 1 : (byte) 0);
+         } else if ((type & ARG_BYTE) != 0) {
+            argState.put(_index, UnsafeWrapper.getByte(kernel, _fieldOffset));
+         } else if ((type & ARG_LONG) != 0) {
+            argState.putLong(_index, UnsafeWrapper.getLong(kernel, _fieldOffset));
+         } else if ((type & ARG_DOUBLE) != 0) {
+            argState.putDouble(_index, UnsafeWrapper.getDouble(kernel, _fieldOffset));
+         }
+         return;
+      }
+      // statics have no instance offset, they are rare enough to read reflectively
+      try {
+         final Field field = _arg.getField();
+         if ((type & ARG_FLOAT) != 0) {
+            argState.putFloat(_index, field.getFloat(null));
+         } else if ((type & ARG_INT) != 0) {
+            argState.putInt(_index, field.getInt(null));
+         } else if ((type & ARG_BOOLEAN) != 0) {
+            argState.put(_index, field.getBoolean(null) ? (byte) 1 : (byte) 0);
+         } else if ((type & ARG_BYTE) != 0) {
+            argState.put(_index, field.getByte(null));
+         } else if ((type & ARG_LONG) != 0) {
+            argState.putLong(_index, field.getLong(null));
+         } else if ((type & ARG_DOUBLE) != 0) {
+            argState.putDouble(_index, field.getDouble(null));
+         }
+      } catch (final IllegalAccessException e) {
+         e.printStackTrace();
+      }
+   }
+
    // private int numAvailableProcessors = Runtime.getRuntime().availableProcessors();
 
    private Kernel executeOpenCL(final String _entrypointName, final Range _range, final int _passes) throws AparapiException {
@@ -872,18 +1043,52 @@ public class KernelRunner extends KernelRunnerJNI{
       // We need to do this as input to computing the localSize
       assert args != null : "args should not be null";
       final boolean needSync = updateKernelArrayRefs();
+      writeArgState(_range);
       if (needSync && logger.isLoggable(Level.FINE)) {
          logger.fine("Need to resync arrays on " + kernel.getClass().getName());
       }
 
+      // entrypoints other than run() are dispatched by name against the same buffers, on the kernel's own device
+      final boolean named = !_entrypointName.equals("run");
+      if (named && !entryPoint.hasEntrypoint(_entrypointName)) {
+         return warnFallBackAndExecute(_entrypointName, _range, _passes, "entrypoint " + _entrypointName
+               + " was not built, tag it with @Kernel.EntryPoint");
+      }
+
+      // object arrays are unpacked on this thread and chunked executions wait for their chunks, so neither can run async
+      final boolean async = (asyncRequest != null) && !named && (executionChunks <= 1) && !usesOopConversion;
+
+      // split single pass 1D executions across the execution devices, the native side falls back to the first device
+      final boolean multiDevice = (deviceContextHandles != null) && !async && !named && (_range.getDims() == 1)
+            && (_passes == 1) && !usesOopConversion;
+
       // native side will reallocate array buffers if necessary
-      if (runKernelJNI(jniContextHandle, _range, needSync, _passes) != 0) {
+      final int status;
+      if (async) {
+         status = runKernelAsyncJNI(jniContextHandle, _range, needSync, _passes, asyncRequest);
+      } else if (named) {
+         status = runKernelNameJNI(jniContextHandle, _entrypointName, _range, needSync, _passes);
+      } else if (multiDevice) {
+         partitionRange(_range);
+         status = runKernelMultiJNI(deviceContextHandles, _range, needSync, _passes, deviceOffsets, deviceCounts);
+      } else if (executionChunks > 1) {
+         status = runKernelChunkedJNI(jniContextHandle, _range, needSync, _passes, executionChunks);
+      } else {
+         status = runKernelJNI(jniContextHandle, _range, needSync, _passes);
+      }
+      if (status != 0) {
          logger.warning("### CL exec seems to have failed. Trying to revert to Java ###");
          kernel.setFallbackExecutionMode();
          return execute(_entrypointName, _range, _passes);
       }
 
-      if (usesOopConversion == true) {
+      if (multiDevice && dynamicRebalancing) {
+         rebalance();
+      }
+
+      if (async) {
+         pendingExecution = asyncRequest;
+      } else if (usesOopConversion == true) {
          restoreObjects();
       }
 
@@ -925,6 +1130,8 @@ public class KernelRunner extends KernelRunnerJNI{
 
    public synchronized Kernel execute(String _entrypointName, final Range _range, final int _passes) {
 
+      awaitPendingExecution();
+
       long executeStartTime = System.currentTimeMillis();
 
       if (_range == null) {
@@ -935,58 +1142,60 @@ public class KernelRunner extends KernelRunnerJNI{
       if (kernel.getExecutionMode().isOpenCL()) {
          // System.out.println("OpenCL");
 
-         // See if user supplied a Device
+         // See if user supplied a Device, the first of the execution devices overrides the range's device
          Device device = _range.getDevice();
+         if (executionDevices != null) {
+            device = executionDevices[0];
+         }
 
          if ((device == null) || (device instanceof OpenCLDevice)) {
             if (entryPoint == null) {
                try {
                   final ClassModel classModel = new ClassModel(kernel.getClass());
-                  entryPoint = classModel.getEntrypoint(_entrypointName, kernel);
+                  // run() is always built, the program also holds any @Kernel.EntryPoint methods for named dispatch
+                  entryPoint = classModel.getEntrypoint("run", kernel);
                } catch (final Exception exception) {
                   return warnFallBackAndExecute(_entrypointName, _range, _passes, exception);
                }
 
                if ((entryPoint != null) && !entryPoint.shouldFallback()) {
-                  synchronized (Kernel.class) { // This seems to be needed because of a race condition uncovered with issue #68 http://code.google.com/p/aparapi/issues/detail?id=68
-                     if (device != null && !(device instanceof OpenCLDevice)) {
-                        throw new IllegalStateException("range's device is not suitable for OpenCL ");
-                     }
+                  if (device != null && !(device instanceof OpenCLDevice)) {
+                     throw new IllegalStateException("range's device is not suitable for OpenCL ");
+                  }
 
-                     OpenCLDevice openCLDevice = (OpenCLDevice) device; // still might be null! 
-
-                     int jniFlags = 0;
-                     if (openCLDevice == null) {
-                        if (kernel.getExecutionMode().equals(EXECUTION_MODE.GPU)) {
-                           // We used to treat as before by getting first GPU device
-                           // now we get the best GPU
-                           openCLDevice = (OpenCLDevice) OpenCLDevice.best();
-                           jniFlags |= JNI_FLAG_USE_GPU; // this flag might be redundant now. 
-                        } else {
-                           // We fetch the first CPU device 
-                           openCLDevice = (OpenCLDevice) OpenCLDevice.firstCPU();
-                           if (openCLDevice == null) {
-                              return warnFallBackAndExecute(_entrypointName, _range, _passes,
-                                    "CPU request can't be honored not CPU device");
-                           }
-                        }
+                  OpenCLDevice openCLDevice = (OpenCLDevice) device; // still might be null! 
+
+                  int jniFlags = 0;
+                  if (openCLDevice == null) {
+                     if (kernel.getExecutionMode().equals(EXECUTION_MODE.GPU)) {
+                        // We used to treat as before by getting first GPU device
+                        // now we get the best GPU
+                        openCLDevice = (OpenCLDevice) OpenCLDevice.best();
+                        jniFlags |= JNI_FLAG_USE_GPU; // this flag might be redundant now. 
                      } else {
-                        if (openCLDevice.getType() == Device.TYPE.GPU) {
-                           jniFlags |= JNI_FLAG_USE_GPU; // this flag might be redundant now. 
+                        // We fetch the first CPU device 
+                        openCLDevice = (OpenCLDevice) OpenCLDevice.firstCPU();
+                        if (openCLDevice == null) {
+                           return warnFallBackAndExecute(_entrypointName, _range, _passes,
+                                 "CPU request can't be honored not CPU device");
                         }
                      }
+                  } else {
+                     if (openCLDevice.getType() == Device.TYPE.GPU) {
+                        jniFlags |= JNI_FLAG_USE_GPU; // this flag might be redundant now. 
+                     }
+                  }
 
-                     //  jniFlags |= (Config.enableProfiling ? JNI_FLAG_ENABLE_PROFILING : 0);
-                     //  jniFlags |= (Config.enableProfilingCSV ? JNI_FLAG_ENABLE_PROFILING_CSV | JNI_FLAG_ENABLE_PROFILING : 0);
-                     //  jniFlags |= (Config.enableVerboseJNI ? JNI_FLAG_ENABLE_VERBOSE_JNI : 0);
-                     // jniFlags |= (Config.enableVerboseJNIOpenCLResourceTracking ? JNI_FLAG_ENABLE_VERBOSE_JNI_OPENCL_RESOURCE_TRACKING :0);
-                     // jniFlags |= (kernel.getExecutionMode().equals(EXECUTION_MODE.GPU) ? JNI_FLAG_USE_GPU : 0);
-                     // Init the device to check capabilities before emitting the
-                     // code that requires the capabilities.
+                  //  jniFlags |= (Config.enableProfiling ? JNI_FLAG_ENABLE_PROFILING : 0);
+                  //  jniFlags |= (Config.enableProfilingCSV ? JNI_FLAG_ENABLE_PROFILING_CSV | JNI_FLAG_ENABLE_PROFILING : 0);
+                  //  jniFlags |= (Config.enableVerboseJNI ? JNI_FLAG_ENABLE_VERBOSE_JNI : 0);
+                  // jniFlags |= (Config.enableVerboseJNIOpenCLResourceTracking ? JNI_FLAG_ENABLE_VERBOSE_JNI_OPENCL_RESOURCE_TRACKING :0);
+                  // jniFlags |= (kernel.getExecutionMode().equals(EXECUTION_MODE.GPU) ? JNI_FLAG_USE_GPU : 0);
+                  // Init the device to check capabilities before emitting the
+                  // code that requires the capabilities.
 
-                     // synchronized(Kernel.class){
-                     jniContextHandle = initJNI(kernel, openCLDevice, jniFlags); // openCLDevice will not be null here
-                  } // end of synchronized! issue 68
+                  // the native side initializes its shared state once, so kernels may be created from any number of threads (issue #68)
+                  jniContextHandle = initJNI(kernel, openCLDevice, jniFlags); // openCLDevice will not be null here
 
                   if (jniContextHandle == 0) {
                      return warnFallBackAndExecute(_entrypointName, _range, _passes, "initJNI failed to return a valid handle");
@@ -1106,7 +1315,7 @@ public class KernelRunner extends KernelRunnerJNI{
                               try {
                                  setMultiArrayType(args[i], type);
                               } catch(AparapiException e) {
-                                 return warnFallBackAndExecute(_entrypointName, _range, _passes, "failed to set kernel arguement " + args[i].getName() + ".  Aparapi only supports 2D and 3D arrays.");
+                                 return warnFallBackAndExecute(_entrypointName, _range, _passes, "failed to set kernel arguement " + args[i].getName() + ": " + e.getMessage());
                               }
                            } else {
 
@@ -1128,6 +1337,13 @@ public class KernelRunner extends KernelRunnerJNI{
                                  args[i].setType(args[i].getType() | ARG_ARRAYLENGTH);
                               }
 
+                              // arrays with a declared access pattern can be transferred chunk by chunk
+                              final Kernel.Chunked chunked = field.getAnnotation(Kernel.Chunked.class);
+                              if (chunked != null && chunked.stride() > 0) {
+                                 args[i].setType(args[i].getType() | ARG_CHUNKED);
+                                 args[i].setChunkStride(chunked.stride());
+                              }
+
                               if (type.getName().startsWith("[L")) {
                                  args[i].setType(args[i].getType() | (ARG_OBJ_ARRAY_STRUCT | ARG_WRITE | ARG_READ));
                                  if (logger.isLoggable(Level.FINE)) {
@@ -1180,7 +1396,12 @@ public class KernelRunner extends KernelRunnerJNI{
 
                   argc = i;
 
-                  setArgsJNI(jniContextHandle, args, argc);
+                  allocateArgState();
+                  setArgsJNI(jniContextHandle, args, argc, argState);
+
+                  if (executionDevices != null && executionDevices.length > 1) {
+                     initDeviceContexts(openCL);
+                  }
 
                   conversionTime = System.currentTimeMillis() - executeStartTime;
 
@@ -1204,7 +1425,7 @@ public class KernelRunner extends KernelRunnerJNI{
                   "OpenCL was requested but Device supplied was not an OpenCLDevice");
          }
       } else {
-         executeJava(_range, _passes);
+         executeJava(_entrypointName, _range, _passes);
       }
 
       if (Config.enableExecutionModeReporting) {
@@ -1242,9 +1463,6 @@ public class KernelRunner extends KernelRunnerJNI{
    private void setMultiArrayType(KernelArg arg, Class<?> type) throws AparapiException {
       arg.setType(arg.getType() | (ARG_WRITE | ARG_READ | ARG_APARAPI_BUFFER));
       int numDims = 0;
-      while(type.getName().startsWith("[[[[")) {
-         throw new AparapiException("Aparapi only supports 2D and 3D arrays.");
-      }
       arg.setType(arg.getType() | ARG_ARRAYLENGTH);
       while(type.getName().charAt(numDims) == '[') {
          numDims++;
@@ -1291,10 +1509,26 @@ public class KernelRunner extends KernelRunnerJNI{
          arg.setType(arg.getType() | ARG_SHORT);
       }
       int primitiveSize = getPrimitiveSize(arg.getType());
+      if (primitiveSize == 0) {
+         throw new AparapiException(arg.getName() + " is not an array of primitives");
+      }
       int totalElements = 1;
       for(int i = 0; i < numDims; i++) {
          totalElements *= dims[i];
       }
+      if (arg.getField().getAnnotation(Jagged.class) != null) {
+         if ((numDims != 2) || ((arg.getType() & ARG_GLOBAL) == 0)) {
+            throw new AparapiException(arg.getName() + " is @Jagged but only global 2D arrays may be jagged");
+         }
+         arg.setType(arg.getType() | ARG_JAGGED);
+         totalElements = 0;
+         for (int i = 0; i < dims[0]; i++) {
+            final Object row = Array.get(buffer, i);
+            if (row != null) {
+               totalElements += Array.getLength(row);
+            }
+         }
+      }
       arg.setSizeInBytes(totalElements * primitiveSize);
    }
 
@@ -1330,6 +1564,7 @@ public class KernelRunner extends KernelRunnerJNI{
     * @see Kernel#get(boolean[] arr)
     */
    public void get(Object array) {
+      awaitPendingExecution();
       if (explicit
             && ((kernel.getExecutionMode() == Kernel.EXECUTION_MODE.GPU) || (kernel.getExecutionMode() == Kernel.EXECUTION_MODE.CPU))) {
          // Only makes sense when we are using OpenCL
@@ -1338,6 +1573,7 @@ public class KernelRunner extends KernelRunnerJNI{
    }
    
    public void get(Object array, int start, int length) {
+	      awaitPendingExecution();
 	      if (explicit
 	              && ((kernel.getExecutionMode() == Kernel.EXECUTION_MODE.GPU) || (kernel.getExecutionMode() == Kernel.EXECUTION_MODE.CPU))) {
 	           // Only makes sense when we are using OpenCL
@@ -1347,7 +1583,68 @@ public class KernelRunner extends KernelRunnerJNI{
    
    
 
+   /**
+    * @return a report of the OpenCL resources held by every kernel, empty if OpenCL is not available
+    */
+   public String getOpenCLResourceReport() {
+      if (!OpenCLLoader.isOpenCLAvailable()) {
+         return ("");
+      }
+      return (getResourceReportJNI());
+   }
+
+   /**
+    * @return the latency summaries of every device context of the kernel, whose histograms are then reset
+    */
+   public List<LatencySummary> getLatencySummaries() {
+      awaitPendingExecution();
+      final List<LatencySummary> summaries = new ArrayList<LatencySummary>();
+      if (jniContextHandle == 0) {
+         return (summaries);
+      }
+      final long[] values = getLatencyJNI(getContextHandles());
+      final LatencySummary.METRIC[] metrics = LatencySummary.METRIC.values();
+      for (int m = 0; m < metrics.length && ((m + 1) * LatencySummary.FIELDS) <= values.length; m++) {
+         final int base = m * LatencySummary.FIELDS;
+         summaries.add(new LatencySummary(metrics[m], values[base], values[base + 1], values[base + 2], values[base + 3],
+               values[base + 4], values[base + 5]));
+      }
+      return (summaries);
+   }
+
+   /**
+    * @return the handles of every device context of the kernel
+    */
+   private long[] getContextHandles() {
+      return ((deviceContextHandles != null) ? deviceContextHandles : new long[] {
+         jniContextHandle
+      });
+   }
+
+   /**
+    * @return the transfer counters of the kernel, summed over its device contexts
+    */
+   public TransferCounters getTransferCounters() {
+      awaitPendingExecution();
+      if (jniContextHandle == 0) {
+         return (new TransferCounters(new long[0]));
+      }
+      return (new TransferCounters(getTransferCountersJNI(getContextHandles())));
+   }
+
+   /**
+    * @return the transfer log of the last run, empty unless enableTransferLog is set
+    */
+   public String getTransferLog() {
+      awaitPendingExecution();
+      if (jniContextHandle == 0) {
+         return ("");
+      }
+      return (getTransferLogJNI(getContextHandles()));
+   }
+
    public List<ProfileInfo> getProfileInfo() {
+      awaitPendingExecution();
       if (((kernel.getExecutionMode() == Kernel.EXECUTION_MODE.GPU) || (kernel.getExecutionMode() == Kernel.EXECUTION_MODE.CPU))) {
          // Only makes sense when we are using OpenCL
          return (getProfileInfoJNI(jniContextHandle));
@@ -1417,6 +1714,246 @@ public class KernelRunner extends KernelRunnerJNI{
       return (explicit);
    }
 
+   /**
+    * Start an execution without waiting for it to complete.
+    * <p>
+    * Executions which cannot run asynchronously (JTP, chunked executions, entrypoints other than <code>run()</code> or
+    * kernels using object arrays) run to completion before this returns, and the returned future is already done.
+    * 
+    * @return a future which completes once the results are back in the kernel's arrays
+    */
+   public synchronized Future<Kernel> executeAsync(String _entrypointName, final Range _range, final int _passes) {
+      final CompletionFuture<Kernel> future = new CompletionFuture<Kernel>(kernel);
+      asyncRequest = future;
+      try {
+         execute(_entrypointName, _range, _passes);
+      } finally {
+         asyncRequest = null;
+      }
+
+      if (pendingExecution != future) {
+         future.complete(0);
+      }
+      return (future);
+   }
+
+   /**
+    * Wait for an execution started by <code>executeAsync()</code> before its kernel, buffers or profile are touched again.
+    */
+   private synchronized void awaitPendingExecution() {
+      if (pendingExecution != null) {
+         // a callback which can't attach to the JVM never completes the future, it leaves its status on the context
+         while (!pendingExecution.await(ASYNC_POLL_MILLIS)) {
+            final int failure = getAsyncFailureJNI(jniContextHandle);
+            if (failure != 0) {
+               pendingExecution.complete(failure);
+            }
+         }
+         final int status = pendingExecution.getStatus();
+         pendingExecution = null;
+         if (status != 0) {
+            logger.warning("### CL async exec completed with status " + status + " ###");
+         }
+      }
+   }
+
+   private OpenCLDevice[] executionDevices = null;
+
+   private float[] executionWeights = null;
+
+   private boolean dynamicRebalancing = false;
+
+   /**
+    * One context per execution device, the first is always <code>jniContextHandle</code>. Null unless at least two devices
+    * built the kernel.
+    */
+   private long[] deviceContextHandles = null;
+
+   private float[] deviceWeights = null;
+
+   private OpenCLDevice[] contextDevices = null;
+
+   private int[] deviceOffsets = null;
+
+   private int[] deviceCounts = null;
+
+   /**
+    * Split OpenCL executions of this kernel across <code>_devices</code>. Must be called before the first execution.
+    * 
+    * @param _devices the devices to split 1D single pass executions across, the first also runs everything else
+    */
+   public synchronized void setExecutionDevices(OpenCLDevice... _devices) {
+      if (jniContextHandle != 0) {
+         throw new IllegalStateException("execution devices must be set before the kernel is first executed");
+      }
+      executionDevices = ((_devices == null) || (_devices.length == 0)) ? null : _devices.clone();
+   }
+
+   /**
+    * Set the share of each execution device, defaults to each device's compute unit count.
+    * 
+    * @param _weights one weight per device passed to <code>setExecutionDevices()</code>
+    */
+   public synchronized void setExecutionDeviceWeights(float... _weights) {
+      executionWeights = (_weights == null) ? null : _weights.clone();
+      if (deviceContextHandles != null) {
+         deviceWeights = initialWeights();
+      }
+   }
+
+   /**
+    * Adjust the device weights after each split execution from the measured execute time of each device. Requires
+    * profiling to be enabled (<code>-Dcom.amd.aparapi.enableProfiling=true</code>).
+    */
+   public synchronized void setDynamicRebalancing(boolean _dynamicRebalancing) {
+      dynamicRebalancing = _dynamicRebalancing;
+      if (dynamicRebalancing && !Config.enableProfiling) {
+         logger.warning("dynamic rebalancing needs profiling, enable it with -Dcom.amd.aparapi.enableProfiling=true");
+      }
+   }
+
+   /**
+    * @return the current weight of each device executions are split across, or null if executions are not split
+    */
+   public synchronized float[] getExecutionDeviceWeights() {
+      return ((deviceWeights == null) ? null : deviceWeights.clone());
+   }
+
+   /**
+    * Create, build and set the args of a context for each execution device after the first. Devices which fail are dropped.
+    */
+   private void initDeviceContexts(String _openCL) {
+      final List<Long> handles = new ArrayList<Long>();
+      final List<OpenCLDevice> devices = new ArrayList<OpenCLDevice>();
+      handles.add(jniContextHandle);
+      devices.add(executionDevices[0]);
+
+      for (int d = 1; d < executionDevices.length; d++) {
+         final OpenCLDevice device = executionDevices[d];
+         long handle;
+         synchronized (Kernel.class) {
+            handle = initJNI(kernel, device, (device.getType() == Device.TYPE.GPU) ? JNI_FLAG_USE_GPU : 0);
+         }
+         if ((handle != 0) && (buildProgramJNI(handle, _openCL) == 0)) {
+            disposeJNI(handle);
+            handle = 0;
+         }
+         if (handle == 0) {
+            logger.warning("Not splitting executions of " + kernel.getClass() + " onto " + device);
+            continue;
+         }
+         setArgsJNI(handle, args, argc, argState);
+         handles.add(handle);
+         devices.add(device);
+      }
+
+      if (handles.size() > 1) {
+         deviceContextHandles = new long[handles.size()];
+         contextDevices = new OpenCLDevice[devices.size()];
+         for (int d = 0; d < deviceContextHandles.length; d++) {
+            deviceContextHandles[d] = handles.get(d);
+            contextDevices[d] = devices.get(d);
+         }
+         deviceOffsets = new int[deviceContextHandles.length];
+         deviceCounts = new int[deviceContextHandles.length];
+         deviceWeights = initialWeights();
+      }
+   }
+
+   private void disposeDeviceContexts() {
+      if (deviceContextHandles != null) {
+         for (int d = 1; d < deviceContextHandles.length; d++) {
+            disposeJNI(deviceContextHandles[d]);
+         }
+         deviceContextHandles = null;
+      }
+   }
+
+   /**
+    * The user's weights for the devices which built the kernel, otherwise their compute unit counts.
+    */
+   private float[] initialWeights() {
+      final float[] weights = new float[contextDevices.length];
+      for (int d = 0; d < contextDevices.length; d++) {
+         weights[d] = Math.max(1, contextDevices[d].getMaxComputeUnits());
+         if (executionWeights != null) {
+            for (int e = 0; e < executionDevices.length && e < executionWeights.length; e++) {
+               if ((executionDevices[e] == contextDevices[d]) && (executionWeights[e] > 0f)) {
+                  weights[d] = executionWeights[e];
+               }
+            }
+         }
+      }
+      return (weights);
+   }
+
+   /**
+    * Split the work groups of a 1D range across the devices in proportion to their weights, the last device gets the remainder.
+    */
+   private void partitionRange(Range _range) {
+      final int localSize = _range.getLocalSize(0);
+      final int groups = _range.getGlobalSize(0) / localSize;
+
+      float total = 0f;
+      for (final float weight : deviceWeights) {
+         total += weight;
+      }
+
+      int offset = 0;
+      for (int d = 0; d < deviceWeights.length; d++) {
+         final int remaining = groups - (offset / localSize);
+         int deviceGroups = (d == (deviceWeights.length - 1)) ? remaining : Math.round((groups * deviceWeights[d]) / total);
+         deviceGroups = Math.min(deviceGroups, remaining);
+         deviceOffsets[d] = offset;
+         deviceCounts[d] = deviceGroups * localSize;
+         offset += deviceCounts[d];
+      }
+   }
+
+   /**
+    * Move the device weights half way towards the throughput measured for each device in the last execution.
+    */
+   private void rebalance() {
+      final float[] throughput = new float[deviceWeights.length];
+      float measuredWeight = 0f;
+      float measuredThroughput = 0f;
+      for (int d = 0; d < deviceWeights.length; d++) {
+         final long time = (deviceCounts[d] > 0) ? getExecutionTimeJNI(deviceContextHandles[d]) : -1L;
+         if (time > 0) {
+            throughput[d] = (float) deviceCounts[d] / time;
+            measuredWeight += deviceWeights[d];
+            measuredThroughput += throughput[d];
+         }
+      }
+
+      if (measuredThroughput > 0f) {
+         for (int d = 0; d < deviceWeights.length; d++) {
+            if (throughput[d] > 0f) {
+               deviceWeights[d] = (deviceWeights[d] + ((throughput[d] * measuredWeight) / measuredThroughput)) / 2f;
+            }
+         }
+         if (logger.isLoggable(Level.FINE)) {
+            logger.fine("rebalanced device weights to " + Arrays.toString(deviceWeights));
+         }
+      }
+   }
+
+   private CompletionFuture<Kernel> asyncRequest = null;
+
+   private CompletionFuture<Kernel> pendingExecution = null;
+
+   private static final long ASYNC_POLL_MILLIS = 100;
+
+   private int executionChunks = 1;
+
+   public void setExecutionChunks(int _chunks) {
+      executionChunks = _chunks;
+   }
+
+   public int getExecutionChunks() {
+      return (executionChunks);
+   }
+
    /**
     * Determine the time taken to convert bytecode to OpenCL for first Kernel.execute(range) call.
     * 
@@ -38,6 +38,7 @@ under those regulations, please refer to the U.S. Bureau of Industry and Securit
 package com.amd.aparapi.internal.model;
 
 import java.lang.reflect.Field;
+import java.lang.reflect.Method;
 import java.lang.reflect.Modifier;
 import java.util.ArrayList;
 import java.util.Collections;
@@ -111,6 +112,9 @@ public class Entrypoint{
 
    private MethodModel methodModel;
 
+   // Other entrypoints tagged with @Kernel.EntryPoint, compiled into the same program and sharing our args
+   private final List<MethodModel> entrypointMethods = new ArrayList<MethodModel>();
+
    /**
       True is an indication to use the fp64 pragma
    */
@@ -485,15 +489,26 @@ public class Entrypoint{
          }
       }
 
-      // Collect all methods called directly from kernel's run method
-      for (final MethodCall methodCall : methodModel.getMethodCalls()) {
+      collectEntrypointMethods();
+
+      final List<MethodModel> roots = new ArrayList<MethodModel>();
+      roots.add(methodModel);
+      roots.addAll(entrypointMethods);
 
-         ClassModelMethod m = resolveCalledMethod(methodCall, classModel);
-         if ((m != null) && !methodMap.keySet().contains(m)) {
-            final MethodModel target = new MethodModel(m, this);
-            methodMap.put(m, target);
-            methodModel.getCalledMethods().add(target);
-            discovered = true;
+      // Collect all methods called directly from kernel's run method (and from the other entrypoints)
+      for (final MethodModel root : roots) {
+         for (final MethodCall methodCall : root.getMethodCalls()) {
+
+            ClassModelMethod m = resolveCalledMethod(methodCall, classModel);
+            if (m != null) {
+               MethodModel target = methodMap.get(m);
+               if (target == null) {
+                  target = new MethodModel(m, this);
+                  methodMap.put(m, target);
+                  discovered = true;
+               }
+               root.getCalledMethods().add(target);
+            }
          }
       }
 
@@ -529,7 +544,9 @@ public class Entrypoint{
          }
       }
 
-      methodModel.checkForRecursion(new HashSet<MethodModel>());
+      for (final MethodModel root : roots) {
+         root.checkForRecursion(new HashSet<MethodModel>());
+      }
 
       if (logger.isLoggable(Level.FINE)) {
          logger.fine("fallback=" + fallback);
@@ -540,8 +557,8 @@ public class Entrypoint{
          Collections.reverse(calledMethods);
          final List<MethodModel> methods = new ArrayList<MethodModel>(calledMethods);
 
-         // add method to the calledMethods so we can include in this list
-         methods.add(methodModel);
+         // add method (and the other entrypoints) to the calledMethods so we can include in this list
+         methods.addAll(roots);
          final Set<String> fieldAssignments = new HashSet<String>();
 
          final Set<String> fieldAccesses = new HashSet<String>();
@@ -814,6 +831,55 @@ public class Entrypoint{
       }
    }
 
+   /**
+    * Find the other methods of the kernel class tagged with <code>&#64;Kernel.EntryPoint</code>.
+    * <p>
+    * Each must be a <code>void</code> instance method taking no arguments, just like <code>run()</code>.
+    *
+    * @throws AparapiException
+    */
+   private void collectEntrypointMethods() throws AparapiException {
+      final Set<String> names = new HashSet<String>();
+      names.add(methodModel.getSimpleName());
+
+      for (Class<?> c = classModel.getClassWeAreModelling(); (c != null) && (c != Kernel.class); c = c.getSuperclass()) {
+         for (final Method method : c.getDeclaredMethods()) {
+            if ((method.getAnnotation(Kernel.EntryPoint.class) != null) && !Modifier.isStatic(method.getModifiers())
+                  && (method.getParameterTypes().length == 0) && (method.getReturnType() == Void.TYPE)
+                  && names.add(method.getName())) {
+               // an override in a subclass is found first, getMethodModel() also searches from the subclass up
+               entrypointMethods.add(classModel.getMethodModel(method.getName(), "()V"));
+               if (logger.isLoggable(Level.FINE)) {
+                  logger.fine("adding entrypoint " + method.getName());
+               }
+            }
+         }
+      }
+   }
+
+   /**
+    * @return the other entrypoints compiled alongside this one, which can be dispatched by name against the same args
+    */
+   public List<MethodModel> getEntrypointMethods() {
+      return (entrypointMethods);
+   }
+
+   /**
+    * @param _name the name of an entrypoint method
+    * @return true if <code>_name</code> is this entrypoint or one of the others compiled alongside it
+    */
+   public boolean hasEntrypoint(String _name) {
+      if (methodModel.getSimpleName().equals(_name)) {
+         return (true);
+      }
+      for (final MethodModel mm : entrypointMethods) {
+         if (mm.getSimpleName().equals(_name)) {
+            return (true);
+         }
+      }
+      return (false);
+   }
+
    public boolean shouldFallback() {
       return (fallback);
    }
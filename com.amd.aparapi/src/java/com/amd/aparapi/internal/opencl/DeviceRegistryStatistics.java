@@ -0,0 +1,57 @@
+package com.amd.aparapi.internal.opencl;
+
+/**
+ * A snapshot of the counters of the contexts and programs shared between kernels running on the same device.
+ * 
+ * @see OpenCLLoader#getDeviceRegistryStatistics()
+ */
+public class DeviceRegistryStatistics{
+
+   private final long liveContexts;
+
+   private final long cachedPrograms;
+
+   private final long contextsCreated;
+
+   private final long programsCreated;
+
+   DeviceRegistryStatistics(long[] _counters) {
+      liveContexts = _counters[0];
+      cachedPrograms = _counters[1];
+      contextsCreated = _counters[2];
+      programsCreated = _counters[3];
+   }
+
+   /**
+    * @return The number of shared contexts currently referenced by a kernel or program
+    */
+   public long getLiveContexts() {
+      return liveContexts;
+   }
+
+   /**
+    * @return The number of programs currently cached for reuse
+    */
+   public long getCachedPrograms() {
+      return cachedPrograms;
+   }
+
+   /**
+    * @return The number of shared contexts created
+    */
+   public long getContextsCreated() {
+      return contextsCreated;
+   }
+
+   /**
+    * @return The number of programs built from source or loaded from the binary cache, rather than reused
+    */
+   public long getProgramsCreated() {
+      return programsCreated;
+   }
+
+   @Override public String toString() {
+      return "liveContexts=" + liveContexts + ", cachedPrograms=" + cachedPrograms + ", contextsCreated=" + contextsCreated
+            + ", programsCreated=" + programsCreated;
+   }
+}
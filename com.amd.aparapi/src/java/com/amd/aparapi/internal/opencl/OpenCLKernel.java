@@ -3,8 +3,10 @@ package com.amd.aparapi.internal.opencl;
 import com.amd.aparapi.ProfileInfo;
 import com.amd.aparapi.internal.kernel.KernelRunner;
 import java.util.List;
+import java.util.concurrent.Future;
 
 import com.amd.aparapi.internal.jni.OpenCLJNI;
+import com.amd.aparapi.internal.util.CompletionFuture;
 
 public class OpenCLKernel extends OpenCLJNI{
 
@@ -16,6 +18,8 @@ public class OpenCLKernel extends OpenCLJNI{
 
    private long kernelId = 0;
 
+   private CompletionFuture<OpenCLKernel> pendingInvoke = null;
+
    /**
     * This constructor is specifically for JNI usage
     * 
@@ -56,12 +60,41 @@ public class OpenCLKernel extends OpenCLJNI{
    }
 
    public void invoke(Object[] _args) {
+      awaitPendingInvoke();
       invoke(this, _args);
    }
 
+   /**
+    * Enqueue an invoke without waiting for it to complete. The arrays passed in <code>_args</code> should not be accessed
+    * until the returned future is done.
+    * 
+    * @param _args the range followed by the kernel args
+    * @return a future which completes once results have been copied back into the arrays
+    */
+   public Future<OpenCLKernel> invokeAsync(Object[] _args) {
+      awaitPendingInvoke();
+      final CompletionFuture<OpenCLKernel> future = new CompletionFuture<OpenCLKernel>(this);
+      if (invokeAsync(this, _args, future) == 0) {
+         pendingInvoke = future;
+      } else {
+         // could not be enqueued, so run it to completion instead
+         invoke(this, _args);
+         future.complete(0);
+      }
+      return (future);
+   }
+
    public void dispose(){
+       awaitPendingInvoke();
        disposeKernel(this);
    }
 
+   private void awaitPendingInvoke() {
+      if (pendingInvoke != null) {
+         pendingInvoke.await();
+         pendingInvoke = null;
+      }
+   }
+
 
 }
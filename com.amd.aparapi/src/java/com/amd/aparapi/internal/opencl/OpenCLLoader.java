@@ -66,4 +66,22 @@ public class OpenCLLoader extends OpenCLJNI{
    public static boolean isOpenCLAvailable() {
       return openCLAvailable;
    }
+
+   /**
+    * Retrieve the counters of the program binary cache (see <code>-Dcom.amd.aparapi.programCacheDir</code>)
+    * 
+    * @return The counters since the native library was loaded
+    */
+   public static ProgramCacheStatistics getProgramCacheStatistics() {
+      return new ProgramCacheStatistics(openCLAvailable ? instance.getProgramCacheCounters() : new long[6]);
+   }
+
+   /**
+    * Retrieve the counters of the contexts and programs shared between kernels running on the same device
+    * 
+    * @return The counters since the native library was loaded
+    */
+   public static DeviceRegistryStatistics getDeviceRegistryStatistics() {
+      return new DeviceRegistryStatistics(openCLAvailable ? instance.getDeviceRegistryCounters() : new long[4]);
+   }
 }
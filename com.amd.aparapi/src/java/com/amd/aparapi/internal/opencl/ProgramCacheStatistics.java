@@ -0,0 +1,77 @@
+package com.amd.aparapi.internal.opencl;
+
+/**
+ * A snapshot of the counters of the on disk program binary cache.
+ * 
+ * @see OpenCLLoader#getProgramCacheStatistics()
+ */
+public class ProgramCacheStatistics{
+
+   private final long hits;
+
+   private final long misses;
+
+   private final long stores;
+
+   private final long invalidBinaries;
+
+   private final long buildTimeNanos;
+
+   private final long loadTimeNanos;
+
+   ProgramCacheStatistics(long[] _counters) {
+      hits = _counters[0];
+      misses = _counters[1];
+      stores = _counters[2];
+      invalidBinaries = _counters[3];
+      buildTimeNanos = _counters[4];
+      loadTimeNanos = _counters[5];
+   }
+
+   /**
+    * @return The number of programs created from a cached binary
+    */
+   public long getHits() {
+      return hits;
+   }
+
+   /**
+    * @return The number of programs built from source whilst the cache was enabled
+    */
+   public long getMisses() {
+      return misses;
+   }
+
+   /**
+    * @return The number of binaries written to the cache
+    */
+   public long getStores() {
+      return stores;
+   }
+
+   /**
+    * @return The number of cached binaries the OpenCL platform rejected, these were rebuilt from source
+    */
+   public long getInvalidBinaries() {
+      return invalidBinaries;
+   }
+
+   /**
+    * @return The total time spent building programs from source (ns)
+    */
+   public long getBuildTimeNanos() {
+      return buildTimeNanos;
+   }
+
+   /**
+    * @return The total time spent creating programs from cached binaries (ns)
+    */
+   public long getLoadTimeNanos() {
+      return loadTimeNanos;
+   }
+
+   @Override public String toString() {
+      return "hits=" + hits + ", misses=" + misses + ", stores=" + stores + ", invalidBinaries=" + invalidBinaries
+            + ", buildTime=" + (buildTimeNanos / 1000000) + "ms, loadTime=" + (loadTimeNanos / 1000000) + "ms";
+   }
+}
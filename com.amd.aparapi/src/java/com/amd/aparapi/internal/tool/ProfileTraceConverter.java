@@ -0,0 +1,258 @@
+package com.amd.aparapi.internal.tool;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedWriter;
+import java.io.DataInputStream;
+import java.io.EOFException;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStreamWriter;
+import java.io.Writer;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * Converts the file recorded with -Dcom.amd.aparapi.profileFile=&lt;file&gt; to Chrome trace event JSON, which
+ * chrome://tracing and Perfetto show as a timeline with one row per OpenCL command queue, and a row for the host phases
+ * of each kernel.
+ *
+ * Usage java com.amd.aparapi.internal.tool.ProfileTraceConverter &lt;profile file&gt; [&lt;trace.json&gt;]
+ *
+ * The record layout matches ProfileRecord in the native Profiler.h.
+ */
+public class ProfileTraceConverter{
+
+   public static final int READ = 0;
+
+   public static final int EXECUTE = 1;
+
+   public static final int WRITE = 2;
+
+   public static final int HOST = 3;
+
+   private static final byte[] MAGIC = "APARPROF".getBytes();
+
+   private static final int BYTE_ORDER_MARK = 0x01020304;
+
+   private static final int HEADER_SIZE = 16;
+
+   private static final int RECORD_SIZE = 256;
+
+   private static final int NAME_OFFSET = 64;
+
+   private static final int NAME_SIZE = 64;
+
+   private static final int KERNEL_OFFSET = 128;
+
+   private static final int KERNEL_SIZE = 120;
+
+   private static final int SAMPLE_INTERVAL_OFFSET = 248;
+
+   /**
+    * One recorded event, times are device nanoseconds.
+    */
+   public static class Event{
+      public long context;
+
+      public long queue;
+
+      public long run;
+
+      public long queued;
+
+      public long submit;
+
+      public long start;
+
+      public long end;
+
+      public int type;
+
+      public int pass;
+
+      public String name;
+
+      public String kernel;
+
+      /**
+       * the run was profiled as one in this many, weight the event by it when totalling
+       */
+      public int sampleInterval;
+   }
+
+   /**
+    * Read every event of a profile file.
+    */
+   public static List<Event> read(InputStream _in) throws IOException {
+      final DataInputStream in = new DataInputStream(_in);
+      final byte[] header = new byte[HEADER_SIZE];
+      in.readFully(header);
+      for (int i = 0; i < MAGIC.length; i++) {
+         if (header[i] != MAGIC[i]) {
+            throw new IOException("not an aparapi profile file");
+         }
+      }
+      final ByteBuffer headerBuffer = ByteBuffer.wrap(header, MAGIC.length, 8);
+      final ByteOrder order = (headerBuffer.getInt() == BYTE_ORDER_MARK) ? ByteOrder.BIG_ENDIAN : ByteOrder.LITTLE_ENDIAN;
+      headerBuffer.order(order);
+      final int recordSize = headerBuffer.getInt();
+      if (recordSize < RECORD_SIZE) {
+         throw new IOException("unexpected profile record size " + recordSize);
+      }
+
+      final List<Event> events = new ArrayList<Event>();
+      final byte[] record = new byte[recordSize];
+      while (true) {
+         try {
+            in.readFully(record);
+         } catch (final EOFException eof) {
+            // a partly written last record is dropped
+            break;
+         }
+         final ByteBuffer buffer = ByteBuffer.wrap(record).order(order);
+         final Event event = new Event();
+         event.context = buffer.getLong();
+         event.queue = buffer.getLong();
+         event.run = buffer.getLong();
+         event.queued = buffer.getLong();
+         event.submit = buffer.getLong();
+         event.start = buffer.getLong();
+         event.end = buffer.getLong();
+         event.type = buffer.getInt();
+         event.pass = buffer.getInt();
+         event.name = string(record, NAME_OFFSET, NAME_SIZE);
+         event.kernel = string(record, KERNEL_OFFSET, KERNEL_SIZE);
+         event.sampleInterval = Math.max(1, buffer.getInt(SAMPLE_INTERVAL_OFFSET));
+         events.add(event);
+      }
+      return events;
+   }
+
+   private static String string(byte[] _bytes, int _offset, int _size) {
+      int length = 0;
+      while (length < _size && _bytes[_offset + length] != 0) {
+         length++;
+      }
+      try {
+         return new String(_bytes, _offset, length, "UTF-8");
+      } catch (final java.io.UnsupportedEncodingException e) {
+         return new String(_bytes, _offset, length);
+      }
+   }
+
+   private static String label(Event _event) {
+      switch (_event.type) {
+         case READ:
+            return "read " + _event.name;
+         case WRITE:
+            return "write " + _event.name;
+         case EXECUTE:
+            final String kernel = _event.kernel.substring(_event.kernel.lastIndexOf('.') + 1);
+            return (_event.name.length() > 0 ? kernel + " " + _event.name : kernel) + " pass " + _event.pass;
+         case HOST:
+            return _event.name;
+      }
+      return "command";
+   }
+
+   private static String category(Event _event) {
+      switch (_event.type) {
+         case READ:
+            return "read";
+         case WRITE:
+            return "write";
+         case EXECUTE:
+            return "execute";
+         case HOST:
+            return "host";
+      }
+      return "unknown";
+   }
+
+   private static String escape(String _string) {
+      final StringBuilder escaped = new StringBuilder();
+      for (int i = 0; i < _string.length(); i++) {
+         final char c = _string.charAt(i);
+         if (c == '"' || c == '\\') {
+            escaped.append('\\').append(c);
+         } else if (c < 0x20) {
+            escaped.append(String.format("\\u%04x", (int) c));
+         } else {
+            escaped.append(c);
+         }
+      }
+      return escaped.toString();
+   }
+
+   private static String micros(long _nanos) {
+      return String.format("%d.%03d", _nanos / 1000, _nanos % 1000);
+   }
+
+   /**
+    * @return the row an event is shown on, its queue or the host phases of its context
+    */
+   private static String row(Event _event) {
+      return (_event.type == HOST) ? String.format("host 0x%x", _event.context) : String.format("queue 0x%x", _event.queue);
+   }
+
+   /**
+    * Write events as a Chrome trace, one complete ("X") event each on the row of its queue. Times are microseconds
+    * from the earliest queued event.
+    */
+   public static void writeTrace(List<Event> _events, Writer _out) throws IOException {
+      long base = Long.MAX_VALUE;
+      final Map<String, Integer> rows = new LinkedHashMap<String, Integer>();
+      for (final Event event : _events) {
+         base = Math.min(base, event.queued);
+         final String row = row(event);
+         if (!rows.containsKey(row)) {
+            rows.put(row, rows.size() + 1);
+         }
+      }
+
+      _out.write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+      _out.write("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"aparapi\"}}");
+      for (final Map.Entry<String, Integer> row : rows.entrySet()) {
+         _out.write(String.format(",%n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+               row.getValue(), row.getKey()));
+      }
+      for (final Event event : _events) {
+         _out.write(String.format(",%n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%s,\"dur\":%s,"
+               + "\"args\":{\"kernel\":\"%s\",\"context\":\"0x%x\",\"run\":%d,\"pass\":%d,\"queuedToStartUs\":%s,"
+               + "\"sampleInterval\":%d}}",
+               escape(label(event)), category(event), rows.get(row(event)), micros(event.start - base),
+               micros(Math.max(0, event.end - event.start)), escape(event.kernel), event.context, event.run, event.pass,
+               micros(Math.max(0, event.start - event.queued)), event.sampleInterval));
+      }
+      _out.write("\n]}\n");
+      _out.flush();
+   }
+
+   public static void main(String[] _args) throws IOException {
+      if (_args.length < 1) {
+         System.err.println("usage: ProfileTraceConverter <profile file> [<trace.json>]");
+         System.exit(1);
+      }
+      final InputStream in = new BufferedInputStream(new FileInputStream(_args[0]));
+      final List<Event> events;
+      try {
+         events = read(in);
+      } finally {
+         in.close();
+      }
+      final String traceFile = (_args.length > 1) ? _args[1] : _args[0] + ".json";
+      final Writer out = new BufferedWriter(new OutputStreamWriter(new FileOutputStream(traceFile), "UTF-8"));
+      try {
+         writeTrace(events, out);
+      } finally {
+         out.close();
+      }
+      System.out.println("wrote " + events.size() + " events to " + traceFile);
+   }
+}
@@ -0,0 +1,129 @@
+package com.amd.aparapi.internal.util;
+
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+
+import com.amd.aparapi.internal.annotation.UsedByJNICode;
+import com.amd.aparapi.internal.exception.AparapiException;
+
+/**
+ * A <code>Future</code> for an asynchronous OpenCL execution.
+ * <p>
+ * The native side completes this future from an OpenCL event callback once the execution, including the read back of
+ * any results into Java arrays, has finished.
+ *
+ * @param <T> the type of the value returned once the execution completes
+ */
+public class CompletionFuture<T> implements Future<T>{
+
+   private final T value;
+
+   private boolean done = false;
+
+   private int status = 0;
+
+   public CompletionFuture(T _value) {
+      value = _value;
+   }
+
+   /**
+    * Called (possibly from a native callback thread) when the execution has completed.
+    *
+    * @param _status 0 if the execution succeeded, otherwise the OpenCL error status
+    */
+   @UsedByJNICode public synchronized void complete(int _status) {
+      status = _status;
+      done = true;
+      notifyAll();
+   }
+
+   /**
+    * Work already enqueued on an OpenCL device cannot be cancelled.
+    *
+    * @return false
+    */
+   @Override public boolean cancel(boolean _mayInterruptIfRunning) {
+      return (false);
+   }
+
+   @Override public boolean isCancelled() {
+      return (false);
+   }
+
+   @Override public synchronized boolean isDone() {
+      return (done);
+   }
+
+   /**
+    * @return the status the execution completed with, only meaningful once <code>isDone()</code>
+    */
+   public synchronized int getStatus() {
+      return (status);
+   }
+
+   @Override public synchronized T get() throws InterruptedException, ExecutionException {
+      while (!done) {
+         wait();
+      }
+      return (result());
+   }
+
+   @Override public synchronized T get(long _timeout, TimeUnit _unit) throws InterruptedException, ExecutionException,
+         TimeoutException {
+      long remaining = _unit.toNanos(_timeout);
+      final long deadline = System.nanoTime() + remaining;
+      while (!done) {
+         if (remaining <= 0) {
+            throw new TimeoutException();
+         }
+         TimeUnit.NANOSECONDS.timedWait(this, remaining);
+         remaining = deadline - System.nanoTime();
+      }
+      return (result());
+   }
+
+   /**
+    * Wait for completion without throwing, used before the resources of the execution are touched again.
+    *
+    * @return the status the execution completed with
+    */
+   public synchronized int await() {
+      boolean interrupted = false;
+      while (!done) {
+         try {
+            wait();
+         } catch (final InterruptedException e) {
+            interrupted = true;
+         }
+      }
+      if (interrupted) {
+         Thread.currentThread().interrupt();
+      }
+      return (status);
+   }
+
+   /**
+    * Wait at most <code>_millis</code> for completion without throwing.
+    *
+    * @return true if the execution has completed
+    */
+   public synchronized boolean await(long _millis) {
+      if (!done) {
+         try {
+            wait(_millis);
+         } catch (final InterruptedException e) {
+            Thread.currentThread().interrupt();
+         }
+      }
+      return (done);
+   }
+
+   private T result() throws ExecutionException {
+      if (status != 0) {
+         throw new ExecutionException(new AparapiException("OpenCL execution failed with status " + status));
+      }
+      return (value);
+   }
+}
@@ -106,8 +106,17 @@ public abstract class BlockWriter{
    public final static String arrayLengthMangleSuffix = "__javaArrayLength";
    public final static String arrayDimMangleSuffix = "__javaArrayDimension";
 
+   public final static String arrayOffsetsMangleSuffix = "__javaArrayOffsets";
+
    public abstract void write(String _string);
 
+   /**
+    * @return true if the named array field is a jagged 2D array, whose rows are found through its row offsets
+    */
+   public boolean isJaggedArray(String _arrayName) {
+      return (false);
+   }
+
    public void writeln(String _string) {
       write(_string);
       newLine();
@@ -453,10 +462,11 @@ public abstract class BlockWriter{
          }
          writeInstruction(arrayLoadInstruction.getArrayRef());
          write("[");
-         writeInstruction(arrayLoadInstruction.getArrayIndex());
 
          //object array, find the size of each object in the array
          //for 2D arrays, this size is the size of a row.
+         //jagged 2D arrays look up where the row starts instead
+         //&(arrayName[this->arrayName__javaArrayOffsets[arrayIndex]])
          if(arrayLoadInstruction instanceof I_AALOAD) {
             int dim = 0;
             Instruction load = arrayLoadInstruction.getArrayRef();
@@ -466,7 +476,16 @@ public abstract class BlockWriter{
             }
 
             String arrayName = ((AccessInstanceField)load).getConstantPoolFieldEntry().getNameAndTypeEntry().getNameUTF8Entry().getUTF8();
-            write(" * this->" + arrayName + arrayDimMangleSuffix+dim);
+            if (isJaggedArray(arrayName)) {
+               write("this->" + arrayName + arrayOffsetsMangleSuffix + "[");
+               writeInstruction(arrayLoadInstruction.getArrayIndex());
+               write("]");
+            } else {
+               writeInstruction(arrayLoadInstruction.getArrayIndex());
+               write(" * this->" + arrayName + arrayDimMangleSuffix+dim);
+            }
+         } else {
+            writeInstruction(arrayLoadInstruction.getArrayIndex());
          }
 
          write("]");
@@ -505,7 +524,17 @@ public abstract class BlockWriter{
          }
          final AccessInstanceField child = (AccessInstanceField) load;
          final String arrayName = child.getConstantPoolFieldEntry().getNameAndTypeEntry().getNameUTF8Entry().getUTF8();
-         write("this->" + arrayName + arrayLengthMangleSuffix + dim);
+         if (dim == 1 && isJaggedArray(arrayName)) {
+            //the length of a row of a jagged array is the distance to the start of the next row
+            final Instruction rowIndex = ((AccessArrayElement) _instruction.getFirstChild()).getArrayIndex();
+            write("(this->" + arrayName + arrayOffsetsMangleSuffix + "[(");
+            writeInstruction(rowIndex);
+            write(") + 1] - this->" + arrayName + arrayOffsetsMangleSuffix + "[");
+            writeInstruction(rowIndex);
+            write("])");
+         } else {
+            write("this->" + arrayName + arrayLengthMangleSuffix + dim);
+         }
       } else if (_instruction instanceof AssignToField) {
          final AssignToField assignedField = (AssignToField) _instruction;
 
@@ -39,9 +39,11 @@ package com.amd.aparapi.internal.writer;
 
 import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.HashSet;
 import java.util.Iterator;
 import java.util.List;
 import java.util.Map;
+import java.util.Set;
 
 import com.amd.aparapi.Config;
 import com.amd.aparapi.Kernel;
@@ -102,6 +104,11 @@ public abstract class KernelWriter extends BlockWriter{
 
    private Entrypoint entryPoint = null;
 
+   /**
+    * names of the jagged 2D array fields, which are indexed through their row offsets
+    */
+   private final Set<String> jaggedArrays = new HashSet<String>();
+
    public final static Map<String, String> javaToCLIdentifierMap = new HashMap<String, String>();
    {
       javaToCLIdentifierMap.put("getGlobalId()I", "get_global_id(0)");
@@ -287,12 +294,15 @@ public abstract class KernelWriter extends BlockWriter{
 
    public final static String CONSTANT_ANNOTATION_NAME = "L" + Constant.class.getName().replace(".", "/") + ";";
 
+   public final static String JAGGED_ANNOTATION_NAME = "L" + Kernel.Jagged.class.getName().replace(".", "/") + ";";
+
    @Override public void write(Entrypoint _entryPoint) throws CodeGenException {
       final List<String> thisStruct = new ArrayList<String>();
       final List<String> argLines = new ArrayList<String>();
       final List<String> assigns = new ArrayList<String>();
 
       entryPoint = _entryPoint;
+      jaggedArrays.clear();
 
       for (final ClassModelField field : _entryPoint.getReferencedClassModelFields()) {
          // Field field = _entryPoint.getClassModel().getField(f.getName());
@@ -310,6 +320,7 @@ public abstract class KernelWriter extends BlockWriter{
          String type = field.getName().endsWith(Kernel.LOCAL_SUFFIX) ? __local
                : (field.getName().endsWith(Kernel.CONSTANT_SUFFIX) ? __constant : __global);
          final RuntimeAnnotationsEntry visibleAnnotations = field.getAttributePool().getRuntimeVisibleAnnotationsEntry();
+         boolean jagged = false;
 
          if (visibleAnnotations != null) {
             for (final AnnotationInfo ai : visibleAnnotations) {
@@ -318,6 +329,8 @@ public abstract class KernelWriter extends BlockWriter{
                   type = __local;
                } else if (typeDescriptor.equals(CONSTANT_ANNOTATION_NAME)) {
                   type = __constant;
+               } else if (typeDescriptor.equals(JAGGED_ANNOTATION_NAME)) {
+                  jagged = true;
                }
             }
          }
@@ -413,6 +426,16 @@ public abstract class KernelWriter extends BlockWriter{
                thisStruct.add(dimStructLine.toString());
             }
          }
+
+         // Jagged 2D arrays are packed row after row, add the start of each row (and the end of the last)
+         // named like foo__javaArrayOffsets
+         if (jagged && numDimensions == 2 && type.equals(__global)) {
+            final String offsetsName = field.getName() + BlockWriter.arrayOffsetsMangleSuffix;
+            argLines.add(__global + " int *" + offsetsName);
+            thisStruct.add(__global + " int *" + offsetsName);
+            assigns.add("this->" + offsetsName + " = " + offsetsName);
+            jaggedArrays.add(field.getName());
+         }
       }
 
       if (Config.enableByteWrites || _entryPoint.requiresByteAddressableStorePragma()) {
@@ -592,11 +615,30 @@ public abstract class KernelWriter extends BlockWriter{
          newLine();
       }
 
-      write("__kernel void " + _entryPoint.getMethodModel().getSimpleName() + "(");
+      writeKernel(_entryPoint.getMethodModel(), argLines, assigns);
+
+      // the other entrypoints take exactly the same args so the runtime can dispatch any of them against the same buffers
+      for (final MethodModel mm : _entryPoint.getEntrypointMethods()) {
+         newLine();
+         writeKernel(mm, argLines, assigns);
+      }
+      out();
+   }
+
+   /**
+    * Write a <code>__kernel</code> function which unpacks the args into the 'this' struct and then runs the body of an entrypoint.
+    * 
+    * @param _methodModel the entrypoint method
+    * @param _argLines the kernel args
+    * @param _assigns the assignments of the args into the 'this' struct
+    * @throws CodeGenException
+    */
+   private void writeKernel(MethodModel _methodModel, List<String> _argLines, List<String> _assigns) throws CodeGenException {
+      write("__kernel void " + _methodModel.getSimpleName() + "(");
 
       in();
       boolean first = true;
-      for (final String line : argLines) {
+      for (final String line : _argLines) {
 
          if (first) {
             first = false;
@@ -622,18 +664,21 @@ public abstract class KernelWriter extends BlockWriter{
       newLine();
       writeln("This thisStruct;");
       writeln("This* this=&thisStruct;");
-      for (final String line : assigns) {
+      for (final String line : _assigns) {
          write(line);
          writeln(";");
       }
       write("this->passid = passid");
       writeln(";");
 
-      writeMethodBody(_entryPoint.getMethodModel());
+      writeMethodBody(_methodModel);
       out();
       newLine();
       writeln("}");
-      out();
+   }
+
+   @Override public boolean isJaggedArray(String _arrayName) {
+      return (jaggedArrays.contains(_arrayName));
    }
 
    @Override public void writeThisRef() {
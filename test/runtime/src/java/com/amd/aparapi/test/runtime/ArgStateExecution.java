@@ -0,0 +1,138 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.util.Arrays;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class ArgStateExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class PrimitivesKernel extends Kernel{
+
+      static int offset;
+
+      int scale;
+
+      float bias;
+
+      long big;
+
+      boolean negate;
+
+      byte shift;
+
+      float[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         float value = (gid * scale) + bias + (float) (big - 10000000000L) + shift + offset;
+         if (negate) {
+            value = -value;
+         }
+         values[gid] = value;
+      }
+
+   }
+
+   private static void check(PrimitivesKernel kernel, int size) {
+      for (int i = 0; i < kernel.values.length; i++) {
+         float expected = 0f;
+         if (i < size) {
+            expected = (i * kernel.scale) + kernel.bias + (float) (kernel.big - 10000000000L) + kernel.shift + PrimitivesKernel.offset;
+            if (kernel.negate) {
+               expected = -expected;
+            }
+         }
+         assertEquals("values[" + i + "]", expected, kernel.values[i], 0.001f);
+      }
+   }
+
+   @Test public void primitivesAndRangeChangeBetweenRuns() {
+
+      final int SIZE = 1024;
+      final PrimitivesKernel kernel = new PrimitivesKernel();
+      kernel.values = new float[SIZE];
+
+      for (int run = 0; run < 4; run++) {
+         // every primitive, including the static one, and the global size change between runs
+         final int size = SIZE >> run;
+         final Range range = openCLDevice.createRange(size);
+         PrimitivesKernel.offset = run * 3;
+         kernel.scale = run + 1;
+         kernel.bias = run * 0.5f;
+         kernel.big = 10000000000L + run;
+         kernel.negate = (run % 2) == 1;
+         kernel.shift = (byte) (run * 2);
+
+         Arrays.fill(kernel.values, 0f);
+         kernel.execute(range);
+         assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+         check(kernel, size);
+      }
+
+      kernel.dispose();
+   }
+
+   public static class CopyKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      int add;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] + add;
+      }
+
+   }
+
+   @Test public void unchangedArgsAreKeptAndChangedOnesSet() {
+
+      final int SIZE = 512;
+      final CopyKernel kernel = new CopyKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+      final int[] a = new int[SIZE];
+      final int[] b = new int[SIZE];
+      for (int i = 0; i < SIZE; i++) {
+         a[i] = i;
+         b[i] = SIZE - i;
+      }
+
+      kernel.out = new int[SIZE];
+      for (int run = 0; run < 6; run++) {
+         // the input array only changes every other run, the primitive only every third
+         kernel.in = ((run / 2) % 2 == 0) ? a : b;
+         kernel.add = run / 3;
+         kernel.execute(range);
+         assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+         for (int i = 0; i < SIZE; i++) {
+            assertEquals("run " + run + " out[" + i + "]", kernel.in[i] + kernel.add, kernel.out[i]);
+         }
+      }
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,119 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.util.concurrent.Future;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class AsyncExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class ScaleKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      int scale;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] * scale;
+      }
+
+   }
+
+   @Test public void asyncMatchesExpected() throws Exception {
+
+      final int SIZE = 1024 * 16;
+      final ScaleKernel kernel = new ScaleKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      kernel.scale = 3;
+
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      final int[] expected = new int[SIZE];
+      for (int i = 0; i < SIZE; i++) {
+         expected[i] = kernel.in[i] * kernel.scale;
+      }
+
+      final Future<Kernel> future = kernel.executeAsync(range);
+      assertTrue("future yields the kernel", future.get() == kernel);
+      assertTrue("async out == expected", Util.same(kernel.out, expected));
+
+      // a second async execution is only started once the first has completed
+      Util.zero(kernel.out);
+      kernel.executeAsync(range);
+      final Future<Kernel> second = kernel.executeAsync(range);
+      second.get();
+      assertTrue("second async out == expected", Util.same(kernel.out, expected));
+
+      // a synchronous execution after an async one must also see the results
+      Util.zero(kernel.out);
+      kernel.executeAsync(range);
+      kernel.execute(range);
+      assertTrue("sync after async out == expected", Util.same(kernel.out, expected));
+
+      kernel.dispose();
+   }
+
+   @Test public void syncAfterAsyncUploadsChangedInput() throws Exception {
+
+      final int SIZE = 1024 * 16;
+      final ScaleKernel kernel = new ScaleKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      kernel.scale = 2;
+
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+      kernel.executeAsync(range).get();
+
+      // the async execution's device resident buffers must not outlive it, the next run uploads as usual
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = SIZE - index;
+         }
+      });
+      kernel.execute(range);
+
+      final int[] expected = new int[SIZE];
+      for (int i = 0; i < SIZE; i++) {
+         expected[i] = (SIZE - i) * kernel.scale;
+      }
+      assertTrue("sync out == expected from the changed input", Util.same(kernel.out, expected));
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,114 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class ChunkedExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class PairSumKernel extends Kernel{
+
+      @Kernel.Chunked(stride = 2) int[] pairs;
+
+      @Kernel.Chunked int[] sums;
+
+      int bias;
+
+      @Override public void run() {
+         int gid = getGlobalId(0);
+         sums[gid] = pairs[gid * 2] + pairs[gid * 2 + 1] + bias;
+      }
+
+   }
+
+   @Test public void chunkedMatchesWhole() {
+
+      final int SIZE = 1024 * 64;
+      final PairSumKernel kernel = new PairSumKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.pairs = new int[SIZE * 2];
+      kernel.sums = new int[SIZE];
+      kernel.bias = 3;
+
+      Util.fill(kernel.pairs, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      kernel.setExecutionChunks(4);
+      kernel.execute(range);
+
+      final int[] expected = new int[SIZE];
+      for (int i = 0; i < SIZE; i++) {
+         expected[i] = kernel.pairs[i * 2] + kernel.pairs[i * 2 + 1] + kernel.bias;
+      }
+
+      assertTrue("chunked sums == expected", Util.same(kernel.sums, expected));
+
+      // run again to check the chunk queues and buffers are reused correctly
+      Util.zero(kernel.sums);
+      kernel.execute(range);
+      assertTrue("second chunked sums == expected", Util.same(kernel.sums, expected));
+
+      kernel.dispose();
+   }
+
+   public static class MirrorKernel extends Kernel{
+
+      @Kernel.Chunked int[] in;
+
+      @Kernel.Chunked int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId(0);
+         out[gid] = in[getGlobalSize() - 1 - gid];
+      }
+
+   }
+
+   @Test public void globalSizeKernelRunsWhole() {
+
+      final int SIZE = 1024 * 64;
+      final MirrorKernel kernel = new MirrorKernel();
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      // a chunk would see its own global size, so the kernel is not chunked
+      kernel.setExecutionChunks(4);
+      kernel.execute(openCLDevice.createRange(SIZE));
+
+      for (int i = 0; i < SIZE; i++) {
+         if (kernel.out[i] != SIZE - 1 - i) {
+            fail("out[" + i + "] = " + kernel.out[i]);
+         }
+      }
+
+      kernel.dispose();
+   }
+
+}
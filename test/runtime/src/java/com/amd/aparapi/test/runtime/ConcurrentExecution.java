@@ -0,0 +1,133 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class ConcurrentExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   static final int THREADS = 8;
+
+   static final int KERNELS_PER_THREAD = 4;
+
+   static final int RUNS = 50;
+
+   static final int SIZE = 4096;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class ScaleKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      int scale;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] * scale;
+      }
+
+   }
+
+   /**
+    * Creates its own kernels then runs each of them in turn, checking every result.
+    */
+   static class Worker implements Callable<Void>{
+
+      final int id;
+
+      Worker(int _id) {
+         id = _id;
+      }
+
+      @Override public Void call() {
+         final Range range = openCLDevice.createRange(SIZE);
+         final ScaleKernel[] kernels = new ScaleKernel[KERNELS_PER_THREAD];
+         for (int k = 0; k < kernels.length; k++) {
+            kernels[k] = new ScaleKernel();
+            kernels[k].in = new int[SIZE];
+            kernels[k].out = new int[SIZE];
+            for (int i = 0; i < SIZE; i++) {
+               kernels[k].in[i] = i + id;
+            }
+         }
+         for (int run = 0; run < RUNS; run++) {
+            for (int k = 0; k < kernels.length; k++) {
+               final ScaleKernel kernel = kernels[k];
+               kernel.scale = run + k;
+               kernel.execute(range);
+               assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+               for (int i = 0; i < SIZE; i++) {
+                  assertEquals("thread " + id + " kernel " + k + " run " + run + " out[" + i + "]", kernel.in[i] * kernel.scale,
+                        kernel.out[i]);
+               }
+            }
+         }
+         for (int k = 0; k < kernels.length; k++) {
+            kernels[k].dispose();
+         }
+         return null;
+      }
+   }
+
+   private static void runThreads(int threads) throws Exception {
+      final ExecutorService pool = Executors.newFixedThreadPool(threads);
+      try {
+         final List<Future<Void>> results = new ArrayList<Future<Void>>();
+         for (int t = 0; t < threads; t++) {
+            results.add(pool.submit(new Worker(t)));
+         }
+         for (Future<Void> result : results) {
+            // rethrows any assertion a worker failed
+            result.get();
+         }
+      } finally {
+         pool.shutdown();
+      }
+   }
+
+   @Test public void threadsCreateAndRunKernelsConcurrently() throws Exception {
+      runThreads(1);
+      runThreads(THREADS);
+
+      // the trackers take no lock, every handle the threads created and released must still have been matched
+      final ScaleKernel kernel = new ScaleKernel();
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      kernel.execute(openCLDevice.createRange(SIZE));
+      final String report = kernel.getOpenCLResourceReport();
+      for (final String line : report.split("\n")) {
+         if (line.endsWith("unmatched releases")) {
+            assertTrue(report, line.endsWith(" 0 unmatched releases"));
+         }
+      }
+      kernel.dispose();
+   }
+
+}
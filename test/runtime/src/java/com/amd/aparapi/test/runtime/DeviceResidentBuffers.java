@@ -0,0 +1,104 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.TransferCounters;
+import com.amd.aparapi.TransferCounters.COUNTER;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class DeviceResidentBuffers{
+
+   static{
+      // each test class runs in its own vm, so this is set before the config is read
+      System.setProperty("com.amd.aparapi.enableDeviceResidentBuffers", "true");
+   }
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class IncrementKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = values[gid] + 1;
+      }
+
+   }
+
+   @Test public void buffersOutliveTheirRuns() {
+
+      final int SIZE = 1024;
+      final IncrementKernel kernel = new IncrementKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+      kernel.values = new int[SIZE];
+
+      kernel.execute(range);
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      final TransferCounters first = kernel.getTransferCounters();
+
+      // the array may move between runs, the buffer is still kept as the array is never left pinned
+      for (int run = 0; run < 3; run++) {
+         System.gc();
+         kernel.execute(range);
+      }
+      final TransferCounters later = kernel.getTransferCounters().since(first);
+      assertEquals(later.toString(), 0, later.get(COUNTER.BUFFERS_CREATED));
+      assertEquals(later.toString(), 0, later.get(COUNTER.REALLOC_MOVED));
+      assertEquals(later.toString(), 3 * SIZE * 4, later.get(COUNTER.BYTES_UPLOADED));
+      assertEquals(later.toString(), 3 * SIZE * 4, later.get(COUNTER.BYTES_DOWNLOADED));
+      for (int i = 0; i < SIZE; i++) {
+         assertEquals("values[" + i + "]", 4, kernel.values[i]);
+      }
+
+      kernel.dispose();
+   }
+
+   @Test public void explicitRunsSkipTransfers() {
+
+      final int SIZE = 1024;
+      final IncrementKernel kernel = new IncrementKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+      kernel.values = new int[SIZE];
+
+      kernel.setExplicit(true);
+      kernel.put(kernel.values);
+      kernel.execute(range);
+      final TransferCounters first = kernel.getTransferCounters();
+
+      // nothing is put or got, so the runs leave the values on the device
+      kernel.execute(range);
+      kernel.execute(range);
+      final TransferCounters skipped = kernel.getTransferCounters().since(first);
+      assertEquals(skipped.toString(), 0, skipped.get(COUNTER.BYTES_UPLOADED));
+      assertEquals(skipped.toString(), 0, skipped.get(COUNTER.BYTES_DOWNLOADED));
+      for (int i = 0; i < SIZE; i++) {
+         assertEquals("values[" + i + "] untouched on the host", 0, kernel.values[i]);
+      }
+
+      kernel.get(kernel.values);
+      for (int i = 0; i < SIZE; i++) {
+         assertEquals("values[" + i + "]", 3, kernel.values[i]);
+      }
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,90 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class JaggedArrayExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class RowSumKernel extends Kernel{
+
+      @Jagged int[][] rows;
+
+      int[] sums;
+
+      @Override public void run() {
+         int row = getGlobalId();
+         int sum = 0;
+         for (int i = 0; i < rows[row].length; i++) {
+            sum += rows[row][i];
+            rows[row][i] = rows[row][i] * 2;
+         }
+         sums[row] = sum;
+      }
+
+   }
+
+   private static int[][] createRows(int _count, int _shift) {
+      final int[][] rows = new int[_count][];
+      for (int r = 0; r < _count; r++) {
+         // lengths 0, 1, ... 12 so some rows are empty and the first is not the longest
+         rows[r] = new int[(r + _shift) % 13];
+         for (int i = 0; i < rows[r].length; i++) {
+            rows[r][i] = r + i;
+         }
+      }
+      return (rows);
+   }
+
+   private static void check(RowSumKernel _kernel, int[][] _original) {
+      for (int r = 0; r < _original.length; r++) {
+         int sum = 0;
+         for (int i = 0; i < _original[r].length; i++) {
+            sum += _original[r][i];
+            assertEquals("rows[" + r + "][" + i + "]", 2 * _original[r][i], _kernel.rows[r][i]);
+         }
+         assertEquals("sums[" + r + "]", sum, _kernel.sums[r]);
+         assertEquals("row " + r + " keeps its length", _original[r].length, _kernel.rows[r].length);
+      }
+   }
+
+   @Test public void rowsArePackedAndScatteredBack() {
+
+      final int COUNT = 256;
+      final RowSumKernel kernel = new RowSumKernel();
+      final Range range = openCLDevice.createRange(COUNT);
+
+      kernel.rows = createRows(COUNT, 0);
+      kernel.sums = new int[COUNT];
+      kernel.execute(range);
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      check(kernel, createRows(COUNT, 0));
+
+      // the same row count with different row lengths needs new offsets
+      kernel.rows = createRows(COUNT, 5);
+      kernel.execute(range);
+      check(kernel, createRows(COUNT, 5));
+
+      kernel.dispose();
+   }
+
+}
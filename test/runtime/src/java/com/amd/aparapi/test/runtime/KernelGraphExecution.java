@@ -0,0 +1,124 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.KernelGraph;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class KernelGraphExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class ScaleKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] * 2;
+      }
+
+   }
+
+   public static class OffsetKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      int offset;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] + offset;
+      }
+
+   }
+
+   public static class SumKernel extends Kernel{
+
+      int[] a;
+
+      int[] b;
+
+      int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = a[gid] + b[gid];
+      }
+
+   }
+
+   @Test public void graphMatchesExpected() {
+
+      final int SIZE = 1024 * 16;
+      final Range range = openCLDevice.createRange(SIZE);
+
+      final int[] source = new int[SIZE];
+      final int[] scaled = new int[SIZE];
+      final int[] offset = new int[SIZE];
+      final int[] result = new int[SIZE];
+
+      // scale and offset both read source and can run side by side, sum waits for both
+      final ScaleKernel scale = new ScaleKernel();
+      scale.in = source;
+      scale.out = scaled;
+      final OffsetKernel offsetKernel = new OffsetKernel();
+      offsetKernel.in = source;
+      offsetKernel.out = offset;
+      offsetKernel.offset = 3;
+      final SumKernel sum = new SumKernel();
+      sum.a = scaled;
+      sum.b = offset;
+      sum.out = result;
+
+      final KernelGraph graph = new KernelGraph();
+      graph.add(scale, range).add(offsetKernel, range).add(sum, range);
+      graph.input(source).output(result);
+
+      for (int run = 0; run < 3; run++) {
+         final int base = run * 100;
+         Util.fill(source, new Util.Filler(){
+            public void fill(int[] array, int index) {
+               array[index] = index + base;
+            }
+         });
+         Util.zero(result);
+
+         graph.run();
+
+         final int[] expected = new int[SIZE];
+         for (int i = 0; i < SIZE; i++) {
+            expected[i] = (source[i] * 2) + (source[i] + 3);
+         }
+         assertTrue("run " + run + " result == expected", Util.same(result, expected));
+      }
+
+      assertTrue("graph runs natively", graph.isNative());
+
+      graph.dispose();
+      scale.dispose();
+      offsetKernel.dispose();
+      sum.dispose();
+   }
+
+}
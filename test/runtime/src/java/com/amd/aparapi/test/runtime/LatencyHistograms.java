@@ -0,0 +1,80 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.util.List;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.LatencySummary;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class LatencyHistograms{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class SquareKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = values[gid] * values[gid];
+      }
+
+   }
+
+   private static LatencySummary find(List<LatencySummary> _summaries, LatencySummary.METRIC _metric) {
+      for (final LatencySummary summary : _summaries) {
+         if (summary.getMetric() == _metric) {
+            return (summary);
+         }
+      }
+      fail("no summary for " + _metric);
+      return (null);
+   }
+
+   @Test public void percentilesCoverEveryRunAndResetOnRead() {
+
+      final int runs = 20;
+      final SquareKernel kernel = new SquareKernel();
+      final Range range = openCLDevice.createRange(1024);
+      kernel.values = new int[1024];
+      for (int i = 0; i < runs; i++) {
+         kernel.execute(range);
+      }
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+
+      final List<LatencySummary> summaries = kernel.getLatencySummaries();
+      final LatencySummary run = find(summaries, LatencySummary.METRIC.RUN_NANOS);
+      assertEquals(run.toString(), runs, run.getCount());
+      assertTrue(run.toString(), run.getP50() <= run.getP90());
+      assertTrue(run.toString(), run.getP90() <= run.getP99());
+      assertTrue(run.toString(), run.getP99() <= run.getMax());
+
+      final LatencySummary upload = find(summaries, LatencySummary.METRIC.UPLOAD_BYTES);
+      assertEquals(upload.toString(), runs, upload.getCount());
+      assertTrue(upload.toString(), upload.getMax() >= 1024 * 4);
+
+      final LatencySummary again = find(kernel.getLatencySummaries(), LatencySummary.METRIC.RUN_NANOS);
+      assertEquals("read resets the histograms", 0, again.getCount());
+
+      kernel.dispose();
+   }
+
+}
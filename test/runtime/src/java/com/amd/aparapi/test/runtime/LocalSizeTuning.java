@@ -0,0 +1,141 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertNotNull;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.IOException;
+import java.io.InputStreamReader;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class LocalSizeTuning{
+
+   static final String TUNING_FILE = "com.amd.aparapi.localSizeTuningFile";
+
+   static final int SIZE = 1 << 16;
+
+   static{
+      // each test class runs in its own vm, so these are set before the config is read
+      System.setProperty("com.amd.aparapi.enableLocalSizeTuning", "true");
+      System.setProperty("com.amd.aparapi.localSizeTuningTrials", "1");
+      if (System.getProperty(TUNING_FILE) == null) {
+         System.setProperty(TUNING_FILE, new File(System.getProperty("java.io.tmpdir"), "aparapi-tuning-" + System.nanoTime()
+               + ".txt").getPath());
+      }
+   }
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class DoubleKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = gid * 2;
+      }
+
+   }
+
+   /**
+    * @return the tuned line of the run entrypoint over global sizes 2^16, null until the tuning file has one
+    */
+   static String[] tunedEntry(File file) throws IOException {
+      if (!file.exists()) {
+         return (null);
+      }
+      final BufferedReader reader = new BufferedReader(new FileReader(file));
+      try {
+         for (String line = reader.readLine(); line != null; line = reader.readLine()) {
+            final String[] fields = line.trim().split(" ");
+            if (!line.startsWith("#") && fields.length == 5 && fields[2].equals("run") && fields[3].equals("16")) {
+               return (fields);
+            }
+         }
+      } finally {
+         reader.close();
+      }
+      return (null);
+   }
+
+   @Test public void convergesAndPersists() throws Exception {
+
+      final File file = new File(System.getProperty(TUNING_FILE));
+      file.delete();
+
+      final DoubleKernel kernel = new DoubleKernel();
+      kernel.values = new int[SIZE];
+      // the local size is derived, so it may be tuned
+      final Range range = openCLDevice.createRange(SIZE);
+
+      // one timed run per candidate, a handful of candidates per power of two up to the max group size
+      String[] entry = null;
+      for (int run = 0; run < 200 && entry == null; run++) {
+         Util.zero(kernel.values);
+         kernel.execute(range);
+         for (int i = 0; i < SIZE; i++) {
+            assertEquals("run " + run + " values[" + i + "]", i * 2, kernel.values[i]);
+         }
+         entry = tunedEntry(file);
+      }
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      assertNotNull("tuned entry written to " + file, entry);
+      final long localSize = Long.parseLong(entry[4]);
+      assertTrue("tuned local size " + localSize + " divides " + SIZE, localSize == 0 || (SIZE % localSize) == 0);
+      kernel.dispose();
+
+      // a new vm reads the entry, so starts tuned rather than timing the candidates again
+      final ProcessBuilder builder = new ProcessBuilder(new File(System.getProperty("java.home"), "bin/java").getPath(), "-cp",
+            System.getProperty("java.class.path"), "-Djava.library.path=" + System.getProperty("java.library.path"), "-D"
+                  + TUNING_FILE + "=" + file.getPath(), "-Dcom.amd.aparapi.enableVerboseJNI=true", LocalSizeTuning.class.getName());
+      builder.redirectErrorStream(true);
+      final Process process = builder.start();
+      final StringBuilder output = new StringBuilder();
+      final BufferedReader reader = new BufferedReader(new InputStreamReader(process.getInputStream()));
+      for (String line = reader.readLine(); line != null; line = reader.readLine()) {
+         output.append(line).append('\n');
+      }
+      reader.close();
+      assertEquals(output.toString(), 0, process.waitFor());
+      assertTrue(output.toString(), output.indexOf("ran on OpenCL") >= 0);
+      assertFalse(output.toString(), output.indexOf("tuning local size of run") >= 0);
+
+      file.delete();
+   }
+
+   /**
+    * runs the kernel once in a vm started by convergesAndPersists
+    */
+   public static void main(String[] _args) {
+      final DoubleKernel kernel = new DoubleKernel();
+      kernel.values = new int[SIZE];
+      final Device device = Device.best();
+      kernel.execute(((OpenCLDevice) device).createRange(SIZE));
+      if (kernel.getExecutionMode().isOpenCL()) {
+         System.out.println("ran on OpenCL");
+      }
+      kernel.dispose();
+   }
+
+}
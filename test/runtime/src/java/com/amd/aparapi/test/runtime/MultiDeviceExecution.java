@@ -0,0 +1,164 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class MultiDeviceExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class SquareKernel extends Kernel{
+
+      int[] in;
+
+      @Kernel.Chunked(stride = 2) int[] pairs;
+
+      @Kernel.Chunked int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] * in[gid];
+         pairs[gid * 2] = in[gid];
+         pairs[gid * 2 + 1] = -in[gid];
+      }
+
+   }
+
+   public static class ReverseKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[getGlobalSize() - 1 - gid] = in[gid];
+      }
+
+   }
+
+   public static class MirrorKernel extends Kernel{
+
+      int[] in;
+
+      @Kernel.Chunked int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[getGlobalSize() - 1 - gid];
+      }
+
+   }
+
+   @Test public void splitMatchesExpected() {
+
+      final int SIZE = 1024 * 16;
+      final SquareKernel kernel = new SquareKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.in = new int[SIZE];
+      kernel.pairs = new int[SIZE * 2];
+      kernel.out = new int[SIZE];
+
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      final int[] expected = new int[SIZE];
+      final int[] expectedPairs = new int[SIZE * 2];
+      for (int i = 0; i < SIZE; i++) {
+         expected[i] = kernel.in[i] * kernel.in[i];
+         expectedPairs[i * 2] = kernel.in[i];
+         expectedPairs[i * 2 + 1] = -kernel.in[i];
+      }
+
+      // two contexts on the same device still split the range and merge the outputs
+      kernel.setExecutionDevices(openCLDevice, openCLDevice);
+      kernel.setExecutionDeviceWeights(1f, 3f);
+      kernel.execute(range);
+
+      assertTrue("split out == expected", Util.same(kernel.out, expected));
+      assertTrue("split pairs == expected", Util.same(kernel.pairs, expectedPairs));
+
+      // run again with rebalanced weights to check the per device buffers are reused correctly
+      Util.zero(kernel.out);
+      Util.zero(kernel.pairs);
+      kernel.setDynamicRebalancing(true);
+      kernel.execute(range);
+      kernel.execute(range);
+      assertTrue("rebalanced out == expected", Util.same(kernel.out, expected));
+      assertTrue("rebalanced pairs == expected", Util.same(kernel.pairs, expectedPairs));
+
+      kernel.dispose();
+   }
+
+   @Test public void unchunkedOutputRunsWhole() {
+
+      final int SIZE = 1024 * 16;
+      final ReverseKernel kernel = new ReverseKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      // each work item writes outside its own slice, so merging by slice would lose most of the output
+      kernel.setExecutionDevices(openCLDevice, openCLDevice);
+      kernel.execute(range);
+
+      for (int i = 0; i < SIZE; i++) {
+         assertTrue("out[" + i + "] == in[" + (SIZE - 1 - i) + "]", kernel.out[i] == kernel.in[SIZE - 1 - i]);
+      }
+
+      kernel.dispose();
+   }
+
+   @Test public void globalSizeKernelRunsWhole() {
+
+      final int SIZE = 1024 * 16;
+      final MirrorKernel kernel = new MirrorKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      // out is chunked, but a share would read its own global size and mirror within itself
+      kernel.setExecutionDevices(openCLDevice, openCLDevice);
+      kernel.execute(range);
+
+      for (int i = 0; i < SIZE; i++) {
+         assertTrue("out[" + i + "] == in[" + (SIZE - 1 - i) + "]", kernel.out[i] == kernel.in[SIZE - 1 - i]);
+      }
+
+      kernel.dispose();
+   }
+
+}
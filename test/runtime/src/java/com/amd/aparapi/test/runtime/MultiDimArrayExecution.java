@@ -0,0 +1,208 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class MultiDimArrayExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class Scale2DKernel extends Kernel{
+
+      int[][] in;
+
+      int[][] out;
+
+      @Override public void run() {
+         int x = getGlobalId(0);
+         int y = getGlobalId(1);
+         out[x][y] = in[x][y] * 2;
+      }
+
+   }
+
+   public static class Scale3DKernel extends Kernel{
+
+      float[][][] in;
+
+      float[][][] out;
+
+      @Override public void run() {
+         int x = getGlobalId(0);
+         int y = getGlobalId(1);
+         int z = getGlobalId(2);
+         out[x][y][z] = in[x][y][z] * 2f;
+      }
+
+   }
+
+   public static class Scale4DKernel extends Kernel{
+
+      int[][][][] in;
+
+      int[][][][] out;
+
+      @Override public void run() {
+         int x = getGlobalId(0);
+         int y = getGlobalId(1);
+         int z = getGlobalId(2);
+         for (int w = 0; w < in[x][y][z].length; w++) {
+            out[x][y][z][w] = in[x][y][z][w] * 2;
+         }
+      }
+
+   }
+
+   @Test public void rowsAreCopiedBothWays2D() {
+
+      // several chunks worth of rows so the packing is spread over the workers
+      final int ROWS = 600;
+      final int COLS = 1000;
+      final Scale2DKernel kernel = new Scale2DKernel();
+      kernel.in = new int[ROWS][COLS];
+      kernel.out = new int[ROWS][COLS];
+      for (int i = 0; i < ROWS; i++) {
+         for (int j = 0; j < COLS; j++) {
+            kernel.in[i][j] = i * COLS + j;
+         }
+      }
+
+      kernel.execute(openCLDevice.createRange2D(ROWS, COLS, 8, 8));
+
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      for (int i = 0; i < ROWS; i++) {
+         for (int j = 0; j < COLS; j++) {
+            assertEquals("out[" + i + "][" + j + "]", 2 * (i * COLS + j), kernel.out[i][j]);
+         }
+      }
+
+      kernel.dispose();
+   }
+
+   @Test public void rowsAreCopiedBothWays3D() {
+
+      final int X = 4;
+      final int Y = 300;
+      final int Z = 300;
+      final Scale3DKernel kernel = new Scale3DKernel();
+      kernel.in = new float[X][Y][Z];
+      kernel.out = new float[X][Y][Z];
+      for (int i = 0; i < X; i++) {
+         for (int j = 0; j < Y; j++) {
+            for (int k = 0; k < Z; k++) {
+               kernel.in[i][j][k] = (i * Y + j) * Z + k;
+            }
+         }
+      }
+
+      kernel.execute(openCLDevice.createRange3D(X, Y, Z, 2, 2, 2));
+
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      for (int i = 0; i < X; i++) {
+         for (int j = 0; j < Y; j++) {
+            for (int k = 0; k < Z; k++) {
+               assertEquals("out[" + i + "][" + j + "][" + k + "]", 2f * ((i * Y + j) * Z + k), kernel.out[i][j][k], 0f);
+            }
+         }
+      }
+
+      kernel.dispose();
+   }
+
+   @Test public void buffersAreReusedAcrossRuns() {
+
+      final int ROWS = 64;
+      final int COLS = 64;
+      final Scale2DKernel kernel = new Scale2DKernel();
+      kernel.in = new int[ROWS][COLS];
+      kernel.out = new int[ROWS][COLS];
+
+      // the same shape each run keeps the device buffers, the host changes must still be seen
+      for (int run = 1; run <= 3; run++) {
+         for (int i = 0; i < ROWS; i++) {
+            for (int j = 0; j < COLS; j++) {
+               kernel.in[i][j] = run * (i + j);
+            }
+         }
+         kernel.execute(openCLDevice.createRange2D(ROWS, COLS, 8, 8));
+         for (int i = 0; i < ROWS; i++) {
+            for (int j = 0; j < COLS; j++) {
+               assertEquals("run " + run + " out[" + i + "][" + j + "]", 2 * run * (i + j), kernel.out[i][j]);
+            }
+         }
+      }
+
+      // a new shape replaces them
+      kernel.in = new int[ROWS * 2][COLS];
+      kernel.out = new int[ROWS * 2][COLS];
+      for (int i = 0; i < ROWS * 2; i++) {
+         for (int j = 0; j < COLS; j++) {
+            kernel.in[i][j] = i - j;
+         }
+      }
+      kernel.execute(openCLDevice.createRange2D(ROWS * 2, COLS, 8, 8));
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      for (int i = 0; i < ROWS * 2; i++) {
+         for (int j = 0; j < COLS; j++) {
+            assertEquals("resized out[" + i + "][" + j + "]", 2 * (i - j), kernel.out[i][j]);
+         }
+      }
+
+      kernel.dispose();
+   }
+
+   @Test public void rowsAreCopiedBothWays4D() {
+
+      final int X = 4;
+      final int Y = 8;
+      final int Z = 16;
+      final int W = 32;
+      final Scale4DKernel kernel = new Scale4DKernel();
+      kernel.in = new int[X][Y][Z][W];
+      kernel.out = new int[X][Y][Z][W];
+      for (int i = 0; i < X; i++) {
+         for (int j = 0; j < Y; j++) {
+            for (int k = 0; k < Z; k++) {
+               for (int l = 0; l < W; l++) {
+                  kernel.in[i][j][k][l] = ((i * Y + j) * Z + k) * W + l;
+               }
+            }
+         }
+      }
+
+      kernel.execute(openCLDevice.createRange3D(X, Y, Z, 2, 2, 2));
+
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+      for (int i = 0; i < X; i++) {
+         for (int j = 0; j < Y; j++) {
+            for (int k = 0; k < Z; k++) {
+               for (int l = 0; l < W; l++) {
+                  assertEquals("out[" + i + "][" + j + "][" + k + "][" + l + "]", 2 * (((i * Y + j) * Z + k) * W + l),
+                        kernel.out[i][j][k][l]);
+               }
+            }
+         }
+      }
+
+      kernel.dispose();
+   }
+
+}
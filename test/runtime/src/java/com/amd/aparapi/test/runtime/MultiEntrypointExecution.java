@@ -0,0 +1,111 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class MultiEntrypointExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class PhaseKernel extends Kernel{
+
+      int[] values;
+
+      int[] scratch;
+
+      int bias;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         scratch[gid] = values[gid] * 2;
+      }
+
+      @EntryPoint public void addBias() {
+         int gid = getGlobalId();
+         scratch[gid] = scratch[gid] + bias;
+      }
+
+      @EntryPoint public void store() {
+         int gid = getGlobalId();
+         values[gid] = scratch[gid];
+      }
+
+   }
+
+   @Test public void phasesShareBuffers() {
+
+      final int SIZE = 1024 * 16;
+      final PhaseKernel kernel = new PhaseKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.values = new int[SIZE];
+      kernel.scratch = new int[SIZE];
+      kernel.bias = 5;
+
+      Util.fill(kernel.values, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      final int[] expected = new int[SIZE];
+      for (int i = 0; i < SIZE; i++) {
+         expected[i] = (kernel.values[i] * 2) + kernel.bias;
+      }
+
+      // the phases only see each other's results if they share the device buffers
+      kernel.setExplicit(true);
+      kernel.put(kernel.values);
+      kernel.execute(range);
+      kernel.execute("addBias", range);
+      kernel.execute("store", range);
+      kernel.get(kernel.values);
+
+      assertTrue("values == expected", Util.same(kernel.values, expected));
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+
+      kernel.dispose();
+   }
+
+   @Test public void namedEntrypointImplicitTransfers() {
+
+      final int SIZE = 1024;
+      final PhaseKernel kernel = new PhaseKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.values = new int[SIZE];
+      kernel.scratch = new int[SIZE];
+      kernel.bias = 7;
+
+      // a named entrypoint can be the first execution of a kernel
+      kernel.execute("addBias", range);
+
+      final int[] expected = new int[SIZE];
+      Util.fill(expected, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = 7;
+         }
+      });
+      assertTrue("scratch == expected", Util.same(kernel.scratch, expected));
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,67 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class MultiPassExecution{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class AccumulateKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = values[gid] + getPassId();
+      }
+
+   }
+
+   @Test public void passesSeeEachOthersResults() {
+
+      final int SIZE = 1024;
+      final int PASSES = 200;
+      final AccumulateKernel kernel = new AccumulateKernel();
+      final Range range = openCLDevice.createRange(SIZE);
+
+      kernel.values = new int[SIZE];
+
+      // every pass must run after the one before with its own passid
+      kernel.execute(range, PASSES);
+
+      final int[] expected = new int[SIZE];
+      Util.fill(expected, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = (PASSES * (PASSES - 1)) / 2;
+         }
+      });
+      assertTrue("values == expected", Util.same(kernel.values, expected));
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+
+      // and again, the work group size is now cached
+      Util.zero(kernel.values);
+      kernel.execute(range, PASSES);
+      assertTrue("second execution values == expected", Util.same(kernel.values, expected));
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,119 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assume.assumeTrue;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class NUMAExecution{
+
+   static{
+      // each test class runs in its own vm, so this is set before the config is read
+      System.setProperty("com.amd.aparapi.enableNUMAFission", "true");
+   }
+
+   static OpenCLDevice cpuDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.firstCPU();
+      if (device instanceof OpenCLDevice) {
+         cpuDevice = (OpenCLDevice) device;
+      }
+   }
+
+   public static class SmoothKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      // not getGlobalSize(), a kernel reading it is never split
+      int size;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         int left = in[(gid + size - 1) % size];
+         int right = in[(gid + 1) % size];
+         out[gid] = left + in[gid] * 2 + right + getPassId();
+      }
+
+   }
+
+   @Test public void splitMatchesUnsplit() {
+
+      // only a CPU device is split into its NUMA nodes
+      assumeTrue(cpuDevice != null);
+
+      // an odd number of groups so the nodes get unequal shares
+      final int SIZE = 64 * 37;
+      final int PASSES = 3;
+
+      final SmoothKernel split = new SmoothKernel();
+      split.in = new int[SIZE];
+      split.out = new int[SIZE];
+      split.size = SIZE;
+      Util.fill(split.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = (index * 7) % 101;
+         }
+      });
+
+      final SmoothKernel unsplit = new SmoothKernel();
+      unsplit.in = split.in.clone();
+      unsplit.out = new int[SIZE];
+      unsplit.size = SIZE;
+      unsplit.setExecutionMode(Kernel.EXECUTION_MODE.JTP);
+
+      final Range range = cpuDevice.createRange(SIZE, 64);
+      split.execute(range, PASSES);
+      unsplit.execute(Range.create(SIZE, 64), PASSES);
+
+      assertTrue("split out == unsplit out", Util.same(split.out, unsplit.out));
+
+      // again, now the node placed buffers are reused
+      Util.zero(split.out);
+      split.execute(range, PASSES);
+      assertTrue("split out == unsplit out on reuse", Util.same(split.out, unsplit.out));
+
+      split.dispose();
+      unsplit.dispose();
+   }
+
+   public static class GroupKernel extends Kernel{
+
+      int[] out;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = getGroupId() * 1000000 + getNumGroups() * 1000 + (getGlobalSize() - gid) % 1000;
+      }
+
+   }
+
+   @Test public void rangeBuiltinsSeeTheWholeRange() {
+
+      assumeTrue(cpuDevice != null);
+
+      final int SIZE = 64 * 37;
+
+      final GroupKernel kernel = new GroupKernel();
+      kernel.out = new int[SIZE];
+      kernel.execute(cpuDevice.createRange(SIZE, 64));
+
+      // a slice would see its own global size and group count, and group ids from 0
+      for (int i = 0; i < SIZE; i++) {
+         assertEquals("out[" + i + "]", (i / 64) * 1000000 + 37 * 1000 + (SIZE - i) % 1000, kernel.out[i]);
+      }
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,80 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+import java.io.ByteArrayInputStream;
+import java.io.StringWriter;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.List;
+
+import org.junit.Test;
+
+import com.amd.aparapi.internal.tool.ProfileTraceConverter;
+
+public class ProfileTraceConversion{
+
+   private static void putString(ByteBuffer buffer, int offset, String value) {
+      final byte[] bytes = value.getBytes();
+      for (int i = 0; i < bytes.length; i++) {
+         buffer.put(offset + i, bytes[i]);
+      }
+   }
+
+   private static void putRecord(ByteBuffer buffer, long queue, long start, long end, int type, int pass, String name,
+         int sampleInterval) {
+      final int base = buffer.position();
+      buffer.putLong(0x1000L);
+      buffer.putLong(queue);
+      buffer.putLong(3L);
+      buffer.putLong(start - 500);
+      buffer.putLong(start - 100);
+      buffer.putLong(start);
+      buffer.putLong(end);
+      buffer.putInt(type);
+      buffer.putInt(pass);
+      putString(buffer, base + 64, name);
+      putString(buffer, base + 128, "com.example.SquareKernel");
+      buffer.putInt(base + 248, sampleInterval);
+      buffer.position(base + 256);
+   }
+
+   @Test public void convertsRecordsOfEitherByteOrder() throws Exception {
+      for (final ByteOrder order : new ByteOrder[] {
+            ByteOrder.LITTLE_ENDIAN,
+            ByteOrder.BIG_ENDIAN
+      }) {
+         final ByteBuffer buffer = ByteBuffer.allocate(16 + 4 * 256 + 10).order(order);
+         buffer.put("APARPROF".getBytes());
+         buffer.putInt(0x01020304);
+         buffer.putInt(256);
+         putRecord(buffer, 0xa0L, 1000, 3000, ProfileTraceConverter.WRITE, 0, "values", 4);
+         putRecord(buffer, 0xa0L, 4000, 9000, ProfileTraceConverter.EXECUTE, 1, "", 4);
+         putRecord(buffer, 0xb0L, 10000, 12500, ProfileTraceConverter.READ, 0, "values", 4);
+         putRecord(buffer, 0L, 1000, 3300, ProfileTraceConverter.HOST, 0, "args", 0);
+
+         // trailing partial record is ignored
+         final List<ProfileTraceConverter.Event> events = ProfileTraceConverter.read(new ByteArrayInputStream(buffer.array()));
+         assertEquals(4, events.size());
+         assertEquals("values", events.get(0).name);
+         assertEquals("com.example.SquareKernel", events.get(1).kernel);
+         assertEquals(1, events.get(1).pass);
+         assertEquals(12500L, events.get(2).end);
+         assertEquals(4, events.get(2).sampleInterval);
+         // records written before sampling carry no interval
+         assertEquals(1, events.get(3).sampleInterval);
+
+         final StringWriter json = new StringWriter();
+         ProfileTraceConverter.writeTrace(events, json);
+         final String trace = json.toString();
+         assertTrue(trace, trace.contains("\"name\":\"write values\",\"cat\":\"write\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":0.500,\"dur\":2.000"));
+         assertTrue(trace, trace.contains("\"name\":\"SquareKernel pass 1\",\"cat\":\"execute\""));
+         assertTrue(trace, trace.contains("\"sampleInterval\":4}"));
+         assertTrue(trace, trace.contains("\"name\":\"read values\",\"cat\":\"read\",\"ph\":\"X\",\"pid\":1,\"tid\":2"));
+         assertTrue(trace, trace.contains("\"args\":{\"name\":\"queue 0xb0\"}"));
+         assertTrue(trace, trace.contains("\"name\":\"args\",\"cat\":\"host\",\"ph\":\"X\",\"pid\":1,\"tid\":3,\"ts\":0.500,\"dur\":2.300"));
+         assertTrue(trace, trace.contains("\"args\":{\"name\":\"host 0x1000\"}"));
+      }
+   }
+}
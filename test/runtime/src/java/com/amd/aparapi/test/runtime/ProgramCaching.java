@@ -0,0 +1,173 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStreamReader;
+import java.io.RandomAccessFile;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+import com.amd.aparapi.internal.opencl.OpenCLLoader;
+import com.amd.aparapi.internal.opencl.ProgramCacheStatistics;
+
+public class ProgramCaching{
+
+   static final String CACHE_DIR = "com.amd.aparapi.programCacheDir";
+
+   static final int SIZE = 1024;
+
+   static{
+      // each test class runs in its own vm, so this is set before the config is read
+      if (System.getProperty(CACHE_DIR) == null) {
+         System.setProperty(CACHE_DIR, new File(System.getProperty("java.io.tmpdir"), "aparapi-programs-" + System.nanoTime())
+               .getPath());
+      }
+   }
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class SquareKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = gid * gid;
+      }
+
+   }
+
+   static void runSquares(Device device) {
+      final SquareKernel kernel = new SquareKernel();
+      kernel.values = new int[SIZE];
+      kernel.execute(device.createRange(SIZE));
+      for (int i = 0; i < SIZE; i++) {
+         assertEquals("values[" + i + "]", i * i, kernel.values[i]);
+      }
+      assertTrue("ran on OpenCL", kernel.getExecutionMode().isOpenCL());
+      kernel.dispose();
+   }
+
+   /**
+    * runs the kernel in a new vm sharing the cache directory
+    * 
+    * @return {hits, misses, stores} of that vm
+    */
+   static long[] runInNewVM(File dir) throws IOException, InterruptedException {
+      final ProcessBuilder builder = new ProcessBuilder(new File(System.getProperty("java.home"), "bin/java").getPath(), "-cp",
+            System.getProperty("java.class.path"), "-Djava.library.path=" + System.getProperty("java.library.path"), "-D"
+                  + CACHE_DIR + "=" + dir.getPath(), ProgramCaching.class.getName());
+      builder.redirectErrorStream(true);
+      final Process process = builder.start();
+      final StringBuilder output = new StringBuilder();
+      long[] counters = null;
+      final BufferedReader reader = new BufferedReader(new InputStreamReader(process.getInputStream()));
+      for (String line = reader.readLine(); line != null; line = reader.readLine()) {
+         output.append(line).append('\n');
+         if (line.startsWith("counters ")) {
+            final String[] fields = line.split(" ");
+            counters = new long[] {
+                  Long.parseLong(fields[1]),
+                  Long.parseLong(fields[2]),
+                  Long.parseLong(fields[3])
+            };
+         }
+      }
+      reader.close();
+      assertEquals(output.toString(), 0, process.waitFor());
+      if (counters == null) {
+         fail(output.toString());
+      }
+      return (counters);
+   }
+
+   static File[] entries(File dir) {
+      final File[] entries = dir.listFiles();
+      assertTrue("entries in " + dir, entries != null && entries.length > 0);
+      return (entries);
+   }
+
+   @Test public void missHitAndRebuild() throws Exception {
+
+      final File dir = new File(System.getProperty(CACHE_DIR));
+
+      // first use builds from source and stores the binary
+      final ProgramCacheStatistics before = OpenCLLoader.getProgramCacheStatistics();
+      runSquares(openCLDevice);
+      final ProgramCacheStatistics after = OpenCLLoader.getProgramCacheStatistics();
+      assertTrue(after.toString(), after.getMisses() > before.getMisses());
+      assertTrue(after.toString(), after.getStores() > before.getStores());
+      assertEquals(after.toString(), before.getHits(), after.getHits());
+
+      // a new vm loads it
+      long[] counters = runInNewVM(dir);
+      assertTrue("hits " + counters[0], counters[0] > 0);
+      assertEquals("misses", 0, counters[1]);
+
+      // an entry holding another program's key (a hash collision or an older driver) is rebuilt and replaced
+      for (final File entry : entries(dir)) {
+         final RandomAccessFile file = new RandomAccessFile(entry, "rw");
+         try {
+            // the first byte of the stored key, after the magic and the key length
+            file.seek(16);
+            final int b = file.read();
+            file.seek(16);
+            file.write(b ^ 0x5a);
+         } finally {
+            file.close();
+         }
+      }
+      counters = runInNewVM(dir);
+      assertEquals("hits", 0, counters[0]);
+      assertTrue("misses " + counters[1], counters[1] > 0);
+      assertTrue("stores " + counters[2], counters[2] > 0);
+      assertTrue("hits once replaced", runInNewVM(dir)[0] > 0);
+
+      // as is a truncated entry
+      for (final File entry : entries(dir)) {
+         final RandomAccessFile file = new RandomAccessFile(entry, "rw");
+         try {
+            file.setLength(file.length() / 2);
+         } finally {
+            file.close();
+         }
+      }
+      counters = runInNewVM(dir);
+      assertEquals("hits", 0, counters[0]);
+      assertTrue("stores " + counters[2], counters[2] > 0);
+      assertTrue("hits once replaced", runInNewVM(dir)[0] > 0);
+
+      for (final File entry : entries(dir)) {
+         entry.delete();
+      }
+      dir.delete();
+   }
+
+   /**
+    * runs the kernel once in a vm started by missHitAndRebuild and prints the cache counters
+    */
+   public static void main(String[] _args) {
+      runSquares(Device.best());
+      final ProgramCacheStatistics statistics = OpenCLLoader.getProgramCacheStatistics();
+      System.out.println("counters " + statistics.getHits() + " " + statistics.getMisses() + " " + statistics.getStores());
+   }
+
+}
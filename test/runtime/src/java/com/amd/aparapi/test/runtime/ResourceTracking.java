@@ -0,0 +1,54 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class ResourceTracking{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class SquareKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = values[gid] * values[gid];
+      }
+
+   }
+
+   @Test public void reportCoversEveryTrackedKind() {
+
+      final SquareKernel kernel = new SquareKernel();
+      final Range range = openCLDevice.createRange(256);
+      kernel.values = new int[256];
+      kernel.execute(range);
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+
+      final String report = kernel.getOpenCLResourceReport();
+      assertTrue(report, report.contains("cl_mem"));
+      assertTrue(report, report.contains("cl_command_queue"));
+      assertTrue(report, report.contains("cl_event (read)"));
+
+      kernel.dispose();
+   }
+
+}
@@ -0,0 +1,85 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+import com.amd.aparapi.internal.opencl.DeviceRegistryStatistics;
+import com.amd.aparapi.internal.opencl.OpenCLLoader;
+
+public class SharedDeviceObjects{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class AddKernel extends Kernel{
+
+      int[] values;
+
+      int add;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = gid + add;
+      }
+
+   }
+
+   static AddKernel run(Range range, int add) {
+      final AddKernel kernel = new AddKernel();
+      kernel.values = new int[range.getGlobalSize(0)];
+      kernel.add = add;
+      kernel.execute(range);
+      assertTrue("ran on OpenCL", kernel.getExecutionMode().isOpenCL());
+      for (int i = 0; i < kernel.values.length; i++) {
+         assertEquals("values[" + i + "]", i + add, kernel.values[i]);
+      }
+      return (kernel);
+   }
+
+   @Test public void kernelsOnOneDeviceShareContextAndProgram() {
+
+      final Range range = openCLDevice.createRange(1024);
+      final DeviceRegistryStatistics before = OpenCLLoader.getDeviceRegistryStatistics();
+      assertEquals(before.toString(), 0, before.getLiveContexts());
+
+      final AddKernel first = run(range, 1);
+      final AddKernel second = run(range, 2);
+      DeviceRegistryStatistics now = OpenCLLoader.getDeviceRegistryStatistics();
+      assertEquals(now.toString(), 1, now.getLiveContexts());
+      assertEquals(now.toString(), before.getContextsCreated() + 1, now.getContextsCreated());
+      assertEquals(now.toString(), before.getProgramsCreated() + 1, now.getProgramsCreated());
+
+      // the context (and with it the cached program) goes with its last kernel
+      first.dispose();
+      now = OpenCLLoader.getDeviceRegistryStatistics();
+      assertEquals(now.toString(), 1, now.getLiveContexts());
+      second.dispose();
+      now = OpenCLLoader.getDeviceRegistryStatistics();
+      assertEquals(now.toString(), 0, now.getLiveContexts());
+      assertEquals(now.toString(), 0, now.getCachedPrograms());
+
+      // a new context builds its own program rather than reusing one built in the released context
+      final AddKernel third = run(range, 3);
+      now = OpenCLLoader.getDeviceRegistryStatistics();
+      assertEquals(now.toString(), before.getContextsCreated() + 2, now.getContextsCreated());
+      assertEquals(now.toString(), before.getProgramsCreated() + 2, now.getProgramsCreated());
+      third.dispose();
+   }
+
+}
@@ -0,0 +1,76 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Config;
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.TransferCounters;
+import com.amd.aparapi.TransferCounters.COUNTER;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class TransferAccounting{
+
+   static OpenCLDevice openCLDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.best();
+      if (device == null || !(device instanceof OpenCLDevice)) {
+         fail("no opencl device!");
+      }
+      openCLDevice = (OpenCLDevice) device;
+   }
+
+   public static class SquareKernel extends Kernel{
+
+      int[] values;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         values[gid] = values[gid] * values[gid];
+      }
+
+   }
+
+   @Test public void countsBuffersAndBytesOfEachRun() {
+
+      final SquareKernel kernel = new SquareKernel();
+      final Range range = openCLDevice.createRange(256);
+      kernel.values = new int[256];
+      kernel.execute(range);
+      assertTrue("still running on OpenCL", kernel.getExecutionMode().isOpenCL());
+
+      final TransferCounters first = kernel.getTransferCounters();
+      assertTrue(first.toString(), first.get(COUNTER.BUFFERS_CREATED) >= 1);
+      assertEquals(first.toString(), 256 * 4, first.get(COUNTER.BYTES_UPLOADED));
+      assertEquals(first.toString(), 256 * 4, first.get(COUNTER.BYTES_DOWNLOADED));
+      assertTrue(first.toString(), first.get(COUNTER.IMPLICIT_TRANSFERS) >= 2);
+      assertEquals(first.toString(), 0, first.get(COUNTER.EXPLICIT_TRANSFERS));
+
+      // a new array needs a new buffer
+      kernel.values = new int[256];
+      kernel.execute(range);
+      final TransferCounters second = kernel.getTransferCounters().since(first);
+      assertTrue(second.toString(), second.get(COUNTER.REALLOC_NEW_ARRAY) >= 1);
+      assertTrue(second.toString(), second.get(COUNTER.BUFFERS_RELEASED) >= 1);
+      assertEquals(second.toString(), 256 * 4, second.get(COUNTER.BYTES_UPLOADED));
+
+      final String log = kernel.getTransferLog();
+      if (Config.enableTransferLog) {
+         assertTrue(log, log.contains("values: create buffer"));
+         assertTrue(log, log.contains("values: download"));
+      } else {
+         assertEquals("", log);
+      }
+
+      kernel.dispose();
+   }
+
+}
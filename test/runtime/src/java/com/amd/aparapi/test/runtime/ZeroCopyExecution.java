@@ -0,0 +1,82 @@
+package com.amd.aparapi.test.runtime;
+
+import static org.junit.Assert.fail;
+import static org.junit.Assume.assumeTrue;
+
+import org.junit.BeforeClass;
+import org.junit.Test;
+
+import com.amd.aparapi.Kernel;
+import com.amd.aparapi.Range;
+import com.amd.aparapi.device.Device;
+import com.amd.aparapi.device.OpenCLDevice;
+
+public class ZeroCopyExecution{
+
+   static{
+      // each test class runs in its own vm, so this is set before the config is read
+      System.setProperty("com.amd.aparapi.enableZeroCopyCPU", "true");
+   }
+
+   static OpenCLDevice cpuDevice = null;
+
+   @BeforeClass public static void setUpBeforeClass() throws Exception {
+
+      Device device = Device.firstCPU();
+      if (device instanceof OpenCLDevice) {
+         cpuDevice = (OpenCLDevice) device;
+      }
+   }
+
+   public static class AddKernel extends Kernel{
+
+      int[] in;
+
+      int[] out;
+
+      int add;
+
+      @Override public void run() {
+         int gid = getGlobalId();
+         out[gid] = in[gid] + add;
+      }
+
+   }
+
+   @Test public void mappedTransfersMatchExpected() {
+
+      // only CPU devices use zero copy buffers
+      assumeTrue(cpuDevice != null);
+
+      final int SIZE = 1024 * 4;
+      final AddKernel kernel = new AddKernel();
+      final Range range = cpuDevice.createRange(SIZE);
+
+      kernel.in = new int[SIZE];
+      kernel.out = new int[SIZE];
+      kernel.add = 5;
+      Util.fill(kernel.in, new Util.Filler(){
+         public void fill(int[] array, int index) {
+            array[index] = index;
+         }
+      });
+
+      // every upload maps the buffer for writing, each run must see the array as it is now
+      for (int run = 0; run < 3; run++) {
+         kernel.execute(range);
+         for (int i = 0; i < SIZE; i++) {
+            if (kernel.out[i] != kernel.in[i] + kernel.add) {
+               fail("run " + run + " out[" + i + "] != in[" + i + "] + add");
+            }
+         }
+         Util.apply(kernel.in, kernel.in, new Util.Operator(){
+            public void apply(int[] lhs, int[] rhs, int index) {
+               lhs[index] = rhs[index] * 3 + 1;
+            }
+         });
+      }
+
+      kernel.dispose();
+   }
+
+}